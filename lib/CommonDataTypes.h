@@ -5,6 +5,18 @@
 #ifndef WATERUP_PLANTPOT_COMMONDATATYPES_H
 #define WATERUP_PLANTPOT_COMMONDATATYPES_H
 
+#define RESERVOIR_CALIBRATION_POINTS 4 // The maximum amount of reservoir calibration points.
+
+#ifndef POT_CHANNEL_COUNT
+#define POT_CHANNEL_COUNT 1 // The amount of pots driven by this board, set by the build flags of an rack.
+#endif
+
+#define POT_MAX_CHANNELS 8 // The maximum amount of pots, one 3 bit multiplexer.
+
+#if POT_CHANNEL_COUNT < 1 || POT_CHANNEL_COUNT > POT_MAX_CHANNELS
+#error "POT_CHANNEL_COUNT has to be between 1 and POT_MAX_CHANNELS."
+#endif
+
 /**
  * Data structure that contains LED configuration.
  */
@@ -37,5 +49,58 @@ struct PlantCareSettings
     uint8_t containsPlant;
 };
 
+/**
+ * Data structure that contains the bounds of the adaptive measurement interval.
+ */
+struct CadenceSettings
+{
+    uint32_t measurementFloor;
+    uint32_t measurementCeiling;
+};
+
+/**
+ * Data structure that contains the encoding of the statistic and warning messages and how
+ * many statistics are published in one message.
+ */
+struct TelemetrySettings
+{
+    uint8_t encoding;
+    uint8_t batchSize;
+    uint32_t batchLatency;
+};
+
+/**
+ * Data structure that contains the watering settings of an pot, the response gain of every
+ * channel is learned from the moisture rise after its doses.
+ */
+struct WateringSettings
+{
+    uint8_t mode;
+    uint16_t responseGain[POT_CHANNEL_COUNT];
+    uint16_t learnedDoses[POT_CHANNEL_COUNT];
+};
+
+/**
+ * Data structure that contains the water reservoir calibration of an pot. Every point is
+ * an echo time measured at an known fill level, ordered by echo time.
+ */
+struct ReservoirCalibration
+{
+    uint8_t pointCount;
+    uint16_t echoTimes[RESERVOIR_CALIBRATION_POINTS];
+    uint16_t fillLevels[RESERVOIR_CALIBRATION_POINTS];
+};
+
+/**
+ * Data structure that contains an reservoir calibration point send by the backend, the fill
+ * level is measured by hand while the pot reports the echo time.
+ */
+struct ReservoirCalibrationPoint
+{
+    uint16_t echoTime;
+    uint16_t fillLevel;
+    uint8_t clear;
+};
+
 
 #endif //WATERUP_PLANTPOT_COMMONDATATYPES_H
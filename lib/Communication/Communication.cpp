@@ -6,23 +6,23 @@
 #include "Communication.h"
 
 /**
- * The json string C-style formatted that will be filled with data and send to the mqtt broker.
+ * The mac address of the plant pot. It is set to an default but will be overwritten by setup(),
+ * it is formatted once so publishing an message doesn't build an new String every time.
  */
-const char *potStatisticJsonFormat = "{\"mac\":\"%s\",\"type\":\"potstats-mesg\",\"counter\":%d,\"moisture\":%lu,\"waterLevel\":%d}";
+char potMacAddress[MAC_ADDRESS_LENGTH] = "5C:CF:7F:19:9C:39"; // The mac addess of the plant pot.
 
-/**
- * The json string C-style formatted that will be filled with data and send to the mqtt broker.
- */
-const char *potWarningJsonFormat = "{\"mac\":\"%s\",\"type\":\"warning-mesg\",\"counter\":%d,\"warning\":\"%lu\"}";
+uint8_t potMacBytes[TELEMETRY_MAC_SIZE] = { 0x5C, 0xCF, 0x7F, 0x19, 0x9C, 0x39 }; // The mac address as bytes for the binary messages.
 
-/**
- * The mac address of the plant pot. It is set to an default but will be overwritten after the
- * constructor is called.
- */
-String potMacAddress = "5C:CF:7F:19:9C:39"; // The mac addess of the plant pot.
+char potDeviceId[DEVICE_ID_LENGTH] = "5CCF7F199C39"; // The device id in the configuration topics, the mac address without colons.
+char configTopic[DEVICE_TOPIC_LENGTH]; // The wildcard topic of all configuration of this pot, built by setup().
+char configTopicPrefix[DEVICE_TOPIC_LENGTH]; // The configuration topic without the wildcard, the routes are looked up after it.
 
 char jsonMessageSendBuffer[JSON_BUFFER_SIZE]; // The buffer that will be filled with data to send to the MQTT broker.
-char jsonMessageReceiveBuffer[JSON_BUFFER_SIZE]; // The buffer that will be filled with data received fro the MQTT broker.
+MessageWriter jsonMessageWriter( jsonMessageSendBuffer, JSON_BUFFER_SIZE ); // The writer that fills the send buffer with an json message.
+char batchMessageSendBuffer[BATCH_BUFFER_SIZE]; // The buffer that will be filled with an batch of statistics to send to the MQTT broker.
+MessageWriter batchMessageWriter( batchMessageSendBuffer, BATCH_BUFFER_SIZE ); // The writer that fills the batch buffer with an json message.
+uint8_t binaryMessageSendBuffer[TELEMETRY_MAX_MESSAGE_SIZE]; // The buffer that will be filled with an binary message to send to the MQTT broker.
+char messageReceiveBuffer[RECEIVE_BUFFER_SIZE]; // The buffer that will be filled with data received from the MQTT broker.
 
 uint32_t potStatisticCounter = 0; // An statistic message publication counter.
 uint32_t potWarningCounter = 0; // An warning message publication counter.
@@ -35,9 +35,17 @@ uint32_t potWarningCounter = 0; // An warning message publication counter.
 WiFiClientSecure client;
 
 /**
- * Setup the MQTT client for communicating to the MQTT broker.
+ * The TLS session of the last connection to the broker. The client saves the session after every
+ * handshake and offers it on the next connection, so an reconnect only has to prove that both
+ * sides still know the secret instead of doing the RSA key exchange again.
  */
-Adafruit_MQTT_Client mqtt( &client, MQTT_BROKER_HOST, MQTT_BROKER_PORT, MQTT_BROKER_USERNAME, MQTT_BROKER_PASSWORD );
+BearSSL::Session tlsSession;
+
+/**
+ * Setup the MQTT client for communicating to the MQTT broker. It receives the configuration
+ * messages in the receive buffer and passes them to the handler of their topic.
+ */
+PotMqttClient mqtt( &client, MQTT_BROKER_HOST, MQTT_BROKER_PORT, MQTT_BROKER_USERNAME, MQTT_BROKER_PASSWORD, messageReceiveBuffer, RECEIVE_BUFFER_SIZE );
 
 /**
  * Create the required publish clients that will be used to send messages to the mqtt broker
@@ -47,22 +55,37 @@ Adafruit_MQTT_Publish statisticPublisher = Adafruit_MQTT_Publish( &mqtt, MQTT_BR
 Adafruit_MQTT_Publish warningPublisher = Adafruit_MQTT_Publish( &mqtt, MQTT_BROKER_USERNAME TOPIC_PUBLISH_WARNING );
 
 /**
- * Create the required subscribe clients that listen for incoming configuration messages send by the
- * mqtt broker.
+ * Create the subscription to the configuration messages send by the mqtt broker. It only makes
+ * the client subscribe to the wildcard topic when it connects, the messages are passed to the
+ * handlers in CONFIG_ROUTES. The subscriber keeps an pointer to the topic, the topic is filled in
+ * by setup() before the pot subscribes.
  */
-Adafruit_MQTT_Subscribe ledConfigListener = Adafruit_MQTT_Subscribe( &mqtt,  MQTT_BROKER_USERNAME TOPIC_SUBSCRIBE_LED_CONFIG );
-Adafruit_MQTT_Subscribe mqttConfigListener = Adafruit_MQTT_Subscribe( &mqtt, MQTT_BROKER_USERNAME TOPIC_SUBSCRIBE_MQTT_CONFIG );
-Adafruit_MQTT_Subscribe plantCareConfigListener = Adafruit_MQTT_Subscribe( &mqtt, MQTT_BROKER_USERNAME TOPIC_SUBSCRIBE_PLANT_CARE_CONFIG );
+Adafruit_MQTT_Subscribe configListener = Adafruit_MQTT_Subscribe( &mqtt, configTopic );
 
 Configuration *Communication::potConfig = nullptr; // Initiate the static config variable with null.
 
+/**
+ * The handlers of the kinds of configuration, the topics are searched binary so the rows have to
+ * stay sorted by topic. An new kind of configuration only needs an row here.
+ */
+const PotMqttRoute Communication::CONFIG_ROUTES[] = {
+        { TOPIC_CONFIG_LED, &Communication::listenForLedConfiguration },
+        { TOPIC_CONFIG_MQTT, &Communication::listenForMqttConfiguration },
+        { TOPIC_CONFIG_PLANT_CARE, &Communication::listenForPlantCareConfiguration },
+        { TOPIC_CONFIG_RESERVOIR_CALIBRATION, &Communication::listenForReservoirCalibration },
+        { TOPIC_CONFIG_WARNING, &Communication::listenForWarningConfiguration }
+};
+
 /**
  * The constructor will initiate the communication library with some default
  * values and will save an reference to the configuration library.
  * @param potConfiguration  An pointer to the configuration library.
  */
-Communication::Communication( Configuration *potConfiguration )
+Communication::Communication( Configuration *potConfiguration ) :
+        reconnectBackoff( RECONNECT_INITIAL_DELAY, RECONNECT_MAXIMUM_DELAY, ESP.getChipId())
 {
+    this->connectionState = CONNECTION_NO_WIFI; // Until connect() finds the wifi network.
+    this->tlsBuffers = POT_TLS_FRAGMENT_LENGTH > 0 ? TLS_BUFFERS_UNKNOWN : TLS_BUFFERS_FULL;
     potConfiguration->setup();
     delay( 1000 );
     Communication::potConfig = potConfiguration;
@@ -71,7 +94,10 @@ Communication::Communication( Configuration *potConfiguration )
 /**
  * This function initiates the communication settings. It will try to connect to the last
  * configured wifi network it it fails it will create an access point hosts an configuration
- * website where an user can connect to and set the wifi configuration.
+ * website where an user can connect to and set the wifi configuration. Without an user the
+ * access point closes after WIFI_CONFIG_PORTAL_TIMEOUT seconds and the pot continues without
+ * wifi, so plant care runs while the router is down. The chip keeps connecting to the stored
+ * network in the background and connect() waits for it.
  */
 void Communication::setup()
 {
@@ -84,61 +110,175 @@ void Communication::setup()
 #endif
 
     WiFiManager wifiManager;
-    wifiManager.autoConnect();
-
-    while ( WiFi.waitForConnectResult() != WL_CONNECTED )
+    wifiManager.setConfigPortalTimeout( WIFI_CONFIG_PORTAL_TIMEOUT );
+    if ( !wifiManager.autoConnect())
     {
-        delay( 500 );
-        Serial << F( "." );
+        POT_ERROR_PRINTLN( F( "[error] - Unable to connect to the wifi network, continuing without it." ))
     }
 
-    POT_DEBUG_PRINTLN(
-            F( "[info] - Successfully connected to the wifi network.\n" ) NEW_LINE
-            F( "[debug] - IP address assigned from the router: " ) APPEND WiFi.localIP() NEW_LINE
-            F( "[info] - Successfully connected to the wifi network.\n" ) NEW_LINE
-            F( "[debug] - Plant pot mac address: " ) APPEND WiFi.macAddress())
+    strncpy( potMacAddress, WiFi.macAddress().c_str(), MAC_ADDRESS_LENGTH - 1 ); // The mac address of the chip is known without an network.
+    TelemetryCodec::parseMacAddress( potMacAddress, potMacBytes );
+    this->buildDeviceTopics();
+
+    POT_DEBUG_PRINTLN( F( "[debug] - Plant pot mac address: " ) APPEND potMacAddress )
+
+    client.setFingerprint( MQTT_BROKER_FINGERPRINT ); // The certificate is checked during the handshake of the mqtt connection.
+    client.setSession( &tlsSession ); // Resume the TLS session of the previous connection.
 
-    verifyFingerprint(); // Check SHA1 fingerprint of the MQTT broker.
-    potMacAddress = WiFi.macAddress();
+    WiFi.setSleepMode( WIFI_LIGHT_SLEEP ); // Allow the chip to sleep while the scheduler waits for the next task.
+    configTime( 0, 0, NTP_SERVER ); // Set the clock so logged statistics can be replayed with their measurement time.
     this->listenForConfiguration();
 }
 
 /**
- * This function checks if there already is an mqtt connection if not it will attempt to open one. If
- * it fails to manny times it will kill its self so the user has to reset the plant pot.
+ * This function checks if there already is an mqtt connection if not it will attempt to open one.
+ * Only one attempt is made per call and only when the backoff delay after the last failed attempt
+ * passed, so the scheduler keeps running the plant care and led tasks while the broker is down.
+ * The SHA1 fingerprint of the broker certificate is checked during the TLS handshake of the mqtt
+ * connection itself, we use the fingerprint instead of the complete certificate because of the
+ * memory limitations of the ESP8266. An broker that isn't trusted is retried with the same backoff
+ * as an broker that can't be reached, the pot never connects to an broker it doesn't trust.
+ * The TLS buffers are allocated by the handshake, so the free heap is reported before and after.
+ * Without wifi there is no attempt, the chip reconnects to the wifi network in the background.
  */
 void Communication::connect()
 {
-    int8_t ret;
-    uint8_t maxRetries = 50;
+    if ( WiFi.status() != WL_CONNECTED )
+    {
+        if ( this->connectionState != CONNECTION_NO_WIFI )
+        {
+            POT_ERROR_PRINTLN( F( "[error] - Not connected to the wifi network, waiting for it." ))
+            this->connectionState = CONNECTION_NO_WIFI;
+        }
+        return;
+    }
+
+    if ( this->connectionState == CONNECTION_NO_WIFI )
+    {
+        POT_DEBUG_PRINTLN(
+                F( "[info] - Successfully connected to the wifi network.\n" ) NEW_LINE
+                F( "[debug] - IP address assigned from the router: " ) APPEND WiFi.localIP())
+        this->connectionState = mqtt.connected() ? CONNECTION_CONNECTED : CONNECTION_WAITING; // An short drop of the wifi can leave the broker connection open.
+    }
 
     if ( mqtt.connected())
     {
         return;
     }
 
-    Serial << F( "[info] - Attempting to connect to the MQTT broker." ) << endl;
+    if ( this->connectionState == CONNECTION_CONNECTED ) // Did we lose the connection since the last check?
+    {
+        POT_ERROR_PRINTLN( F( "[error] - Lost the connection to the MQTT broker." ))
+        this->connectionState = CONNECTION_WAITING;
+    }
 
-    while (( ret = mqtt.connect()) != 0 )
-    { // connect will return 0 for connected
-        POT_ERROR_PRINTLN( F( "[error] - Connecting to the MQTT broker failed because: " ) APPEND mqtt.connectErrorString( ret )) // Print an detailed error message.
-        POT_DEBUG_PRINTLN( F( "[info] - Retrying to connect to the MQTT broker in 5 seconds..." ))
+    if ( !this->reconnectBackoff.isAttemptDue( (uint32_t) millis()))
+    {
+        return;
+    }
 
-        mqtt.disconnect(); // Send disconnect package.
-        delay( 2000 );  // wait 5 seconds
-        maxRetries--;
+    Serial << F( "[info] - Attempting to connect to the MQTT broker." ) << endl;
 
-        if ( maxRetries == 0 )
+    this->prepareTlsBuffers();
+#ifdef POT_DEBUG
+    uint32_t freeHeap = ESP.getFreeHeap();
+#endif
+
+    int8_t ret = mqtt.connect(); // connect will return 0 for connected
+    if ( ret != 0 )
+    {
+        int tlsError = client.getLastSSLError();
+        if ( tlsError == BR_ERR_X509_NOT_TRUSTED )
         {
-            POT_ERROR_PRINTLN( F( "[error] - Connecting to the MQTT broker failed it seems the broker is unavailable." ))
-            POT_DEBUG_PRINTLN( F( "[info] - Halting the execution of the program." ))
-            while ( 1 ) // You shall not pass! Seriously this effectively kills the pot and you have to reset it or wait to the death of the universe.
-            {
-            }
+            POT_ERROR_PRINTLN( F("[error] - Connecting to the MQTT broker failed because the TLS/SSL certificate could not be verified." ))
+            POT_DEBUG_PRINTLN( F( "[debug] - TLS/SSL SHA1 certificate fingerprint allowed: " ) APPEND MQTT_BROKER_FINGERPRINT )
+            this->connectionState = CONNECTION_UNTRUSTED;
         }
+        else if ( tlsError == BR_ERR_TOO_LARGE && this->tlsBuffers == TLS_BUFFERS_LEAN )
+        {
+            POT_ERROR_PRINTLN( F( "[error] - The MQTT broker sent an TLS record larger than the fragment length it agreed to, switching to the full TLS buffers." ))
+            client.setBufferSizes( TLS_FULL_RECEIVE_BUFFER_SIZE, TLS_FULL_TRANSMIT_BUFFER_SIZE );
+            this->tlsBuffers = TLS_BUFFERS_FULL;
+            this->connectionState = CONNECTION_WAITING;
+        }
+        else
+        {
+            POT_ERROR_PRINTLN( F( "[error] - Connecting to the MQTT broker failed because: " ) APPEND mqtt.connectErrorString( ret )) // Print an detailed error message.
+            this->connectionState = CONNECTION_WAITING;
+        }
+        mqtt.disconnect(); // Send disconnect package.
+
+        this->reconnectBackoff.recordFailure( (uint32_t) millis());
+        POT_DEBUG_PRINTLN( F( "[info] - Retrying to connect to the MQTT broker in " ) APPEND this->reconnectBackoff.getStatistics()->lastDelay APPEND F( " milliseconds." ))
+        return;
+    }
+
+    if ( this->tlsBuffers == TLS_BUFFERS_UNKNOWN ) // The probe failed but the broker was reached, so it refused the fragment length.
+    {
+        POT_DEBUG_PRINTLN( F( "[info] - The MQTT broker refused an fragment length of " ) APPEND POT_TLS_FRAGMENT_LENGTH APPEND F( " bytes, using the full TLS buffers." ))
+        this->tlsBuffers = TLS_BUFFERS_FULL;
+    }
+
+    this->reconnectBackoff.recordSuccess();
+    this->connectionState = CONNECTION_CONNECTED;
+    POT_DEBUG_PRINTLN(
+            F("[info] - Successfully connected to the MQTT broker." ) NEW_LINE
+            F( "[debug] - Free heap before connecting: " ) APPEND freeHeap APPEND F( " bytes, while connected: " ) APPEND ESP.getFreeHeap() APPEND F( " bytes." ))
+}
+
+/**
+ * Ask the broker if it sends TLS records of at most POT_TLS_FRAGMENT_LENGTH bytes and size the
+ * TLS buffers to the answer. The probe only exchanges the hello messages, so it is much cheaper
+ * than an handshake. The full buffers are kept when the probe fails, an broker that can't be
+ * reached is asked again before the next attempt and an broker that is reached refused.
+ */
+void Communication::prepareTlsBuffers()
+{
+#if POT_TLS_FRAGMENT_LENGTH > 0
+    if ( this->tlsBuffers != TLS_BUFFERS_UNKNOWN )
+    {
+        return;
+    }
+
+    if ( WiFiClientSecure::probeMaxFragmentLength( MQTT_BROKER_HOST, MQTT_BROKER_PORT, POT_TLS_FRAGMENT_LENGTH ))
+    {
+        POT_DEBUG_PRINTLN( F( "[info] - The MQTT broker agreed to an fragment length of " ) APPEND POT_TLS_FRAGMENT_LENGTH APPEND F( " bytes, using the lean TLS buffers." ))
+        client.setBufferSizes( POT_TLS_FRAGMENT_LENGTH, TLS_LEAN_TRANSMIT_BUFFER_SIZE );
+        this->tlsBuffers = TLS_BUFFERS_LEAN;
+        return;
     }
+    client.setBufferSizes( TLS_FULL_RECEIVE_BUFFER_SIZE, TLS_FULL_TRANSMIT_BUFFER_SIZE );
+#endif
+}
+
+/**
+ * This function returns the state of the connection to the broker.
+ *
+ * @return uint8_t - CONNECTION_CONNECTED, CONNECTION_WAITING or CONNECTION_UNTRUSTED.
+ */
+uint8_t Communication::getConnectionState()
+{
+    return this->connectionState;
+}
 
-    POT_DEBUG_PRINTLN( F("[info] - Successfully connected to the MQTT broker." ))
+/**
+ * This function returns the counters of the connection attempts.
+ *
+ * @return ReconnectStatistics* - An pointer to the counters.
+ */
+ReconnectStatistics* Communication::getReconnectStatistics()
+{
+    return this->reconnectBackoff.getStatistics();
+}
+
+/**
+ * This function returns the size of the TLS buffers the connection to the broker uses.
+ *
+ * @return uint8_t - TLS_BUFFERS_UNKNOWN, TLS_BUFFERS_LEAN or TLS_BUFFERS_FULL.
+ */
+uint8_t Communication::getTlsBuffers()
+{
+    return this->tlsBuffers;
 }
 
 /**
@@ -154,174 +294,536 @@ Configuration *Communication::getConfiguration()
 
 /**
  * This function will publish statistics about the pot's current state to the
- * mqtt broker. It will fill json send buffer with the the C-style formatted
- * json whrere the placeholders are replaced with the correct data and pass the
- * buffer to the mqtt publisher.
+ * mqtt broker. It will write the json message field by field into the send buffer
+ * and pass the buffer to the mqtt publisher. The channel tells the backend which pot
+ * of an rack the statistic belongs to, an single pot always uses channel 0. An pot
+ * with an flow meter also reports the total volume of water it gave. When the backend
+ * configured the binary encoding the same fields are packed instead.
  *
+ * @param channel               The channel of the pot.
  * @param groundMoistureLevel   The current percentage of moisture in the ground.
  * @param waterReservoirLevel   The current percentage of water left in the reservoir.
+ * @param hoursLeft             The forecasted hours until the reservoir is empty, -1 if unknown.
+ * @param measurementInterval   The current interval in milliseconds between two measurements.
+ * @param dispensedVolume       The total volume in millilitres the flow meter measured, only published with an flow meter.
+ * @return bool - True if the message was published to the broker.
  */
-void Communication::publishStatistic( int groundMoistureLevel, int waterReservoirLevel )
+bool Communication::publishStatistic( uint8_t channel, int groundMoistureLevel, int waterReservoirLevel, int hoursLeft, uint32_t measurementInterval, uint32_t dispensedVolume )
 {
-    snprintf( jsonMessageSendBuffer, JSON_BUFFER_SIZE, potStatisticJsonFormat, WiFi.macAddress().c_str(), potStatisticCounter++, groundMoistureLevel, waterReservoirLevel );
-    if ( !statisticPublisher.publish( jsonMessageSendBuffer )) // Did we publish the message to the broker?
+    if ( this->isBinaryEncoding())
+    {
+        TelemetryMessage message = TelemetryMessage();
+        message.type = TELEMETRY_TYPE_STATISTIC;
+        message.counter = potStatisticCounter++;
+        message.channel = channel;
+        message.moisture = (int16_t) groundMoistureLevel;
+        message.waterLevel = (int16_t) waterReservoirLevel;
+        message.hoursLeft = (int16_t) hoursLeft;
+        message.interval = measurementInterval;
+#ifdef POT_FLOW_METER
+        message.flags = TELEMETRY_FLAG_DISPENSED;
+        message.dispensed = dispensedVolume;
+#endif
+        return this->publishBinary( &statisticPublisher, message );
+    }
+
+    jsonMessageWriter.begin();
+    jsonMessageWriter.addText( PSTR( "mac" ), potMacAddress );
+    jsonMessageWriter.addFlashText( PSTR( "type" ), PSTR( "potstats-mesg" ));
+    jsonMessageWriter.addUnsigned( PSTR( "counter" ), potStatisticCounter++ );
+    jsonMessageWriter.addUnsigned( PSTR( "channel" ), channel );
+    jsonMessageWriter.addSigned( PSTR( "moisture" ), groundMoistureLevel );
+    jsonMessageWriter.addSigned( PSTR( "waterLevel" ), waterReservoirLevel );
+    jsonMessageWriter.addSigned( PSTR( "hoursLeft" ), hoursLeft );
+    jsonMessageWriter.addUnsigned( PSTR( "interval" ), measurementInterval );
+#ifdef POT_FLOW_METER
+    jsonMessageWriter.addUnsigned( PSTR( "dispensed" ), dispensedVolume );
+#else
+    (void) dispensedVolume; // Only published with an flow meter.
+#endif
+    if ( !jsonMessageWriter.end() || !statisticPublisher.publish( jsonMessageSendBuffer )) // Did we publish the message to the broker?
     {
         POT_ERROR_PRINTLN( F( "[error] - Unable to send message: " ) APPEND jsonMessageSendBuffer )
+        return false;
     }
-    else
+
+    POT_DEBUG_PRINTLN(
+            F( "[debug] - Message with id: " ) APPEND potStatisticCounter APPEND F( " content: " ) APPEND jsonMessageSendBuffer NEW_LINE
+            F( "[info] - Successfully published message to the MQTT broker." ) NEW_LINE
+            F( "[debug] - Publish topic: " ) APPEND MQTT_BROKER_USERNAME APPEND TOPIC_PUBLISH_STATISTIC )
+    return true;
+}
+
+/**
+ * This function will publish an statistic that was measured earlier to the mqtt broker. The
+ * message contains the time of the measurement so the backend can put it in the right place.
+ *
+ * @param channel               The channel of the pot.
+ * @param groundMoistureLevel   The percentage of moisture in the ground.
+ * @param waterReservoirLevel   The percentage of water left in the reservoir.
+ * @param measuredAt            The unix time in seconds of the measurement, 0 if unknown.
+ * @return bool - True if the message was published to the broker.
+ */
+bool Communication::publishLoggedStatistic( uint8_t channel, int groundMoistureLevel, int waterReservoirLevel, uint32_t measuredAt )
+{
+    if ( this->isBinaryEncoding())
     {
-        POT_DEBUG_PRINTLN(
-                F( "[debug] - Message with id: " ) APPEND potStatisticCounter APPEND F( " content: " ) APPEND jsonMessageSendBuffer NEW_LINE
-                F( "[info] - Successfully published message to the MQTT broker." ) NEW_LINE
-                F( "[debug] - Publish topic: " ) APPEND MQTT_BROKER_USERNAME APPEND TOPIC_PUBLISH_STATISTIC )
+        TelemetryMessage message = TelemetryMessage();
+        message.type = TELEMETRY_TYPE_STATISTIC;
+        message.flags = TELEMETRY_FLAG_TIME;
+        message.counter = potStatisticCounter++;
+        message.channel = channel;
+        message.moisture = (int16_t) groundMoistureLevel;
+        message.waterLevel = (int16_t) waterReservoirLevel;
+        message.hoursLeft = -1;
+        message.time = measuredAt;
+        return this->publishBinary( &statisticPublisher, message );
     }
+
+    jsonMessageWriter.begin();
+    jsonMessageWriter.addText( PSTR( "mac" ), potMacAddress );
+    jsonMessageWriter.addFlashText( PSTR( "type" ), PSTR( "potstats-mesg" ));
+    jsonMessageWriter.addUnsigned( PSTR( "counter" ), potStatisticCounter++ );
+    jsonMessageWriter.addUnsigned( PSTR( "channel" ), channel );
+    jsonMessageWriter.addSigned( PSTR( "moisture" ), groundMoistureLevel );
+    jsonMessageWriter.addSigned( PSTR( "waterLevel" ), waterReservoirLevel );
+    jsonMessageWriter.addUnsigned( PSTR( "time" ), measuredAt );
+    if ( !jsonMessageWriter.end() || !statisticPublisher.publish( jsonMessageSendBuffer )) // Did we publish the message to the broker?
+    {
+        POT_ERROR_PRINTLN( F( "[error] - Unable to send message: " ) APPEND jsonMessageSendBuffer )
+        return false;
+    }
+    return true;
+}
+
+/**
+ * This function will publish an batch of statistics as one message to the mqtt broker. The
+ * json message contains an array with an array of the time, channel, moisture and water
+ * level for every statistic, an pot with an flow meter adds the dispensed volume. The whole
+ * batch uses one message counter.
+ *
+ * @param samples               The statistics with their measurement time.
+ * @param count                 The amount of statistics, at most TELEMETRY_MAX_BATCH_SIZE.
+ * @param hoursLeft             The forecasted hours until the reservoir is empty, -1 if unknown.
+ * @param measurementInterval   The current interval in milliseconds between two measurements.
+ * @return bool - True if the message was published to the broker.
+ */
+bool Communication::publishStatisticBatch( const TelemetrySample *samples, uint8_t count, int hoursLeft, uint32_t measurementInterval )
+{
+    if ( this->isBinaryEncoding())
+    {
+        TelemetryMessage message = TelemetryMessage();
+        message.type = TELEMETRY_TYPE_BATCH;
+        message.counter = potStatisticCounter++;
+        message.hoursLeft = (int16_t) hoursLeft;
+        message.interval = measurementInterval;
+#ifdef POT_FLOW_METER
+        message.flags = TELEMETRY_FLAG_DISPENSED;
+#endif
+        memcpy( message.mac, potMacBytes, TELEMETRY_MAC_SIZE );
+
+        uint16_t length = TelemetryCodec::encodeBatch( message, samples, count, (uint8_t*) batchMessageSendBuffer, BATCH_BUFFER_SIZE );
+        if ( length == 0 || !statisticPublisher.publish( (uint8_t*) batchMessageSendBuffer, length )) // Did we publish the message to the broker?
+        {
+            POT_ERROR_PRINTLN( F( "[error] - Unable to send binary batch with counter: " ) APPEND message.counter )
+            return false;
+        }
+        return true;
+    }
+
+    batchMessageWriter.begin();
+    batchMessageWriter.addText( PSTR( "mac" ), potMacAddress );
+    batchMessageWriter.addFlashText( PSTR( "type" ), PSTR( "potstats-batch" ));
+    batchMessageWriter.addUnsigned( PSTR( "counter" ), potStatisticCounter++ );
+    batchMessageWriter.addSigned( PSTR( "hoursLeft" ), hoursLeft );
+    batchMessageWriter.addUnsigned( PSTR( "interval" ), measurementInterval );
+    batchMessageWriter.beginArray( PSTR( "samples" ));
+    for ( uint8_t i = 0; i < count; i++ )
+    {
+        batchMessageWriter.beginArray();
+        batchMessageWriter.addUnsignedElement( samples[i].time );
+        batchMessageWriter.addUnsignedElement( samples[i].channel );
+        batchMessageWriter.addSignedElement( samples[i].moisture );
+        batchMessageWriter.addSignedElement( samples[i].waterLevel );
+#ifdef POT_FLOW_METER
+        batchMessageWriter.addUnsignedElement( samples[i].dispensed );
+#endif
+        batchMessageWriter.endArray();
+    }
+    batchMessageWriter.endArray();
+    if ( !batchMessageWriter.end() || !statisticPublisher.publish( batchMessageSendBuffer )) // Did we publish the message to the broker?
+    {
+        POT_ERROR_PRINTLN( F( "[error] - Unable to send batch of statistics: " ) APPEND count )
+        return false;
+    }
+
+    POT_DEBUG_PRINTLN(
+            F( "[debug] - Batch with id: " ) APPEND potStatisticCounter APPEND F( " statistics: " ) APPEND count NEW_LINE
+            F( "[info] - Successfully published message to the MQTT broker." ))
+    return true;
+}
+
+/**
+ * This function checks if there is an connection to the mqtt broker.
+ *
+ * @return bool - True if the pot is connected to the broker.
+ */
+bool Communication::isConnected()
+{
+    return mqtt.connected();
+}
+
+/**
+ * This function returns the current unix time. The clock counts from 1970 until the time
+ * server answered, so times before CLOCK_VALID_AFTER mean the clock isn't set yet.
+ *
+ * @return uint32_t - The unix time in seconds, 0 if the clock isn't set yet.
+ */
+uint32_t Communication::getTime()
+{
+    time_t now = time( nullptr );
+    return now < CLOCK_VALID_AFTER ? 0 : (uint32_t) now;
 }
 
 /**
  * This function will publish warnings about the reservoir water level to the mqtt
- * broker. It will fill json send buffer with the the C-style formatted
- * json whrere the placeholders are replaced with the correct data and pass the
- * buffer to the mqtt publisher.
+ * broker. It will write the json message field by field into the send buffer and
+ * pass the buffer to the warning publisher. The backend reads the warning as text.
  *
  * @param warningType   The type of warning to be send.
+ * @param channel       The channel the warning belongs to, TELEMETRY_CHANNEL_BOARD for the whole pot.
+ * @return bool - True if the message was published to the broker.
  */
-void Communication::publishWarning( uint8_t warningType )
+bool Communication::publishWarning( uint8_t warningType, uint8_t channel )
 {
-    snprintf( jsonMessageSendBuffer, JSON_BUFFER_SIZE, potWarningJsonFormat, WiFi.macAddress().c_str(), potWarningCounter++, warningType );
-    if ( !statisticPublisher.publish( jsonMessageSendBuffer )) // Did we publish the message to the broker?
+    if ( this->isBinaryEncoding())
+    {
+        TelemetryMessage message = TelemetryMessage();
+        message.type = TELEMETRY_TYPE_WARNING;
+        message.counter = potWarningCounter++;
+        message.warning = warningType;
+        message.channel = channel;
+        return this->publishBinary( &warningPublisher, message );
+    }
+
+    jsonMessageWriter.begin();
+    jsonMessageWriter.addText( PSTR( "mac" ), potMacAddress );
+    jsonMessageWriter.addFlashText( PSTR( "type" ), PSTR( "warning-mesg" ));
+    jsonMessageWriter.addUnsigned( PSTR( "counter" ), potWarningCounter++ );
+    jsonMessageWriter.addUnsigned( PSTR( "channel" ), channel );
+    jsonMessageWriter.addUnsigned( PSTR( "warning" ), warningType, true );
+    if ( !jsonMessageWriter.end() || !warningPublisher.publish( jsonMessageSendBuffer )) // Did we publish the message to the broker?
     {
         POT_ERROR_PRINTLN( F( "[error] - Unable to send message: " ) APPEND jsonMessageSendBuffer )
+        return false;
     }
-    else
+
+    POT_DEBUG_PRINTLN(
+            F( "[debug] - Message with id: " ) APPEND potWarningCounter APPEND F( " content: " ) APPEND jsonMessageSendBuffer NEW_LINE
+            F( "[info] - Successfully published message to the MQTT broker." ))
+    return true;
+}
+
+/**
+ * This function checks if the backend asked for binary statistic and warning messages.
+ *
+ * @return bool - True if the messages should be published binary, false for json.
+ */
+bool Communication::isBinaryEncoding()
+{
+    return Communication::potConfig->getTelemetrySettings()->encoding == TELEMETRY_ENCODING_BINARY;
+}
+
+/**
+ * This function will pack an message into the binary send buffer and pass it to an
+ * publisher. The message is about an sixth of the json message, so the radio is on for
+ * less time and the backend pays for less traffic.
+ *
+ * @param publisher The publisher of the topic.
+ * @param message   The fields of the message, the mac address is filled in.
+ * @return bool - True if the message was published to the broker.
+ */
+bool Communication::publishBinary( Adafruit_MQTT_Publish *publisher, TelemetryMessage &message )
+{
+    memcpy( message.mac, potMacBytes, TELEMETRY_MAC_SIZE );
+
+    uint8_t length = TelemetryCodec::encode( message, binaryMessageSendBuffer, TELEMETRY_MAX_MESSAGE_SIZE );
+    if ( length == 0 || !publisher->publish( binaryMessageSendBuffer, length )) // Did we publish the message to the broker?
     {
-        POT_DEBUG_PRINTLN(
-                F( "[debug] - Message with id: " ) APPEND potStatisticCounter APPEND F( " content: " ) APPEND jsonMessageSendBuffer NEW_LINE
-                F( "[info] - Successfully published message to the MQTT broker." ))
+        POT_ERROR_PRINTLN( F( "[error] - Unable to send binary message with counter: " ) APPEND message.counter )
+        return false;
     }
+
+    POT_DEBUG_PRINTLN(
+            F( "[debug] - Binary message with id: " ) APPEND message.counter APPEND F( " length: " ) APPEND length NEW_LINE
+            F( "[info] - Successfully published message to the MQTT broker." ))
+    return true;
+}
+
+/**
+ * This function returns the amount of statistic messages published.
+ *
+ * @return uint32_t - The statistic message counter.
+ */
+uint32_t Communication::getStatisticCounter()
+{
+    return potStatisticCounter;
+}
+
+/**
+ * This function returns the amount of warning messages published.
+ *
+ * @return uint32_t - The warning message counter.
+ */
+uint32_t Communication::getWarningCounter()
+{
+    return potWarningCounter;
+}
+
+/**
+ * This function will restore the message counters, like after waking up from deep
+ * sleep when the counters were kept in RTC memory.
+ *
+ * @param statisticCounter  The statistic message counter.
+ * @param warningCounter    The warning message counter.
+ */
+void Communication::restoreCounters( uint32_t statisticCounter, uint32_t warningCounter )
+{
+    potStatisticCounter = statisticCounter;
+    potWarningCounter = warningCounter;
 }
 
 /**
  * This function will start listening for configuration send by the mqtt broker. It will register
- * the callback functions to the mqtt listeners so when an message is received it knows what function
- * to execute.
+ * the routing table at the mqtt client so when an message is received it knows what function
+ * to execute. The topic contains the device id, so the pot only receives its own configuration.
  */
 void Communication::listenForConfiguration()
 {
     POT_DEBUG_PRINTLN(
             F("[debug] - Start listening to configuration messages") NEW_LINE
-            F("[debug] - Listening on:") APPEND MQTT_BROKER_USERNAME APPEND TOPIC_SUBSCRIBE_PLANT_CARE_CONFIG)
-
-    ledConfigListener.setCallback( &Communication::listenForLedConfiguration );
-    mqttConfigListener.setCallback( &Communication::listenForMqttConfiguration );
-    plantCareConfigListener.setCallback( &Communication::listenForPlantCareConfiguration );
+            F("[debug] - Listening on: ") APPEND configTopic)
 
-    mqtt.subscribe( &ledConfigListener );
-    mqtt.subscribe( &mqttConfigListener );
-    mqtt.subscribe( &plantCareConfigListener );
+    mqtt.setRoutes( configTopicPrefix, Communication::CONFIG_ROUTES, sizeof( Communication::CONFIG_ROUTES ) / sizeof( Communication::CONFIG_ROUTES[0] ));
+    mqtt.subscribe( &configListener );
 }
 
 /**
- * This function will attempt to verify the TLS/SSL certificate send from the MQTT broker by its SHA1 fingerprint.
- * We use the SHA1 fingerprints instead of the complete certificates because of the memory limitations
- * of the arduino/huzzah. It will get the SHA1 send by the mqtt broker and compare it with the fingerprint hard
- * coded in the code stored on the plant pot.
+ * Build the configuration topic of this pot. The device id is the mac address in hexadecimal
+ * without the colons, colons would make the topics harder to type in an MQTT client. The topic
+ * is built once so the broker filters the configuration of the other pots out.
  */
-void Communication::verifyFingerprint()
+void Communication::buildDeviceTopics()
 {
-    POT_DEBUG_PRINTLN( F( "[info] - Attempting to open an secure connection to the MQTT broker at:" ) APPEND MQTT_BROKER_HOST)
+    static const char hexDigits[] = "0123456789ABCDEF";
 
-    if ( !client.connect( MQTT_BROKER_HOST, MQTT_BROKER_PORT ))
+    for ( uint8_t i = 0; i < TELEMETRY_MAC_SIZE; i++ )
     {
-        POT_ERROR_PRINTLN( F( "[error] - Connecting to the MQTT broker failed because we can't reach it." ))
-        POT_DEBUG_PRINTLN( F( "[info] - Halting the execution of the program." ))
-        while ( 1 ) // You shall not pass! Seriously this effectively kills the pot and you have to reset it or wait to the death of the universe.
-        {
-        }
+        potDeviceId[i * 2] = hexDigits[potMacBytes[i] >> 4];
+        potDeviceId[i * 2 + 1] = hexDigits[potMacBytes[i] & 0x0F];
     }
+    potDeviceId[TELEMETRY_MAC_SIZE * 2] = '\0';
 
-    if ( client.verify( MQTT_BROKER_FINGERPRINT, MQTT_BROKER_HOST ))
-    {
-        POT_DEBUG_PRINTLN( "[info] - Successfully verified the integrity of the TLS/SSL certificate send by the broker." )
-    }
-    else
-    {
-        POT_ERROR_PRINTLN( F("[error] - Connecting to the MQTT broker failed because the TLS/SSL certificate could not be verified." ))
-        POT_DEBUG_PRINTLN(
-                F( "[debug] - TLS/SSL SHA1 certificate fingerprint allowed: " ) APPEND MQTT_BROKER_FINGERPRINT NEW_LINE
-                F( "[info] - Halting the execution of the program." ))
-        while ( 1 ) // You shall not pass! Seriously this effectively kills the pot and you have to reset it or wait to the death of the universe.
-        {
-        }
-    }
+    Communication::buildDeviceTopic( configTopicPrefix, TOPIC_SUBSCRIBE_CONFIG );
+    Communication::buildDeviceTopic( configTopic, TOPIC_SUBSCRIBE_CONFIG TOPIC_CONFIG_WILDCARD );
 }
 
-void Communication::listen()
+/**
+ * Build an topic like inf1i-plantpot/5CCF7F199C39/subscribe/config/+. The longest topic is
+ * 47 bytes, so it always fits in DEVICE_TOPIC_LENGTH.
+ *
+ * @param topic     The buffer of DEVICE_TOPIC_LENGTH bytes for the topic.
+ * @param suffix    The part of the topic after the device id.
+ */
+void Communication::buildDeviceTopic( char *topic, const char *suffix )
 {
-    mqtt.processPackets(10);
+    strcpy( topic, MQTT_BROKER_USERNAME "/" );
+    strcat( topic, potDeviceId );
+    strcat( topic, suffix );
 }
 
-void Communication::parseJsonData( char *messageData, uint16_t dataLength, uint8_t receivedOnListener )
+/**
+ * This function will process incoming messages from the mqtt broker and execute the
+ * handlers of the topics that received an message.
+ */
+void Communication::listen()
 {
-    const size_t bufferSize = JSON_OBJECT_SIZE(4) + 80;
-    DynamicJsonBuffer jsonBuffer(bufferSize);
-    JsonObject& root = jsonBuffer.parseObject(messageData);
-
-    POT_ERROR_PRINTLN( F( "[debug] - Received data from the mqtt broker:" ) APPEND messageData )
-    POT_ERROR_PRINTLN( F( "[debug] - Received data length" ) APPEND messageData )
+    mqtt.processMessages(10);
+}
 
-    if ( not root.success())
+/**
+ * This function will ping the mqtt broker to keep the connection alive. When the broker
+ * doesn't respond the connection gets closed so the next connect() reopens it.
+ */
+void Communication::ping()
+{
+    if( mqtt.connected() && !mqtt.ping() )
     {
-        POT_ERROR_PRINTLN( F( "[error] - Error receiving json data the json data send by the broker is invalid" ))
-        return;
+        POT_ERROR_PRINTLN( F( "[error] - The MQTT broker did not respond to our ping, closing the connection." ))
+        mqtt.disconnect();
     }
+}
 
-    if ( root["mac"] == false )
+/**
+ * Copy the TLS session of the last connection to the broker. The session only holds the session
+ * id, the protocol version, the cipher suite and the master secret, so an plain copy can be
+ * restored after deep sleep. An pot that never connected copies an empty session.
+ *
+ * @param data  The memory to copy the session to.
+ * @param size  The size of the memory in bytes.
+ * @return bool - False when the session doesn't fit.
+ */
+bool Communication::storeSession( uint8_t *data, size_t size )
+{
+    if ( size < sizeof( tlsSession ))
     {
-        POT_ERROR_PRINTLN( F("[error] - Error receiving json data the mac and type nodes are missing." ))
-        return;
+        POT_ERROR_PRINTLN( F( "[error] - The TLS session doesn't fit in: " ) APPEND size APPEND F( " bytes." ))
+        return false;
     }
+    memcpy( data, &tlsSession, sizeof( tlsSession ));
+    return true;
+}
 
-    String messageMacAddress = root[ "mac" ];
-
-    if ( not messageMacAddress.equals( WiFi.macAddress()))
+/**
+ * Restore an TLS session that was stored earlier. An empty session makes the next connection
+ * do an full handshake, just like an broker that forgot the session.
+ *
+ * @param data  The memory the session was copied to.
+ * @param size  The size of the memory in bytes.
+ * @return bool - False when the memory doesn't hold an session.
+ */
+bool Communication::restoreSession( const uint8_t *data, size_t size )
+{
+    if ( size < sizeof( tlsSession ))
     {
-        POT_DEBUG_PRINTLN( F( "[debug] - The message received is not for us." ))
-        return;
+        return false;
     }
+    memcpy( &tlsSession, data, sizeof( tlsSession ));
+    return true;
+}
+
+/**
+ * This will decode the incoming json data and update the stored configuration. The message is
+ * decoded into an copy of the current settings, so an message without the optional fields keeps
+ * them and an rejected message doesn't change anything.
+ *
+ * @param messageData           String containing json data.
+ * @param dataLength            The length of the json string.
+ * @param receivedOnListener    The type of listener that received the message.
+ */
+void Communication::parseJsonData( char *messageData, uint16_t dataLength, uint8_t receivedOnListener )
+{
+    POT_DEBUG_PRINTLN( F( "[debug] - Received data from the mqtt broker:" ) APPEND messageData )
 
     switch ( receivedOnListener )
     {
         case LED_LISTENER:
+        {
             POT_DEBUG_PRINTLN( F( "[debug] - Parsing json led configuration message." ))
 
-            Communication::potConfig->setLedSettings(
-                    ( uint8_t ) root[ "red" ], // The new red led luminosity
-                    ( uint8_t ) root[ "green" ], // The new green led luminosity
-                    ( uint8_t ) root[ "blue" ] // The new blue led luminosity
-            );
+            LedConfigMessage message;
+            message.led = *Communication::potConfig->getLedSettings();
+            if ( Communication::decodeConfiguration( LED_CONFIG_SCHEMA, messageData, dataLength, &message ))
+            {
+                Communication::potConfig->setLedSettings( message.led.red, message.led.green, message.led.blue );
+            }
             break;
+        }
 
         case MQTT_LISTENER:
-            POT_ERROR_PRINTLN( F( "[debug] - Parsing json mqtt configuration message." ))
+        {
+            POT_DEBUG_PRINTLN( F( "[debug] - Parsing json mqtt configuration message." ))
+
+            MqttConfigMessage message;
+            TelemetrySettings *telemetry = Communication::potConfig->getTelemetrySettings();
+            message.mqtt = *Communication::potConfig->getMqttSettings();
+            message.telemetry = *telemetry;
+            if ( !Communication::decodeConfiguration( MQTT_CONFIG_SCHEMA, messageData, dataLength, &message ))
+            {
+                break;
+            }
 
             Communication::potConfig->setMQTTSettings(
-                    ( uint32_t ) root[ "stat-interval" ], // The new MQTT statistic publish interval
-                    ( uint32_t ) root[ "resend-interval" ], // The new MQTT resend warning interval
-                    ( uint32_t ) root[ "ping-interval" ], // The new MQTT ping interval
-                    ( uint8_t ) root[ "publish-threshold" ] // The new
+                    message.mqtt.statisticPublishInterval, // The new MQTT statistic publish interval
+                    message.mqtt.resendWarningInterval, // The new MQTT resend warning interval
+                    message.mqtt.pingBrokerInterval, // The new MQTT ping interval
+                    message.mqtt.publishReservoirWarningThreshold // The new reservoir level in percent that triggers the warning
             );
+
+            if ( message.telemetry.encoding != telemetry->encoding || message.telemetry.batchSize != telemetry->batchSize || message.telemetry.batchLatency != telemetry->batchLatency ) // The encoding and batching are optional, older backends only read single json statistics.
+            {
+                Communication::potConfig->setTelemetrySettings(
+                        message.telemetry.encoding, // The new message encoding
+                        message.telemetry.batchSize, // The new amount of statistics per message
+                        message.telemetry.batchLatency // The new longest time an statistic waits in an batch
+                );
+            }
             break;
+        }
 
         case PLANT_CARE_LISTENER:
-            POT_ERROR_PRINTLN( F( "[debug] - Parsing json plant care configuration message." ))
+        {
+            POT_DEBUG_PRINTLN( F( "[debug] - Parsing json plant care configuration message." ))
+
+            PlantCareConfigMessage message;
+            CadenceSettings *cadence = Communication::potConfig->getCadenceSettings();
+            message.plantCare = *Communication::potConfig->getPlantCareSettings();
+            message.cadence = *cadence;
+            if ( !Communication::decodeConfiguration( PLANT_CARE_CONFIG_SCHEMA, messageData, dataLength, &message ))
+            {
+                break;
+            }
 
             Communication::potConfig->setPlantCareSettings(
-                    ( uint8_t ) root["moisture-need"],
-                    ( uint32_t ) root["interval"],
-                    ( uint32_t ) 3600,
-                    ( uint8_t ) root["contains-plant"]
+                    message.plantCare.takeMeasurementInterval, // The new measurement interval
+                    message.plantCare.sleepAfterGivingWater, // The message doesn't contain the soak time, keep it
+                    message.plantCare.groundMoistureOptimal, // The new optimal ground moisture level
+                    message.plantCare.containsPlant // The new setting to enable or disable plant care
             );
+
+            if ( message.cadence.measurementFloor != cadence->measurementFloor || message.cadence.measurementCeiling != cadence->measurementCeiling ) // The interval bounds are optional.
+            {
+                Communication::potConfig->setCadenceSettings( message.cadence.measurementFloor, message.cadence.measurementCeiling );
+            }
             break;
+        }
+
+        case WARNING_LISTENER:
+        {
+            POT_DEBUG_PRINTLN( F( "[debug] - Parsing json warning configuration message." ))
+
+            WarningConfigMessage message;
+            message.mqtt = *Communication::potConfig->getMqttSettings();
+            if ( Communication::decodeConfiguration( WARNING_CONFIG_SCHEMA, messageData, dataLength, &message ))
+            {
+                Communication::potConfig->setMQTTSettings(
+                        message.mqtt.statisticPublishInterval, // Keep the statistic publish interval
+                        message.mqtt.resendWarningInterval, // Keep the resend warning interval
+                        message.mqtt.pingBrokerInterval, // Keep the ping interval
+                        message.mqtt.publishReservoirWarningThreshold // The new reservoir level in percent that triggers the warning
+                );
+            }
+            break;
+        }
+
+        case RESERVOIR_CALIBRATION_LISTENER:
+        {
+            POT_DEBUG_PRINTLN( F( "[debug] - Parsing json reservoir calibration message." ))
+
+            ReservoirCalibrationConfigMessage message;
+            message.point.clear = 0; // The other points are kept unless the message asks to clear them.
+            if ( !Communication::decodeConfiguration( RESERVOIR_CALIBRATION_CONFIG_SCHEMA, messageData, dataLength, &message ))
+            {
+                break;
+            }
+
+            if ( message.point.clear )
+            {
+                Communication::potConfig->clearReservoirCalibration();
+            }
+            Communication::potConfig->addReservoirCalibrationPoint( message.point.echoTime, message.point.fillLevel );
+            break;
+        }
 
         default:
             POT_ERROR_PRINTLN( F("[error] - Unknown configuration type." ))
@@ -329,6 +831,33 @@ void Communication::parseJsonData( char *messageData, uint16_t dataLength, uint8
     }
 }
 
+/**
+ * This will decode an configuration message with its schema and log why an message was rejected.
+ *
+ * @param schema    The schema of the message.
+ * @param data      The json message.
+ * @param length    The length of the json message.
+ * @param message   The decoded message, filled with the current settings.
+ * @return bool - True if the message is for this pot and all its fields are valid.
+ */
+bool Communication::decodeConfiguration( const ConfigSchema &schema, const char *data, uint16_t length, void *message )
+{
+    ConfigDecoder decoder( data, length );
+    uint8_t status = decoder.decode( schema, potMacAddress, message );
+
+    if ( status == CONFIG_DECODE_OTHER_POT )
+    {
+        POT_DEBUG_PRINTLN( F( "[debug] - The message received is not for us." ))
+        return false;
+    }
+    if ( status != CONFIG_DECODE_OK )
+    {
+        POT_ERROR_PRINTLN( F( "[error] - Rejected the configuration send by the broker, decoder status: " ) APPEND status )
+        return false;
+    }
+    return true;
+}
+
 /**
  * This function callback will be subscribed to the plant care configuration topic.
  * When new plant care configuration gets published on this topic it will update the
@@ -368,4 +897,28 @@ void Communication::listenForPlantCareConfiguration( char *data, uint16_t messag
     Communication::parseJsonData( data, messageLength, Communication::PLANT_CARE_LISTENER );
 }
 
+/**
+  * This function callback will be routed to the warning configuration topic.
+  * When new warning configuration gets published on this topic it will update the
+  * pot configuration.
+  *
+  * @param data      An json string containing warning configuration.
+  * @param length    The length of the json string.
+  */
+void Communication::listenForWarningConfiguration( char *data, uint16_t messageLength )
+{
+    Communication::parseJsonData( data, messageLength, Communication::WARNING_LISTENER );
+}
 
+/**
+  * This function callback will be routed to the reservoir calibration topic.
+  * When an new calibration point gets published on this topic it will be added to the
+  * pot configuration, the reservoir model uses it from the next water level measurement.
+  *
+  * @param data      An json string containing an reservoir calibration point.
+  * @param length    The length of the json string.
+  */
+void Communication::listenForReservoirCalibration( char *data, uint16_t messageLength )
+{
+    Communication::parseJsonData( data, messageLength, Communication::RESERVOIR_CALIBRATION_LISTENER );
+}
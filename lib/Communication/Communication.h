@@ -7,7 +7,6 @@
  * This library handles the communication between the plant pot and MQTT broker.
  *
  * TODOS:
- * todo: Remove multiple subscribers to an single subscriber.
  * todo: Alter subscribe json message to include an type so we know what config to save.
  */
 #ifndef WATERUP_PLANTPOT_COMMUNICATION_H
@@ -21,8 +20,13 @@
 #include <WiFiManager.h> // Include this library for dynamically setting up the WiFi connection.
 #include <Adafruit_MQTT.h> // Include this library for securely connecting to the internet using WiFi.
 #include <Adafruit_MQTT_Client.h> // Include this library for MQTT communication.
-#include <ArduinoJson.h> // Include this library for parsing incomming json mesages.
+#include <ConfigDecoder.h> // This library contains the code for decoding the incomming json messages.
+#include <ConfigSchemas.h> // This header contains the generated schemas of the configuration messages.
 #include <Configuration.h> // This library contains the code for loading plant pot configuration.
+#include <MessageWriter.h> // This library contains the code for writing the published json messages.
+#include <TelemetryCodec.h> // This library contains the code for packing the published binary messages.
+#include <ReconnectBackoff.h> // This library contains the code for spreading the reconnect attempts.
+#include <PotMqttClient.h> // This library contains the code for dispatching the configuration messages.
 
 #define MQTT_BROKER_HOST "mqtt.inf1i.ga" // The address of the MQTT broker.
 #define MQTT_BROKER_PORT 8883 // The port to connect to at the MQTT broker.
@@ -35,15 +39,44 @@
 #define TOPIC_PUBLISH_STATISTIC "/publish/statistic" // This MQTT topic is used to publish pot state statistics.
 #define TOPIC_PUBLISH_WARNING "/publish/warning" // This is the MQTT topic used to publis warnings to the user.
 
-#define TOPIC_SUBSCRIBE_LED_CONFIG "/subscribe/config/led" // This is the MQTT topic used to listen for led configuration.
-#define TOPIC_SUBSCRIBE_MQTT_CONFIG "/subscribe/config/mqtt" // This is the MQTT topic used to listen for mqtt configuration.
-#define TOPIC_SUBSCRIBE_PLANT_CARE_CONFIG "/subscribe/config/plant-care" // This is the MQTT topic used to listen for plant care configuration.
+#define TOPIC_SUBSCRIBE_CONFIG "/subscribe/config/" // This is the MQTT topic used to listen for configuration, followed by the kind of configuration.
+#define TOPIC_CONFIG_WILDCARD "+" // The wildcard that subscribes to every kind of configuration.
+#define TOPIC_CONFIG_LED "led" // The kind of configuration of the leds.
+#define TOPIC_CONFIG_MQTT "mqtt" // The kind of configuration of the mqtt messages.
+#define TOPIC_CONFIG_PLANT_CARE "plant-care" // The kind of configuration of the plant care.
+#define TOPIC_CONFIG_RESERVOIR_CALIBRATION "reservoir-calibration" // The kind of configuration of the reservoir calibration points.
+#define TOPIC_CONFIG_WARNING "warning" // The kind of configuration of the warnings.
 #define SUBSCRIBE_QOS_LEVEL 0
+#define NTP_SERVER "pool.ntp.org" // The time server used to set the clock of the pot.
+#define CLOCK_VALID_AFTER 1500000000 // The clock counts from 1970 until the time server answered, times before this are invalid.
+#define RECONNECT_INITIAL_DELAY 1000 // The delay in milliseconds after the first failed connection attempt.
+#define RECONNECT_MAXIMUM_DELAY 300000 // The longest delay in milliseconds between two connection attempts.
+#define WIFI_CONFIG_PORTAL_TIMEOUT 180 // The time in seconds the access point for the wifi settings stays open before the pot continues offline.
 
-//inf1i-plantpot/subscribe/config/led
-//inf1i-plantpot/subscribe/config/mqtt
-//inf1i-plantpot/subscribe/config/plant-care
+#ifndef POT_TLS_FRAGMENT_LENGTH
+#define POT_TLS_FRAGMENT_LENGTH 512 // The max fragment length the pot negotiates with the broker, 0 keeps the full TLS buffers. Set by the build flags.
+#endif
+
+#if POT_TLS_FRAGMENT_LENGTH != 0 && POT_TLS_FRAGMENT_LENGTH != 512 && POT_TLS_FRAGMENT_LENGTH != 1024 && POT_TLS_FRAGMENT_LENGTH != 2048 && POT_TLS_FRAGMENT_LENGTH != 4096
+#error "POT_TLS_FRAGMENT_LENGTH has to be 0, 512, 1024, 2048 or 4096."
+#endif
+
+#define TLS_FULL_RECEIVE_BUFFER_SIZE 16384 // The receive buffer in bytes for the largest TLS record, used when the broker refuses an smaller fragment length.
+#define TLS_FULL_TRANSMIT_BUFFER_SIZE 512 // The transmit buffer in bytes the ESP8266 core uses by default.
+#define TLS_LEAN_TRANSMIT_BUFFER_SIZE 256 // The transmit buffer in bytes in the lean TLS mode, an statistic fits in one record and an batch is split.
+
+// The configuration topics contain the device id, so the broker only sends the pot its own configuration:
+//inf1i-plantpot/5CCF7F199C39/subscribe/config/+
+//inf1i-plantpot/5CCF7F199C39/subscribe/config/led
+//inf1i-plantpot/5CCF7F199C39/subscribe/config/mqtt
+//inf1i-plantpot/5CCF7F199C39/subscribe/config/plant-care
+//inf1i-plantpot/5CCF7F199C39/subscribe/config/reservoir-calibration
+//inf1i-plantpot/5CCF7F199C39/subscribe/config/warning
+#define DEVICE_ID_LENGTH 13 // The length of the device id, the mac address without colons like 5CCF7F199C39, including the terminator.
+#define DEVICE_TOPIC_LENGTH 64 // The length of an topic that contains the device id, including the terminator.
 #define JSON_BUFFER_SIZE 200 // This holds the default string buffer size of json messages.
+#define RECEIVE_BUFFER_SIZE 256 // The size of the buffer for the topic and the json message of an received packet.
+#define BATCH_BUFFER_SIZE 512 // The size of the buffer for an batch of TELEMETRY_MAX_BATCH_SIZE statistics.
 
 class Communication; // Forward declare the communication library.
 class Configuration; //  Forward declare the configuration library.
@@ -57,6 +90,15 @@ public:
      */
     static Configuration *potConfig;
 
+    static const uint8_t CONNECTION_CONNECTED = 0; // The pot is connected to the broker.
+    static const uint8_t CONNECTION_WAITING = 1; // The pot waits for the next connection attempt.
+    static const uint8_t CONNECTION_UNTRUSTED = 2; // The broker didn't send the expected certificate, the pot keeps trying.
+    static const uint8_t CONNECTION_NO_WIFI = 3; // The pot isn't connected to the wifi network, the chip keeps trying in the background.
+
+    static const uint8_t TLS_BUFFERS_UNKNOWN = 0; // The broker wasn't asked for an smaller fragment length yet.
+    static const uint8_t TLS_BUFFERS_LEAN = 1; // The broker agreed to the smaller fragment length, the TLS buffers are small.
+    static const uint8_t TLS_BUFFERS_FULL = 2; // The broker refused or the lean TLS mode is disabled, the TLS buffers fit the largest record.
+
     /**
      * The constructor will initiate the communication library with some default
      * values and will save an reference to the configuration library.
@@ -68,16 +110,41 @@ public:
      * This function is used to initiate the Arduino/Huzzah board. It gets
      * executed whenever the board is first powered up or after an rest. It will
      * initiate the communication settings and launce a access point if the
-     * there are no valid wifi settings stored.
+     * there are no valid wifi settings stored. The access point closes after
+     * WIFI_CONFIG_PORTAL_TIMEOUT seconds, connect() waits for the wifi network.
      */
     void setup();
 
     /**
      * This function is used to check if there is an connection to the mqtt broker.
-     * If not it will attempt to pen one.
+     * If not it will attempt to open one when the pot is connected to the wifi network
+     * and the delay after the last failed attempt passed. It never blocks longer than
+     * one attempt, so plant care keeps running while the wifi network or the broker is
+     * unreachable.
      */
     void connect();
 
+    /**
+     * This function returns the state of the connection to the broker.
+     *
+     * @return uint8_t - CONNECTION_CONNECTED, CONNECTION_WAITING, CONNECTION_UNTRUSTED or CONNECTION_NO_WIFI.
+     */
+    uint8_t getConnectionState();
+
+    /**
+     * This function returns the counters of the connection attempts.
+     *
+     * @return ReconnectStatistics* - An pointer to the counters.
+     */
+    ReconnectStatistics* getReconnectStatistics();
+
+    /**
+     * This function returns the size of the TLS buffers the connection to the broker uses.
+     *
+     * @return uint8_t - TLS_BUFFERS_UNKNOWN, TLS_BUFFERS_LEAN or TLS_BUFFERS_FULL.
+     */
+    uint8_t getTlsBuffers();
+
     /**
      * This function will return the pointer to the configuration object that
      * contains communication and plant care settings.
@@ -90,47 +157,192 @@ public:
      * This function will publish statistics about the pot's current state to the
      * mqtt broker.
      *
+     * @param channel               The channel of the pot, 0 for an single pot.
      * @param groundMoistureLevel   The current percentage of moisture in the ground.
      * @param waterReservoirLevel   The current percentage of water left in the reservoir.
+     * @param hoursLeft             The forecasted hours until the reservoir is empty, -1 if unknown.
+     * @param measurementInterval   The current interval in milliseconds between two measurements.
+     * @param dispensedVolume       The total volume in millilitres the flow meter measured, only published with an flow meter.
+     * @return bool - True if the message was published to the broker.
+     */
+    bool publishStatistic( uint8_t channel, int groundMoistureLevel, int waterReservoirLevel, int hoursLeft = -1, uint32_t measurementInterval = 0, uint32_t dispensedVolume = 0 );
+
+    /**
+     * This function will publish an statistic that was measured earlier to the mqtt broker,
+     * like an statistic from the telemetry log that couldn't be published during an outage.
+     *
+     * @param channel               The channel of the pot, 0 for an single pot.
+     * @param groundMoistureLevel   The percentage of moisture in the ground.
+     * @param waterReservoirLevel   The percentage of water left in the reservoir.
+     * @param measuredAt            The unix time in seconds of the measurement, 0 if unknown.
+     * @return bool - True if the message was published to the broker.
+     */
+    bool publishLoggedStatistic( uint8_t channel, int groundMoistureLevel, int waterReservoirLevel, uint32_t measuredAt );
+
+    /**
+     * This function will publish an batch of statistics as one message to the mqtt broker,
+     * so the statistics share one MQTT packet and TLS record.
+     *
+     * @param samples               The statistics with their measurement time.
+     * @param count                 The amount of statistics, at most TELEMETRY_MAX_BATCH_SIZE.
+     * @param hoursLeft             The forecasted hours until the reservoir is empty, -1 if unknown.
+     * @param measurementInterval   The current interval in milliseconds between two measurements.
+     * @return bool - True if the message was published to the broker.
+     */
+    bool publishStatisticBatch( const TelemetrySample *samples, uint8_t count, int hoursLeft, uint32_t measurementInterval );
+
+    /**
+     * This function checks if there is an connection to the mqtt broker.
+     *
+     * @return bool - True if the pot is connected to the broker.
      */
-    void publishStatistic( int groundMoistureLevel, int waterReservoirLevel );
+    bool isConnected();
+
+    /**
+     * This function returns the current unix time, the clock is set by the time server.
+     *
+     * @return uint32_t - The unix time in seconds, 0 if the clock isn't set yet.
+     */
+    uint32_t getTime();
 
     /**
      * This function will publish warnings about the reservoir water level to the mqtt
      * broker. Like messages of an low water level or an empty reservoir.
      *
      * @param warningType   The type of warning to be send.
+     * @param channel       The channel the warning belongs to, TELEMETRY_CHANNEL_BOARD for the whole pot.
+     * @return bool - True if the message was published to the broker.
      */
-    void publishWarning( uint8_t warningType );
+    bool publishWarning( uint8_t warningType, uint8_t channel );
+
+    /**
+     * This function returns the amount of statistic messages published, it is used as
+     * message id by the backend.
+     *
+     * @return uint32_t - The statistic message counter.
+     */
+    uint32_t getStatisticCounter();
+
+    /**
+     * This function returns the amount of warning messages published, it is used as
+     * message id by the backend.
+     *
+     * @return uint32_t - The warning message counter.
+     */
+    uint32_t getWarningCounter();
+
+    /**
+     * This function will restore the message counters, like after waking up from deep
+     * sleep when the counters were kept in RTC memory.
+     *
+     * @param statisticCounter  The statistic message counter.
+     * @param warningCounter    The warning message counter.
+     */
+    void restoreCounters( uint32_t statisticCounter, uint32_t warningCounter );
 
     /**
      * This function will start listening for configuration send by the mqtt broker.
      */
     void listenForConfiguration();
 
+    /**
+     * This function will process incoming messages from the mqtt broker.
+     */
     void listen();
 
+    /**
+     * This function will ping the mqtt broker to keep the connection alive. When the
+     * broker doesn't respond the connection gets closed so the next connect() reopens it.
+     */
+    void ping();
+
+    /**
+     * This function will copy the TLS session of the last connection to the broker, so it can
+     * be kept in RTC memory while the pot sleeps.
+     *
+     * @param data  The memory to copy the session to.
+     * @param size  The size of the memory in bytes.
+     * @return bool - False when the session doesn't fit.
+     */
+    bool storeSession( uint8_t *data, size_t size );
+
+    /**
+     * This function will restore an TLS session that was stored earlier, so the next connection
+     * resumes it instead of doing an full handshake.
+     *
+     * @param data  The memory the session was copied to.
+     * @param size  The size of the memory in bytes.
+     * @return bool - False when the memory doesn't hold an session.
+     */
+    bool restoreSession( const uint8_t *data, size_t size );
+
 private:
     static const uint8_t LED_LISTENER = 0;
     static const uint8_t MQTT_LISTENER = 1;
     static const uint8_t PLANT_CARE_LISTENER = 2;
+    static const uint8_t WARNING_LISTENER = 3;
+    static const uint8_t RESERVOIR_CALIBRATION_LISTENER = 4;
+    static const PotMqttRoute CONFIG_ROUTES[]; // The handlers of the configuration topics, sorted by topic.
+
+    ReconnectBackoff reconnectBackoff; // The policy that spreads the connection attempts.
+    uint8_t connectionState; // The state of the connection to the broker.
+    uint8_t tlsBuffers; // The size of the TLS buffers of the connection to the broker.
+
+    /**
+     * This function will ask the broker for an smaller fragment length before the first connection
+     * and size the TLS buffers to the answer.
+     */
+    void prepareTlsBuffers();
 
     /**
-      * This function will attempt to verify the TLS/SSL certificate send from the MQTT broker by its SHA1 fingerprint.
-      * If the fingerprint doesn't match the one saved in the mqttInf1iGaFingerprint variable it will halt the execution
-      * and print an error message to the serial port.
-      */
-    void verifyFingerprint();
+     * This function will build the configuration topic of this pot from its mac address.
+     */
+    void buildDeviceTopics();
+
+    /**
+     * This function will build an topic that starts with the username and the device id.
+     *
+     * @param topic     The buffer of DEVICE_TOPIC_LENGTH bytes for the topic.
+     * @param suffix    The part of the topic after the device id.
+     */
+    static void buildDeviceTopic( char *topic, const char *suffix );
+
+    /**
+     * This function checks if the backend asked for binary statistic and warning messages.
+     *
+     * @return bool - True if the messages should be published binary, false for json.
+     */
+    bool isBinaryEncoding();
+
+    /**
+     * This function will pack an message and pass it to an publisher.
+     *
+     * @param publisher The publisher of the topic.
+     * @param message   The fields of the message, the mac address is filled in.
+     * @return bool - True if the message was published to the broker.
+     */
+    bool publishBinary( Adafruit_MQTT_Publish *publisher, TelemetryMessage &message );
 
     /**
      * This will attempt to parse the incomming json data and update the stored configuration.
      *
      * @param messageData           String containing json data.
      * @param dataLength            The length of the json string.
-     * @param receivedMessageType   The type of listener that received the message.
+     * @param receivedOnListener    The type of listener that received the message.
      */
     static void parseJsonData( char *messageData, uint16_t dataLength, uint8_t receivedOnListener );
 
+    /**
+     * This will decode an configuration message with its schema and log why an message was rejected.
+     *
+     * @param schema    The schema of the message.
+     * @param data      The json message.
+     * @param length    The length of the json message.
+     * @param message   The decoded message, filled with the current settings.
+     * @return bool - True if the message is for this pot and all its fields are valid.
+     */
+    static bool decodeConfiguration( const ConfigSchema &schema, const char *data, uint16_t length, void *message );
+
     /**
      * This function callback will be subscribed to the plant care configuration topic.
      * When new plant care configuration gets published on this topic it will update the
@@ -160,6 +372,26 @@ private:
     * @param messageLength    The length of the json string.
     */
     static void listenForLedConfiguration( char *data, uint16_t messageLength );
+
+    /**
+    * This function callback will be routed to the warning configuration topic.
+    * When new warning configuration gets published on this topic it will update the
+    * pot configuration.
+    *
+    * @param data      An json string containing warning configuration.
+    * @param messageLength    The length of the json string.
+    */
+    static void listenForWarningConfiguration( char *data, uint16_t messageLength );
+
+    /**
+    * This function callback will be routed to the reservoir calibration topic.
+    * When an new calibration point gets published on this topic it will be added to the
+    * pot configuration.
+    *
+    * @param data      An json string containing an reservoir calibration point.
+    * @param messageLength    The length of the json string.
+    */
+    static void listenForReservoirCalibration( char *data, uint16_t messageLength );
 };
 
 #endif //WATERUP_PLANTPOT_COMMUNICATION_H
@@ -0,0 +1,351 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ */
+#include "ConfigDecoder.h"
+#include <string.h>
+
+#define CONFIG_HASH_PRIME 16777619UL // The prime of the 32 bit FNV-1a hash.
+
+/**
+ * Save the message that is decoded.
+ *
+ * @param json      The json message, it doesn't have to be terminated.
+ * @param length    The length of the message in bytes.
+ */
+ConfigDecoder::ConfigDecoder( const char *json, uint16_t length )
+{
+    this->position = json;
+    this->end = json + length;
+}
+
+/**
+ * Decode the message into the settings of an decoded message. The fields are written as soon as
+ * they are read, an message that is rejected halfway leaves the fields before the error behind.
+ * The slots of the fields that were read are collected in an mask, so the required fields are
+ * checked with one compare at the end.
+ *
+ * @param schema    The schema of the message.
+ * @param mac       The mac address of the pot, like 5C:CF:7F:19:9C:39.
+ * @param message   The decoded message the schema was generated for.
+ * @return uint8_t - CONFIG_DECODE_OK or the reason the message was rejected.
+ */
+uint8_t ConfigDecoder::decode( const ConfigSchema &schema, const char *mac, void *message )
+{
+    uint32_t found = 0;
+
+    if ( !this->expect( '{' ))
+    {
+        return CONFIG_DECODE_INVALID;
+    }
+
+    this->skipWhitespace();
+    if ( this->position < this->end && *this->position == '}' )
+    {
+        this->position++;
+    }
+    else
+    {
+        do
+        {
+            const char *key;
+            uint16_t keyLength;
+
+            this->skipWhitespace();
+            if ( !this->readString( &key, &keyLength ) || !this->expect( ':' ))
+            {
+                return CONFIG_DECODE_INVALID;
+            }
+            this->skipWhitespace();
+
+            int16_t slot = ConfigDecoder::findField( schema, key, keyLength );
+            if ( slot < 0 )
+            {
+                if ( !this->skipValue()) // An newer backend can send fields this pot doesn't know yet.
+                {
+                    return CONFIG_DECODE_INVALID;
+                }
+                continue;
+            }
+
+            uint8_t status = this->decodeValue( schema.fields[slot], mac, ( uint8_t * ) message );
+            if ( status != CONFIG_DECODE_OK )
+            {
+                return status;
+            }
+            found |= 1UL << slot;
+        }
+        while ( this->expect( ',' ));
+
+        if ( this->position >= this->end || *this->position++ != '}' )
+        {
+            return CONFIG_DECODE_INVALID;
+        }
+    }
+
+    this->skipWhitespace();
+    if ( this->position < this->end && *this->position != '\0' )
+    {
+        return CONFIG_DECODE_INVALID;
+    }
+    return ( found & schema.required ) == schema.required ? CONFIG_DECODE_OK : CONFIG_DECODE_MISSING;
+}
+
+/**
+ * Compute the FNV-1a hash of an key, the seed replaces the offset basis of the hash.
+ *
+ * @param seed      The seed of the schema.
+ * @param key       The key, it doesn't have to be terminated.
+ * @param length    The length of the key in bytes.
+ * @return uint32_t - The hash of the key.
+ */
+uint32_t ConfigDecoder::hash( uint32_t seed, const char *key, uint16_t length )
+{
+    uint32_t hash = seed;
+    for ( uint16_t i = 0; i < length; i++ )
+    {
+        hash ^= ( uint8_t ) key[i];
+        hash *= CONFIG_HASH_PRIME;
+    }
+    return hash;
+}
+
+/**
+ * Look an field up in the hash table of an schema. Every key of the schema has its own slot, so
+ * an key that isn't in the slot of its hash isn't in the schema.
+ *
+ * @param schema    The schema of the message.
+ * @param key       The key, it doesn't have to be terminated.
+ * @param length    The length of the key in bytes.
+ * @return int16_t - The slot of the field, -1 when the schema doesn't have the key.
+ */
+int16_t ConfigDecoder::findField( const ConfigSchema &schema, const char *key, uint16_t length )
+{
+    uint8_t slot = ( uint8_t )( ConfigDecoder::hash( schema.seed, key, length ) % schema.slotCount );
+    const ConfigField &field = schema.fields[slot];
+
+    if ( field.key == nullptr || field.keyLength != length || memcmp( field.key, key, length ) != 0 )
+    {
+        return -1;
+    }
+    return slot;
+}
+
+/**
+ * Skip the spaces, tabs and line breaks between the tokens.
+ */
+void ConfigDecoder::skipWhitespace()
+{
+    while ( this->position < this->end && ( *this->position == ' ' || *this->position == '\t' || *this->position == '\n' || *this->position == '\r' ))
+    {
+        this->position++;
+    }
+}
+
+/**
+ * Skip the whitespace and read an expected character, the position only moves past the
+ * whitespace when it is an other character.
+ *
+ * @param character The expected character.
+ * @return bool - False when the next character is an other one.
+ */
+bool ConfigDecoder::expect( char character )
+{
+    this->skipWhitespace();
+    if ( this->position < this->end && *this->position == character )
+    {
+        this->position++;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Read an string. The text isn't unescaped, the keys and text values of the configuration don't
+ * contain escapes so an escaped text never matches them.
+ *
+ * @param text      The variable to store the start of the text in.
+ * @param length    The variable to store the length of the text in.
+ * @return bool - False when the string isn't terminated.
+ */
+bool ConfigDecoder::readString( const char **text, uint16_t *length )
+{
+    if ( this->position >= this->end || *this->position != '"' )
+    {
+        return false;
+    }
+
+    const char *start = ++this->position;
+    while ( this->position < this->end && *this->position != '"' )
+    {
+        if ( *this->position == '\\' )
+        {
+            this->position++;
+        }
+        this->position++;
+    }
+    if ( this->position >= this->end )
+    {
+        return false;
+    }
+
+    *text = start;
+    *length = ( uint16_t )( this->position++ - start );
+    return true;
+}
+
+/**
+ * Read an unsigned number. Signs, fractions and exponents make the message invalid, none of
+ * the settings can hold them.
+ *
+ * @param value The variable to store the number in.
+ * @return uint8_t - CONFIG_DECODE_OK, CONFIG_DECODE_INVALID or CONFIG_DECODE_RANGE.
+ */
+uint8_t ConfigDecoder::readUnsigned( uint32_t *value )
+{
+    const char *start = this->position;
+    uint32_t number = 0;
+    bool overflowed = false;
+
+    while ( this->position < this->end && *this->position >= '0' && *this->position <= '9' )
+    {
+        uint8_t digit = ( uint8_t )( *this->position++ - '0' );
+        if ( number > ( 0xFFFFFFFFUL - digit ) / 10 )
+        {
+            overflowed = true;
+        }
+        number = number * 10 + digit;
+    }
+
+    if ( this->position == start || ( this->position < this->end && ( *this->position == '.' || *this->position == 'e' || *this->position == 'E' )))
+    {
+        return CONFIG_DECODE_INVALID;
+    }
+    *value = number;
+    return overflowed ? CONFIG_DECODE_RANGE : CONFIG_DECODE_OK;
+}
+
+/**
+ * Read and forget the value of an field the schema doesn't know. Objects and arrays are skipped
+ * by counting the brackets outside the strings, the other values end at the next separator.
+ *
+ * @return bool - False when the value isn't valid json.
+ */
+bool ConfigDecoder::skipValue()
+{
+    const char *text;
+    uint16_t length;
+    uint8_t depth = 0;
+    const char *start = this->position;
+
+    while ( this->position < this->end )
+    {
+        char character = *this->position;
+        if ( character == '"' )
+        {
+            if ( !this->readString( &text, &length ))
+            {
+                return false;
+            }
+        }
+        else if ( character == '{' || character == '[' )
+        {
+            depth++;
+            this->position++;
+        }
+        else if ( character == '}' || character == ']' )
+        {
+            if ( depth == 0 )
+            {
+                break;
+            }
+            depth--;
+            this->position++;
+        }
+        else if ( character == ',' && depth == 0 )
+        {
+            break;
+        }
+        else
+        {
+            this->position++;
+        }
+
+        if ( depth == 0 && ( character == '"' || character == '}' || character == ']' ))
+        {
+            break;
+        }
+    }
+    return depth == 0 && this->position > start;
+}
+
+/**
+ * Decode the value of an field into the decoded message. The numbers are written with their
+ * own size, the message is an byte array to the decoder so the offset can't be misaligned.
+ *
+ * @param field     The field of the schema.
+ * @param mac       The mac address of the pot.
+ * @param message   The decoded message.
+ * @return uint8_t - CONFIG_DECODE_OK or the reason the message was rejected.
+ */
+uint8_t ConfigDecoder::decodeValue( const ConfigField &field, const char *mac, uint8_t *message )
+{
+    const char *text;
+    uint16_t length;
+
+    if ( field.kind == CONFIG_FIELD_UNSIGNED )
+    {
+        uint32_t value;
+        uint8_t status = this->readUnsigned( &value );
+        if ( status != CONFIG_DECODE_OK )
+        {
+            return status;
+        }
+        if ( value < field.minimum || value > field.maximum )
+        {
+            return CONFIG_DECODE_RANGE;
+        }
+
+        if ( field.size == 1 )
+        {
+            uint8_t narrow = ( uint8_t ) value;
+            memcpy( message + field.offset, &narrow, 1 );
+        }
+        else if ( field.size == 2 )
+        {
+            uint16_t narrow = ( uint16_t ) value;
+            memcpy( message + field.offset, &narrow, 2 );
+        }
+        else
+        {
+            memcpy( message + field.offset, &value, 4 );
+        }
+        return CONFIG_DECODE_OK;
+    }
+
+    if ( !this->readString( &text, &length ))
+    {
+        return CONFIG_DECODE_INVALID;
+    }
+
+    if ( field.kind == CONFIG_FIELD_MAC ) // The backend writes the mac address in lower case.
+    {
+        if ( strlen( mac ) != length )
+        {
+            return CONFIG_DECODE_OTHER_POT;
+        }
+        for ( uint16_t i = 0; i < length; i++ )
+        {
+            if (( text[i] | 0x20 ) != ( mac[i] | 0x20 ))
+            {
+                return CONFIG_DECODE_OTHER_POT;
+            }
+        }
+        return CONFIG_DECODE_OK;
+    }
+
+    if ( strlen( field.text ) != length || memcmp( field.text, text, length ) != 0 )
+    {
+        return CONFIG_DECODE_TEXT;
+    }
+    return CONFIG_DECODE_OK;
+}
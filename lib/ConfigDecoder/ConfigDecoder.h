@@ -0,0 +1,153 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ *
+ * This library decodes the json configuration messages the pot receives straight into the
+ * settings structs, without building an json tree on the heap. Every message has an schema that
+ * scripts/generate_config_decoders.py generates from the example messages in json/. The schema is
+ * an hash table of the fields, the generator picked an seed that gives every key its own slot so
+ * an key is found with one hash and one compare. The numbers are checked against the range of
+ * their field and the message is rejected when an required field is missing. It doesn't use any
+ * Arduino functions so it can run in the host simulations.
+ */
+#ifndef WATERUP_PLANTPOT_CONFIGDECODER_H
+#define WATERUP_PLANTPOT_CONFIGDECODER_H
+
+#include <stdint.h>
+
+#define CONFIG_FIELD_NONE 0 // An empty slot of the hash table.
+#define CONFIG_FIELD_UNSIGNED 1 // An unsigned number that is stored in the decoded message.
+#define CONFIG_FIELD_MAC 2 // The mac address of the pot the message is meant for.
+#define CONFIG_FIELD_TEXT 3 // An text that has to have one value, like the type of the message.
+
+#define CONFIG_DECODE_OK 0 // The message was decoded.
+#define CONFIG_DECODE_INVALID 1 // The message isn't an valid json object or an field has the wrong type.
+#define CONFIG_DECODE_MISSING 2 // An required field is missing.
+#define CONFIG_DECODE_RANGE 3 // An number is outside the range of its field.
+#define CONFIG_DECODE_TEXT 4 // An text field has an other value than the schema allows.
+#define CONFIG_DECODE_OTHER_POT 5 // The message is meant for an other pot.
+
+/**
+ * Data structure that contains an slot of the hash table of an schema.
+ */
+struct ConfigField
+{
+    const char *key; // The key of the field, nullptr in an empty slot.
+    uint8_t keyLength; // The length of the key in bytes.
+    uint8_t kind; // CONFIG_FIELD_UNSIGNED, CONFIG_FIELD_MAC or CONFIG_FIELD_TEXT.
+    uint8_t offset; // The offset of the value in the decoded message.
+    uint8_t size; // The size of the value in bytes, 1, 2 or 4.
+    uint32_t minimum; // The smallest valid number.
+    uint32_t maximum; // The largest valid number.
+    const char *text; // The only valid value of an text field.
+};
+
+/**
+ * Data structure that contains the schema of an configuration message.
+ */
+struct ConfigSchema
+{
+    const ConfigField *fields; // The hash table of the fields.
+    uint8_t slotCount; // The amount of slots in the hash table.
+    uint32_t seed; // The seed of the hash that gives every key its own slot.
+    uint32_t required; // The slots of the fields every message has to contain, one bit per slot.
+};
+
+/**
+ * This class is used to decode an json configuration message.
+ */
+class ConfigDecoder
+{
+public:
+    /**
+     * The constructor will save the message that is decoded.
+     *
+     * @param json      The json message, it doesn't have to be terminated.
+     * @param length    The length of the message in bytes.
+     */
+    ConfigDecoder( const char *json, uint16_t length );
+
+    /**
+     * This function will decode the message into the settings of an decoded message. The fields
+     * that aren't in the message keep their value, so the settings should be filled with the
+     * current configuration first. The settings are only complete when it returns CONFIG_DECODE_OK.
+     *
+     * @param schema    The schema of the message.
+     * @param mac       The mac address of the pot, like 5C:CF:7F:19:9C:39.
+     * @param message   The decoded message the schema was generated for.
+     * @return uint8_t - CONFIG_DECODE_OK or the reason the message was rejected.
+     */
+    uint8_t decode( const ConfigSchema &schema, const char *mac, void *message );
+
+    /**
+     * This function will compute the FNV-1a hash of an key, the generator uses the same hash.
+     *
+     * @param seed      The seed of the schema.
+     * @param key       The key, it doesn't have to be terminated.
+     * @param length    The length of the key in bytes.
+     * @return uint32_t - The hash of the key.
+     */
+    static uint32_t hash( uint32_t seed, const char *key, uint16_t length );
+
+    /**
+     * This function will look an field up in the hash table of an schema.
+     *
+     * @param schema    The schema of the message.
+     * @param key       The key, it doesn't have to be terminated.
+     * @param length    The length of the key in bytes.
+     * @return int16_t - The slot of the field, -1 when the schema doesn't have the key.
+     */
+    static int16_t findField( const ConfigSchema &schema, const char *key, uint16_t length );
+
+private:
+    const char *position; // The next character to decode.
+    const char *end; // The end of the message.
+
+    /**
+     * This function will skip the spaces, tabs and line breaks between the tokens.
+     */
+    void skipWhitespace();
+
+    /**
+     * This function will skip the whitespace and read an expected character.
+     *
+     * @param character The expected character.
+     * @return bool - False when the next character is an other one.
+     */
+    bool expect( char character );
+
+    /**
+     * This function will read an string.
+     *
+     * @param text      The variable to store the start of the text in.
+     * @param length    The variable to store the length of the text in.
+     * @return bool - False when the string isn't terminated.
+     */
+    bool readString( const char **text, uint16_t *length );
+
+    /**
+     * This function will read an unsigned number.
+     *
+     * @param value The variable to store the number in.
+     * @return uint8_t - CONFIG_DECODE_OK, CONFIG_DECODE_INVALID or CONFIG_DECODE_RANGE.
+     */
+    uint8_t readUnsigned( uint32_t *value );
+
+    /**
+     * This function will read and forget the value of an field the schema doesn't know.
+     *
+     * @return bool - False when the value isn't valid json.
+     */
+    bool skipValue();
+
+    /**
+     * This function will decode the value of an field into the decoded message.
+     *
+     * @param field     The field of the schema.
+     * @param mac       The mac address of the pot.
+     * @param message   The decoded message.
+     * @return uint8_t - CONFIG_DECODE_OK or the reason the message was rejected.
+     */
+    uint8_t decodeValue( const ConfigField &field, const char *mac, uint8_t *message );
+};
+
+#endif //WATERUP_PLANTPOT_CONFIGDECODER_H
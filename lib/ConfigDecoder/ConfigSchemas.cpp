@@ -0,0 +1,63 @@
+/**
+ * Generated by scripts/generate_config_decoders.py from the example messages in json/, don't
+ * edit it. Change the bindings in the script and run it again.
+ */
+#include "ConfigSchemas.h"
+#include <stddef.h>
+#include <TelemetryCodec.h> // This library contains the limits of the message encoding and batches.
+#include <ReservoirModel.h> // This library contains the fill level of an full reservoir.
+
+// The fields of an led-config message, in the slot of the hash of their key.
+static const ConfigField LED_CONFIG_FIELDS[5] = {
+        { "red", 3, CONFIG_FIELD_UNSIGNED, offsetof( LedConfigMessage, led.red ), sizeof( LedSettings::red ), 0, UINT8_MAX, nullptr },
+        { "blue", 4, CONFIG_FIELD_UNSIGNED, offsetof( LedConfigMessage, led.blue ), sizeof( LedSettings::blue ), 0, UINT8_MAX, nullptr },
+        { "green", 5, CONFIG_FIELD_UNSIGNED, offsetof( LedConfigMessage, led.green ), sizeof( LedSettings::green ), 0, UINT8_MAX, nullptr },
+        { nullptr, 0, CONFIG_FIELD_NONE, 0, 0, 0, 0, nullptr },
+        { "mac", 3, CONFIG_FIELD_MAC, 0, 0, 0, 0, nullptr },
+};
+const ConfigSchema LED_CONFIG_SCHEMA = { LED_CONFIG_FIELDS, 5, 0x811C9DD1UL, 0x00000017UL };
+
+// The fields of an mqtt-config message, in the slot of the hash of their key.
+static const ConfigField MQTT_CONFIG_FIELDS[9] = {
+        { "ping-interval", 13, CONFIG_FIELD_UNSIGNED, offsetof( MqttConfigMessage, mqtt.pingBrokerInterval ), sizeof( MQTTSettings::pingBrokerInterval ), 1, UINT32_MAX, nullptr },
+        { "resend-interval", 15, CONFIG_FIELD_UNSIGNED, offsetof( MqttConfigMessage, mqtt.resendWarningInterval ), sizeof( MQTTSettings::resendWarningInterval ), 1, UINT32_MAX, nullptr },
+        { "publish-threshold", 17, CONFIG_FIELD_UNSIGNED, offsetof( MqttConfigMessage, mqtt.publishReservoirWarningThreshold ), sizeof( MQTTSettings::publishReservoirWarningThreshold ), 0, 100, nullptr },
+        { "encoding", 8, CONFIG_FIELD_UNSIGNED, offsetof( MqttConfigMessage, telemetry.encoding ), sizeof( TelemetrySettings::encoding ), 0, TELEMETRY_ENCODING_BINARY, nullptr },
+        { "mac", 3, CONFIG_FIELD_MAC, 0, 0, 0, 0, nullptr },
+        { "batch-size", 10, CONFIG_FIELD_UNSIGNED, offsetof( MqttConfigMessage, telemetry.batchSize ), sizeof( TelemetrySettings::batchSize ), 1, TELEMETRY_MAX_BATCH_SIZE, nullptr },
+        { nullptr, 0, CONFIG_FIELD_NONE, 0, 0, 0, 0, nullptr },
+        { "batch-latency", 13, CONFIG_FIELD_UNSIGNED, offsetof( MqttConfigMessage, telemetry.batchLatency ), sizeof( TelemetrySettings::batchLatency ), 0, UINT32_MAX, nullptr },
+        { "stat-interval", 13, CONFIG_FIELD_UNSIGNED, offsetof( MqttConfigMessage, mqtt.statisticPublishInterval ), sizeof( MQTTSettings::statisticPublishInterval ), 1, UINT32_MAX, nullptr },
+};
+const ConfigSchema MQTT_CONFIG_SCHEMA = { MQTT_CONFIG_FIELDS, 9, 0x811C9E3EUL, 0x00000117UL };
+
+// The fields of an plant-config message, in the slot of the hash of their key.
+static const ConfigField PLANT_CARE_CONFIG_FIELDS[7] = {
+        { "contains-plant", 14, CONFIG_FIELD_UNSIGNED, offsetof( PlantCareConfigMessage, plantCare.containsPlant ), sizeof( PlantCareSettings::containsPlant ), 0, 1, nullptr },
+        { "mac", 3, CONFIG_FIELD_MAC, 0, 0, 0, 0, nullptr },
+        { "interval-ceiling", 16, CONFIG_FIELD_UNSIGNED, offsetof( PlantCareConfigMessage, cadence.measurementCeiling ), sizeof( CadenceSettings::measurementCeiling ), 1, UINT32_MAX, nullptr },
+        { "moisture-need", 13, CONFIG_FIELD_UNSIGNED, offsetof( PlantCareConfigMessage, plantCare.groundMoistureOptimal ), sizeof( PlantCareSettings::groundMoistureOptimal ), 0, 100, nullptr },
+        { nullptr, 0, CONFIG_FIELD_NONE, 0, 0, 0, 0, nullptr },
+        { "interval-floor", 14, CONFIG_FIELD_UNSIGNED, offsetof( PlantCareConfigMessage, cadence.measurementFloor ), sizeof( CadenceSettings::measurementFloor ), 1, UINT32_MAX, nullptr },
+        { "interval", 8, CONFIG_FIELD_UNSIGNED, offsetof( PlantCareConfigMessage, plantCare.takeMeasurementInterval ), sizeof( PlantCareSettings::takeMeasurementInterval ), 1, UINT32_MAX, nullptr },
+};
+const ConfigSchema PLANT_CARE_CONFIG_SCHEMA = { PLANT_CARE_CONFIG_FIELDS, 7, 0x811C9DC7UL, 0x0000004AUL };
+
+// The fields of an reservoir-calibration message, in the slot of the hash of their key.
+static const ConfigField RESERVOIR_CALIBRATION_CONFIG_FIELDS[5] = {
+        { "fill-level", 10, CONFIG_FIELD_UNSIGNED, offsetof( ReservoirCalibrationConfigMessage, point.fillLevel ), sizeof( ReservoirCalibrationPoint::fillLevel ), 0, RESERVOIR_FULL, nullptr },
+        { nullptr, 0, CONFIG_FIELD_NONE, 0, 0, 0, 0, nullptr },
+        { "echo-time", 9, CONFIG_FIELD_UNSIGNED, offsetof( ReservoirCalibrationConfigMessage, point.echoTime ), sizeof( ReservoirCalibrationPoint::echoTime ), 1, UINT16_MAX, nullptr },
+        { "mac", 3, CONFIG_FIELD_MAC, 0, 0, 0, 0, nullptr },
+        { "clear", 5, CONFIG_FIELD_UNSIGNED, offsetof( ReservoirCalibrationConfigMessage, point.clear ), sizeof( ReservoirCalibrationPoint::clear ), 0, 1, nullptr },
+};
+const ConfigSchema RESERVOIR_CALIBRATION_CONFIG_SCHEMA = { RESERVOIR_CALIBRATION_CONFIG_FIELDS, 5, 0x811C9DC5UL, 0x0000000DUL };
+
+// The fields of an warning-conf message, in the slot of the hash of their key.
+static const ConfigField WARNING_CONFIG_FIELDS[4] = {
+        { "mac", 3, CONFIG_FIELD_MAC, 0, 0, 0, 0, nullptr },
+        { "type", 4, CONFIG_FIELD_TEXT, 0, 0, 0, 0, "warning-conf" },
+        { "value", 5, CONFIG_FIELD_UNSIGNED, offsetof( WarningConfigMessage, mqtt.publishReservoirWarningThreshold ), sizeof( MQTTSettings::publishReservoirWarningThreshold ), 0, 100, nullptr },
+        { "warning", 7, CONFIG_FIELD_TEXT, 0, 0, 0, 0, "LOW_RESORVOIR" },
+};
+const ConfigSchema WARNING_CONFIG_SCHEMA = { WARNING_CONFIG_FIELDS, 4, 0x811C9DC5UL, 0x0000000FUL };
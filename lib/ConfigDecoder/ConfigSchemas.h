@@ -0,0 +1,66 @@
+/**
+ * Generated by scripts/generate_config_decoders.py from the example messages in json/, don't
+ * edit it. Change the bindings in the script and run it again.
+ *
+ * This header contains the decoded configuration messages and their schemas.
+ */
+#ifndef WATERUP_PLANTPOT_CONFIGSCHEMAS_H
+#define WATERUP_PLANTPOT_CONFIGSCHEMAS_H
+
+#include <stdint.h>
+#include "../CommonDataTypes.h" // This header contains the settings the messages are decoded into.
+#include "ConfigDecoder.h" // This header contains the decoder that reads the schemas.
+
+/**
+ * Data structure that contains an decoded led-config message, like in json/potConfig.json.
+ */
+struct LedConfigMessage
+{
+    LedSettings led; // The LedSettings the message is decoded into.
+};
+
+extern const ConfigSchema LED_CONFIG_SCHEMA; // The schema of the message.
+
+/**
+ * Data structure that contains an decoded mqtt-config message, like in json/potConfig.json.
+ */
+struct MqttConfigMessage
+{
+    MQTTSettings mqtt; // The MQTTSettings the message is decoded into.
+    TelemetrySettings telemetry; // The TelemetrySettings the message is decoded into.
+};
+
+extern const ConfigSchema MQTT_CONFIG_SCHEMA; // The schema of the message.
+
+/**
+ * Data structure that contains an decoded plant-config message, like in json/potConfig.json.
+ */
+struct PlantCareConfigMessage
+{
+    PlantCareSettings plantCare; // The PlantCareSettings the message is decoded into.
+    CadenceSettings cadence; // The CadenceSettings the message is decoded into.
+};
+
+extern const ConfigSchema PLANT_CARE_CONFIG_SCHEMA; // The schema of the message.
+
+/**
+ * Data structure that contains an decoded reservoir-calibration message, like in json/potConfig.json.
+ */
+struct ReservoirCalibrationConfigMessage
+{
+    ReservoirCalibrationPoint point; // The ReservoirCalibrationPoint the message is decoded into.
+};
+
+extern const ConfigSchema RESERVOIR_CALIBRATION_CONFIG_SCHEMA; // The schema of the message.
+
+/**
+ * Data structure that contains an decoded warning-conf message, like in json/potWarningConfiguration.json.
+ */
+struct WarningConfigMessage
+{
+    MQTTSettings mqtt; // The MQTTSettings the message is decoded into.
+};
+
+extern const ConfigSchema WARNING_CONFIG_SCHEMA; // The schema of the message.
+
+#endif //WATERUP_PLANTPOT_CONFIGSCHEMAS_H
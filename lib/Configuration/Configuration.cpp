@@ -21,6 +21,26 @@ MQTTSettings mqttSettingsObject;
  */
 PlantCareSettings plantCareSettingsObject;
 
+/**
+ * Create the data structure that contains the reservoir calibration.
+ */
+ReservoirCalibration reservoirCalibrationObject;
+
+/**
+ * Create the data structure that contains the watering configuration.
+ */
+WateringSettings wateringSettingsObject;
+
+/**
+ * Create the data structure that contains the measurement interval bounds.
+ */
+CadenceSettings cadenceSettingsObject;
+
+/**
+ * Create the data structure that contains the encoding of the published messages.
+ */
+TelemetrySettings telemetrySettingsObject;
+
 /**
  * Initiate the configuration library, set the eeprom size
  * and default memory addresses used to store configuration.
@@ -30,26 +50,50 @@ Configuration::Configuration()
 #if defined(POT_DEBUG) or defined(POT_ERROR) //
     Serial.begin(115200);
 #endif
-    this->ledSettingsAddress = DEFAULT_EEPROM_ADDRESS_OFFSET;
+    this->layoutVersionAddress = DEFAULT_EEPROM_ADDRESS_OFFSET;
+    this->ledSettingsAddress = this->layoutVersionAddress+sizeof(uint32_t);
     this->mqttSettingsAddress = this->ledSettingsAddress+sizeof(LedSettings);
     this->plantCareSettingsAddress = this->mqttSettingsAddress+sizeof(MQTTSettings);
-    this->configurationStartAddress = this->ledSettingsAddress;
-    this->configurationEndAddress = this->plantCareSettingsAddress+sizeof(PlantCareSettings);
+    this->configurationStartAddress = this->layoutVersionAddress;
+    this->reservoirCalibrationAddress = this->plantCareSettingsAddress+sizeof(PlantCareSettings);
+    this->wateringSettingsAddress = this->reservoirCalibrationAddress+sizeof(ReservoirCalibration);
+    this->cadenceSettingsAddress = this->wateringSettingsAddress+sizeof(WateringSettings);
+    this->telemetrySettingsAddress = this->cadenceSettingsAddress+sizeof(CadenceSettings);
+    this->configurationEndAddress = this->telemetrySettingsAddress+sizeof(TelemetrySettings);
 
     this->eepromSize = EEPROM_MEMORY_SIZE;
 }
 
 /**
- * Initiate the EEPROM library and load the stored settings into ram.
+ * Initiate the EEPROM library and load the stored settings into ram. The settings are only
+ * loaded when the eeprom starts with the layout word of this firmware, an erased eeprom or
+ * one written with an other layout gets the default settings. The reservoir calibration and
+ * the learned watering response of an other layout can't be read either, so they start over.
+ * In duty cycle mode every wake up runs this, so the settings the backend sent survive the
+ * deep sleep and the flash is only written when the layout changed.
  */
 void Configuration::setup()
 {
     EEPROM.begin(this->eepromSize);
     delay(10);
-    this->load();
-//    // HACK remove this!!!!!!!!!!!
-   this->reset();
-    this->store();
+
+    uint32_t layoutVersion = 0;
+    readSettings(this->getLayoutVersionAddress(), layoutVersion);
+    if( layoutVersion == CONFIGURATION_LAYOUT_VERSION )
+    {
+        this->load();
+        return;
+    }
+
+    POT_DEBUG_PRINTLN( F("[debug] - The eeprom doesn't contain the current settings layout, storing the defaults.") )
+    reservoirCalibrationObject.pointCount = 0;
+    wateringSettingsObject.mode = (uint8_t) DEFAULT_SETTING_WATERING_MODE;
+    for (uint8_t channel = 0; channel<POT_CHANNEL_COUNT; channel++)
+    {
+        wateringSettingsObject.responseGain[channel] = 0;
+        wateringSettingsObject.learnedDoses[channel] = 0;
+    }
+    this->reset();
 }
 
 /**
@@ -58,9 +102,15 @@ void Configuration::setup()
  */
 void Configuration::store()
 {
+    writeSettings(this->getLayoutVersionAddress(), (uint32_t) CONFIGURATION_LAYOUT_VERSION);
     writeSettings(this->getLedSettingsAddress(), ledSettingsObject);
     writeSettings(this->getMqttSettingsAddress(), mqttSettingsObject);
     writeSettings(this->getPlantCareSettingsAddress(), plantCareSettingsObject);
+    writeSettings(this->getReservoirCalibrationAddress(), reservoirCalibrationObject);
+    writeSettings(this->getWateringSettingsAddress(), wateringSettingsObject);
+    writeSettings(this->getCadenceSettingsAddress(), cadenceSettingsObject);
+    writeSettings(this->getTelemetrySettingsAddress(), telemetrySettingsObject);
+    EEPROM.commit(); // The ESP8266 emulates the EEPROM in flash, one commit writes all settings to it.
 }
 
 /**
@@ -72,11 +122,43 @@ void Configuration::load()
     readSettings(this->getLedSettingsAddress(), ledSettingsObject);
     readSettings(this->getMqttSettingsAddress(), mqttSettingsObject);
     readSettings(this->getPlantCareSettingsAddress(), plantCareSettingsObject);
+    readSettings(this->getReservoirCalibrationAddress(), reservoirCalibrationObject);
+
+    if( reservoirCalibrationObject.pointCount > RESERVOIR_CALIBRATION_POINTS ) // Erased or never written eeprom.
+    {
+        reservoirCalibrationObject.pointCount = 0;
+    }
+
+    readSettings(this->getWateringSettingsAddress(), wateringSettingsObject);
+    if( wateringSettingsObject.mode > 1 ) // Erased or never written eeprom.
+    {
+        wateringSettingsObject.mode = (uint8_t) DEFAULT_SETTING_WATERING_MODE;
+        for (uint8_t channel = 0; channel<POT_CHANNEL_COUNT; channel++)
+        {
+            wateringSettingsObject.responseGain[channel] = 0;
+            wateringSettingsObject.learnedDoses[channel] = 0;
+        }
+    }
+
+    readSettings(this->getCadenceSettingsAddress(), cadenceSettingsObject);
+    if( cadenceSettingsObject.measurementFloor == 0 || cadenceSettingsObject.measurementFloor > cadenceSettingsObject.measurementCeiling ) // Erased or never written eeprom.
+    {
+        cadenceSettingsObject.measurementFloor = (uint32_t) DEFAULT_SETTING_CADENCE_FLOOR;
+        cadenceSettingsObject.measurementCeiling = (uint32_t) DEFAULT_SETTING_CADENCE_CEILING;
+    }
+    readSettings(this->getTelemetrySettingsAddress(), telemetrySettingsObject);
+    if( telemetrySettingsObject.encoding > 1 || telemetrySettingsObject.batchSize == 0 || telemetrySettingsObject.batchSize > TELEMETRY_MAX_BATCH_SIZE ) // Erased or never written eeprom.
+    {
+        telemetrySettingsObject.encoding = (uint8_t) DEFAULT_SETTING_TELEMETRY_ENCODING;
+        telemetrySettingsObject.batchSize = (uint8_t) DEFAULT_SETTING_TELEMETRY_BATCH_SIZE;
+        telemetrySettingsObject.batchLatency = (uint32_t) DEFAULT_SETTING_TELEMETRY_BATCH_LATENCY;
+    }
 }
 
 /**
  *  Load the default configuration and overwrite it with the configuration stored
- *  in ram and persist the new settings to the eeprom memory.
+ *  in ram and persist the new settings to the eeprom memory. The reservoir calibration
+ *  and the learned watering response belong to the hardware of this pot so they are kept.
  */
 void Configuration::reset()
 {
@@ -94,6 +176,15 @@ void Configuration::reset()
     plantCareSettingsObject.sleepAfterGivingWater = (uint32_t) DEFAULT_SETTING_PLANT_CARE_SLEEP_AFTER_WATER;
     plantCareSettingsObject.groundMoistureOptimal = (uint8_t) DEFAULT_SETTING_PLANT_CARE_MOISTURE_OPTIMAL;
     plantCareSettingsObject.containsPlant = (uint8_t) DEFAULT_SETTING_PLANT_CARE_CONTAINS_PLANT;
+
+    cadenceSettingsObject.measurementFloor = (uint32_t) DEFAULT_SETTING_CADENCE_FLOOR;
+    cadenceSettingsObject.measurementCeiling = (uint32_t) DEFAULT_SETTING_CADENCE_CEILING;
+
+    wateringSettingsObject.mode = (uint8_t) DEFAULT_SETTING_WATERING_MODE;
+
+    telemetrySettingsObject.encoding = (uint8_t) DEFAULT_SETTING_TELEMETRY_ENCODING;
+    telemetrySettingsObject.batchSize = (uint8_t) DEFAULT_SETTING_TELEMETRY_BATCH_SIZE;
+    telemetrySettingsObject.batchLatency = (uint32_t) DEFAULT_SETTING_TELEMETRY_BATCH_LATENCY;
     this->store();
 }
 
@@ -123,6 +214,7 @@ void Configuration::setLedSettings(uint8_t red, uint8_t green, uint8_t blue)
     ledSettingsObject.blue = blue;
 
     writeSettings(this->getLedSettingsAddress(), ledSettingsObject);
+    EEPROM.commit();
 }
 
 /**
@@ -142,6 +234,7 @@ void Configuration::setMQTTSettings(uint32_t statisticPublishInterval, uint32_t
     mqttSettingsObject.publishReservoirWarningThreshold = publishReservoirWarningThreshold;
 
     writeSettings(this->getMqttSettingsAddress(), mqttSettingsObject);
+    EEPROM.commit();
 }
 
 /**
@@ -163,6 +256,114 @@ void Configuration::setPlantCareSettings(uint32_t takeMeasurementInterval, uint3
     }
 
     writeSettings(this->getPlantCareSettingsAddress(), plantCareSettingsObject);
+    EEPROM.commit();
+}
+
+/**
+ * Update the current measurement interval bounds stored in ram and persist the settings
+ * to the eeprom memory.
+ *
+ * @param measurementFloor      The shortest interval between two measurements.
+ * @param measurementCeiling    The longest interval between two measurements.
+ */
+void Configuration::setCadenceSettings(uint32_t measurementFloor, uint32_t measurementCeiling)
+{
+    cadenceSettingsObject.measurementFloor = measurementFloor;
+    cadenceSettingsObject.measurementCeiling = measurementCeiling;
+
+    writeSettings(this->getCadenceSettingsAddress(), cadenceSettingsObject);
+    EEPROM.commit();
+}
+
+/**
+ * Update the current message encoding and batching stored in ram and persist the settings
+ * to the eeprom memory.
+ *
+ * @param encoding      The encoding of the statistic and warning messages, json or binary.
+ * @param batchSize     The amount of statistics in one message, 1 to disable batching.
+ * @param batchLatency  The longest time in milliseconds an statistic waits in an batch.
+ */
+void Configuration::setTelemetrySettings(uint8_t encoding, uint8_t batchSize, uint32_t batchLatency)
+{
+    telemetrySettingsObject.encoding = encoding;
+    telemetrySettingsObject.batchSize = batchSize;
+    telemetrySettingsObject.batchLatency = batchLatency;
+
+    writeSettings(this->getTelemetrySettingsAddress(), telemetrySettingsObject);
+    EEPROM.commit();
+}
+
+/**
+ * Update the current watering configuration stored in ram and persist the settings
+ * to the eeprom memory.
+ *
+ * @param mode          The watering mode, fixed or adaptive doses.
+ * @param responseGain  The learned moisture rise per second of pumping of every channel.
+ * @param learnedDoses  The amount of doses the response gain of every channel is learned from.
+ */
+void Configuration::setWateringSettings(uint8_t mode, const uint16_t *responseGain, const uint16_t *learnedDoses)
+{
+    wateringSettingsObject.mode = mode;
+    for (uint8_t channel = 0; channel<POT_CHANNEL_COUNT; channel++)
+    {
+        wateringSettingsObject.responseGain[channel] = responseGain[channel];
+        wateringSettingsObject.learnedDoses[channel] = learnedDoses[channel];
+    }
+
+    writeSettings(this->getWateringSettingsAddress(), wateringSettingsObject);
+    EEPROM.commit();
+}
+
+/**
+ * Add an water reservoir calibration point and persist the calibration to the eeprom
+ * memory. The points are kept ordered by echo time so the reservoir model can interpolate
+ * between them.
+ *
+ * @param echoTime  The echo time in microseconds measured at the known fill level.
+ * @param fillLevel The known fill level in hundredths of a percent.
+ * @return bool - True if the point is stored, false if all calibration points are in use.
+ */
+bool Configuration::addReservoirCalibrationPoint(uint16_t echoTime, uint16_t fillLevel)
+{
+    uint8_t index = 0;
+    while( index < reservoirCalibrationObject.pointCount && reservoirCalibrationObject.echoTimes[index] < echoTime )
+    {
+        index++;
+    }
+
+    if( index == reservoirCalibrationObject.pointCount || reservoirCalibrationObject.echoTimes[index] != echoTime )
+    {
+        if( reservoirCalibrationObject.pointCount >= RESERVOIR_CALIBRATION_POINTS )
+        {
+            POT_ERROR_PRINTLN( F("[error] - All reservoir calibration points are in use.") )
+            return false;
+        }
+
+        for( uint8_t i = reservoirCalibrationObject.pointCount; i > index; i-- ) // Make room for the new point.
+        {
+            reservoirCalibrationObject.echoTimes[i] = reservoirCalibrationObject.echoTimes[i - 1];
+            reservoirCalibrationObject.fillLevels[i] = reservoirCalibrationObject.fillLevels[i - 1];
+        }
+        reservoirCalibrationObject.pointCount++;
+    }
+
+    reservoirCalibrationObject.echoTimes[index] = echoTime;
+    reservoirCalibrationObject.fillLevels[index] = fillLevel;
+
+    writeSettings(this->getReservoirCalibrationAddress(), reservoirCalibrationObject);
+    EEPROM.commit();
+    return true;
+}
+
+/**
+ * Remove all water reservoir calibration points and persist the empty calibration to the
+ * eeprom memory.
+ */
+void Configuration::clearReservoirCalibration()
+{
+    reservoirCalibrationObject.pointCount = 0;
+    writeSettings(this->getReservoirCalibrationAddress(), reservoirCalibrationObject);
+    EEPROM.commit();
 }
 
 /**
@@ -195,6 +396,46 @@ PlantCareSettings* Configuration::getPlantCareSettings()
     return &plantCareSettingsObject;
 }
 
+/**
+ * Returns an pointer to the watering settings struct.
+ *
+ * @return WateringSettings* an pointer to the watering settings struct.
+ */
+WateringSettings* Configuration::getWateringSettings()
+{
+    return &wateringSettingsObject;
+}
+
+/**
+ * Returns an pointer to the measurement interval bounds struct.
+ *
+ * @return CadenceSettings* an pointer to the measurement interval bounds struct.
+ */
+CadenceSettings* Configuration::getCadenceSettings()
+{
+    return &cadenceSettingsObject;
+}
+
+/**
+ * Returns an pointer to the message encoding and batching struct.
+ *
+ * @return TelemetrySettings* an pointer to the message encoding and batching struct.
+ */
+TelemetrySettings* Configuration::getTelemetrySettings()
+{
+    return &telemetrySettingsObject;
+}
+
+/**
+ * Returns an pointer to the reservoir calibration struct.
+ *
+ * @return ReservoirCalibration* an pointer to the reservoir calibration struct.
+ */
+ReservoirCalibration* Configuration::getReservoirCalibration()
+{
+    return &reservoirCalibrationObject;
+}
+
 void Configuration::printConfiguration()
 {
     Serial << F("[debug] - Printing all configuration:")
@@ -251,14 +492,64 @@ void Configuration::printPlantCareConfiguration()
            << F("\n};\n");
 }
 
+void Configuration::printWateringConfiguration()
+{
+    Serial << F("[debug] - Printing watering configuration:")
+           << F("\nWatering settings = {")
+           << F("\n\tmode:") << wateringSettingsObject.mode;
+    for (uint8_t channel = 0; channel<POT_CHANNEL_COUNT; channel++)
+    {
+        Serial << F(",\n\t{responseGain:") << wateringSettingsObject.responseGain[channel]
+               << F(", learnedDoses:") << wateringSettingsObject.learnedDoses[channel] << "}";
+    }
+    Serial << F("\n};\n");
+}
+
+void Configuration::printCadenceConfiguration()
+{
+    Serial << F("[debug] - Printing measurement interval bounds:")
+           << F("\nCadence settings = {")
+           << F("\n\tmeasurementFloor:") << cadenceSettingsObject.measurementFloor
+           << F(",\n\tmeasurementCeiling:") << cadenceSettingsObject.measurementCeiling
+           << F("\n};\n");
+}
+
+void Configuration::printTelemetryConfiguration()
+{
+    Serial << F("[debug] - Printing message encoding and batching:")
+           << F("\nTelemetry settings = {")
+           << F("\n\tencoding:") << telemetrySettingsObject.encoding
+           << F(",\n\tbatchSize:") << telemetrySettingsObject.batchSize
+           << F(",\n\tbatchLatency:") << telemetrySettingsObject.batchLatency
+           << F("\n};\n");
+}
+
+void Configuration::printReservoirCalibration()
+{
+    Serial << F("[debug] - Printing reservoir calibration:")
+           << F("\nReservoir calibration = {");
+    for (uint8_t i = 0; i<reservoirCalibrationObject.pointCount; i++)
+    {
+        Serial << F("\n\t{echoTime:") << reservoirCalibrationObject.echoTimes[i]
+               << F(", fillLevel:") << reservoirCalibrationObject.fillLevels[i]
+               << (i+1<reservoirCalibrationObject.pointCount ? "}," : "}");
+    }
+    Serial << F("\n};\n");
+}
+
 void Configuration::printStorageAddresses()
 {
     Serial << F("[debug] - Printing EEPROM memory addresses:")
            << F("\nMemory addresses = {")
            << F("\n\tconfigBlockStart:") << this->getConfigurationStartAddress()
+           << F(",\n\tlayoutVersionAddress:") << this->getLayoutVersionAddress()
            << F(",\n\tledSettingsAddress:") << this->getLedSettingsAddress()
            << F(",\n\tmqttSettingsAddress:") << this->getMqttSettingsAddress()
            << F(",\n\tplantCareSettingsAddress:") << this->getPlantCareSettingsAddress()
+           << F(",\n\treservoirCalibrationAddress:") << this->getReservoirCalibrationAddress()
+           << F(",\n\twateringSettingsAddress:") << this->getWateringSettingsAddress()
+           << F(",\n\tcadenceSettingsAddress:") << this->getCadenceSettingsAddress()
+           << F(",\n\ttelemetrySettingsAddress:") << this->getTelemetrySettingsAddress()
            << F("\n\tconfigBlockEnd:") << this->getConfigurationEndAddress()
            << F("\n};\n");
 }
@@ -288,7 +579,15 @@ void Configuration::printMemory()
     Serial << F("\n};\n\nmqtt Memory= {");
     printMemoryDump(this->getMqttSettingsAddress(), this->getPlantCareSettingsAddress());
     Serial << F("\n};\n\nplant care Memory= {");
-    printMemoryDump(this->getPlantCareSettingsAddress(), this->getConfigurationEndAddress());
+    printMemoryDump(this->getPlantCareSettingsAddress(), this->getReservoirCalibrationAddress());
+    Serial << F("\n};\n\nreservoir calibration Memory= {");
+    printMemoryDump(this->getReservoirCalibrationAddress(), this->getWateringSettingsAddress());
+    Serial << F("\n};\n\nwatering Memory= {");
+    printMemoryDump(this->getWateringSettingsAddress(), this->getCadenceSettingsAddress());
+    Serial << F("\n};\n\ncadence Memory= {");
+    printMemoryDump(this->getCadenceSettingsAddress(), this->getTelemetrySettingsAddress());
+    Serial << F("\n};\n\ntelemetry Memory= {");
+    printMemoryDump(this->getTelemetrySettingsAddress(), this->getConfigurationEndAddress());
     Serial << F("\n};\n");
 }
 
@@ -309,7 +608,7 @@ void Configuration::printMqttMemory()
 void Configuration::printPlantCareMemory()
 {
     Serial << F("[debug] - Printing EEPROM plant care memory:\nplant care Memory= {");
-    printMemoryDump(this->getPlantCareSettingsAddress(), this->getConfigurationEndAddress() );
+    printMemoryDump(this->getPlantCareSettingsAddress(), this->getReservoirCalibrationAddress() );
     Serial << F("\n};\n");
 }
 
@@ -328,6 +627,11 @@ uint8_t Configuration::getConfigurationEndAddress()
     return this->configurationEndAddress;
 }
 
+uint8_t Configuration::getLayoutVersionAddress()
+{
+    return this->layoutVersionAddress;
+}
+
 uint8_t Configuration::getLedSettingsAddress()
 {
     return this->ledSettingsAddress;
@@ -341,4 +645,24 @@ uint8_t Configuration::getMqttSettingsAddress()
 uint8_t Configuration::getPlantCareSettingsAddress()
 {
     return this->plantCareSettingsAddress;
+}
+
+uint8_t Configuration::getReservoirCalibrationAddress()
+{
+    return this->reservoirCalibrationAddress;
+}
+
+uint8_t Configuration::getWateringSettingsAddress()
+{
+    return this->wateringSettingsAddress;
+}
+
+uint8_t Configuration::getCadenceSettingsAddress()
+{
+    return this->cadenceSettingsAddress;
+}
+
+uint8_t Configuration::getTelemetrySettingsAddress()
+{
+    return this->telemetrySettingsAddress;
 }
\ No newline at end of file
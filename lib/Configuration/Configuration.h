@@ -12,9 +12,13 @@
 #include "../CommonDataTypes.h"
 #include <Streaming.h> // Include this library for using the << Streaming operator.
 #include <EEPROM.h> // Include this library for using the EEPROM flas storage on the huzzah.
+#include <TelemetryCodec.h> // This library contains the message encodings and the maximum batch size.
 
 #define EEPROM_MEMORY_SIZE 512 // The size in bytes of the EEPROM memory (512 for the huzzah).
 #define DEFAULT_EEPROM_ADDRESS_OFFSET 0 // The addess offset of the config storage.
+#define CONFIGURATION_MAGIC 0x57550000UL // The upper half of the layout word, "WU" marks an eeprom written by this firmware.
+#define CONFIGURATION_LAYOUT 1 // The version of the settings layout, increase it when an settings struct changes.
+#define CONFIGURATION_LAYOUT_VERSION ( CONFIGURATION_MAGIC | ((uint32_t) POT_CHANNEL_COUNT << 8 ) | CONFIGURATION_LAYOUT ) // The layout word, the watering settings grow with the amount of channels.
 
 #define DEFAULT_SETTING_LED_RED 255 // The default setting for the red led.
 #define DEFAULT_SETTING_LED_GREEN 255 // The default setting for the green led.
@@ -30,13 +34,23 @@
 #define DEFAULT_SETTING_PLANT_CARE_MOISTURE_OPTIMAL 30 // The default optimal ground moisture level setting.
 #define DEFAULT_SETTING_PLANT_CARE_CONTAINS_PLANT 1 // The default setting to enable or disable plant care.
 
+#define DEFAULT_SETTING_CADENCE_FLOOR 15000 // The default shortest interval between two measurements.
+#define DEFAULT_SETTING_CADENCE_CEILING 900000 // The default longest interval between two measurements.
+
+#define DEFAULT_SETTING_TELEMETRY_ENCODING 0 // The default encoding of the published messages, 0 for json and 1 for binary.
+#define DEFAULT_SETTING_TELEMETRY_BATCH_SIZE 1 // The default amount of statistics in one message, 1 publishes every statistic right away.
+#define DEFAULT_SETTING_TELEMETRY_BATCH_LATENCY 300000 // The default longest time in milliseconds an statistic waits in an batch.
+
+#define DEFAULT_SETTING_WATERING_MODE 1 // The default watering mode, 0 for fixed doses and 1 for adaptive doses.
+
 class Communication; // Forward declare the communication library.
 class Configuration; //  Forward declare the configuration library.
 class PlantCare; // Forward declare the plant care library.
 
 /**
  * 
- * This template simplifies the writing to EEPROM storage of complex data structures.
+ * This template simplifies the writing to EEPROM storage of complex data structures. It only
+ * changes the copy of the EEPROM in ram, EEPROM.commit() writes the copy to the flash.
  *
  * @param startAddress The EEPROM starting address of the data structure.
  * @param value The data structure to write.
@@ -91,7 +105,8 @@ public:
         NO_ERROR = 0,
         LOW_RESERVOIR = 1,
         EMPTY_RESERVOIR = 2,
-        UNKNOWN_ERROR = 3
+        UNKNOWN_ERROR = 3,
+        NO_WATER_RESPONSE = 4
     };
 
     /**
@@ -101,7 +116,8 @@ public:
     Configuration();
 
     /**
-     * This will initiate the EEPROM library and it will load the stored settings into ram.
+     * This will initiate the EEPROM library and it will load the stored settings into ram. An
+     * eeprom without the current layout word gets the default settings.
      */
     void setup();
 
@@ -161,6 +177,49 @@ public:
      */
     void setPlantCareSettings(uint32_t takeMeasurementInterval, uint32_t sleepAfterGivingWater, uint8_t groundMoistureOptimal, uint8_t containsPlant = 2);
 
+    /**
+     * This function accepts the measurement interval bounds and overwrites the ones stored in ram.
+     *
+     * @param measurementFloor      The shortest interval between two measurements.
+     * @param measurementCeiling    The longest interval between two measurements.
+     */
+    void setCadenceSettings(uint32_t measurementFloor, uint32_t measurementCeiling);
+
+    /**
+     * This function accepts the encoding and batching of the published messages and overwrites
+     * the ones stored in ram.
+     *
+     * @param encoding      The encoding of the statistic and warning messages, json or binary.
+     * @param batchSize     The amount of statistics in one message, 1 to disable batching.
+     * @param batchLatency  The longest time in milliseconds an statistic waits in an batch.
+     */
+    void setTelemetrySettings(uint8_t encoding, uint8_t batchSize, uint32_t batchLatency);
+
+    /**
+     * This function accepts the watering settings and overwrites the ones stored in ram.
+     *
+     * @param mode          The watering mode, fixed or adaptive doses.
+     * @param responseGain  The learned moisture rise per second of pumping of every channel.
+     * @param learnedDoses  The amount of doses the response gain of every channel is learned from.
+     */
+    void setWateringSettings(uint8_t mode, const uint16_t *responseGain, const uint16_t *learnedDoses);
+
+    /**
+     * This function adds an water reservoir calibration point, it replaces an point with the same
+     * echo time. The points are kept ordered by echo time.
+     *
+     * @param echoTime  The echo time in microseconds measured at the known fill level.
+     * @param fillLevel The known fill level in hundredths of a percent.
+     * @return bool - True if the point is stored, false if all calibration points are in use.
+     */
+    bool addReservoirCalibrationPoint(uint16_t echoTime, uint16_t fillLevel);
+
+    /**
+     * This function removes all water reservoir calibration points so the reservoir model is
+     * used without corrections.
+     */
+    void clearReservoirCalibration();
+
     /**
      * This gets the LedSettings struct address currently in use and stored in ram.
      *
@@ -182,6 +241,34 @@ public:
      */
     PlantCareSettings* getPlantCareSettings();
 
+    /**
+     * This gets the CadenceSettings struct address currently in use and stored in ram.
+     *
+     * @return CadenceSettings* an pointer to the measurement interval bounds struct.
+     */
+    CadenceSettings* getCadenceSettings();
+
+    /**
+     * This gets the TelemetrySettings struct address currently in use and stored in ram.
+     *
+     * @return TelemetrySettings* an pointer to the message encoding and batching struct.
+     */
+    TelemetrySettings* getTelemetrySettings();
+
+    /**
+     * This gets the WateringSettings struct address currently in use and stored in ram.
+     *
+     * @return WateringSettings* an pointer to the watering settings struct.
+     */
+    WateringSettings* getWateringSettings();
+
+    /**
+     * This gets the ReservoirCalibration struct address currently in use and stored in ram.
+     *
+     * @return ReservoirCalibration* an pointer to the reservoir calibration struct.
+     */
+    ReservoirCalibration* getReservoirCalibration();
+
     /**
      * This function will print all the current configuration stored in ram.
      */
@@ -202,6 +289,26 @@ public:
      */
     void printPlantCareConfiguration();
 
+    /**
+     * This function will print the current measurement interval bounds stored in ram.
+     */
+    void printCadenceConfiguration();
+
+    /**
+     * This function will print the current message encoding and batching stored in ram.
+     */
+    void printTelemetryConfiguration();
+
+    /**
+     * This function will print the current watering configuration stored in ram.
+     */
+    void printWateringConfiguration();
+
+    /**
+     * This function will print the current reservoir calibration stored in ram.
+     */
+    void printReservoirCalibration();
+
     /**
      * This function will print all the eeprom memory addresses used to permanently
      * store configuration on the pot.f
@@ -251,9 +358,14 @@ private:
     uint16_t eepromSize; // The amount of bits available on the eeprom storage.
     uint8_t configurationStartAddress; // The eeprom starting address of the configuration.
     uint8_t configurationEndAddress; // The eeprom ending address of the configuration.
+    uint8_t layoutVersionAddress; // The eeprom starting address of the layout word.
     uint8_t ledSettingsAddress; // The eeprom starting address of the led configuration.
     uint8_t mqttSettingsAddress; // The eerpom starting address of the mqtt configuration.
     uint8_t plantCareSettingsAddress; // The eeprom starting address of the plant care configuration.
+    uint8_t reservoirCalibrationAddress; // The eeprom starting address of the reservoir calibration.
+    uint8_t wateringSettingsAddress; // The eeprom starting address of the watering configuration.
+    uint8_t cadenceSettingsAddress; // The eeprom starting address of the measurement interval bounds.
+    uint8_t telemetrySettingsAddress; // The eeprom starting address of the message encoding and batching.
 
     /**
      * This functions returns the size of the eeprom storage.
@@ -273,6 +385,12 @@ private:
      */
     uint8_t getConfigurationEndAddress();
 
+    /**
+     * This function returns the starting address of the layout word.
+     * @return  An byte containing the start address of the layout word.
+     */
+    uint8_t getLayoutVersionAddress();
+
     /**
      * This function returns the starting address of the led configuration.
      * @return  An byte containing the end address of the led configuration.
@@ -290,6 +408,30 @@ private:
      * @return  An byte containing the end address of the plant care configuration.
      */
     uint8_t getPlantCareSettingsAddress();
+
+    /**
+     * This function returns the starting address of the reservoir calibration.
+     * @return  An byte containing the start address of the reservoir calibration.
+     */
+    uint8_t getReservoirCalibrationAddress();
+
+    /**
+     * This function returns the starting address of the watering configuration.
+     * @return  An byte containing the start address of the watering configuration.
+     */
+    uint8_t getWateringSettingsAddress();
+
+    /**
+     * This function returns the starting address of the measurement interval bounds.
+     * @return  An byte containing the start address of the measurement interval bounds.
+     */
+    uint8_t getCadenceSettingsAddress();
+
+    /**
+     * This function returns the starting address of the message encoding and batching.
+     * @return  An byte containing the start address of the message encoding and batching.
+     */
+    uint8_t getTelemetrySettingsAddress();
 };
 
 #endif //WATERUP_PLANTPOT_CONFIGURATION_H
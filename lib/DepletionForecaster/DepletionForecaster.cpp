@@ -0,0 +1,137 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ */
+#include "DepletionForecaster.h"
+#include <math.h>
+
+/**
+ * Create an forecaster without history.
+ */
+DepletionForecaster::DepletionForecaster()
+{
+    this->reset();
+}
+
+/**
+ * Remove the history, the next level starts an new fit.
+ */
+void DepletionForecaster::reset()
+{
+    this->weightSum = 0;
+    this->timeSum = 0;
+    this->timeSquareSum = 0;
+    this->levelSum = 0;
+    this->timeLevelSum = 0;
+    this->firstTimestamp = 0;
+    this->lastTimestamp = 0;
+    this->sampleCount = 0;
+}
+
+/**
+ * Add an water level to the regression. The sums are kept relative to the newest level so
+ * they stay small, moving them to the new level and applying the decay takes constant time:
+ * every older time t becomes t - dt and every weight gets multiplied by e^(-dt / tau).
+ *
+ * @param timestamp     The time in seconds of the measurement.
+ * @param waterLevel    The percentage of water left in the reservoir.
+ * @param pumpRan       True if the water pump ran since the previous level.
+ */
+void DepletionForecaster::addSample( uint32_t timestamp, int16_t waterLevel, bool pumpRan )
+{
+    float slope;
+    float fittedLevel;
+    if( !pumpRan && this->fit( &slope, &fittedLevel ))
+    {
+        float hours = ( timestamp - this->lastTimestamp ) / 3600.0f;
+        if( waterLevel > fittedLevel + slope * hours + FORECAST_REFILL_RISE )
+        {
+            this->reset();
+        }
+    }
+
+    if( this->sampleCount > 0 )
+    {
+        float hours = ( timestamp - this->lastTimestamp ) / 3600.0f;
+        float decay = expf( -hours / FORECAST_TIME_CONSTANT );
+
+        this->timeSquareSum = ( this->timeSquareSum - 2 * hours * this->timeSum + hours * hours * this->weightSum ) * decay;
+        this->timeLevelSum = ( this->timeLevelSum - hours * this->levelSum ) * decay;
+        this->timeSum = ( this->timeSum - hours * this->weightSum ) * decay;
+        this->levelSum *= decay;
+        this->weightSum *= decay;
+    }
+    else
+    {
+        this->firstTimestamp = timestamp;
+    }
+
+    this->weightSum += 1;
+    this->levelSum += waterLevel; // The time of the newest level is 0, it adds nothing to the time sums.
+    this->lastTimestamp = timestamp;
+    if( this->sampleCount < 0xFFFF )
+    {
+        this->sampleCount++;
+    }
+}
+
+/**
+ * Return the consumption fitted through the water levels.
+ *
+ * @return float - The consumption in percent per hour, positive when the level drops.
+ */
+float DepletionForecaster::getConsumption()
+{
+    float slope;
+    float level;
+    return this->fit( &slope, &level ) ? -slope : 0;
+}
+
+/**
+ * Return the forecasted time until the reservoir is empty, the fitted level at the newest
+ * sample divided by the consumption. There is no forecast until the levels span enough time.
+ *
+ * @return int16_t - The hours left, FORECAST_UNKNOWN when there is not enough history.
+ */
+int16_t DepletionForecaster::getHoursLeft()
+{
+    float slope;
+    float level;
+    if( this->sampleCount < FORECAST_MIN_SAMPLES ||
+        ( this->lastTimestamp - this->firstTimestamp ) / 3600.0f < FORECAST_MIN_SPAN ||
+        !this->fit( &slope, &level ))
+    {
+        return FORECAST_UNKNOWN;
+    }
+
+    if( level <= 0 )
+    {
+        return 0;
+    }
+    if( -slope < FORECAST_MIN_CONSUMPTION )
+    {
+        return FORECAST_MAX_HOURS;
+    }
+
+    float hoursLeft = level / -slope;
+    return hoursLeft > FORECAST_MAX_HOURS ? FORECAST_MAX_HOURS : (int16_t) hoursLeft;
+}
+
+/**
+ * Compute the weighted least squares line through the levels.
+ *
+ * @param slope The slope in percent per hour.
+ * @param level The fitted level at the newest sample.
+ * @return bool - False when the fit is undefined.
+ */
+bool DepletionForecaster::fit( float *slope, float *level )
+{
+    float denominator = this->weightSum * this->timeSquareSum - this->timeSum * this->timeSum;
+    if( this->sampleCount < 2 || denominator <= 1e-6f )
+    {
+        return false;
+    }
+
+    *slope = ( this->weightSum * this->timeLevelSum - this->timeSum * this->levelSum ) / denominator;
+    *level = ( this->levelSum - *slope * this->timeSum ) / this->weightSum;
+    return true;
+}
@@ -0,0 +1,85 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ *
+ * This library forecasts when the water reservoir runs empty. It fits an line through the
+ * water levels with an exponentially weighted least squares regression, older levels count
+ * less so the forecast follows changes in the consumption. Every level is added in constant
+ * time by keeping the weighted sums relative to the newest level. An refill restarts the fit.
+ * It doesn't use any Arduino functions so it can run in the host simulations.
+ */
+#ifndef WATERUP_PLANTPOT_DEPLETIONFORECASTER_H
+#define WATERUP_PLANTPOT_DEPLETIONFORECASTER_H
+
+#include <stdint.h>
+
+#define FORECAST_UNKNOWN -1 // The hours left when there is not enough history to forecast.
+#define FORECAST_TIME_CONSTANT 24.0f // The age in hours at which an level counts for 37%.
+#define FORECAST_MIN_SPAN 2.0f // The minimum time in hours since the last refill before we forecast.
+#define FORECAST_MIN_SAMPLES 10 // The minimum amount of levels since the last refill before we forecast.
+#define FORECAST_REFILL_RISE 10 // The rise in percent above the fitted level that counts as an refill.
+#define FORECAST_MIN_CONSUMPTION 0.01f // The consumption in percent per hour below which the reservoir never runs empty.
+#define FORECAST_MAX_HOURS 9999 // The maximum forecast in hours.
+
+/**
+ * This class is used to forecast the hours left until the water reservoir is empty.
+ */
+class DepletionForecaster
+{
+public:
+    /**
+     * The constructor will create an forecaster without history.
+     */
+    DepletionForecaster();
+
+    /**
+     * This function removes the history, like after an refill.
+     */
+    void reset();
+
+    /**
+     * This function adds an water level to the regression in constant time. An level that rose
+     * well above the fitted line means the reservoir was refilled and restarts the fit. Levels
+     * measured right after the pump ran can read high because the water surface still moves,
+     * they never count as an refill.
+     *
+     * @param timestamp     The time in seconds of the measurement.
+     * @param waterLevel    The percentage of water left in the reservoir.
+     * @param pumpRan       True if the water pump ran since the previous level.
+     */
+    void addSample( uint32_t timestamp, int16_t waterLevel, bool pumpRan );
+
+    /**
+     * This function returns the consumption fitted through the water levels.
+     *
+     * @return float - The consumption in percent per hour, positive when the level drops.
+     */
+    float getConsumption();
+
+    /**
+     * This function returns the forecasted time until the reservoir is empty.
+     *
+     * @return int16_t - The hours left, FORECAST_UNKNOWN when there is not enough history.
+     */
+    int16_t getHoursLeft();
+
+private:
+    float weightSum; // The sum of the weights.
+    float timeSum; // The weighted sum of the sample times in hours relative to the newest sample.
+    float timeSquareSum; // The weighted sum of the squared sample times.
+    float levelSum; // The weighted sum of the water levels.
+    float timeLevelSum; // The weighted sum of the sample times times the water levels.
+    uint32_t firstTimestamp; // The time in seconds of the first level since the last refill.
+    uint32_t lastTimestamp; // The time in seconds of the newest level.
+    uint16_t sampleCount; // The amount of levels since the last refill.
+
+    /**
+     * This function computes the slope and the fitted level at the newest sample.
+     *
+     * @param slope The slope in percent per hour.
+     * @param level The fitted level at the newest sample.
+     * @return bool - False when the fit is undefined.
+     */
+    bool fit( float *slope, float *level );
+};
+
+#endif //WATERUP_PLANTPOT_DEPLETIONFORECASTER_H
@@ -0,0 +1,110 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ */
+#include "DutyCycle.h"
+
+/**
+ * Initiate the pot state as if the pot was powered on for the first time.
+ */
+DutyCycle::DutyCycle()
+{
+    memset( &this->state, 0, sizeof( RtcPotState ));
+    this->state.magic = DUTY_CYCLE_STATE_MAGIC;
+    this->state.radioEnabled = 1;
+}
+
+/**
+ * Load the pot state from RTC memory. The RTC memory contains garbage after an power cycle,
+ * so the state is only used when the magic number and checksum match.
+ *
+ * @return bool - True if the pot woke up from deep sleep with an valid state.
+ */
+bool DutyCycle::restore()
+{
+    RtcPotState storedState;
+    ESP.rtcUserMemoryRead( DUTY_CYCLE_RTC_OFFSET, (uint32_t*) &storedState, sizeof( RtcPotState ));
+
+    uint32_t checksum = calculateChecksum( (const uint8_t*) &storedState + sizeof( uint32_t ), sizeof( RtcPotState ) - sizeof( uint32_t ));
+    if( storedState.magic != DUTY_CYCLE_STATE_MAGIC || storedState.checksum != checksum )
+    {
+        POT_DEBUG_PRINTLN( F("[debug] - No valid pot state in RTC memory, starting with an fresh state.") )
+        return false;
+    }
+
+    this->state = storedState;
+    this->state.wakeUpCounter++;
+    POT_DEBUG_PRINTLN( F("[debug] - Woke up from deep sleep for the ") APPEND this->state.wakeUpCounter APPEND F(" time.") )
+    return true;
+}
+
+/**
+ * Return an pointer to the pot state.
+ *
+ * @return RtcPotState* - An pointer to the pot state.
+ */
+RtcPotState* DutyCycle::getState()
+{
+    return &this->state;
+}
+
+/**
+ * Return the time since the pot was powered on for the first time. The elapsed time is
+ * stored when going to sleep, millis() counts from the moment the pot woke up.
+ *
+ * @return uint64_t - The time in milliseconds.
+ */
+uint64_t DutyCycle::now()
+{
+    return this->state.elapsedTime + millis();
+}
+
+/**
+ * Check if the radio was enabled for this wake up.
+ *
+ * @return bool - True if we can connect to the WiFi network.
+ */
+bool DutyCycle::isRadioEnabled()
+{
+    return this->state.radioEnabled == 1;
+}
+
+/**
+ * Write the pot state to RTC memory and put the ESP8266 in deep sleep. The radio is only
+ * calibrated and enabled at the next wake up when something has to be published.
+ *
+ * @param sleepTime     The time in milliseconds to sleep.
+ * @param radioNeeded   Boolean to enable the radio at the next wake up.
+ */
+void DutyCycle::sleep( uint32_t sleepTime, bool radioNeeded )
+{
+    this->state.elapsedTime = this->now() + sleepTime;
+    this->state.radioEnabled = radioNeeded ? 1 : 0;
+    this->state.magic = DUTY_CYCLE_STATE_MAGIC;
+    this->state.checksum = calculateChecksum( (const uint8_t*) &this->state + sizeof( uint32_t ), sizeof( RtcPotState ) - sizeof( uint32_t ));
+    ESP.rtcUserMemoryWrite( DUTY_CYCLE_RTC_OFFSET, (uint32_t*) &this->state, sizeof( RtcPotState ));
+
+    POT_DEBUG_PRINTLN( F("[debug] - Going to deep sleep for ") APPEND sleepTime APPEND F(" milliseconds, radio ") APPEND ( radioNeeded ? F("enabled") : F("disabled") ))
+    ESP.deepSleep( (uint64_t) sleepTime * 1000, radioNeeded ? WAKE_RF_DEFAULT : WAKE_RF_DISABLED );
+}
+
+/**
+ * Calculate the CRC32 checksum of an block of memory.
+ *
+ * @param data      An pointer to the memory.
+ * @param length    The amount of bytes.
+ * @return uint32_t - The checksum.
+ */
+uint32_t DutyCycle::calculateChecksum( const uint8_t *data, size_t length )
+{
+    uint32_t crc = 0xFFFFFFFF;
+
+    while( length-- )
+    {
+        crc ^= *data++;
+        for( uint8_t bit = 0; bit < 8; bit++ )
+        {
+            crc = ( crc >> 1 ) ^ ( 0xEDB88320 & ( 0 - ( crc & 1 )));
+        }
+    }
+    return ~crc;
+}
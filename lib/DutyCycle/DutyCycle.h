@@ -0,0 +1,84 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ *
+ * This library lets the pot run from batteries by sleeping between measurements. The pot
+ * state is kept in the RTC memory of the ESP8266 which survives deep sleep. Deep sleep
+ * requires GPIO16 (D0) to be wired to the reset pin so the timer can wake the chip up.
+ */
+#ifndef WATERUP_PLANTPOT_DUTYCYCLE_H
+#define WATERUP_PLANTPOT_DUTYCYCLE_H
+
+#include <Arduino.h> // Include this library for using basic system functions and variables.
+#include "../PotDebugUtitities.h" // This header contains some debug utilities.
+#include "DutyCyclePlanner.h" // This header contains the state kept in RTC memory and the wake up planner.
+
+#define DUTY_CYCLE_RTC_OFFSET 0 // The offset in 4 byte blocks of the pot state in the RTC user memory.
+#define DUTY_CYCLE_STATE_MAGIC 0x57555036 // The magic number of the pot state, change it when RtcPotState changes.
+
+class DutyCycle;
+
+/**
+ * This class is used to keep the pot state in RTC memory and put the pot in deep sleep.
+ */
+class DutyCycle
+{
+public:
+    /**
+     * The constructor will initiate the pot state as if the pot was powered on for the first time.
+     */
+    DutyCycle();
+
+    /**
+     * This function will load the pot state from RTC memory. When the checksum doesn't match
+     * the pot was powered on instead of woken up and an fresh state is used.
+     *
+     * @return bool - True if the pot woke up from deep sleep with an valid state.
+     */
+    bool restore();
+
+    /**
+     * This function returns an pointer to the pot state so other libraries can update it
+     * before the pot goes back to sleep.
+     *
+     * @return RtcPotState* - An pointer to the pot state.
+     */
+    RtcPotState* getState();
+
+    /**
+     * This function returns the time since the pot was powered on for the first time,
+     * including all the time it spent in deep sleep.
+     *
+     * @return uint64_t - The time in milliseconds.
+     */
+    uint64_t now();
+
+    /**
+     * This function checks if the radio was enabled for this wake up.
+     *
+     * @return bool - True if we can connect to the WiFi network.
+     */
+    bool isRadioEnabled();
+
+    /**
+     * This function will write the pot state to RTC memory and put the ESP8266 in deep
+     * sleep. This function doesn't return, the pot resets when it wakes up.
+     *
+     * @param sleepTime     The time in milliseconds to sleep.
+     * @param radioNeeded   Boolean to enable the radio at the next wake up.
+     */
+    void sleep( uint32_t sleepTime, bool radioNeeded );
+
+private:
+    RtcPotState state; // The pot state that survives deep sleep.
+
+    /**
+     * This function will calculate the CRC32 checksum of an block of memory.
+     *
+     * @param data      An pointer to the memory.
+     * @param length    The amount of bytes.
+     * @return uint32_t - The checksum.
+     */
+    static uint32_t calculateChecksum( const uint8_t *data, size_t length );
+};
+
+#endif //WATERUP_PLANTPOT_DUTYCYCLE_H
@@ -0,0 +1,148 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ */
+#include "DutyCyclePlanner.h"
+
+/**
+ * Check if an interval passed since the last time something happened.
+ *
+ * @param lastTime  The last time in milliseconds it happened.
+ * @param interval  The interval in milliseconds, 0 means it never becomes due.
+ * @param now       The current time in milliseconds.
+ * @return bool - True if it is due.
+ */
+bool DutyCyclePlanner::isDue( uint64_t lastTime, uint32_t interval, uint64_t now )
+{
+    return nextDeadline( lastTime, interval ) <= now;
+}
+
+/**
+ * Check if the soil should be measured. After giving water the soil is left alone until
+ * the water had time to spread.
+ *
+ * @param state     The state kept in RTC memory.
+ * @param intervals The configured intervals.
+ * @param now       The current time in milliseconds.
+ * @return bool - True if an measurement is due.
+ */
+bool DutyCyclePlanner::isMeasurementDue( const RtcPotState &state, const DutyCycleIntervals &intervals, uint64_t now )
+{
+    return measurementDeadline( state, intervals ) <= now;
+}
+
+/**
+ * Check if statistics should be published.
+ *
+ * @param state     The state kept in RTC memory.
+ * @param intervals The configured intervals.
+ * @param now       The current time in milliseconds.
+ * @return bool - True if an statistic publication is due.
+ */
+bool DutyCyclePlanner::isStatisticDue( const RtcPotState &state, const DutyCycleIntervals &intervals, uint64_t now )
+{
+    return statisticDeadline( state, intervals ) <= now;
+}
+
+/**
+ * Check if the active warning should be (re)published.
+ *
+ * @param state     The state kept in RTC memory.
+ * @param intervals The configured intervals.
+ * @param now       The current time in milliseconds.
+ * @return bool - True if an warning publication is due.
+ */
+bool DutyCyclePlanner::isWarningDue( const RtcPotState &state, const DutyCycleIntervals &intervals, uint64_t now )
+{
+    return warningDeadline( state, intervals ) <= now;
+}
+
+/**
+ * Compute how long the pot can sleep until the first thing becomes due. The radio only
+ * gets enabled at the next wake up when an publication is due at that moment, waking up
+ * without the radio costs a fraction of the energy.
+ *
+ * @param state         The state kept in RTC memory.
+ * @param intervals     The configured intervals.
+ * @param now           The current time in milliseconds.
+ * @param radioNeeded   Set to true if something has to be published at the next wake up.
+ * @return uint32_t - The time in milliseconds to sleep.
+ */
+uint32_t DutyCyclePlanner::computeSleepTime( const RtcPotState &state, const DutyCycleIntervals &intervals, uint64_t now, bool *radioNeeded )
+{
+    uint64_t measurementTime = measurementDeadline( state, intervals );
+    uint64_t publishTime = statisticDeadline( state, intervals );
+    uint64_t warningTime = warningDeadline( state, intervals );
+
+    if( warningTime < publishTime )
+    {
+        publishTime = warningTime;
+    }
+
+    uint64_t wakeUpTime = measurementTime < publishTime ? measurementTime : publishTime;
+    uint64_t sleepTime = wakeUpTime > now ? wakeUpTime - now : 0;
+
+    if( sleepTime < DUTY_CYCLE_MIN_SLEEP_TIME )
+    {
+        sleepTime = DUTY_CYCLE_MIN_SLEEP_TIME;
+    }
+    if( sleepTime > DUTY_CYCLE_MAX_SLEEP_TIME )
+    {
+        sleepTime = DUTY_CYCLE_MAX_SLEEP_TIME;
+    }
+
+    *radioNeeded = publishTime <= now + sleepTime;
+    return (uint32_t) sleepTime;
+}
+
+/**
+ * Return the time something becomes due.
+ *
+ * @param lastTime  The last time in milliseconds it happened.
+ * @param interval  The interval in milliseconds, 0 means it never becomes due.
+ * @return uint64_t - The time in milliseconds it becomes due or UINT64_MAX if it never does.
+ */
+uint64_t DutyCyclePlanner::nextDeadline( uint64_t lastTime, uint32_t interval )
+{
+    return interval == 0 ? UINT64_MAX : lastTime + interval;
+}
+
+/**
+ * Return the time the next soil measurement is due, but not before the water of the last
+ * watering had time to spread through the soil.
+ */
+uint64_t DutyCyclePlanner::measurementDeadline( const RtcPotState &state, const DutyCycleIntervals &intervals )
+{
+    uint64_t deadline = nextDeadline( state.lastMeasurementTime, intervals.measurementInterval );
+    uint64_t soakedTime = state.lastGivingWaterTime + intervals.sleepAfterGivingWater;
+
+    if( deadline != UINT64_MAX && state.lastGivingWaterTime > 0 && soakedTime > deadline )
+    {
+        deadline = soakedTime;
+    }
+    return deadline;
+}
+
+/**
+ * Return the time the next statistic publication is due.
+ */
+uint64_t DutyCyclePlanner::statisticDeadline( const RtcPotState &state, const DutyCycleIntervals &intervals )
+{
+    return nextDeadline( state.lastPublishStatisticsTime, intervals.statisticInterval );
+}
+
+/**
+ * Return the time the active warning has to be (re)published. Without an active warning it
+ * never becomes due, an new warning is due right away and an failed one gets retried.
+ */
+uint64_t DutyCyclePlanner::warningDeadline( const RtcPotState &state, const DutyCycleIntervals &intervals )
+{
+    if( state.currentWarning == 0 )
+    {
+        return UINT64_MAX;
+    }
+    if( state.currentWarning != state.publishedWarning )
+    {
+        return state.warningAttempts == 0 ? 0 : state.lastWarningAttemptTime + DUTY_CYCLE_RETRY_TIME;
+    }
+    return nextDeadline( state.lastPublishWarningTime, intervals.warningInterval );
+}
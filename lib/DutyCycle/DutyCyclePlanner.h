@@ -0,0 +1,138 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ *
+ * This header contains the state that survives deep sleep and the planner that decides
+ * what is due after waking up and how long the pot can sleep afterwards. It doesn't use
+ * any Arduino functions so the same planning code can run in the host simulations.
+ */
+#ifndef WATERUP_PLANTPOT_DUTYCYCLEPLANNER_H
+#define WATERUP_PLANTPOT_DUTYCYCLEPLANNER_H
+
+#include <stdint.h>
+#include <MeasurementCadence.h> // This library contains the code for adapting the measurement interval.
+
+#define DUTY_CYCLE_MIN_SLEEP_TIME 1000 // The minimum time in milliseconds the pot goes to deep sleep.
+#define DUTY_CYCLE_MAX_SLEEP_TIME 10800000 // The maximum time in milliseconds the ESP8266 can deep sleep in one go.
+#define DUTY_CYCLE_RETRY_TIME 60000 // The time in milliseconds to wait before retrying an failed warning publication.
+#define DUTY_CYCLE_TLS_SESSION_SIZE 88 // The size in bytes of the TLS session parameters of BearSSL, kept so the next wake up can resume the session.
+
+/**
+ * Data structure that contains the pot state that is kept in RTC memory during deep sleep.
+ * All times are milliseconds since the first power up, the sleep time gets added before
+ * going to sleep because millis() starts at zero after every wake up.
+ */
+struct RtcPotState
+{
+    uint32_t checksum; // The CRC32 of all fields below, used to detect an cold boot.
+    uint32_t magic; // An constant that also changes when the layout of this structure changes.
+    uint64_t elapsedTime; // The time at the moment the pot woke up.
+    uint64_t lastMeasurementTime; // The last time we measured the soil moisture.
+    uint64_t lastPublishStatisticsTime; // The last time we published statistics to the broker.
+    uint64_t lastPublishWarningTime; // The last time we published an warning to the broker.
+    uint64_t lastGivingWaterTime; // The last time we gave water.
+    uint64_t lastWarningAttemptTime; // The last time we tried to publish an warning that didn't reach the broker.
+    uint32_t statisticCounter; // The statistic message publication counter.
+    uint32_t warningCounter; // The warning message publication counter.
+    uint32_t wakeUpCounter; // The amount of times the pot woke up from deep sleep.
+    uint32_t doseTime; // The milliseconds, or millilitres with an flow meter, of the last adaptive dose, 0 when its response is learned.
+    uint32_t dispensedVolume; // The total volume in millilitres the flow meter measured.
+    int16_t moistureBeforeDose; // The percentage of moisture in the soil before the last adaptive dose.
+    CadenceState cadence; // The adaptive measurement interval and the previous measurement.
+    uint8_t currentWarning; // The warning that is active at the moment.
+    uint8_t publishedWarning; // The last warning that reached the broker.
+    uint8_t warningChannel; // The channel the active warning belongs to.
+    uint8_t radioEnabled; // Boolean to check if the radio was enabled for this wake up.
+    uint8_t warningAttempts; // The amount of failed attempts to publish the active warning.
+    uint8_t tlsSession[DUTY_CYCLE_TLS_SESSION_SIZE]; // The TLS session of the last connection to the broker, all zeros when there is none.
+};
+
+/**
+ * Data structure that contains the intervals the planner uses. An interval of 0 disables it.
+ */
+struct DutyCycleIntervals
+{
+    uint32_t measurementInterval; // The interval in milliseconds to take pot measurements.
+    uint32_t statisticInterval; // The interval in milliseconds we publish statistics to the broker.
+    uint32_t warningInterval; // The interval in milliseconds to republish warning messages to the broker.
+    uint32_t sleepAfterGivingWater; // The time in milliseconds to wait before giving water again.
+};
+
+/**
+ * This class is used to decide what the pot should do after waking up and when it should
+ * wake up again.
+ */
+class DutyCyclePlanner
+{
+public:
+    /**
+     * This function checks if an interval passed since the last time something happened.
+     *
+     * @param lastTime  The last time in milliseconds it happened.
+     * @param interval  The interval in milliseconds, 0 means it never becomes due.
+     * @param now       The current time in milliseconds.
+     * @return bool - True if it is due.
+     */
+    static bool isDue( uint64_t lastTime, uint32_t interval, uint64_t now );
+
+    /**
+     * This function checks if the soil should be measured and the plant may receive water.
+     *
+     * @param state     The state kept in RTC memory.
+     * @param intervals The configured intervals.
+     * @param now       The current time in milliseconds.
+     * @return bool - True if an measurement is due.
+     */
+    static bool isMeasurementDue( const RtcPotState &state, const DutyCycleIntervals &intervals, uint64_t now );
+
+    /**
+     * This function checks if statistics should be published.
+     *
+     * @param state     The state kept in RTC memory.
+     * @param intervals The configured intervals.
+     * @param now       The current time in milliseconds.
+     * @return bool - True if an statistic publication is due.
+     */
+    static bool isStatisticDue( const RtcPotState &state, const DutyCycleIntervals &intervals, uint64_t now );
+
+    /**
+     * This function checks if the active warning should be (re)published. An warning that
+     * didn't reach the broker yet gets retried after DUTY_CYCLE_RETRY_TIME.
+     *
+     * @param state     The state kept in RTC memory.
+     * @param intervals The configured intervals.
+     * @param now       The current time in milliseconds.
+     * @return bool - True if an warning publication is due.
+     */
+    static bool isWarningDue( const RtcPotState &state, const DutyCycleIntervals &intervals, uint64_t now );
+
+    /**
+     * This function computes how long the pot can sleep until the first thing becomes due
+     * and if the radio is needed at that wake up.
+     *
+     * @param state         The state kept in RTC memory.
+     * @param intervals     The configured intervals.
+     * @param now           The current time in milliseconds.
+     * @param radioNeeded   Set to true if something has to be published at the next wake up.
+     * @return uint32_t - The time in milliseconds to sleep.
+     */
+    static uint32_t computeSleepTime( const RtcPotState &state, const DutyCycleIntervals &intervals, uint64_t now, bool *radioNeeded );
+
+private:
+    /**
+     * This function returns the time something becomes due.
+     *
+     * @param lastTime  The last time in milliseconds it happened.
+     * @param interval  The interval in milliseconds, 0 means it never becomes due.
+     * @return uint64_t - The time in milliseconds it becomes due or UINT64_MAX if it never does.
+     */
+    static uint64_t nextDeadline( uint64_t lastTime, uint32_t interval );
+
+    /**
+     * These functions return the time the measurement, statistic and warning become due.
+     */
+    static uint64_t measurementDeadline( const RtcPotState &state, const DutyCycleIntervals &intervals );
+    static uint64_t statisticDeadline( const RtcPotState &state, const DutyCycleIntervals &intervals );
+    static uint64_t warningDeadline( const RtcPotState &state, const DutyCycleIntervals &intervals );
+};
+
+#endif //WATERUP_PLANTPOT_DUTYCYCLEPLANNER_H
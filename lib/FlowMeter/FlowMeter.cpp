@@ -0,0 +1,109 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ */
+#include "FlowMeter.h"
+
+uint8_t FlowMeter::pulsePin = 0; // Initiate the static pulse pin, it is set by the constructor.
+volatile uint8_t FlowMeter::cutOffPin = 0; // Initiate the pin of the running pump.
+volatile bool FlowMeter::dosing = false; // Initiate the dosing flag, no dose is in progress.
+volatile uint32_t FlowMeter::pulseCount = 0; // Initiate the pulse counter.
+volatile uint32_t FlowMeter::targetPulses = 0; // Initiate the target of the dose.
+volatile uint32_t FlowMeter::lastPulseTime = 0; // Initiate the time of the last pulse.
+
+/**
+ * The constructor will save the pin connected to the flow meter.
+ *
+ * @param pulsePin  The pin connected to the signal wire of the flow meter.
+ */
+FlowMeter::FlowMeter( uint8_t pulsePin )
+{
+    FlowMeter::pulsePin = pulsePin;
+}
+
+/**
+ * Setup the I/O pin and attach the interrupt handler. The signal of the flow meter is an open
+ * collector, so the pin uses its pull up and every pulse is an falling edge.
+ */
+void FlowMeter::setup()
+{
+    pinMode( FlowMeter::pulsePin, INPUT_PULLUP );
+    attachInterrupt( digitalPinToInterrupt( FlowMeter::pulsePin ), &FlowMeter::handlePulseInterrupt, FALLING );
+}
+
+/**
+ * Start counting the pulses of an new dose. The volume is converted to pulses once so the
+ * interrupt handler only has to compare two counters. An volume smaller than one pulse still
+ * waits for one pulse, else the pump would be cut off before it started.
+ *
+ * @param volume        The volume in millilitres to give.
+ * @param cutOffPin     The pin that switches the running water pump.
+ */
+void FlowMeter::startDose( uint32_t volume, uint8_t cutOffPin )
+{
+    uint32_t pulses = volume * FLOW_METER_PULSES_PER_LITRE / 1000;
+
+    noInterrupts();
+    FlowMeter::cutOffPin = cutOffPin;
+    FlowMeter::pulseCount = 0;
+    FlowMeter::targetPulses = pulses > 0 ? pulses : 1;
+    FlowMeter::lastPulseTime = millis();
+    FlowMeter::dosing = true;
+    interrupts();
+}
+
+/**
+ * Stop counting the pulses of the dose.
+ */
+void FlowMeter::stopDose()
+{
+    FlowMeter::dosing = false;
+}
+
+/**
+ * Check if the target volume of the dose was given.
+ *
+ * @return bool - True when the interrupt cut the pump off.
+ */
+bool FlowMeter::isDoseComplete()
+{
+    return FlowMeter::pulseCount >= FlowMeter::targetPulses;
+}
+
+/**
+ * Return the volume of water that passed the flow meter during the dose.
+ *
+ * @return uint32_t - The volume in millilitres.
+ */
+uint32_t FlowMeter::getDispensedVolume()
+{
+    return FlowMeter::pulseCount * 1000 / FLOW_METER_PULSES_PER_LITRE;
+}
+
+/**
+ * Return the time since the last pulse or the start of the dose.
+ *
+ * @return uint32_t - The time in milliseconds.
+ */
+uint32_t FlowMeter::getTimeSinceLastPulse()
+{
+    return millis() - FlowMeter::lastPulseTime;
+}
+
+/**
+ * Count an pulse of the flow meter and cut the pump off when the target volume is reached.
+ * Pulses that arrive while no dose is in progress, like water that runs out of the line
+ * after the pump stopped, are ignored.
+ */
+void ICACHE_RAM_ATTR FlowMeter::handlePulseInterrupt()
+{
+    if( !FlowMeter::dosing )
+    {
+        return;
+    }
+
+    FlowMeter::lastPulseTime = millis();
+    if( ++FlowMeter::pulseCount >= FlowMeter::targetPulses )
+    {
+        digitalWrite( FlowMeter::cutOffPin, LOW );
+    }
+}
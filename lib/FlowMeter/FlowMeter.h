@@ -0,0 +1,90 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ *
+ * This library counts the pulses of an hall effect flow meter in the water line so the pot
+ * can give an volume of water instead of running the pump for an time. The pulses are counted
+ * from an pin interrupt, when the target is reached the interrupt cuts the pump right away so
+ * the dose doesn't overshoot by the time it takes the main loop to notice.
+ */
+#ifndef WATERUP_PLANTPOT_FLOWMETER_H
+#define WATERUP_PLANTPOT_FLOWMETER_H
+
+#include <Arduino.h> // Include this library for using basic system functions and variables.
+#include "../PotDebugUtitities.h" // This header contains some debug utilities.
+
+#define FLOW_METER_PULSES_PER_LITRE 450 // The amount of pulses the flow meter gives for one litre of water.
+#define FLOW_METER_NO_FLOW_TIMEOUT 3000 // The time in milliseconds without pulses after which the water stopped flowing.
+
+class FlowMeter;
+
+/**
+ * This class is used to measure and cut off the volume of water the pump gives.
+ */
+class FlowMeter
+{
+public:
+    /**
+     * The constructor will save the pin connected to the flow meter.
+     *
+     * @param pulsePin  The pin connected to the signal wire of the flow meter.
+     */
+    explicit FlowMeter( uint8_t pulsePin );
+
+    /**
+     * This function will setup the I/O pin and attach the pulse interrupt.
+     */
+    void setup();
+
+    /**
+     * This function will start counting the pulses of an new dose. The pump should be switched
+     * on right after this, the interrupt switches it off when the volume is given.
+     *
+     * @param volume        The volume in millilitres to give.
+     * @param cutOffPin     The pin that switches the running water pump.
+     */
+    void startDose( uint32_t volume, uint8_t cutOffPin );
+
+    /**
+     * This function will stop counting the pulses of the dose, pulses of water that is still
+     * running out of the line after this aren't counted.
+     */
+    void stopDose();
+
+    /**
+     * This function checks if the target volume of the dose was given.
+     *
+     * @return bool - True when the interrupt cut the pump off.
+     */
+    bool isDoseComplete();
+
+    /**
+     * This function returns the volume of water that passed the flow meter during the dose.
+     *
+     * @return uint32_t - The volume in millilitres.
+     */
+    uint32_t getDispensedVolume();
+
+    /**
+     * This function returns the time since the last pulse or the start of the dose, so the
+     * pump can be stopped when the reservoir or the water line is empty.
+     *
+     * @return uint32_t - The time in milliseconds.
+     */
+    uint32_t getTimeSinceLastPulse();
+
+private:
+    static uint8_t pulsePin; // The pin connected to the signal wire of the flow meter.
+    static volatile uint8_t cutOffPin; // The pin of the running water pump, shared with the interrupt handler.
+    static volatile bool dosing; // True while the pulses of an dose are counted.
+    static volatile uint32_t pulseCount; // The amount of pulses counted since the start of the dose.
+    static volatile uint32_t targetPulses; // The amount of pulses at which the pump is cut off.
+    static volatile uint32_t lastPulseTime; // The time in milliseconds of the last pulse.
+
+    /**
+     * This interrupt handler gets called on every pulse of the flow meter and cuts the pump
+     * off when the target volume is reached.
+     */
+    static void handlePulseInterrupt();
+};
+
+#endif //WATERUP_PLANTPOT_FLOWMETER_H
@@ -106,7 +106,7 @@ void LedController::ledShow(){
 void LedController::setColorBasedOnWaterLevel(int waterLevel){
 
     current = millis();
-    if( current - previous > 1000){
+    if( current - previous >= LED_REFRESH_INTERVAL ){
 
         if( waterLevel < 35 )
         {
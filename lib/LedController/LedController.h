@@ -18,6 +18,7 @@
 
 #define PIXEL_PIN 14    // Digital IO pin connected to the NeoPixels.
 #define PIXEL_COUNT 25  // Number of led's
+#define LED_REFRESH_INTERVAL 1000 // The interval in milliseconds the led color gets updated.
 
 
 class LedController;
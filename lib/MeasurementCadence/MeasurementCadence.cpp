@@ -0,0 +1,130 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ */
+#include "MeasurementCadence.h"
+
+/**
+ * Create an cadence without previous measurement.
+ *
+ * @param settings          An pointer to the configured floor and ceiling interval.
+ * @param initialInterval   The interval in milliseconds until the readings can be compared.
+ */
+MeasurementCadence::MeasurementCadence( CadenceSettings *settings, uint32_t initialInterval )
+{
+    this->settings = settings;
+    this->initialInterval = initialInterval;
+    this->state.interval = 0;
+    this->state.lastMoisture = 0;
+    this->state.lastWaterLevel = 0;
+}
+
+/**
+ * Compare an measurement with the previous one and compute the interval until the next one.
+ * The change is measured over the current interval, so an slow drift that adds up over an
+ * long interval still brings the interval down again. An reading that moves towards its
+ * threshold halves the interval, an reading that rests close to its threshold backs off like
+ * any other stable reading. The moisture of an watered pot stays around its threshold.
+ *
+ * @param moisture              The percentage of moisture in the soil.
+ * @param waterLevel            The percentage of water left in the reservoir.
+ * @param moistureThreshold     The moisture level at which the plant receives water.
+ * @param waterLevelThreshold   The water level at which the user gets warned.
+ * @return uint32_t - The interval in milliseconds until the next measurement.
+ */
+uint32_t MeasurementCadence::update( int16_t moisture, int16_t waterLevel, int16_t moistureThreshold, int16_t waterLevelThreshold )
+{
+    uint32_t interval = this->getInterval();
+
+    if( this->state.interval != 0 )
+    {
+        int16_t moistureChange = moisture > this->state.lastMoisture ? moisture - this->state.lastMoisture : this->state.lastMoisture - moisture;
+        int16_t waterLevelChange = waterLevel > this->state.lastWaterLevel ? waterLevel - this->state.lastWaterLevel : this->state.lastWaterLevel - waterLevel;
+        int16_t change = moistureChange > waterLevelChange ? moistureChange : waterLevelChange;
+
+        bool approachingThreshold = this->approaches( moisture, this->state.lastMoisture, moistureThreshold ) ||
+                                    this->approaches( waterLevel, this->state.lastWaterLevel, waterLevelThreshold );
+
+        if( change >= CADENCE_FAST_CHANGE )
+        {
+            interval = 0; // Limited to the floor below.
+        }
+        else if( change > CADENCE_STABLE_CHANGE || approachingThreshold )
+        {
+            interval /= 2;
+        }
+        else
+        {
+            interval = interval > 0x7FFFFFFF ? 0xFFFFFFFF : interval * 2;
+        }
+    }
+
+    this->state.interval = this->limit( interval );
+    this->state.lastMoisture = moisture;
+    this->state.lastWaterLevel = waterLevel;
+    return this->state.interval;
+}
+
+/**
+ * Return the current interval between two measurements. The settings can change at any time
+ * so the interval gets limited again.
+ *
+ * @return uint32_t - The interval in milliseconds, within the configured floor and ceiling.
+ */
+uint32_t MeasurementCadence::getInterval()
+{
+    return this->limit( this->state.interval != 0 ? this->state.interval : this->initialInterval );
+}
+
+/**
+ * Return the state so it can be kept during deep sleep.
+ *
+ * @return CadenceState - The current state.
+ */
+CadenceState MeasurementCadence::getState()
+{
+    return this->state;
+}
+
+/**
+ * Restore an state that was kept during deep sleep.
+ *
+ * @param cadenceState  The state returned by getState() before the pot went to sleep.
+ */
+void MeasurementCadence::restore( CadenceState cadenceState )
+{
+    this->state = cadenceState;
+}
+
+/**
+ * Limit an interval to the configured floor and ceiling, an ceiling below the floor is
+ * treated as an fixed interval at the floor.
+ *
+ * @param interval  The interval in milliseconds.
+ * @return uint32_t - The limited interval in milliseconds.
+ */
+uint32_t MeasurementCadence::limit( uint32_t interval )
+{
+    uint32_t floor = this->settings->measurementFloor > CADENCE_MIN_INTERVAL ? this->settings->measurementFloor : CADENCE_MIN_INTERVAL;
+    uint32_t ceiling = this->settings->measurementCeiling > floor ? this->settings->measurementCeiling : floor;
+
+    if( interval < floor )
+    {
+        return floor;
+    }
+    return interval > ceiling ? ceiling : interval;
+}
+
+/**
+ * Check if an reading close to its threshold moved towards it since the previous measurement.
+ *
+ * @param reading           The percentage of the current measurement.
+ * @param lastReading       The percentage of the previous measurement.
+ * @param threshold         The percentage at which the pot acts on the reading.
+ * @return bool - True if the reading is within CADENCE_THRESHOLD_MARGIN and got closer to the threshold.
+ */
+bool MeasurementCadence::approaches( int16_t reading, int16_t lastReading, int16_t threshold )
+{
+    int16_t distance = reading > threshold ? reading - threshold : threshold - reading;
+    int16_t lastDistance = lastReading > threshold ? lastReading - threshold : threshold - lastReading;
+    return distance <= CADENCE_THRESHOLD_MARGIN && distance < lastDistance;
+}
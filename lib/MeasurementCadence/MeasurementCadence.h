@@ -0,0 +1,106 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ *
+ * This library decides how often the pot measures. While the soil moisture or the water level
+ * changes quickly the pot measures at the configured floor interval, an small change or an
+ * reading that moves towards its threshold halves the interval. When the readings stay the
+ * same the interval doubles after every measurement until it reaches the configured ceiling,
+ * so an stable pot wakes its sensors and radio less.
+ * It doesn't use any Arduino functions so it can run in the host simulations.
+ */
+#ifndef WATERUP_PLANTPOT_MEASUREMENTCADENCE_H
+#define WATERUP_PLANTPOT_MEASUREMENTCADENCE_H
+
+#include <stdint.h>
+#include "../CommonDataTypes.h" // This header contains some data structures that are shared between libraries.
+
+#define CADENCE_STABLE_CHANGE 1 // The change in percent between two measurements that still counts as stable.
+#define CADENCE_FAST_CHANGE 5 // The change in percent between two measurements that counts as an real event.
+#define CADENCE_THRESHOLD_MARGIN 3 // The distance in percent to an threshold within which an reading that moves towards it halves the interval.
+#define CADENCE_MIN_INTERVAL 1000 // The smallest interval in milliseconds, also used when the floor is not configured.
+
+/**
+ * Data structure that contains the state of the cadence, it is small enough to keep in RTC
+ * memory during deep sleep. An interval of 0 means there is no previous measurement yet.
+ */
+struct CadenceState
+{
+    uint32_t interval; // The current interval in milliseconds between two measurements.
+    int16_t lastMoisture; // The percentage of moisture in the soil at the previous measurement.
+    int16_t lastWaterLevel; // The percentage of water in the reservoir at the previous measurement.
+};
+
+/**
+ * This class is used to adapt the measurement interval to how fast the readings change.
+ */
+class MeasurementCadence
+{
+public:
+    /**
+     * The constructor will create an cadence without previous measurement.
+     *
+     * @param settings          An pointer to the configured floor and ceiling interval.
+     * @param initialInterval   The interval in milliseconds until the readings can be compared.
+     */
+    MeasurementCadence( CadenceSettings *settings, uint32_t initialInterval );
+
+    /**
+     * This function compares an measurement with the previous one and computes the interval
+     * until the next measurement. A large change drops the interval to the floor, an small
+     * change or an reading that moves towards its threshold halves it and an stable reading
+     * doubles it.
+     *
+     * @param moisture              The percentage of moisture in the soil.
+     * @param waterLevel            The percentage of water left in the reservoir.
+     * @param moistureThreshold     The moisture level at which the plant receives water.
+     * @param waterLevelThreshold   The water level at which the user gets warned.
+     * @return uint32_t - The interval in milliseconds until the next measurement.
+     */
+    uint32_t update( int16_t moisture, int16_t waterLevel, int16_t moistureThreshold, int16_t waterLevelThreshold );
+
+    /**
+     * This function returns the current interval between two measurements.
+     *
+     * @return uint32_t - The interval in milliseconds, within the configured floor and ceiling.
+     */
+    uint32_t getInterval();
+
+    /**
+     * This function returns the state so it can be kept during deep sleep.
+     *
+     * @return CadenceState - The current state.
+     */
+    CadenceState getState();
+
+    /**
+     * This function restores an state that was kept during deep sleep.
+     *
+     * @param cadenceState  The state returned by getState() before the pot went to sleep.
+     */
+    void restore( CadenceState cadenceState );
+
+private:
+    CadenceSettings *settings; // The configured floor and ceiling interval.
+    CadenceState state; // The current interval and the previous measurement.
+    uint32_t initialInterval; // The interval used until there is an previous measurement.
+
+    /**
+     * This function limits an interval to the configured floor and ceiling.
+     *
+     * @param interval  The interval in milliseconds.
+     * @return uint32_t - The limited interval in milliseconds.
+     */
+    uint32_t limit( uint32_t interval );
+
+    /**
+     * This function checks if an reading close to its threshold moved towards it.
+     *
+     * @param reading           The percentage of the current measurement.
+     * @param lastReading       The percentage of the previous measurement.
+     * @param threshold         The percentage at which the pot acts on the reading.
+     * @return bool - True if the reading is within CADENCE_THRESHOLD_MARGIN and got closer to the threshold.
+     */
+    bool approaches( int16_t reading, int16_t lastReading, int16_t threshold );
+};
+
+#endif //WATERUP_PLANTPOT_MEASUREMENTCADENCE_H
@@ -0,0 +1,375 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ */
+#include "MeasurementHistory.h"
+
+/**
+ * Create an empty history.
+ */
+MeasurementHistory::MeasurementHistory()
+{
+    this->clear();
+}
+
+/**
+ * Remove all records from the history, the encoded bytes are left as they are because
+ * the block lengths tell which bytes are in use.
+ */
+void MeasurementHistory::clear()
+{
+    this->oldestBlock = 0;
+    this->blockCount = 0;
+    this->recordCount = 0;
+    this->lastInterval = 0;
+    this->last.timestamp = 0;
+    this->last.moisture = 0;
+    this->last.waterLevel = 0;
+    this->last.events = 0;
+}
+
+/**
+ * Append an measurement to the history. The record is encoded as the change since the last
+ * record, when it doesn't fit in the newest block an new block is started with an record
+ * containing the absolute values.
+ *
+ * @param timestamp     The time in seconds of the measurement, it can't be older than the previous one.
+ * @param moisture      The percentage of moisture in the soil.
+ * @param waterLevel    The percentage of water left in the reservoir.
+ * @param events        The HISTORY_EVENT flags of things that happened since the previous record.
+ */
+void MeasurementHistory::append( uint32_t timestamp, int16_t moisture, int16_t waterLevel, uint8_t events )
+{
+    uint8_t encoded[MEASUREMENT_HISTORY_MAX_RECORD_SIZE];
+    uint8_t length = 0;
+    int32_t interval = 0;
+
+    if( this->blockCount == 0 )
+    {
+        this->startBlock();
+    }
+
+    uint8_t newest = ( this->oldestBlock + this->blockCount - 1 ) % MEASUREMENT_HISTORY_BLOCKS;
+
+    if( this->blockRecords[newest] > 0 )
+    {
+        interval = (int32_t)( timestamp - this->last.timestamp );
+        uint32_t intervalChange = zigzagEncode( interval - this->lastInterval );
+        uint32_t moistureChange = zigzagEncode( moisture - this->last.moisture );
+        uint32_t waterLevelChange = zigzagEncode( waterLevel - this->last.waterLevel );
+
+        if( events == 0 && intervalChange < 4 && moistureChange < 4 && waterLevelChange < 8 )
+        {
+            encoded[length++] = (uint8_t)( intervalChange << 5 | moistureChange << 3 | waterLevelChange );
+        }
+        else
+        {
+            encoded[length++] = (uint8_t)( 0x80 | ( events != 0 ? 1 : 0 ));
+            length += writeVarint( &encoded[length], intervalChange );
+            length += writeVarint( &encoded[length], moistureChange );
+            length += writeVarint( &encoded[length], waterLevelChange );
+            if( events != 0 )
+            {
+                encoded[length++] = events;
+            }
+        }
+
+        if( length > MEASUREMENT_HISTORY_BLOCK_SIZE - this->blockLength[newest] ) // Doesn't fit, start an new block.
+        {
+            this->startBlock();
+            newest = ( this->oldestBlock + this->blockCount - 1 ) % MEASUREMENT_HISTORY_BLOCKS;
+            length = 0;
+        }
+    }
+
+    if( this->blockRecords[newest] == 0 ) // The first record of an block contains the absolute values.
+    {
+        interval = 0;
+        length = writeVarint( encoded, timestamp );
+        length += writeVarint( &encoded[length], zigzagEncode( moisture ));
+        length += writeVarint( &encoded[length], zigzagEncode( waterLevel ));
+        encoded[length++] = events;
+    }
+
+    uint8_t *destination = &this->buffer[newest][this->blockLength[newest]];
+    for( uint8_t i = 0; i < length; i++ )
+    {
+        destination[i] = encoded[i];
+    }
+
+    this->blockLength[newest] += length;
+    this->blockRecords[newest]++;
+    this->recordCount++;
+    this->lastInterval = interval;
+    this->last.timestamp = timestamp;
+    this->last.moisture = moisture;
+    this->last.waterLevel = waterLevel;
+    this->last.events = events;
+}
+
+/**
+ * Return the latest record in the history.
+ *
+ * @param record    The record to write the latest measurement to.
+ * @return bool - False if the history is empty.
+ */
+bool MeasurementHistory::getLatest( HistoryRecord *record )
+{
+    if( this->recordCount == 0 )
+    {
+        return false;
+    }
+
+    *record = this->last;
+    return true;
+}
+
+/**
+ * Start an iteration at the oldest record in the history.
+ *
+ * @param cursor    The cursor to initialize.
+ */
+void MeasurementHistory::startIteration( HistoryCursor *cursor )
+{
+    cursor->block = this->oldestBlock;
+    cursor->blocksLeft = this->blockCount;
+    cursor->offset = 0;
+    cursor->previousInterval = 0;
+    cursor->previous.timestamp = 0;
+    cursor->previous.moisture = 0;
+    cursor->previous.waterLevel = 0;
+    cursor->previous.events = 0;
+}
+
+/**
+ * Start an iteration at the first record at or after an timestamp. The first record of
+ * every block contains its timestamp, so whole blocks before the timestamp are skipped.
+ *
+ * @param cursor    The cursor to initialize.
+ * @param timestamp The time in seconds of the first record to read.
+ */
+void MeasurementHistory::startIterationAt( HistoryCursor *cursor, uint32_t timestamp )
+{
+    this->startIteration( cursor );
+
+    while( cursor->blocksLeft > 1 )
+    {
+        uint8_t nextBlock = ( cursor->block + 1 ) % MEASUREMENT_HISTORY_BLOCKS;
+        uint8_t offset = 0;
+        if( readVarint( this->buffer[nextBlock], &offset ) > timestamp )
+        {
+            break;
+        }
+        cursor->block = nextBlock;
+        cursor->blocksLeft--;
+    }
+
+    HistoryCursor position;
+    HistoryRecord record;
+    do
+    {
+        position = *cursor;
+    }
+    while( this->next( cursor, &record ) && record.timestamp < timestamp );
+
+    *cursor = position; // Rewind to the first record at or after the timestamp.
+}
+
+/**
+ * Read the next record of an iteration, moving to the next block when the current one
+ * is read completely.
+ *
+ * @param cursor    The cursor of the iteration.
+ * @param record    The record to write the measurement to.
+ * @return bool - False when there are no records left.
+ */
+bool MeasurementHistory::next( HistoryCursor *cursor, HistoryRecord *record )
+{
+    while( cursor->blocksLeft > 0 )
+    {
+        if( cursor->offset < this->blockLength[cursor->block] )
+        {
+            this->decodeRecord( cursor, record );
+            return true;
+        }
+
+        cursor->block = ( cursor->block + 1 ) % MEASUREMENT_HISTORY_BLOCKS;
+        cursor->blocksLeft--;
+        cursor->offset = 0;
+    }
+    return false;
+}
+
+/**
+ * Compute the aggregates of all records at or after an timestamp.
+ *
+ * @param since     The time in seconds of the start of the window.
+ * @param aggregate The aggregate to write the result to.
+ */
+void MeasurementHistory::aggregate( uint32_t since, HistoryAggregate *aggregate )
+{
+    HistoryCursor cursor;
+    HistoryRecord record;
+    int32_t moistureSum = 0;
+    int32_t waterLevelSum = 0;
+
+    aggregate->count = 0;
+    aggregate->pumpStarts = 0;
+    aggregate->minimumMoisture = aggregate->maximumMoisture = aggregate->averageMoisture = 0;
+    aggregate->minimumWaterLevel = aggregate->maximumWaterLevel = aggregate->averageWaterLevel = 0;
+
+    this->startIterationAt( &cursor, since );
+    while( this->next( &cursor, &record ))
+    {
+        if( aggregate->count == 0 || record.moisture < aggregate->minimumMoisture ) aggregate->minimumMoisture = record.moisture;
+        if( aggregate->count == 0 || record.moisture > aggregate->maximumMoisture ) aggregate->maximumMoisture = record.moisture;
+        if( aggregate->count == 0 || record.waterLevel < aggregate->minimumWaterLevel ) aggregate->minimumWaterLevel = record.waterLevel;
+        if( aggregate->count == 0 || record.waterLevel > aggregate->maximumWaterLevel ) aggregate->maximumWaterLevel = record.waterLevel;
+        if( record.events & HISTORY_EVENT_PUMP_STARTED ) aggregate->pumpStarts++;
+
+        moistureSum += record.moisture;
+        waterLevelSum += record.waterLevel;
+        aggregate->count++;
+    }
+
+    if( aggregate->count > 0 )
+    {
+        aggregate->averageMoisture = (int16_t)( moistureSum / aggregate->count );
+        aggregate->averageWaterLevel = (int16_t)( waterLevelSum / aggregate->count );
+    }
+}
+
+/**
+ * Return the amount of records in the history.
+ */
+uint16_t MeasurementHistory::getRecordCount()
+{
+    return this->recordCount;
+}
+
+/**
+ * Return the amount of bytes used by the records in the history.
+ */
+uint16_t MeasurementHistory::getUsedBytes()
+{
+    uint16_t usedBytes = 0;
+    for( uint8_t i = 0; i < this->blockCount; i++ )
+    {
+        usedBytes += this->blockLength[( this->oldestBlock + i ) % MEASUREMENT_HISTORY_BLOCKS];
+    }
+    return usedBytes;
+}
+
+/**
+ * Start an new block after the newest one, when all blocks are in use the oldest block
+ * and its records are dropped.
+ */
+void MeasurementHistory::startBlock()
+{
+    if( this->blockCount == MEASUREMENT_HISTORY_BLOCKS )
+    {
+        this->recordCount -= this->blockRecords[this->oldestBlock];
+        this->oldestBlock = ( this->oldestBlock + 1 ) % MEASUREMENT_HISTORY_BLOCKS;
+        this->blockCount--;
+    }
+
+    uint8_t newBlock = ( this->oldestBlock + this->blockCount ) % MEASUREMENT_HISTORY_BLOCKS;
+    this->blockLength[newBlock] = 0;
+    this->blockRecords[newBlock] = 0;
+    this->blockCount++;
+}
+
+/**
+ * Read the record at the offset of an cursor and move the cursor to the next record.
+ */
+void MeasurementHistory::decodeRecord( HistoryCursor *cursor, HistoryRecord *record )
+{
+    const uint8_t *block = this->buffer[cursor->block];
+
+    if( cursor->offset == 0 ) // The first record of an block contains the absolute values.
+    {
+        record->timestamp = readVarint( block, &cursor->offset );
+        record->moisture = (int16_t) zigzagDecode( readVarint( block, &cursor->offset ));
+        record->waterLevel = (int16_t) zigzagDecode( readVarint( block, &cursor->offset ));
+        record->events = block[cursor->offset++];
+        cursor->previousInterval = 0;
+        cursor->previous = *record;
+        return;
+    }
+
+    uint8_t header = block[cursor->offset++];
+    int32_t intervalChange;
+    int32_t moistureChange;
+    int32_t waterLevelChange;
+
+    if(( header & 0x80 ) == 0 )
+    {
+        intervalChange = zigzagDecode(( header >> 5 ) & 0x03 );
+        moistureChange = zigzagDecode(( header >> 3 ) & 0x03 );
+        waterLevelChange = zigzagDecode( header & 0x07 );
+        record->events = 0;
+    }
+    else
+    {
+        intervalChange = zigzagDecode( readVarint( block, &cursor->offset ));
+        moistureChange = zigzagDecode( readVarint( block, &cursor->offset ));
+        waterLevelChange = zigzagDecode( readVarint( block, &cursor->offset ));
+        record->events = ( header & 0x01 ) ? block[cursor->offset++] : 0;
+    }
+
+    cursor->previousInterval += intervalChange;
+    record->timestamp = cursor->previous.timestamp + cursor->previousInterval;
+    record->moisture = (int16_t)( cursor->previous.moisture + moistureChange );
+    record->waterLevel = (int16_t)( cursor->previous.waterLevel + waterLevelChange );
+    cursor->previous = *record;
+}
+
+/**
+ * Write an value as varint, 7 bits per byte with the high bit set when more bytes follow.
+ *
+ * @return uint8_t - The amount of bytes written.
+ */
+uint8_t MeasurementHistory::writeVarint( uint8_t *destination, uint32_t value )
+{
+    uint8_t length = 0;
+    while( value >= 0x80 )
+    {
+        destination[length++] = (uint8_t)( value | 0x80 );
+        value >>= 7;
+    }
+    destination[length++] = (uint8_t) value;
+    return length;
+}
+
+/**
+ * Read an varint and move the offset past it.
+ */
+uint32_t MeasurementHistory::readVarint( const uint8_t *source, uint8_t *offset )
+{
+    uint32_t value = 0;
+    uint8_t shift = 0;
+    uint8_t byte;
+    do
+    {
+        byte = source[( *offset )++];
+        value |= (uint32_t)( byte & 0x7F ) << shift;
+        shift += 7;
+    }
+    while(( byte & 0x80 ) && shift < 35 );
+    return value;
+}
+
+/**
+ * Map signed values to unsigned ones so small negative changes stay small: 0, -1, 1, -2 become 0, 1, 2, 3.
+ */
+uint32_t MeasurementHistory::zigzagEncode( int32_t value )
+{
+    return ((uint32_t) value << 1 ) ^ (uint32_t)( value >> 31 );
+}
+
+/**
+ * Map zigzag encoded values back to signed ones.
+ */
+int32_t MeasurementHistory::zigzagDecode( uint32_t value )
+{
+    return (int32_t)( value >> 1 ) ^ -(int32_t)( value & 1 );
+}
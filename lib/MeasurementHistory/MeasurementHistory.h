@@ -0,0 +1,185 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ *
+ * This library keeps an compressed history of the pot measurements in ram. The buffer is
+ * split into blocks, every block starts with an record containing the absolute values and
+ * the records after it only contain the changes. Timestamps are stored as the change of the
+ * interval (delta of delta) so an measurement at an fixed interval with small changes takes
+ * one byte. When the buffer is full the oldest block is dropped.
+ *
+ * The firmware only writes the history for now, nothing on the pot reads it back yet. The
+ * iteration and aggregates are there for the features that will publish or serve the history,
+ * until then they are checked by the measurement-history test of the simulation:
+ *   ctest --test-dir simulation/build
+ *
+ * Record encoding:
+ *   - First record of an block: varint timestamp, varint zigzag moisture, varint zigzag
+ *     water level and the event byte.
+ *   - Compact record, one byte 0tt mm www: the zigzag encoded timestamp delta of delta
+ *     (-2..1), moisture change (-2..1) and water level change (-4..3) without events.
+ *   - Full record, byte 1000000e followed by the varint zigzag timestamp delta of delta,
+ *     moisture change, water level change and the event byte when e is set.
+ */
+#ifndef WATERUP_PLANTPOT_MEASUREMENTHISTORY_H
+#define WATERUP_PLANTPOT_MEASUREMENTHISTORY_H
+
+#include <stdint.h>
+
+#ifndef MEASUREMENT_HISTORY_BLOCKS
+#define MEASUREMENT_HISTORY_BLOCKS 32 // The amount of blocks in the history buffer.
+#endif
+#define MEASUREMENT_HISTORY_BLOCK_SIZE 128 // The size in bytes of one block, about 2 hours of minute measurements.
+#define MEASUREMENT_HISTORY_MAX_RECORD_SIZE 17 // The maximum size in bytes of one encoded record.
+
+#define HISTORY_EVENT_PUMP_STARTED 0x01 // The water pump was switched on since the previous record.
+#define HISTORY_EVENT_PUMP_STOPPED 0x02 // The water pump was switched off since the previous record.
+
+/**
+ * Data structure that contains one decoded measurement.
+ */
+struct HistoryRecord
+{
+    uint32_t timestamp; // The time in seconds of the measurement.
+    int16_t moisture; // The percentage of moisture in the soil.
+    int16_t waterLevel; // The percentage of water left in the reservoir.
+    uint8_t events; // The HISTORY_EVENT flags of things that happened since the previous record.
+};
+
+/**
+ * Data structure that contains the position of an iteration through the history, it also
+ * contains the previous record because the records only contain the changes.
+ */
+struct HistoryCursor
+{
+    uint8_t block; // The index of the block being read.
+    uint8_t blocksLeft; // The amount of blocks left to read, including the current one.
+    uint8_t offset; // The offset of the next record inside the block.
+    int32_t previousInterval; // The time between the previous two records.
+    HistoryRecord previous; // The previous record.
+};
+
+/**
+ * Data structure that contains the aggregates of an time window of the history.
+ */
+struct HistoryAggregate
+{
+    uint16_t count; // The amount of records in the window.
+    int16_t minimumMoisture; // The lowest soil moisture.
+    int16_t maximumMoisture; // The highest soil moisture.
+    int16_t averageMoisture; // The average soil moisture.
+    int16_t minimumWaterLevel; // The lowest water level.
+    int16_t maximumWaterLevel; // The highest water level.
+    int16_t averageWaterLevel; // The average water level.
+    uint16_t pumpStarts; // The amount of times the water pump was switched on.
+};
+
+/**
+ * This class is used to append measurements to the history and read them back without
+ * allocating memory.
+ */
+class MeasurementHistory
+{
+public:
+    /**
+     * The constructor will create an empty history.
+     */
+    MeasurementHistory();
+
+    /**
+     * This function removes all records from the history.
+     */
+    void clear();
+
+    /**
+     * This function appends an measurement to the history. It takes constant time, when the
+     * buffer is full the oldest block of records is dropped.
+     *
+     * @param timestamp     The time in seconds of the measurement, it can't be older than the previous one.
+     * @param moisture      The percentage of moisture in the soil.
+     * @param waterLevel    The percentage of water left in the reservoir.
+     * @param events        The HISTORY_EVENT flags of things that happened since the previous record.
+     */
+    void append( uint32_t timestamp, int16_t moisture, int16_t waterLevel, uint8_t events );
+
+    /**
+     * This function returns the latest record in the history.
+     *
+     * @param record    The record to write the latest measurement to.
+     * @return bool - False if the history is empty.
+     */
+    bool getLatest( HistoryRecord *record );
+
+    /**
+     * This function starts an iteration at the oldest record in the history.
+     *
+     * @param cursor    The cursor to initialize.
+     */
+    void startIteration( HistoryCursor *cursor );
+
+    /**
+     * This function starts an iteration at the first record at or after an timestamp, whole
+     * blocks before the timestamp are skipped without decoding them.
+     *
+     * @param cursor    The cursor to initialize.
+     * @param timestamp The time in seconds of the first record to read.
+     */
+    void startIterationAt( HistoryCursor *cursor, uint32_t timestamp );
+
+    /**
+     * This function reads the next record of an iteration. Appending records while iterating
+     * is allowed as long as the block of the cursor doesn't get dropped.
+     *
+     * @param cursor    The cursor of the iteration.
+     * @param record    The record to write the measurement to.
+     * @return bool - False when there are no records left.
+     */
+    bool next( HistoryCursor *cursor, HistoryRecord *record );
+
+    /**
+     * This function computes the aggregates of all records at or after an timestamp.
+     *
+     * @param since     The time in seconds of the start of the window.
+     * @param aggregate The aggregate to write the result to.
+     */
+    void aggregate( uint32_t since, HistoryAggregate *aggregate );
+
+    /**
+     * This function returns the amount of records in the history.
+     */
+    uint16_t getRecordCount();
+
+    /**
+     * This function returns the amount of bytes used by the records in the history.
+     */
+    uint16_t getUsedBytes();
+
+private:
+    uint8_t buffer[MEASUREMENT_HISTORY_BLOCKS][MEASUREMENT_HISTORY_BLOCK_SIZE]; // The encoded records.
+    uint8_t blockLength[MEASUREMENT_HISTORY_BLOCKS]; // The amount of bytes used in every block.
+    uint8_t blockRecords[MEASUREMENT_HISTORY_BLOCKS]; // The amount of records in every block.
+    uint8_t oldestBlock; // The index of the oldest block.
+    uint8_t blockCount; // The amount of blocks in use.
+    uint16_t recordCount; // The amount of records in the history.
+    int32_t lastInterval; // The time between the last two records.
+    HistoryRecord last; // The last record.
+
+    /**
+     * This function starts an new block, it drops the oldest block when the buffer is full.
+     */
+    void startBlock();
+
+    /**
+     * This function reads the record at the offset of an cursor.
+     */
+    void decodeRecord( HistoryCursor *cursor, HistoryRecord *record );
+
+    /**
+     * These functions encode and decode the zigzag varints.
+     */
+    static uint8_t writeVarint( uint8_t *destination, uint32_t value );
+    static uint32_t readVarint( const uint8_t *source, uint8_t *offset );
+    static uint32_t zigzagEncode( int32_t value );
+    static int32_t zigzagDecode( uint32_t value );
+};
+
+#endif //WATERUP_PLANTPOT_MEASUREMENTHISTORY_H
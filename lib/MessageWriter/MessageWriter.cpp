@@ -0,0 +1,298 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ */
+#include "MessageWriter.h"
+
+/**
+ * Save the buffer the message is written to.
+ *
+ * @param buffer    The buffer the message is written to.
+ * @param size      The size of the buffer in bytes, including the terminator.
+ */
+MessageWriter::MessageWriter( char *buffer, uint16_t size )
+{
+    this->buffer = buffer;
+    this->size = size;
+    this->length = 0;
+    this->overflowed = false;
+    this->separate = false;
+}
+
+/**
+ * Start an new message by opening the json object.
+ */
+void MessageWriter::begin()
+{
+    this->length = 0;
+    this->overflowed = false;
+    this->separate = false;
+    this->append( '{' );
+}
+
+/**
+ * Append an text field.
+ *
+ * @param key       The key of the field, stored in flash with PSTR().
+ * @param value     The text in RAM, it is written as is so it may not contain quotes.
+ */
+void MessageWriter::addText( const char *key, const char *value )
+{
+    this->appendKey( key );
+    this->append( '"' );
+    this->appendText( value );
+    this->append( '"' );
+}
+
+/**
+ * Append an text field with an constant value.
+ *
+ * @param key       The key of the field, stored in flash with PSTR().
+ * @param value     The text, stored in flash with PSTR().
+ */
+void MessageWriter::addFlashText( const char *key, const char *value )
+{
+    this->appendKey( key );
+    this->append( '"' );
+    this->appendFlashText( value );
+    this->append( '"' );
+}
+
+/**
+ * Append an unsigned number field.
+ *
+ * @param key       The key of the field, stored in flash with PSTR().
+ * @param value     The number.
+ * @param quoted    True to write the number as text, for fields the backend reads as text.
+ */
+void MessageWriter::addUnsigned( const char *key, uint32_t value, bool quoted )
+{
+    this->appendKey( key );
+    if( quoted )
+    {
+        this->append( '"' );
+    }
+    this->appendNumber( value );
+    if( quoted )
+    {
+        this->append( '"' );
+    }
+}
+
+/**
+ * Append an signed number field.
+ *
+ * @param key       The key of the field, stored in flash with PSTR().
+ * @param value     The number.
+ */
+void MessageWriter::addSigned( const char *key, int32_t value )
+{
+    this->appendKey( key );
+    this->appendSigned( value );
+}
+
+/**
+ * Open an array, the first element doesn't get an comma.
+ *
+ * @param key   The key of the field, stored in flash with PSTR(), nullptr inside an array.
+ */
+void MessageWriter::beginArray( const char *key )
+{
+    if( key != nullptr )
+    {
+        this->appendKey( key );
+    }
+    else
+    {
+        this->appendSeparator();
+    }
+    this->append( '[' );
+    this->separate = false;
+}
+
+/**
+ * Append an unsigned number to the open array.
+ *
+ * @param value The number.
+ */
+void MessageWriter::addUnsignedElement( uint32_t value )
+{
+    this->appendSeparator();
+    this->appendNumber( value );
+}
+
+/**
+ * Append an signed number to the open array.
+ *
+ * @param value The number.
+ */
+void MessageWriter::addSignedElement( int32_t value )
+{
+    this->appendSeparator();
+    this->appendSigned( value );
+}
+
+/**
+ * Close the open array, the array counts as an element of the object or array around it.
+ */
+void MessageWriter::endArray()
+{
+    this->append( ']' );
+    this->separate = true;
+}
+
+/**
+ * Close the json object and terminate the message. An message that didn't fit is cleared, so
+ * an truncated message is never published.
+ *
+ * @return bool - False when the message didn't fit in the buffer, the buffer then holds an empty string.
+ */
+bool MessageWriter::end()
+{
+    this->append( '}' );
+    if( this->overflowed )
+    {
+        this->buffer[0] = '\0';
+        this->length = 0;
+        return false;
+    }
+    this->buffer[this->length] = '\0';
+    return true;
+}
+
+/**
+ * Return the length of the message.
+ *
+ * @return uint16_t - The length in bytes without the terminator.
+ */
+uint16_t MessageWriter::getLength()
+{
+    return this->length;
+}
+
+/**
+ * Append the separator and the key of an field, the first field doesn't get an comma.
+ *
+ * @param key   The key of the field, stored in flash.
+ */
+void MessageWriter::appendKey( const char *key )
+{
+    this->appendSeparator();
+    this->append( '"' );
+    this->appendFlashText( key );
+    this->append( '"' );
+    this->append( ':' );
+}
+
+/**
+ * Append an comma when the object or array already has an field or element, the next one
+ * always needs an comma.
+ */
+void MessageWriter::appendSeparator()
+{
+    if( this->separate )
+    {
+        this->append( ',' );
+    }
+    this->separate = true;
+}
+
+/**
+ * Append an signed number. The magnitude is computed in unsigned arithmetic so the smallest
+ * number doesn't overflow.
+ *
+ * @param value The number.
+ */
+void MessageWriter::appendSigned( int32_t value )
+{
+    if( value < 0 )
+    {
+        this->append( '-' );
+        this->appendNumber( 0U - (uint32_t) value );
+    }
+    else
+    {
+        this->appendNumber( (uint32_t) value );
+    }
+}
+
+/**
+ * Append an text from RAM. The loop works on local pointers, the compiler would otherwise
+ * reload the length after every character because the buffer could alias it.
+ *
+ * @param text  The text.
+ */
+void MessageWriter::appendText( const char *text )
+{
+    char *position = this->buffer + this->length;
+    char *last = this->buffer + this->size - 1; // Keep one byte free for the terminator.
+
+    while( *text != '\0' && position < last )
+    {
+        *position++ = *text++;
+    }
+    this->length = (uint16_t)( position - this->buffer );
+    if( *text != '\0' )
+    {
+        this->overflowed = true;
+    }
+}
+
+/**
+ * Append an text from flash, one byte at the time because flash can only be read aligned.
+ *
+ * @param text  The text, stored in flash.
+ */
+void MessageWriter::appendFlashText( const char *text )
+{
+    char *position = this->buffer + this->length;
+    char *last = this->buffer + this->size - 1; // Keep one byte free for the terminator.
+    char character = (char) pgm_read_byte( text++ );
+
+    while( character != '\0' && position < last )
+    {
+        *position++ = character;
+        character = (char) pgm_read_byte( text++ );
+    }
+    this->length = (uint16_t)( position - this->buffer );
+    if( character != '\0' )
+    {
+        this->overflowed = true;
+    }
+}
+
+/**
+ * Append the decimal digits of an number. The digits are written backwards into an small
+ * buffer on the stack first, an uint32_t has at most 10 digits.
+ *
+ * @param value The number.
+ */
+void MessageWriter::appendNumber( uint32_t value )
+{
+    char digits[11];
+    char *first = digits + sizeof( digits ) - 1;
+
+    *first = '\0';
+    do
+    {
+        *--first = (char)( '0' + value % 10 );
+        value /= 10;
+    }
+    while( value > 0 );
+
+    this->appendText( first );
+}
+
+/**
+ * Append one character, one byte is kept free for the terminator.
+ *
+ * @param character The character.
+ */
+void MessageWriter::append( char character )
+{
+    if( this->length + 1 >= this->size )
+    {
+        this->overflowed = true;
+        return;
+    }
+    this->buffer[this->length++] = character;
+}
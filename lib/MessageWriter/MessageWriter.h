@@ -0,0 +1,175 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ *
+ * This library writes the json messages the pot publishes straight into the send buffer. Every
+ * field is appended with its own type, so there are no format strings that can disagree with
+ * their arguments and no temporary strings on the heap. Arrays of numbers and arrays of such
+ * arrays can be nested in the object for batches of statistics. The keys and constant values are read
+ * from flash, only the send buffer is in RAM. It doesn't use any Arduino functions so it can
+ * run in the host simulations.
+ */
+#ifndef WATERUP_PLANTPOT_MESSAGEWRITER_H
+#define WATERUP_PLANTPOT_MESSAGEWRITER_H
+
+#include <stdint.h>
+
+#ifdef ARDUINO
+#include <pgmspace.h> // Include this library for reading the keys from flash.
+#endif
+#ifndef PSTR
+#define PSTR( text ) ( text ) // The host keeps all strings in RAM.
+#endif
+#ifndef pgm_read_byte
+#define pgm_read_byte( address ) ( *(const uint8_t*)( address )) // The host reads flash strings like any other.
+#endif
+
+#define MAC_ADDRESS_LENGTH 18 // The length of an mac address formatted like 5C:CF:7F:19:9C:39, including the terminator.
+
+/**
+ * This class is used to write an json object into an fixed buffer.
+ */
+class MessageWriter
+{
+public:
+    /**
+     * The constructor will save the buffer the message is written to.
+     *
+     * @param buffer    The buffer the message is written to.
+     * @param size      The size of the buffer in bytes, including the terminator.
+     */
+    MessageWriter( char *buffer, uint16_t size );
+
+    /**
+     * This function will start an new message, it overwrites the previous one.
+     */
+    void begin();
+
+    /**
+     * This function will append an text field.
+     *
+     * @param key       The key of the field, stored in flash with PSTR().
+     * @param value     The text in RAM, it is written as is so it may not contain quotes.
+     */
+    void addText( const char *key, const char *value );
+
+    /**
+     * This function will append an text field with an constant value.
+     *
+     * @param key       The key of the field, stored in flash with PSTR().
+     * @param value     The text, stored in flash with PSTR().
+     */
+    void addFlashText( const char *key, const char *value );
+
+    /**
+     * This function will append an unsigned number field.
+     *
+     * @param key       The key of the field, stored in flash with PSTR().
+     * @param value     The number.
+     * @param quoted    True to write the number as text, for fields the backend reads as text.
+     */
+    void addUnsigned( const char *key, uint32_t value, bool quoted = false );
+
+    /**
+     * This function will append an signed number field.
+     *
+     * @param key       The key of the field, stored in flash with PSTR().
+     * @param value     The number.
+     */
+    void addSigned( const char *key, int32_t value );
+
+    /**
+     * This function will open an array. An array in an array doesn't have an key.
+     *
+     * @param key   The key of the field, stored in flash with PSTR(), nullptr inside an array.
+     */
+    void beginArray( const char *key = nullptr );
+
+    /**
+     * This function will append an unsigned number to the open array.
+     *
+     * @param value The number.
+     */
+    void addUnsignedElement( uint32_t value );
+
+    /**
+     * This function will append an signed number to the open array.
+     *
+     * @param value The number.
+     */
+    void addSignedElement( int32_t value );
+
+    /**
+     * This function will close the open array.
+     */
+    void endArray();
+
+    /**
+     * This function will close the message.
+     *
+     * @return bool - False when the message didn't fit in the buffer, the buffer then holds an empty string.
+     */
+    bool end();
+
+    /**
+     * This function returns the length of the message.
+     *
+     * @return uint16_t - The length in bytes without the terminator.
+     */
+    uint16_t getLength();
+
+private:
+    char *buffer; // The buffer the message is written to.
+    uint16_t size; // The size of the buffer in bytes, including the terminator.
+    uint16_t length; // The amount of bytes written.
+    bool overflowed; // True when an field didn't fit in the buffer.
+    bool separate; // True when the next field or element needs an comma in front of it.
+
+    /**
+     * This function will append the separator and the key of an field.
+     *
+     * @param key   The key of the field, stored in flash.
+     */
+    void appendKey( const char *key );
+
+    /**
+     * This function will append an comma when the object or array already has an field or element.
+     */
+    void appendSeparator();
+
+    /**
+     * This function will append an signed number.
+     *
+     * @param value The number.
+     */
+    void appendSigned( int32_t value );
+
+    /**
+     * This function will append an text from RAM.
+     *
+     * @param text  The text.
+     */
+    void appendText( const char *text );
+
+    /**
+     * This function will append an text from flash.
+     *
+     * @param text  The text, stored in flash.
+     */
+    void appendFlashText( const char *text );
+
+    /**
+     * This function will append the decimal digits of an number.
+     *
+     * @param value The number.
+     */
+    void appendNumber( uint32_t value );
+
+    /**
+     * This function will append one character.
+     *
+     * @param character The character.
+     */
+    void append( char character );
+};
+
+#endif //WATERUP_PLANTPOT_MESSAGEWRITER_H
@@ -6,29 +6,108 @@
  */
 #include "PlantCare.h"
 
+const uint8_t PlantCare::waterPumpPins[POT_CHANNEL_COUNT] = IO_PINS_WATER_PUMP; // The pins that switch the water pump of every channel.
+volatile uint8_t PlantCare::runningWaterPumpPin = IO_PIN_WATER_PUMP; // The pin of the running water pump.
+
+#if POT_CHANNEL_COUNT > 1
+static const uint8_t muxSelectPins[] = IO_PINS_MUX_SELECT; // The pins connected to the select inputs of the multiplexer.
+static_assert( POT_CHANNEL_COUNT <= 4, "The board has pins for the pumps of 4 channels." );
+static_assert( POT_CHANNEL_COUNT <= ( 1 << sizeof( muxSelectPins )), "The multiplexer doesn't have an input for every channel." );
+#endif
+
 /**
  * This function initiates the plant care library. It sets up the
  * I/O pins that are connected to the sensors and water pump and
  * initiates the time keeper variables.
  */
-PlantCare::PlantCare( Communication *potCommunication )
+PlantCare::PlantCare( Communication *potCommunication, TaskScheduler *taskScheduler, SensorSnapshot *sensorSnapshot, MeasurementHistory *measurementHistory, TelemetryLog *potTelemetryLog ) :
+#ifdef POT_FLOW_METER
+        flowMeter( IO_PIN_FLOW_METER ),
+#endif
+        sonar( IO_PIN_SONAR_TRIGGER, IO_PIN_SONAR_ECHO, SONAR_ECHO_TIMEOUT ),
+        reservoirFilter( SONAR_SAMPLE_BURST, REDUCE_MEDIAN, SONAR_SMOOTHING_FACTOR, SONAR_ECHO_TOLERANCE ),
+        moistureFilter( MOISTURE_SAMPLE_BURST, REDUCE_TRIMMED_MEAN, MOISTURE_SMOOTHING_FACTOR, MOISTURE_SAMPLE_TOLERANCE ),
+        reservoirModel( potCommunication->getConfiguration()->getReservoirCalibration() ),
+        wateringController( potCommunication->getConfiguration()->getWateringSettings(), WATER_DOSE_DEFAULT, WATER_DOSE_MAX, WATER_DOSE_MIN ),
+        cadence( potCommunication->getConfiguration()->getCadenceSettings(), potCommunication->getConfiguration()->getPlantCareSettings()->takeMeasurementInterval )
 {
     /**
      * The assignment statements below will set the basic pot configuration from the config library
      * and save it to this object attributes.
      */
-    long whatTimeIsIt = millis(); // The current milliseconds since the last reset.
-    this->lastPublishStatisticsTime = whatTimeIsIt;
-    this->lastPublishWarningTime = whatTimeIsIt;
-    this->lastPingTime = whatTimeIsIt;
-    this->lastMeasurementTime = whatTimeIsIt;
-    this->lastGivingWaterTime = whatTimeIsIt;
-
-    this->waterPumpState = LOW; // Set the current state of the water pump to LOW so its off when we start.
+    this->lastGivingWaterTime = 0;
+
+    for( uint8_t channel = 0; channel < POT_CHANNEL_COUNT; channel++ )
+    {
+        this->channels.pumpState[channel] = PUMP_IDLE; // Set the current state of the water pumps to idle so they are off when we start.
+        this->channels.doseTime[channel] = 0;
+        this->channels.moistureBeforeDose[channel] = 0;
+        this->channels.unansweredDoses[channel] = 0;
+        this->channels.dispensedVolume[channel] = 0;
+        this->channelContexts[channel].plantCare = this;
+        this->channelContexts[channel].channel = channel;
+    }
+    this->channels.unpublished = 0;
+    this->scheduler = taskScheduler; // Set the scheduler instance that runs the plant care tasks.
+    this->snapshot = sensorSnapshot; // Set the snapshot instance that shares the sensor readings.
+    this->history = measurementHistory; // Set the history instance the measurements are appended to.
+    this->telemetryLog = potTelemetryLog; // Set the log instance for statistics that couldn't be published.
+    this->reportedDroppedRecords = 0;
+    this->statisticBatchCount = 0;
+    this->statisticBatchStartTime = 0;
+    this->pendingHistoryEvents = 0;
+    this->measurementTaskId = SCHEDULER_INVALID_TASK; // Not registered until setup().
+#ifdef POT_FLOW_METER
+    this->flowCheckTaskId = SCHEDULER_INVALID_TASK; // Only registered while an pump runs.
+    this->waterPumpStartTime = 0;
+#endif
     this->communication = potCommunication; // Set the communication instance for communication between the pot and mqtt broker.
     this->configuration = communication->getConfiguration(); // Set tge configuration instance containing mqtt, led and plant care configuration.
     this->currentWarning = this->configuration->WarningType::NO_ERROR;
+    this->currentWarningChannel = TELEMETRY_CHANNEL_BOARD;
+    this->lastPersistGainTime = 0;
+    for( uint8_t channel = 0; channel < POT_CHANNEL_COUNT; channel++ ) // Continue with the gains learned before the last restart.
+    {
+        this->channels.responseGain[channel] = this->configuration->getWateringSettings()->responseGain[channel];
+        this->channels.learnedDoses[channel] = this->configuration->getWateringSettings()->learnedDoses[channel];
+    }
+
+    this->loadConfiguration();
 
+    /**
+     * Register the sensors at the snapshot, the reservoir is assumed full until the first
+     * measurement finishes.
+     */
+    this->snapshot->addSensor( SENSOR_WATER_LEVEL, WATER_LEVEL_TIME_TO_LIVE, 100, &PlantCare::refreshWaterLevel, this );
+    for( uint8_t channel = 0; channel < POT_CHANNEL_COUNT; channel++ )
+    {
+        this->snapshot->addSensor( SENSOR_SOIL_MOISTURE + channel, MOISTURE_TIME_TO_LIVE, 0, &PlantCare::refreshMoistureLevel, &this->channelContexts[channel] );
+    }
+
+    /**
+     * The pim mode function calls below will setup the I/O pin modes to either input or output.
+     */
+    pinMode( IO_PIN_SOIL_MOISTURE, INPUT );
+    for( uint8_t channel = 0; channel < POT_CHANNEL_COUNT; channel++ )
+    {
+        pinMode( waterPumpPins[channel], OUTPUT );
+        digitalWrite( waterPumpPins[channel], LOW ); // Make sure we don't give the drown the plant.
+    }
+#if POT_CHANNEL_COUNT > 1
+    for( uint8_t i = 0; i < sizeof( muxSelectPins ); i++ )
+    {
+        pinMode( muxSelectPins[i], OUTPUT );
+    }
+#endif
+}
+
+/**
+ * Copy the led, mqtt and plant care settings from the configuration into this object and
+ * start the measurement cadence over from the configured measurement interval. The task
+ * intervals are registered in setup(), so this has to be called before that.
+ */
+void PlantCare::loadConfiguration()
+{
     // Led settings
     this->red = configuration->getLedSettings()->red;
     this->green = configuration->getLedSettings()->green;
@@ -46,157 +125,1116 @@ PlantCare::PlantCare( Communication *potCommunication )
     this->groundMoistureOptimal = configuration->getPlantCareSettings()->groundMoistureOptimal;
     this->containsPlant = configuration->getPlantCareSettings()->containsPlant;
 
-    /**
-     * The pim mode function calls below will setup the I/O pin modes to either input or output.
-     */
-    pinMode( IO_PIN_SONAR_TRIGGER, OUTPUT );
-    pinMode( IO_PIN_SONAR_ECHO, INPUT );
-    pinMode( IO_PIN_SOIL_MOISTURE, INPUT );
-    pinMode( IO_PIN_WATER_PUMP, OUTPUT );
-    digitalWrite( IO_PIN_WATER_PUMP, LOW ); // Make sure we don't give the drown the plant.
+    this->cadence = MeasurementCadence( this->configuration->getCadenceSettings(), this->takeMeasurementInterval );
+    for( uint8_t channel = 0; channel < POT_CHANNEL_COUNT; channel++ )
+    {
+        this->channels.cadence[channel] = this->cadence.getState();
+    }
+}
+
+/**
+ * Setup the sensors that need the system to be initiated. The ultra sonic sensor
+ * attaches an interrupt to its echo pin which can't be done from an global constructor.
+ * After that the plant care tasks get registered at the scheduler with the configured intervals.
+ */
+void PlantCare::setup()
+{
+    this->sonar.setup();
+#ifdef POT_FLOW_METER
+    this->flowMeter.setup();
+#endif
+
+    this->scheduler->addPeriodicTask( &PlantCare::communicationTask, this, COMMUNICATION_LISTEN_INTERVAL, 0 );
+    this->measurementTaskId = this->scheduler->addPeriodicTask( &PlantCare::measurementTask, this, this->cadence.getInterval(), this->cadence.getInterval() );
+    this->scheduler->addPeriodicTask( &PlantCare::statisticTask, this, this->publishStatisticInterval, this->publishStatisticInterval );
+    this->scheduler->addPeriodicTask( &PlantCare::warningTask, this, this->republishWarningInterval, this->republishWarningInterval );
+    this->scheduler->addPeriodicTask( &PlantCare::pingTask, this, this->pingInterval, this->pingInterval );
+    this->scheduler->addPeriodicTask( &PlantCare::replayTask, this, TELEMETRY_REPLAY_INTERVAL, TELEMETRY_REPLAY_INTERVAL );
 }
 
 /**
- * Check if there is connection to the mqtt broker. If not attempt to reconnect to the broker.
- * Start publishing messages and listening for messages from the broker. And take care of the plant.
+ * Take care of the plant by running all plant care tasks that are due. Checking the
+ * connection, listening for messages, measuring, giving water and publishing are all
+ * tasks that run at their own interval.
  */
 void PlantCare::takeCareOfPlant()
 {
-    this->currentTime = millis();
-    this->communication->connect(); // Are we still connected?
-    this->communication->listen();
+    this->scheduler->run();
+}
+
+/**
+ * This function returns the percentage of water left in the reservoir from the sensor
+ * snapshot. When the level is stale an new measurement is started in the background and
+ * the last level is returned until it finishes.
+ *
+ * @return int - The percentage of water left in the reservoir.
+ */
+int PlantCare::checkWaterReservoir()
+{
+    return this->snapshot->getValue( SENSOR_WATER_LEVEL );
+}
+
+/**
+ * Start an burst of echoes to measure the water level, the reservoir task collects the
+ * echoes as soon as the sensor is ready for the next one.
+ */
+void PlantCare::startWaterLevelMeasurement()
+{
+    this->reservoirFilter.startBurst();
+    this->triggerEcho();
 
-    if( this->containsPlant == 1 )
+    if( this->scheduler->addOneShotTask( &PlantCare::reservoirTask, this, SONAR_MIN_CYCLE_TIME ) == SCHEDULER_INVALID_TASK )
     {
-        this->publishPotStatistic();
-        this->giveWater();
+        POT_ERROR_PRINTLN( F("[error] - Can't schedule the water level measurement, keeping the last water level.") )
+        this->snapshot->update( SENSOR_WATER_LEVEL, this->snapshot->getValue( SENSOR_WATER_LEVEL ), 0 );
     }
 }
 
 /**
- * This function will use the ultra sonic sensor to measure percentage
- * of water left in the reservoir.
+ * Collect the last echo from the ultra sonic sensor and start the next one. One bad echo
+ * shouldn't trigger an empty reservoir warning, so an burst of echoes is filtered into one
+ * water level. When the level is stable it stays fresh longer so the pot measures less often.
+ */
+void PlantCare::sampleWaterReservoir()
+{
+    if( this->sonar.isMeasurementReady() )
+    {
+        if( this->sonar.hasValidEcho() )
+        {
+            this->reservoirFilter.addSample( this->sonar.readEchoTime() );
+        }
+        else
+        {
+            this->sonar.readEchoTime(); // Release the sensor for the next measurement.
+            this->reservoirFilter.addMissingSample();
+        }
+    }
+
+    if( this->reservoirFilter.isBurstComplete() )
+    {
+        FilteredValue echoTime;
+        this->reservoirFilter.reduce( &echoTime );
+        int waterLevel = this->snapshot->getValue( SENSOR_WATER_LEVEL );
+
+        if( echoTime.confidence >= SENSOR_MIN_CONFIDENCE )
+        {
+            waterLevel = this->convertEchoTimeToWaterLevel( echoTime.value );
+        }
+        else
+        {
+            POT_ERROR_PRINTLN( F("[error] - The water level measurement is unreliable, keeping the last water level. Confidence: ") APPEND echoTime.confidence )
+        }
+
+        uint32_t stableTimeToLive = this->cadence.getInterval() / 2 > WATER_LEVEL_STABLE_TIME_TO_LIVE ? this->cadence.getInterval() / 2 : WATER_LEVEL_STABLE_TIME_TO_LIVE;
+        this->snapshot->setTimeToLive( SENSOR_WATER_LEVEL, echoTime.stable ? stableTimeToLive : WATER_LEVEL_TIME_TO_LIVE );
+        this->snapshot->update( SENSOR_WATER_LEVEL, waterLevel, echoTime.confidence );
+        return;
+    }
+
+    this->triggerEcho();
+    if( this->scheduler->addOneShotTask( &PlantCare::reservoirTask, this, SONAR_MIN_CYCLE_TIME ) == SCHEDULER_INVALID_TASK )
+    {
+        POT_ERROR_PRINTLN( F("[error] - Can't schedule the next echo, keeping the last water level.") )
+        this->snapshot->update( SENSOR_WATER_LEVEL, this->snapshot->getValue( SENSOR_WATER_LEVEL ), 0 );
+    }
+}
+
+/**
+ * Trigger the next echo of the burst. An hung or disconnected sensor can hold its echo pin
+ * high, then the sensor refuses every trigger and no echo would ever be collected. An trigger
+ * that is refused while no echo is in flight counts as an missing echo, so the burst completes
+ * with an low confidence and the water level becomes unreliable instead of refreshing forever.
+ */
+void PlantCare::triggerEcho()
+{
+    if( !this->sonar.trigger() && this->sonar.getState() == UltrasonicSensor::SONAR_IDLE )
+    {
+        this->reservoirFilter.addMissingSample();
+    }
+}
+
+/**
+ * Convert the time the sound took to travel to the water surface and back into the
+ * percentage of water left in the reservoir. The reservoir model looks the fill level up
+ * in an table generated at compile time and limits it to 0-100%, so an echo from below
+ * the bottom no longer wraps around to an full reservoir.
  *
+ * @param echoTime  The echo time in microseconds.
  * @return int - The percentage of water left in the reservoir.
  */
-int PlantCare::checkWaterReservoir()
+int PlantCare::convertEchoTimeToWaterLevel( uint32_t echoTime )
 {
-    // Clear the trigger pin.
-    digitalWrite(IO_PIN_SONAR_TRIGGER, LOW);
-    delayMicroseconds(2);
+    uint16_t fillLevel = this->reservoirModel.getFillLevel( echoTime );
+    //POT_DEBUG_PRINTLN( F("[debug] - The reservoir fill level in hundredths of a percent is: ") APPEND fillLevel )
 
-    // Send short pulse to the trigger pin
-    digitalWrite(IO_PIN_SONAR_TRIGGER, HIGH);
-    delayMicroseconds(10);
-    digitalWrite(IO_PIN_SONAR_TRIGGER, LOW);
+    return ( fillLevel + 50 ) / 100; // Round it to an whole percentage.
+}
+
+/**
+ * Measure the water level and wait for the burst of echoes to finish. It only blocks for the
+ * time the sensor needs between echoes, it is used when the pot wakes up from deep sleep and
+ * there is nothing else to do.
+ *
+ * @return int - The percentage of water left in the reservoir.
+ */
+int PlantCare::measureWaterLevelNow()
+{
+    uint16_t measurements = this->snapshot->getMeasurementCount( SENSOR_WATER_LEVEL );
+    uint32_t startTime = millis();
 
-    // Measure the time it took for the sound wave to return to the sensor.
-    long responseTime = pulseIn(IO_PIN_SONAR_ECHO, HIGH); //Listening and waiting for wave
-    delay(10);
+    this->snapshot->invalidate( SENSOR_WATER_LEVEL );
+    this->snapshot->refresh( SENSOR_WATER_LEVEL );
 
-    // Convert response time in microseconds to distance in centimeters.
-    long cmDistanceToWaterSurface  = responseTime * SOUND_SPEED_CM_PER_MICRO_SECOND / 2;
-    //POT_DEBUG_PRINTLN( F("[debug] - The distance from the ultrasonic sensor to the water surface is: ") APPEND cmDistanceToWaterSurface )
+    while( this->snapshot->getMeasurementCount( SENSOR_WATER_LEVEL ) == measurements && millis() - startTime < 2 * SONAR_SAMPLE_BURST * SONAR_MIN_CYCLE_TIME )
+    {
+        this->scheduler->run();
+        delay( 1 );
+    }
 
-    // Calculate how much water is left in the reservoir.
-    uint16_t waterLeftInReservoir = RESERVOIR_CONTENT_CM_3 - (RESERVOIR_1_CM_CONTENT_CM_3 * cmDistanceToWaterSurface );
+    return this->snapshot->getValue( SENSOR_WATER_LEVEL );
+}
 
-    // Convert it to an percentage.
-    return waterLeftInReservoir / (RESERVOIR_CONTENT_CM_3/100);
+/**
+ * This function returns the soil moisture from the sensor snapshot. When the moisture
+ * level is stale the soil is measured right away.
+ *
+ * @param channel   The channel of the pot.
+ * @return int - The percentage resistance the soil has.
+ */
+int PlantCare::checkMoistureLevel( uint8_t channel )
+{
+    return this->snapshot->getValue( SENSOR_SOIL_MOISTURE + channel );
 }
 
 /**
  * This function will use the ground moisture sensor to measure the resistance
  * of the soil. If its wet the resistance is les so we know how wet the ground is.
- * @return int - The percentage resistance the soil has.
+ * An burst of readings is filtered so an noisy reading doesn't make us give water.
+ *
+ * @param channel   The channel of the pot.
  */
-int PlantCare::checkMoistureLevel()
+void PlantCare::measureMoistureLevel( uint8_t channel )
 {
-    uint16_t soilResistance = analogRead(IO_PIN_SOIL_MOISTURE);
-    uint8_t percentageOfSoilMoisture = soilResistance / (1024/100);
+#if POT_CHANNEL_COUNT > 1
+    this->selectMoistureSensor( channel );
+#endif
+    for( uint8_t i = 0; i < MOISTURE_SAMPLE_BURST; i++ )
+    {
+        this->moistureFilter.addSample( analogRead(IO_PIN_SOIL_MOISTURE) );
+    }
+
+    FilteredValue soilResistance;
+    this->moistureFilter.reduce( &soilResistance );
+    uint8_t percentageOfSoilMoisture = soilResistance.value / (1024/100);
 
     /*POT_DEBUG_PRINTLN( F("[debug] - Checking the soil moisture level") NEW_LINE
-    F("[debug] - Measured ") APPEND soilResistance APPEND F( "/1024 so the percentage is: " ) APPEND percentageOfSoilMoisture)*/
+    F("[debug] - Measured ") APPEND soilResistance.value APPEND F( "/1024 so the percentage is: " ) APPEND percentageOfSoilMoisture)*/
 
-    return percentageOfSoilMoisture;
+    this->snapshot->update( SENSOR_SOIL_MOISTURE + channel, percentageOfSoilMoisture, soilResistance.confidence );
+}
+
+#if POT_CHANNEL_COUNT > 1
+/**
+ * Switch the analog multiplexer to the soil moisture sensor of an channel. The bits of the
+ * channel number go to the select inputs, after that the output gets time to settle.
+ *
+ * @param channel   The channel of the pot.
+ */
+void PlantCare::selectMoistureSensor( uint8_t channel )
+{
+    for( uint8_t i = 0; i < sizeof( muxSelectPins ); i++ )
+    {
+        digitalWrite( muxSelectPins[i], ( channel >> i ) & 1 ? HIGH : LOW );
+    }
+    delayMicroseconds( MUX_SETTLE_TIME );
 }
+#endif
 
 /**
- *Take care of giving the plant water. Give water based on the interval configured and wait for an certain
- * time after giving water so the water has time to spread through the soil.
+ * Take care of giving the plant water. Measure the soil moisture and start the pump when it is
+ * too dry, the pump gets switched off by an task at its deadline so the main loop keeps running
+ * while the plant receives water. The watering controller sizes the dose, in the adaptive mode
+ * with the learned response of the soil. Only one pump runs at the same time, when an other
+ * channel is giving water this channel waits for its turn.
+ *
+ * @param channel   The channel of the pot.
  */
-void PlantCare::giveWater()
+void PlantCare::giveWater( uint8_t channel )
 {
-    if( this->currentTime - this->lastMeasurementTime > this->takeMeasurementInterval && this->currentTime - this->lastGivingWaterTime > sleepAfterGivingWaterTime)
+    if( this->channels.pumpState[channel] != PUMP_IDLE ) // Are we still giving water or waiting for it to soak in?
+    {
+        return;
+    }
+
+    int currentGroundMoisture = checkMoistureLevel( channel );
+
+    if( this->snapshot->getConfidence( SENSOR_SOIL_MOISTURE + channel ) < SENSOR_MIN_CONFIDENCE )
+    {
+        return;
+    }
+
+    uint32_t doseTime = this->wateringController.computeDoseTime( currentGroundMoisture, this->groundMoistureOptimal, this->channels.responseGain[channel] );
+    if( doseTime > 0 )
     {
-        POT_DEBUG_PRINTLN( F("[debug] - Giving water to the plant."))
-        this->lastMeasurementTime = currentTime;
-        int currentGroundMoisture = checkMoistureLevel();
+        if( !this->pumpArbiter.acquire( channel ))
+        {
+            POT_DEBUG_PRINTLN( F("[debug] - An other pump is running, waiting for the turn of channel: ") APPEND channel )
+            return;
+        }
 
-        if( currentGroundMoisture < this->groundMoistureOptimal )
+        POT_DEBUG_PRINTLN( F("[debug] - Giving water to the plant for: ") APPEND doseTime APPEND F(WATER_DOSE_UNIT) APPEND F(" channel: ") APPEND channel )
+        if( this->wateringController.isAdaptive() )
         {
-            activateWaterPump();
-            delay( WATER_PUMP_DEFAULT_TIME );
-            deactivateWaterPump();
-            this->lastGivingWaterTime = currentTime+WATER_PUMP_DEFAULT_TIME;
+            this->channels.doseTime[channel] = doseTime;
+            this->channels.moistureBeforeDose[channel] = currentGroundMoisture;
         }
+        this->startWaterPump( channel, doseTime );
     }
 }
 
+/**
+ * Give water to the channels that were waiting while an other pump was running. The soil is
+ * measured again first, an channel that doesn't need water anymore passes its turn on.
+ */
+void PlantCare::giveWaterToWaitingChannels()
+{
+    uint8_t channel = this->pumpArbiter.takeNextWaiting();
+    while( channel != CHANNEL_NONE )
+    {
+        this->giveWater( channel );
+        channel = this->pumpArbiter.takeNextWaiting();
+    }
+}
+
+/**
+ * End the soaking period so the plant can receive water again. In the adaptive mode the
+ * response of the soil to the dose is learned and the plant gets the rest of the water it
+ * needs right away, instead of waiting for the next measurement. When the soil didn't respond
+ * to WATERING_MAX_UNANSWERED_DOSES doses in a row the water doesn't reach the sensor, like with
+ * an loose tube or an sensor outside the pot. Dosing again after every settle time would pump
+ * the reservoir into the saucer, so the channel waits the configured sleep time and the user
+ * gets an warning.
+ *
+ * @param channel   The channel of the pot.
+ */
+void PlantCare::finishSoaking( uint8_t channel )
+{
+    POT_DEBUG_PRINTLN( F("[debug] - The water had time to soak in, the plant can receive water again. Channel: ") APPEND channel )
+    this->channels.pumpState[channel] = PUMP_IDLE;
+
+    if( this->channels.doseTime[channel] == 0 )
+    {
+        return;
+    }
+
+    this->learnDoseResponse( channel );
+    if( this->channels.unansweredDoses[channel] < WATERING_MAX_UNANSWERED_DOSES )
+    {
+        this->giveWater( channel );
+        return;
+    }
+
+    POT_ERROR_PRINTLN( F("[error] - The soil didn't respond to the last doses, waiting the configured sleep time. Channel: ") APPEND channel )
+    if( this->currentWarning == this->configuration->NO_ERROR ) // An reservoir warning explains the missing response better.
+    {
+        this->publishPotWarning( this->configuration->NO_WATER_RESPONSE, channel );
+    }
+    if( this->scheduler->addOneShotTask( &PlantCare::soakingDoneTask, &this->channelContexts[channel], this->sleepAfterGivingWaterTime ) != SCHEDULER_INVALID_TASK )
+    {
+        this->channels.pumpState[channel] = PUMP_SOAKING;
+    }
+}
+
+/**
+ * Learn the response of the soil to the last dose. The moisture level was invalidated when
+ * the pump stopped, so this measures the soil after the water settled. The learned gain is
+ * persisted so the pot doesn't have to learn it again after an power loss. Every channel learns
+ * its own gain, the pots of an rack can have different soil and tubes.
+ *
+ * @param channel   The channel of the pot.
+ */
+void PlantCare::learnDoseResponse( uint8_t channel )
+{
+    int moisture = this->checkMoistureLevel( channel );
+    uint32_t doseTime = this->channels.doseTime[channel];
+    this->channels.doseTime[channel] = 0;
+
+    if( this->snapshot->getConfidence( SENSOR_SOIL_MOISTURE + channel ) < SENSOR_MIN_CONFIDENCE )
+    {
+        return; // Forget the dose, an unreliable response would spoil the gain.
+    }
+
+    this->wateringController.startDose( this->channels.moistureBeforeDose[channel], doseTime );
+    if( moisture > this->channels.moistureBeforeDose[channel] )
+    {
+        this->channels.unansweredDoses[channel] = 0;
+    }
+    else if( this->channels.unansweredDoses[channel] < 0xFF )
+    {
+        this->channels.unansweredDoses[channel]++;
+    }
+
+    if( this->wateringController.learn( moisture, &this->channels.responseGain[channel], &this->channels.learnedDoses[channel] ))
+    {
+        POT_DEBUG_PRINTLN( F("[debug] - Learned the watering response gain: ") APPEND this->channels.responseGain[channel] APPEND F(" channel: ") APPEND channel )
+        this->persistResponseGain( channel );
+    }
+}
+
+/**
+ * Persist the learned gains when the gain of the channel changed by WATERING_PERSIST_GAIN_CHANGE
+ * percent since it was persisted, or when an smaller change waited WATERING_PERSIST_INTERVAL.
+ * Every commit erases an flash sector, while an change of a few percent is learned again by the
+ * next doses after an power loss. The configuration holds the gains that were persisted last,
+ * one commit writes the gains of all channels. In duty cycle mode the ram is lost at every deep
+ * sleep, there the gain is persisted after every dose, which is at most one per wake up.
+ *
+ * @param channel   The channel of which the gain was learned.
+ */
+void PlantCare::persistResponseGain( uint8_t channel )
+{
+    WateringSettings *settings = this->configuration->getWateringSettings();
+    uint16_t gain = this->channels.responseGain[channel];
+    uint16_t persistedGain = settings->responseGain[channel];
+    uint16_t change = gain > persistedGain ? gain - persistedGain : persistedGain - gain;
+
+#ifndef POT_DUTY_CYCLE
+    if( persistedGain != WATERING_GAIN_UNKNOWN
+        && (uint32_t) change * 100 < (uint32_t) persistedGain * WATERING_PERSIST_GAIN_CHANGE
+        && this->scheduler->now() - this->lastPersistGainTime < WATERING_PERSIST_INTERVAL )
+    {
+        return;
+    }
+#endif
+
+    this->configuration->setWateringSettings( settings->mode, this->channels.responseGain, this->channels.learnedDoses );
+    this->lastPersistGainTime = this->scheduler->now();
+}
+
+/**
+ * Switch the water pump on and register an task that switches it off at the deadline. The
+ * safety timer makes sure the pump stops at the deadline even if the main loop is blocked by
+ * something like an reconnect to the mqtt broker. With an flow meter the interrupt of the
+ * meter cuts the pump off at the volume of the dose, the deadline is only an safety cap and
+ * an task checks the meter until the pump stopped.
+ *
+ * @param channel   The channel of the pot.
+ * @param dose      The milliseconds the pump should run, or millilitres with an flow meter.
+ */
+void PlantCare::startWaterPump( uint8_t channel, uint32_t dose )
+{
+    if( dose > WATER_DOSE_MAX ) // Never allow the pump to drown the plant.
+    {
+        dose = WATER_DOSE_MAX;
+    }
+
+#ifdef POT_FLOW_METER
+    this->flowCheckTaskId = this->scheduler->addPeriodicTask( &PlantCare::flowCheckTask, &this->channelContexts[channel], FLOW_METER_CHECK_INTERVAL, FLOW_METER_CHECK_INTERVAL );
+    if( this->flowCheckTaskId == SCHEDULER_INVALID_TASK )
+    {
+        this->cancelWaterPump( channel );
+        return;
+    }
+    this->channels.pumpState[channel] = PUMP_RUNNING;
+    this->pendingHistoryEvents |= HISTORY_EVENT_PUMP_STARTED;
+    this->flowMeter.startDose( dose, waterPumpPins[channel] );
+    this->waterPumpStartTime = this->scheduler->now();
+    this->activateWaterPump( channel );
+    this->waterPumpSafetyTimer.once_ms( WATER_PUMP_MAX_TIME, &PlantCare::forceWaterPumpOff );
+#else
+    if( this->scheduler->addOneShotTask( &PlantCare::waterPumpDeadlineTask, &this->channelContexts[channel], dose ) == SCHEDULER_INVALID_TASK )
+    {
+        this->cancelWaterPump( channel );
+        return;
+    }
+    this->channels.pumpState[channel] = PUMP_RUNNING;
+    this->pendingHistoryEvents |= HISTORY_EVENT_PUMP_STARTED;
+    this->activateWaterPump( channel );
+    this->waterPumpSafetyTimer.once_ms( dose, &PlantCare::forceWaterPumpOff );
+#endif
+}
+
+/**
+ * Give up on an dose when the task that stops the pump can't be registered, without it the pump
+ * would stay in the running state forever. The pump isn't switched on and the pumps are handed
+ * back, so the plant gets an new dose at the next measurement.
+ *
+ * @param channel   The channel of the pot.
+ */
+void PlantCare::cancelWaterPump( uint8_t channel )
+{
+    POT_ERROR_PRINTLN( F("[error] - Can't schedule the end of the dose, not giving water to channel: ") APPEND channel )
+    this->channels.pumpState[channel] = PUMP_IDLE;
+    this->channels.doseTime[channel] = 0;
+    this->pumpArbiter.release( channel );
+}
+
+#ifdef POT_FLOW_METER
+/**
+ * Stop the water pump when the dose is complete. When the meter doesn't count any pulses the
+ * reservoir or the water line is empty, the pump is stopped so it doesn't run dry until the
+ * deadline. The dose is also stopped at the deadline when the meter misses pulses.
+ *
+ * @param channel   The channel of the pot.
+ */
+void PlantCare::checkWaterFlow( uint8_t channel )
+{
+    if( this->flowMeter.isDoseComplete() )
+    {
+        this->stopWaterPump( channel );
+    }
+    else if( this->flowMeter.getTimeSinceLastPulse() > FLOW_METER_NO_FLOW_TIMEOUT )
+    {
+        POT_ERROR_PRINTLN( F("[error] - No water flows through the flow meter, stopping the water pump of channel: ") APPEND channel )
+        this->stopWaterPump( channel );
+    }
+    else if( this->scheduler->now() - this->waterPumpStartTime >= WATER_PUMP_MAX_TIME )
+    {
+        POT_ERROR_PRINTLN( F("[error] - The dose didn't complete in time, stopping the water pump of channel: ") APPEND channel )
+        this->stopWaterPump( channel );
+    }
+}
+#endif
+
+/**
+ * Switch the water pump off and give the water time to spread through the soil before the
+ * plant can receive water again. In the fixed mode this is the configured sleep time, in the
+ * adaptive mode the dose is sized to the target so it only waits until the water settled.
+ * After that the next channel that was waiting for the pumps gets its turn.
+ *
+ * @param channel   The channel of the pot.
+ */
+void PlantCare::stopWaterPump( uint8_t channel )
+{
+    this->waterPumpSafetyTimer.detach();
+    this->deactivateWaterPump( channel );
+#ifdef POT_FLOW_METER
+    this->scheduler->cancelTask( this->flowCheckTaskId );
+    this->flowCheckTaskId = SCHEDULER_INVALID_TASK;
+    this->flowMeter.stopDose();
+
+    uint32_t volume = this->flowMeter.getDispensedVolume();
+    this->channels.dispensedVolume[channel] += volume;
+    if( this->channels.doseTime[channel] != 0 ) // Learn from the water that was given instead of the dose, 0 forgets an dose that didn't flow.
+    {
+        this->channels.doseTime[channel] = volume;
+    }
+    POT_DEBUG_PRINTLN( F("[debug] - The flow meter measured millilitres: ") APPEND volume APPEND F(" channel: ") APPEND channel )
+#endif
+    this->lastGivingWaterTime = this->scheduler->now();
+    this->channels.pumpState[channel] = PUMP_SOAKING;
+    this->pendingHistoryEvents |= HISTORY_EVENT_PUMP_STOPPED;
+    this->snapshot->invalidate( SENSOR_SOIL_MOISTURE + channel ); // The water changes the soil moisture.
+    if( this->scheduler->addOneShotTask( &PlantCare::soakingDoneTask, &this->channelContexts[channel], this->wateringController.getSettleTime( this->sleepAfterGivingWaterTime )) == SCHEDULER_INVALID_TASK )
+    {
+        POT_ERROR_PRINTLN( F("[error] - Can't schedule the end of the soaking period, forgetting the dose of channel: ") APPEND channel )
+        this->channels.pumpState[channel] = PUMP_IDLE; // Without the task the channel would never receive water again.
+        this->channels.doseTime[channel] = 0;
+    }
+
+    this->pumpArbiter.release( channel );
+    this->giveWaterToWaitingChannels();
+}
+
 /**
  * Write an voltage on the water pump pin so the transistor will allow the 12v current
  * to flow through the water pump.
+ *
+ * @param channel   The channel of the pot.
  */
-void PlantCare::activateWaterPump()
+void PlantCare::activateWaterPump( uint8_t channel )
 {
     POT_DEBUG_PRINTLN( F("[debug] Activating the water pump."))
-    digitalWrite(IO_PIN_WATER_PUMP, HIGH );
+    runningWaterPumpPin = waterPumpPins[channel];
+    digitalWrite( waterPumpPins[channel], HIGH );
 }
 
 /**
  * Switch the transistor off so the power to the water pump gets cut.
+ *
+ * @param channel   The channel of the pot.
  */
-void PlantCare::deactivateWaterPump()
+void PlantCare::deactivateWaterPump( uint8_t channel )
 {
     POT_DEBUG_PRINTLN( F("[debug] Deactivating the water pump."))
-    digitalWrite(IO_PIN_WATER_PUMP, LOW );
+    digitalWrite( waterPumpPins[channel], LOW );
+}
+
+/**
+ * Cut the power to the water pump when its deadline passes. This runs from the timer
+ * interrupt context so it only touches the pin and leaves the state to the pump deadline task.
+ */
+void PlantCare::forceWaterPumpOff()
+{
+    digitalWrite( runningWaterPumpPin, LOW );
 }
 
 /**
- * Take care of publishing pot statistics to the broker based on the configured
- * interval and previous tine an message was published.
+ * Take care of publishing the statistics of every channel with an new measurement to the
+ * broker and update the current warning based on the water level in the shared reservoir.
+ * The statistics of all channels go over the same connection, tagged with their channel.
+ * When batching is configured the statistics are collected in the batch instead, an new
+ * warning publishes the batch first so the backend gets the statistics that lead up to it.
  */
 void PlantCare::publishPotStatistic()
 {
-    if( this->currentTime - this->lastPublishStatisticsTime > this->publishStatisticInterval )
+    POT_DEBUG_PRINTLN( F("[debug] - Publishing statistic message to the mqtt broker.") )
+    int waterLevel = this->checkWaterReservoir();
+    if(waterLevel == 0) waterLevel = 1;
+
+    bool batching = this->configuration->getTelemetrySettings()->batchSize > 1;
+    for( uint8_t channel = 0; channel < POT_CHANNEL_COUNT; channel++ )
     {
-        POT_DEBUG_PRINTLN( F("[debug] - Publishing statistic message to the mqtt broker.") )
-        this->lastPublishStatisticsTime = this->currentTime;
-        int waterLevel = this->checkWaterReservoir();
-        if(waterLevel == 0) waterLevel = 1;
+        if( !( this->channels.unpublished & ( 1 << channel )))
+        {
+            continue;
+        }
+        this->channels.unpublished &= ~( 1 << channel );
 
-        if( waterLevel < this->publishReservoirWarningThreshold ) // Should we send an warning to the user?
+        int moisture = this->checkMoistureLevel( channel );
+        if( batching )
+        {
+            this->batchStatistic( channel, moisture, waterLevel );
+        }
+        else if( !this->communication->isConnected() || !this->communication->publishStatistic( channel, moisture, waterLevel, this->forecaster.getHoursLeft(), this->cadence.getInterval(), this->channels.dispensedVolume[channel] ))
         {
-            this->currentWarning = waterLevel > 5 ? this->configuration->LOW_RESERVOIR : this->configuration->EMPTY_RESERVOIR;
-            this->publishPotWarning( this->currentWarning );
+            POT_DEBUG_PRINTLN( F("[debug] - The broker is unreachable, logging the statistic for later.") )
+            this->logStatistic( channel, moisture, waterLevel, this->communication->getTime() );
         }
+    }
 
-        this->communication->publishStatistic( this->checkMoistureLevel(), waterLevel );
+    uint8_t warningChannel;
+    uint8_t warning = this->determineWarning( waterLevel, &warningChannel );
+    if( this->snapshot->getConfidence( SENSOR_WATER_LEVEL ) < SENSOR_MIN_CONFIDENCE ) // Don't change the warning based on an unreliable level.
+    {
+        POT_DEBUG_PRINTLN( F("[debug] - The water level is unreliable, keeping the current warning.") )
+    }
+    else if( warning != this->configuration->NO_ERROR ) // Should we send an warning to the user?
+    {
+        this->publishPotWarning( warning, warningChannel );
+    }
+    else
+    {
+        this->currentWarning = this->configuration->NO_ERROR;
+        this->currentWarningChannel = TELEMETRY_CHANNEL_BOARD;
     }
 }
 
 /**
- * Take care of publishing pot warnings to the broker based on the configured republish
- * intervals and previously send warning message.
+ * Add an statistic to the batch with the time it was measured, the batch is published when
+ * it holds the configured amount of statistics.
+ *
+ * @param channel       The channel of the pot.
+ * @param moisture      The percentage of moisture in the soil.
+ * @param waterLevel    The percentage of water left in the reservoir.
+ */
+void PlantCare::batchStatistic( uint8_t channel, int moisture, int waterLevel )
+{
+    if( this->statisticBatchCount == 0 )
+    {
+        this->statisticBatchStartTime = millis();
+    }
+
+    TelemetrySample *sample = &this->statisticBatch[this->statisticBatchCount++];
+    sample->time = this->communication->getTime();
+    sample->channel = channel;
+    sample->moisture = (int16_t) moisture;
+    sample->waterLevel = (int16_t) waterLevel;
+    sample->dispensed = this->channels.dispensedVolume[channel];
+
+    if( this->isStatisticBatchDue() )
+    {
+        this->flushStatisticBatch();
+    }
+}
+
+/**
+ * Check if the batch should be published. The batch is due when it holds the configured
+ * amount of statistics or when its oldest statistic waited for the configured latency. The
+ * batch can't grow past its array, even when the configuration changed in between.
+ *
+ * @return bool - True if the batch should be published.
+ */
+bool PlantCare::isStatisticBatchDue()
+{
+    TelemetrySettings *settings = this->configuration->getTelemetrySettings();
+    if( this->statisticBatchCount == 0 )
+    {
+        return false;
+    }
+    return this->statisticBatchCount >= settings->batchSize
+        || this->statisticBatchCount >= TELEMETRY_MAX_BATCH_SIZE
+        || (uint32_t)( millis() - this->statisticBatchStartTime ) >= settings->batchLatency; // Wraps like millis() does.
+}
+
+/**
+ * Publish the statistics in the batch as one message. When the broker is unreachable the
+ * statistics are appended to the telemetry log, so the replay publishes them like any other
+ * statistic that couldn't be published.
+ */
+void PlantCare::flushStatisticBatch()
+{
+    if( this->statisticBatchCount == 0 )
+    {
+        return;
+    }
+
+    if( !this->communication->isConnected() || !this->communication->publishStatisticBatch( this->statisticBatch, this->statisticBatchCount, this->forecaster.getHoursLeft(), this->cadence.getInterval() ))
+    {
+        POT_DEBUG_PRINTLN( F("[debug] - The broker is unreachable, logging the batch for later.") )
+        for( uint8_t i = 0; i < this->statisticBatchCount; i++ )
+        {
+            TelemetrySample *sample = &this->statisticBatch[i];
+            this->logStatistic( sample->channel, sample->moisture, sample->waterLevel, sample->time );
+        }
+    }
+    this->statisticBatchCount = 0;
+}
+
+/**
+ * Append an statistic that couldn't be published to the telemetry log. When the log is full it
+ * drops its oldest segment, the backend can't tell those statistics were measured so the loss
+ * is reported here.
+ *
+ * @param channel       The channel of the pot.
+ * @param moisture      The percentage of moisture in the soil.
+ * @param waterLevel    The percentage of water left in the reservoir.
+ * @param time          The unix time in seconds of the measurement.
+ */
+void PlantCare::logStatistic( uint8_t channel, int moisture, int waterLevel, uint32_t time )
+{
+    if( !this->telemetryLog->append( time, channel, moisture, waterLevel ))
+    {
+        POT_ERROR_PRINTLN( F("[error] - Can't log the statistic of channel: ") APPEND channel )
+    }
+
+    uint32_t droppedRecords = this->telemetryLog->getDroppedRecords();
+    if( droppedRecords != this->reportedDroppedRecords )
+    {
+        POT_ERROR_PRINTLN( F("[error] - The telemetry log is full, statistics dropped in total: ") APPEND droppedRecords )
+        this->reportedDroppedRecords = droppedRecords;
+    }
+}
+
+/**
+ * Publish an batch of logged statistics when the pot is connected to the broker again. Only
+ * one small batch is published per run so live statistics and configuration messages don't
+ * have to wait for the whole backlog. When an publish fails the batch stays in the log and
+ * is published again at the next run.
+ */
+void PlantCare::replayTelemetry()
+{
+    if( !this->communication->isConnected() || !this->telemetryLog->hasBacklog() )
+    {
+        return;
+    }
+
+    TelemetryRecord records[TELEMETRY_REPLAY_BATCH];
+    uint8_t count = this->telemetryLog->readBatch( records, TELEMETRY_REPLAY_BATCH );
+
+    for( uint8_t i = 0; i < count; i++ )
+    {
+        if( !this->communication->publishLoggedStatistic( records[i].channel, records[i].moisture, records[i].waterLevel, records[i].time ))
+        {
+            return;
+        }
+    }
+
+    POT_DEBUG_PRINTLN( F("[debug] - Replayed logged statistics: ") APPEND count )
+    this->telemetryLog->commitBatch();
+}
+
+/**
+ * Append the current soil moisture, water level and the water pump events since the last
+ * record to the measurement history. The values come from the sensor snapshot so recording
+ * doesn't cause an extra measurement when they are fresh. Reliable water levels also feed
+ * the depletion forecaster. In an rack the history follows the soil of channel 0, the pump
+ * events of all channels are recorded. Nothing reads the history back on the pot yet.
+ */
+void PlantCare::recordMeasurement()
+{
+    uint32_t timestamp = (uint32_t)( this->scheduler->now() / 1000 );
+    int waterLevel = this->checkWaterReservoir();
+
+    this->history->append( timestamp, this->checkMoistureLevel( 0 ), waterLevel, this->pendingHistoryEvents );
+    if( this->snapshot->getConfidence( SENSOR_WATER_LEVEL ) >= SENSOR_MIN_CONFIDENCE )
+    {
+        this->forecaster.addSample( timestamp, waterLevel, this->pendingHistoryEvents != 0 );
+    }
+    this->pendingHistoryEvents = 0;
+    this->channels.unpublished = ( 1 << POT_CHANNEL_COUNT ) - 1;
+}
+
+/**
+ * Compute the next measurement interval from the readings of the last measurement and apply
+ * it to the measurement task. The pot measures at the floor interval while the soil moisture
+ * or water level changes or is close to the watering or warning threshold, and backs off to
+ * the ceiling interval while they stay the same. A stable water level also stays fresh for
+ * half the interval so the leds don't wake the sonar more often than the measurements do.
+ * Every channel has its own cadence, the channels are measured together at the shortest
+ * interval and the cadence is left at the state of the channel that needs it.
+ */
+void PlantCare::adaptMeasurementInterval()
+{
+    int waterLevel = this->checkWaterReservoir();
+    uint32_t interval = 0;
+    uint8_t fastestChannel = 0;
+
+    for( uint8_t channel = 0; channel < POT_CHANNEL_COUNT; channel++ )
+    {
+        this->cadence.restore( this->channels.cadence[channel] );
+        uint32_t channelInterval = this->cadence.update( this->checkMoistureLevel( channel ), waterLevel, this->groundMoistureOptimal, this->publishReservoirWarningThreshold );
+        this->channels.cadence[channel] = this->cadence.getState();
+
+        if( channel == 0 || channelInterval < interval )
+        {
+            interval = channelInterval;
+            fastestChannel = channel;
+        }
+    }
+
+    this->cadence.restore( this->channels.cadence[fastestChannel] );
+    this->scheduler->setTaskInterval( this->measurementTaskId, interval );
+
+    POT_DEBUG_PRINTLN( F("[debug] - The next measurement is in milliseconds: ") APPEND interval )
+}
+
+/**
+ * Determine the warning for an water level, an empty reservoir warning when it is almost empty
+ * and an low reservoir warning when the forecast runs out within FORECAST_LOW_RESERVOIR_HOURS.
+ * A pot that drinks little can run on an low level for days while a thirsty plant empties a
+ * half full reservoir overnight. Until there is enough history to forecast, like right after
+ * an refill or an reboot, the configured threshold percentage is used. With enough water an
+ * channel of which the soil doesn't respond to the doses gets an no water response warning.
+ *
+ * @param waterLevel    The percentage of water left in the reservoir.
+ * @param channel       The channel the warning belongs to, TELEMETRY_CHANNEL_BOARD for an reservoir warning.
+ * @return uint8_t - The warning type, NO_ERROR if the reservoir contains enough water and the soil responds.
+ */
+uint8_t PlantCare::determineWarning( int waterLevel, uint8_t *channel )
+{
+    *channel = TELEMETRY_CHANNEL_BOARD; // The reservoir is shared by all channels.
+    if( waterLevel <= RESERVOIR_EMPTY_LEVEL )
+    {
+        return this->configuration->EMPTY_RESERVOIR;
+    }
+
+    int16_t hoursLeft = this->forecaster.getHoursLeft();
+    bool lowReservoir = hoursLeft == FORECAST_UNKNOWN ? waterLevel < this->publishReservoirWarningThreshold : hoursLeft < FORECAST_LOW_RESERVOIR_HOURS;
+    if( lowReservoir )
+    {
+        return this->configuration->LOW_RESERVOIR;
+    }
+
+    for( uint8_t i = 0; i < POT_CHANNEL_COUNT; i++ )
+    {
+        if( this->channels.unansweredDoses[i] >= WATERING_MAX_UNANSWERED_DOSES )
+        {
+            *channel = i;
+            return this->configuration->NO_WATER_RESPONSE;
+        }
+    }
+    return this->configuration->NO_ERROR;
+}
+
+/**
+ * Update the current warning and publish it to the broker right away when it changed. The
+ * warning task republishes the active warning at the configured republish interval. An
+ * batch of statistics that is still waiting is published before the warning.
  *
  * @param warningType   The type of warning to publish like an empty or near empty reservoir.
+ * @param channel       The channel the warning belongs to, TELEMETRY_CHANNEL_BOARD for the whole pot.
+ */
+void PlantCare::publishPotWarning( uint8_t warningType, uint8_t channel )
+{
+    if( warningType == this->currentWarning && channel == this->currentWarningChannel )
+    {
+        return;
+    }
+
+    POT_DEBUG_PRINTLN( F("[debug] - Publishing warning message to the mqtt broker.") )
+    this->flushStatisticBatch(); // Publish the statistics that lead up to the warning first.
+    this->currentWarning = warningType;
+    this->currentWarningChannel = channel;
+    this->communication->publishWarning( warningType, channel );
+}
+
+/**
+ * Run one wake up of the battery powered duty cycle mode. The pot measures and gives water when
+ * the measurement interval passed, only when the radio was enabled for this wake up it connects
+ * to the broker to publish statistics and warnings. The TLS session is kept in RTC memory so the
+ * connection of the next wake up skips the full handshake. After that the planner computes when
+ * the next thing is due and the pot goes back to deep sleep.
+ *
+ * @param dutyCycle An pointer to the duty cycle instance that keeps the state during deep sleep.
  */
-void PlantCare::publishPotWarning( uint8_t warningType )
+void PlantCare::runDutyCycle( DutyCycle *dutyCycle )
 {
-    if( this->currentTime - this->lastPublishWarningTime > this->republishWarningInterval && this->currentWarning )
+    RtcPotState *state = dutyCycle->getState();
+    DutyCycleIntervals intervals;
+    this->cadence.restore( state->cadence );
+    this->channels.cadence[0] = state->cadence;
+    intervals.measurementInterval = this->containsPlant == 1 ? this->cadence.getInterval() : 0;
+    intervals.statisticInterval = this->containsPlant == 1 ? this->publishStatisticInterval : 0;
+    intervals.warningInterval = this->republishWarningInterval;
+    intervals.sleepAfterGivingWater = this->wateringController.getSettleTime( this->sleepAfterGivingWaterTime );
+
+    this->sonar.setup();
+#ifdef POT_FLOW_METER
+    this->flowMeter.setup();
+    this->channels.dispensedVolume[0] = state->dispensedVolume;
+#endif
+    this->communication->restoreCounters( state->statisticCounter, state->warningCounter );
+
+    int waterLevel = this->measureWaterLevelNow();
+    if( this->snapshot->getConfidence( SENSOR_WATER_LEVEL ) >= SENSOR_MIN_CONFIDENCE )
+    {
+        state->currentWarning = this->determineWarning( waterLevel, &state->warningChannel );
+    }
+    if( state->currentWarning == this->configuration->NO_ERROR )
     {
-        POT_DEBUG_PRINTLN( F("[debug] - Publishing warning message to the mqtt broker.") )
-        this->lastPublishWarningTime = this->currentTime;
-        this->communication->publishWarning(warningType);
+        state->publishedWarning = this->configuration->NO_ERROR;
+        state->warningAttempts = 0;
     }
-}
\ No newline at end of file
+
+    if( DutyCyclePlanner::isMeasurementDue( *state, intervals, dutyCycle->now() ))
+    {
+        state->lastMeasurementTime = dutyCycle->now();
+
+        if( state->doseTime != 0 ) // Learn the response to the dose given before the last sleep.
+        {
+            this->channels.doseTime[0] = state->doseTime;
+            this->channels.moistureBeforeDose[0] = state->moistureBeforeDose;
+            this->learnDoseResponse( 0 );
+            state->doseTime = 0;
+        }
+
+        this->giveWater( 0 );
+
+        while( this->channels.pumpState[0] == PUMP_RUNNING ) // Wait for the pump, the deadline task stops it.
+        {
+            this->scheduler->run();
+            delay( 10 );
+        }
+
+        if( this->channels.pumpState[0] == PUMP_SOAKING )
+        {
+            state->lastGivingWaterTime = dutyCycle->now();
+            state->doseTime = this->channels.doseTime[0];
+            state->moistureBeforeDose = this->channels.moistureBeforeDose[0];
+            state->dispensedVolume = this->channels.dispensedVolume[0];
+        }
+
+        this->adaptMeasurementInterval();
+        state->cadence = this->cadence.getState();
+        intervals.measurementInterval = this->cadence.getInterval();
+    }
+
+    bool statisticDue = DutyCyclePlanner::isStatisticDue( *state, intervals, dutyCycle->now() );
+    bool warningDue = DutyCyclePlanner::isWarningDue( *state, intervals, dutyCycle->now() );
+
+    if( dutyCycle->isRadioEnabled() && ( statisticDue || warningDue ))
+    {
+        this->telemetryLog->setup(); // The log is only mounted when the radio is on, it costs an wake up time otherwise.
+        this->communication->restoreSession( state->tlsSession, sizeof( state->tlsSession )); // Resume the session of the previous wake up.
+        this->communication->setup();
+        this->communication->connect();
+
+        if( warningDue )
+        {
+            if( this->communication->publishWarning( state->currentWarning, state->warningChannel ))
+            {
+                state->publishedWarning = state->currentWarning;
+                state->lastPublishWarningTime = dutyCycle->now();
+                state->warningAttempts = 0;
+            }
+            else
+            {
+                state->lastWarningAttemptTime = dutyCycle->now();
+                state->warningAttempts++;
+            }
+        }
+
+        if( statisticDue )
+        {
+            int moisture = this->checkMoistureLevel( 0 );
+            if( this->communication->isConnected() && this->communication->publishStatistic( 0, moisture, waterLevel == 0 ? 1 : waterLevel, FORECAST_UNKNOWN, this->cadence.getInterval(), state->dispensedVolume ))
+            {
+                this->replayTelemetry(); // Publish the statistics of the wake ups the broker was unreachable.
+            }
+            else
+            {
+                POT_DEBUG_PRINTLN( F("[debug] - The broker is unreachable, logging the statistic for later.") )
+                this->logStatistic( 0, moisture, waterLevel == 0 ? 1 : waterLevel, this->communication->getTime() );
+            }
+            state->lastPublishStatisticsTime = dutyCycle->now(); // The statistic is published or logged, the next one is due after the interval.
+        }
+
+        this->communication->listen(); // Pick up configuration retained by the broker.
+        state->statisticCounter = this->communication->getStatisticCounter();
+        state->warningCounter = this->communication->getWarningCounter();
+        this->communication->storeSession( state->tlsSession, sizeof( state->tlsSession ));
+    }
+
+    bool radioNeeded = false;
+    uint32_t sleepTime = DutyCyclePlanner::computeSleepTime( *state, intervals, dutyCycle->now(), &radioNeeded );
+    dutyCycle->sleep( sleepTime, radioNeeded );
+}
+
+/**
+ * Check the connection to the mqtt broker, reconnect if needed and process incoming messages.
+ *
+ * @param plantCare An pointer to the plant care instance that registered the task.
+ */
+void PlantCare::communicationTask( void *plantCare )
+{
+    PlantCare *self = (PlantCare*) plantCare;
+    self->communication->connect(); // Are we still connected?
+    self->communication->listen();
+}
+
+/**
+ * Publish an batch of logged statistics to the mqtt broker.
+ *
+ * @param plantCare An pointer to the plant care instance that registered the task.
+ */
+void PlantCare::replayTask( void *plantCare )
+{
+    ((PlantCare*) plantCare)->replayTelemetry();
+}
+
+/**
+ * Collect the last echo of the water level measurement and start the next one.
+ *
+ * @param plantCare An pointer to the plant care instance that registered the task.
+ */
+void PlantCare::reservoirTask( void *plantCare )
+{
+    ((PlantCare*) plantCare)->sampleWaterReservoir();
+}
+
+/**
+ * Start an water level measurement, the snapshot calls this when the water level is stale.
+ *
+ * @param plantCare An pointer to the plant care instance that registered the sensor.
+ */
+void PlantCare::refreshWaterLevel( void *plantCare )
+{
+    ((PlantCare*) plantCare)->startWaterLevelMeasurement();
+}
+
+/**
+ * Measure the soil moisture of an channel, the snapshot calls this when the moisture level is stale.
+ *
+ * @param plantCareChannel  An pointer to the channel context that registered the sensor.
+ */
+void PlantCare::refreshMoistureLevel( void *plantCareChannel )
+{
+    PlantCareChannel *context = (PlantCareChannel*) plantCareChannel;
+    context->plantCare->measureMoistureLevel( context->channel );
+}
+
+/**
+ * Measure the soil moisture, give the plants water if they need it and record the measurement.
+ *
+ * @param plantCare An pointer to the plant care instance that registered the task.
+ */
+void PlantCare::measurementTask( void *plantCare )
+{
+    PlantCare *self = (PlantCare*) plantCare;
+    if( self->containsPlant == 1 )
+    {
+        for( uint8_t channel = 0; channel < POT_CHANNEL_COUNT; channel++ )
+        {
+            self->giveWater( channel );
+        }
+        self->recordMeasurement();
+        self->adaptMeasurementInterval();
+    }
+}
+
+/**
+ * Publish the pot statistics to the mqtt broker. Only new measurements get published, so
+ * when the cadence backed off the statistics slow down with it. An batch that waited for
+ * the configured latency is published even when there are no new measurements.
+ *
+ * @param plantCare An pointer to the plant care instance that registered the task.
+ */
+void PlantCare::statisticTask( void *plantCare )
+{
+    PlantCare *self = (PlantCare*) plantCare;
+    if( self->containsPlant == 1 && self->channels.unpublished != 0 )
+    {
+        self->publishPotStatistic();
+    }
+    if( self->isStatisticBatchDue() ) // The latency of an batch is checked at the statistic interval.
+    {
+        self->flushStatisticBatch();
+    }
+}
+
+/**
+ * Republish the active warning so the user gets reminded until the problem is solved.
+ *
+ * @param plantCare An pointer to the plant care instance that registered the task.
+ */
+void PlantCare::warningTask( void *plantCare )
+{
+    PlantCare *self = (PlantCare*) plantCare;
+    if( self->currentWarning != self->configuration->NO_ERROR )
+    {
+        POT_DEBUG_PRINTLN( F("[debug] - Republishing warning message to the mqtt broker.") )
+        self->communication->publishWarning( self->currentWarning, self->currentWarningChannel );
+    }
+}
+
+/**
+ * Ping the mqtt broker so the connection stays alive.
+ *
+ * @param plantCare An pointer to the plant care instance that registered the task.
+ */
+void PlantCare::pingTask( void *plantCare )
+{
+    ((PlantCare*) plantCare)->communication->ping();
+}
+
+#ifdef POT_FLOW_METER
+/**
+ * Check the flow meter while the water pump of an channel runs.
+ *
+ * @param plantCareChannel  An pointer to the channel context that registered the task.
+ */
+void PlantCare::flowCheckTask( void *plantCareChannel )
+{
+    PlantCareChannel *context = (PlantCareChannel*) plantCareChannel;
+    if( context->plantCare->channels.pumpState[context->channel] == PUMP_RUNNING )
+    {
+        context->plantCare->checkWaterFlow( context->channel );
+    }
+}
+#else
+/**
+ * Stop the water pump of an channel when its deadline passed.
+ *
+ * @param plantCareChannel  An pointer to the channel context that registered the task.
+ */
+void PlantCare::waterPumpDeadlineTask( void *plantCareChannel )
+{
+    PlantCareChannel *context = (PlantCareChannel*) plantCareChannel;
+    if( context->plantCare->channels.pumpState[context->channel] == PUMP_RUNNING )
+    {
+        context->plantCare->stopWaterPump( context->channel );
+    }
+}
+#endif
+
+/**
+ * End the soaking period of an channel so the plant can receive water again.
+ *
+ * @param plantCareChannel  An pointer to the channel context that registered the task.
+ */
+void PlantCare::soakingDoneTask( void *plantCareChannel )
+{
+    PlantCareChannel *context = (PlantCareChannel*) plantCareChannel;
+    context->plantCare->finishSoaking( context->channel );
+}
@@ -13,57 +13,194 @@
 #include <Configuration.h> // This library contains the code for loading plant pot configuration.
 #include <Communication.h> // This library contains the code for communication between the pot and broker.
 #include <LedController.h> // This library contains the code for taking care of the plant.
+#include <Ticker.h> // Include this library for scheduling the water pump safety stop.
+#include <UltrasonicSensor.h> // This library contains the code for measuring the water level without blocking.
+#include <TaskScheduler.h> // This library contains the code for running the pot's tasks at their deadlines.
+#include <DutyCycle.h> // This library contains the code for sleeping between measurements on battery power.
+#include <SensorFilter.h> // This library contains the code for filtering bursts of sensor samples.
+#include <ReservoirModel.h> // This library contains the code for converting echo times into reservoir fill levels.
+#include <SensorSnapshot.h> // This library contains the latest readings shared by all parts of the pot.
+#include <MeasurementHistory.h> // This library contains the compressed history of the pot measurements.
+#include <TelemetryLog.h> // This library contains the flash log of statistics that couldn't be published.
+#include <WateringController.h> // This library contains the code for sizing the water doses.
+#include <DepletionForecaster.h> // This library contains the code for forecasting when the reservoir is empty.
+#include <MeasurementCadence.h> // This library contains the code for adapting the measurement interval.
+#include <PotChannels.h> // This library contains the state of the pots driven by this board.
+#include <FlowMeter.h> // This library contains the code for giving an volume of water.
 
-#define RESERVOIR_CONTENT_CM_3 16000 // The water reservoir content in square centimeters
-#define RESERVOIR_1_CM_CONTENT_CM_3 400 // The content in square centimeters of 1 cm reservoir height.
-#define SOUND_SPEED_CM_PER_MICRO_SECOND 0.034 //An approximation to the amount of centimeters sound travels in one micro second.
+// The maximum echo time in microseconds, the sound never has to travel further than the reservoir bottom and back.
+#define SONAR_ECHO_TIMEOUT ( SONAR_ECHO_START_LATENCY + ReservoirShape::maxEchoTime( RESERVOIR_ECHO_MARGIN_MM ))
+#define WATER_LEVEL_TIME_TO_LIVE 10000 // The time in milliseconds an water level stays fresh.
+#define WATER_LEVEL_STABLE_TIME_TO_LIVE 60000 // The time in milliseconds an water level stays fresh when the level is stable.
+#define MOISTURE_TIME_TO_LIVE 10000 // The time in milliseconds an soil moisture level stays fresh.
+
+#define SENSOR_FILTER_CAPACITY 9 // The maximum amount of samples in an burst.
+#define SENSOR_MIN_CONFIDENCE 50 // The minimum confidence in percent of an measurement before we act on it.
+#define SONAR_SAMPLE_BURST 5 // The amount of echoes measured for one water level.
+#define SONAR_SMOOTHING_FACTOR 128 // The weight of an new water level in the smoothed level, 256 disables smoothing.
+#define SONAR_ECHO_TOLERANCE 60 // The spread in microseconds of the echoes before the confidence drops to 0 (about 1 cm).
+#define MOISTURE_SAMPLE_BURST 7 // The amount of analog readings for one soil moisture measurement.
+#define MOISTURE_SMOOTHING_FACTOR 256 // The weight of an new moisture level in the smoothed level, 256 disables smoothing.
+#define MOISTURE_SAMPLE_TOLERANCE 20 // The spread of the analog readings before the confidence drops to 0.
+#define COMMUNICATION_LISTEN_INTERVAL 100 // The interval in milliseconds we check the connection and listen for messages.
+#define TELEMETRY_REPLAY_INTERVAL 5000 // The interval in milliseconds between two batches of logged statistics.
+#define TELEMETRY_REPLAY_BATCH 10 // The maximum amount of logged statistics published in one batch.
 
 #define IO_PIN_SONAR_TRIGGER 13 // The pin connected trigger port of the ultra sonar sensor.
 #define IO_PIN_SONAR_ECHO 12 // The pin connected to the echo port of the ultra sonar sensor.
-#define IO_PIN_SOIL_MOISTURE A0 // The pin connected to the analog read of the soil moisture sensor.
+#define IO_PIN_SOIL_MOISTURE A0 // The pin connected to the analog read of the soil moisture sensor, through the multiplexer in an rack.
+#ifdef POT_DUTY_CYCLE
+#define IO_PIN_WATER_PUMP 5 // GPIO16 wakes the pot from deep sleep, so the water pump moves to D1.
+#else
 #define IO_PIN_WATER_PUMP 16 // The pin connected to the transistor base for switching the water pump.
+#endif
+
+#if POT_CHANNEL_COUNT > 1
+#ifdef POT_DUTY_CYCLE
+#error "An rack of pots can't run on batteries, the water pump of channel 1 uses the pin of the duty cycle pump."
+#endif
+#define IO_PINS_WATER_PUMP { 16, 5, 4, 15 } // The pins that switch the water pump of every channel.
+#define IO_PINS_MUX_SELECT { 0, 2 } // The pins connected to the select inputs of the analog multiplexer, S0 first.
+#define MUX_SETTLE_TIME 10 // The time in microseconds the multiplexer output needs to settle after switching.
+#else
+#define IO_PINS_WATER_PUMP { IO_PIN_WATER_PUMP } // The pin that switches the water pump of the pot.
+#endif
 
 #define WATER_PUMP_DEFAULT_TIME 5000 // The default time to activate the water pump.
+#define WATER_PUMP_MAX_TIME 30000 // The maximum time the water pump is allowed to run in one go.
+
+#ifdef POT_FLOW_METER
+#if POT_CHANNEL_COUNT > 1
+#define IO_PIN_FLOW_METER 3 // The pumps of an rack take turns so they share the flow meter, it uses the RX pin because the others are taken.
+#else
+#define IO_PIN_FLOW_METER 4 // The pin connected to the signal wire of the flow meter in the water line.
+#endif
+#define FLOW_METER_CHECK_INTERVAL 100 // The interval in milliseconds we check the flow meter while the pump runs.
+#define WATER_DOSE_DEFAULT 100 // The volume in millilitres of an dose when the response of the soil is unknown.
+#define WATER_DOSE_MIN 10 // The smallest volume in millilitres worth running the pump for.
+#define WATER_DOSE_MAX 500 // The maximum volume in millilitres of one dose, the pump time stays limited to WATER_PUMP_MAX_TIME.
+#define WATER_DOSE_UNIT " millilitres" // The unit of an dose in the debug messages.
+#else
+#define WATER_DOSE_DEFAULT WATER_PUMP_DEFAULT_TIME // Without an flow meter an dose is an time.
+#define WATER_DOSE_MIN WATERING_MIN_DOSE_TIME // The shortest time in milliseconds worth running the pump for.
+#define WATER_DOSE_MAX WATER_PUMP_MAX_TIME // The maximum time in milliseconds of one dose.
+#define WATER_DOSE_UNIT " milliseconds" // The unit of an dose in the debug messages.
+#endif
+#define WATERING_MAX_UNANSWERED_DOSES 3 // The doses in a row without an moisture rise before the pot waits the configured sleep time between doses.
+#define WATERING_PERSIST_GAIN_CHANGE 10 // The change in percent of the learned gain that is persisted right away.
+#define WATERING_PERSIST_INTERVAL 86400000 // The longest time in milliseconds an smaller change of the learned gain waits before it is persisted.
+#define RESERVOIR_EMPTY_LEVEL 5 // The percentage of water at or below which the reservoir counts as empty.
+#define FORECAST_LOW_RESERVOIR_HOURS 48 // The forecasted hours left below which we warn for an low reservoir.
 
 class Communication; // Forward declare the communication library.
 class Configuration; //  Forward declare the configuration library.
 class PlantCare; // Forward declare the plant care library.
 
+/**
+ * Data structure passed to the task callbacks of an channel, so they know which pot to take care of.
+ */
+struct PlantCareChannel
+{
+    PlantCare *plantCare; // The plant care instance that registered the task.
+    uint8_t channel; // The channel of the pot.
+};
+
 class PlantCare
 {
 public:
     /**
      * This function initiates the plant care library. It sets up the
      * I/O pins that are connected to the sensors and water pump.
+     *
+     * @param potCommunication  An pointer to the communication library.
+     * @param taskScheduler     An pointer to the scheduler that runs the plant care tasks.
+     * @param sensorSnapshot    An pointer to the snapshot that shares the sensor readings.
+     * @param measurementHistory An pointer to the history the measurements are appended to.
+     * @param potTelemetryLog   An pointer to the log of statistics that couldn't be published.
+     */
+    PlantCare( Communication* potCommunication, TaskScheduler* taskScheduler, SensorSnapshot* sensorSnapshot, MeasurementHistory* measurementHistory, TelemetryLog* potTelemetryLog );
+
+    /**
+     * This function will copy the settings from the configuration into the plant care
+     * library. It has to be called before setup() to take effect on the task intervals.
+     */
+    void loadConfiguration();
+
+    /**
+     * This function will setup the sensors that need the system to be initiated, like
+     * the interrupt of the ultra sonic sensor, and register the plant care tasks.
      */
-    PlantCare( Communication* potCommunication );
+    void setup();
 
     /**
      * This is the main function of the project. It will take care of the
-     * plant and control everything.
+     * plant and control everything by running the tasks that are due.
      */
     void takeCareOfPlant();
 
     /**
-     * This function will use the ultra sonic sensor to measure percentage
-     * of water left in the reservoir.
+     * This function returns the percentage of water left in the reservoir from the sensor
+     * snapshot. An new measurement is started when the level is stale.
      * @return int - The percentage of water left in the reservoir.
      */
     int checkWaterReservoir();
 
+    /**
+     * This function runs one wake up of the battery powered duty cycle mode. It takes
+     * measurements, gives water and publishes when it is due, after that it puts the pot
+     * back into deep sleep until the next thing is due. This function doesn't return.
+     *
+     * @param dutyCycle An pointer to the duty cycle instance that keeps the state during deep sleep.
+     */
+    void runDutyCycle( DutyCycle* dutyCycle );
+
+    /**
+     * An enumeration containing all states of the water pump state machine.
+     */
+    enum WaterPumpState
+    {
+        PUMP_IDLE = 0, // The pump is off and the plant can receive water at the next measurement.
+        PUMP_RUNNING = 1, // The pump is on and has to be switched off when the pump deadline passes.
+        PUMP_SOAKING = 2 // The pump is off and the water gets time to spread through the soil.
+    };
+
 private:
-    bool waterPumpState; // The current state of the water pump, either on or off.
+    static const uint8_t waterPumpPins[POT_CHANNEL_COUNT]; // The pins that switch the water pump of every channel.
+    static volatile uint8_t runningWaterPumpPin; // The pin of the running water pump, used by the safety timer.
+    ChannelTable channels; // The water pump state, pending dose, learned gain and cadence of every channel.
+    PlantCareChannel channelContexts[POT_CHANNEL_COUNT]; // The contexts passed to the tasks of every channel.
+    PumpArbiter pumpArbiter; // The arbiter that makes sure only one water pump runs at the same time.
+    Ticker waterPumpSafetyTimer; // Timer that switches the pump off at its deadline even when the loop is blocked.
+#ifdef POT_FLOW_METER
+    FlowMeter flowMeter; // The flow meter that measures the water the pumps give.
+    uint8_t flowCheckTaskId; // The id of the task that checks the flow meter while an pump runs.
+    uint64_t waterPumpStartTime; // The time in milliseconds the running pump was switched on.
+#endif
+    UltrasonicSensor sonar; // The ultra sonic sensor used to measure the water level in the reservoir.
+    SampleFilter<SENSOR_FILTER_CAPACITY> reservoirFilter; // The filter that reduces an burst of echo times to one.
+    SampleFilter<SENSOR_FILTER_CAPACITY> moistureFilter; // The filter that reduces an burst of analog readings to one, smoothing is off so the channels can share it.
+    ReservoirModel reservoirModel; // The model that converts echo times into reservoir fill levels.
+    WateringController wateringController; // The controller that sizes the water doses and learns the response of the soil, the gain of every channel is in the channel table.
+    DepletionForecaster forecaster; // The forecaster of the hours left until the reservoir is empty.
+    MeasurementCadence cadence; // The policy that adapts the measurement interval, it holds the state of the channel that measures most often.
+    uint8_t measurementTaskId; // The id of the measurement task, its interval follows the cadence.
+    SensorSnapshot* snapshot; // The snapshot that shares the sensor readings with the rest of the pot.
+    MeasurementHistory* history; // The history the measurements are appended to.
+    TelemetryLog* telemetryLog; // The log of statistics that couldn't be published.
+    uint32_t reportedDroppedRecords; // The amount of records the telemetry log dropped that were reported already.
+    TelemetrySample statisticBatch[TELEMETRY_MAX_BATCH_SIZE]; // The statistics waiting to be published in one message.
+    uint8_t statisticBatchCount; // The amount of statistics in the batch.
+    uint32_t statisticBatchStartTime; // The time in milliseconds the oldest statistic of the batch was added.
+    uint8_t pendingHistoryEvents; // The HISTORY_EVENT flags of things that happened since the last history record.
     Configuration* configuration; // An configuration instance containing mqtt, led and plant care configuration.
     Communication* communication; // An communication instance for communication between the pot and mqtt broker.
+    TaskScheduler* scheduler; // An scheduler instance that runs the plant care tasks at their deadlines.
 
-    uint32_t currentTime; // The current milliseconds since the last reset.
-    uint32_t lastPublishStatisticsTime; // The time in milliseconds we published statistics to the broker.
-    uint32_t lastPublishWarningTime; // The last time in milliseconds we published an warning to the broker.
-    uint32_t lastPingTime; // The last time in milliseconds we pinged to the broker.
-    uint32_t lastMeasurementTime; // The last time in milliseconds we took an measurement.
-    uint32_t lastGivingWaterTime; // The last time in milliseconds we gave water.
+    uint64_t lastGivingWaterTime; // The last time in milliseconds we gave water.
+    uint64_t lastPersistGainTime; // The last time in milliseconds the learned gains were persisted.
 
     uint8_t currentWarning; // The current warning code.
+    uint8_t currentWarningChannel; // The channel the current warning belongs to.
 
     // Led settings
     uint8_t red; // The luminosity strength of the red led in the reservoir.
@@ -83,41 +220,257 @@ private:
     uint8_t containsPlant; // Boolean to check if the pot contains an plant.
 
     /**
-     * This function will use the ground moisture sensor to measure the resistance
-     * of the soil. If its wet the resistance is les so we know how wet the ground is.
+     * This function returns the soil moisture from the sensor snapshot, the soil is
+     * measured again when the moisture level is stale.
+     *
+     * @param channel   The channel of the pot.
      * @return int - The percentage resistance the soil has.
      */
-    int checkMoistureLevel();
+    int checkMoistureLevel( uint8_t channel );
+
+    /**
+     * This function will use the ground moisture sensor to measure the resistance
+     * of the soil and store it in the sensor snapshot. If its wet the resistance is les
+     * so we know how wet the ground is.
+     *
+     * @param channel   The channel of the pot.
+     */
+    void measureMoistureLevel( uint8_t channel );
+
+#if POT_CHANNEL_COUNT > 1
+    /**
+     * This function will switch the analog multiplexer to the soil moisture sensor of an channel.
+     *
+     * @param channel   The channel of the pot.
+     */
+    void selectMoistureSensor( uint8_t channel );
+#endif
+
+    /**
+     * This function will measure the water level and wait for the echo to return. It only
+     * blocks for the time the sound needs to travel, it is used when the pot wakes up from
+     * deep sleep and there is nothing else to do.
+     *
+     * @return int - The percentage of water left in the reservoir.
+     */
+    int measureWaterLevelNow();
+
+    /**
+     * This function will start an burst of echoes to measure the water level.
+     */
+    void startWaterLevelMeasurement();
+
+    /**
+     * This function will collect the last echo from the ultra sonic sensor and start the
+     * next one. When the burst is complete the echoes are filtered into an new water level
+     * and stored in the sensor snapshot, the level stays fresh longer when it is stable.
+     */
+    void sampleWaterReservoir();
+
+    /**
+     * This function will trigger the next echo of the burst. When the sensor refuses the
+     * trigger without an echo in flight the echo counts as missing, so the burst completes.
+     */
+    void triggerEcho();
+
+    /**
+     * This function will convert the time the sound took to travel to the water surface and
+     * back into the percentage of water left in the reservoir, using the calibrated reservoir model.
+     *
+     * @param echoTime  The echo time in microseconds.
+     * @return int - The percentage of water left in the reservoir.
+     */
+    int convertEchoTimeToWaterLevel( uint32_t echoTime );
+
+    /**
+     * This function will append the current soil moisture, water level and water pump
+     * events to the measurement history.
+     */
+    void recordMeasurement();
+
+    /**
+     * This function will compute the next measurement interval from the last measurement
+     * and apply it to the measurement task.
+     */
+    void adaptMeasurementInterval();
+
+    /**
+     * This function determines the warning for an water level.
+     *
+     * @param waterLevel    The percentage of water left in the reservoir.
+     * @param channel       The channel the warning belongs to, TELEMETRY_CHANNEL_BOARD for an reservoir warning.
+     * @return uint8_t - The warning type, NO_ERROR if the reservoir contains enough water.
+     */
+    uint8_t determineWarning( int waterLevel, uint8_t *channel );
 
     /**
      * This function will take care of giving the plant water. It will give water based on the
-     * configured interval and sleep time.
+     * measured soil moisture when the pump is not running or soaking. When the pump of an other
+     * channel is running the channel waits for its turn.
+     *
+     * @param channel   The channel of the pot.
+     */
+    void giveWater( uint8_t channel );
+
+    /**
+     * This function will give water to the channels that were waiting for their turn, until
+     * one of them switches its pump on.
+     */
+    void giveWaterToWaitingChannels();
+
+    /**
+     * This function will end the soaking period. In the adaptive mode it learns the response
+     * of the soil to the last dose and gives more water right away when it is still too dry.
+     *
+     * @param channel   The channel of the pot.
+     */
+    void finishSoaking( uint8_t channel );
+
+    /**
+     * This function will learn the response of the soil of an channel to its last dose and
+     * persist the learned gain in the configuration.
+     *
+     * @param channel   The channel of the pot.
+     */
+    void learnDoseResponse( uint8_t channel );
+
+    /**
+     * This function will persist the learned gains when the gain of an channel changed enough
+     * or wasn't persisted for an day, so the flash isn't erased for every dose.
+     *
+     * @param channel   The channel of which the gain was learned.
+     */
+    void persistResponseGain( uint8_t channel );
+
+    /**
+     * This function will switch the water pump on for an dose and move the state machine to
+     * the running state. Without an flow meter the dose is the time the pump runs, with an
+     * flow meter it is the volume of water and the time only limits the dose.
+     *
+     * @param channel   The channel of the pot.
+     * @param dose      The milliseconds the pump should run, or millilitres with an flow meter.
+     */
+    void startWaterPump( uint8_t channel, uint32_t dose );
+
+    /**
+     * This function will give up on an dose when the task that stops the pump can't be
+     * registered and hand the pumps back to the other channels.
+     *
+     * @param channel   The channel of the pot.
+     */
+    void cancelWaterPump( uint8_t channel );
+
+#ifdef POT_FLOW_METER
+    /**
+     * This function will stop the water pump when the flow meter counted the volume of the
+     * dose, when no water flows anymore or when the pump ran for the maximum time.
+     *
+     * @param channel   The channel of the pot.
      */
-    void giveWater();
+    void checkWaterFlow( uint8_t channel );
+#endif
 
     /**
-     * This function will take care of publishing pot statistics to the broker based on
-     * the configured interval and previous published message.
+     * This function will switch the water pump off and move the state machine to the
+     * soaking state, after that the next waiting channel gets its turn.
+     *
+     * @param channel   The channel of the pot.
+     */
+    void stopWaterPump( uint8_t channel );
+
+    /**
+     * This function will take care of publishing the statistics of every channel with an new
+     * measurement to the broker and raise an warning when the water reservoir is running low.
      */
     void publishPotStatistic();
 
     /**
-     * This function will take care of publishing pot warnings to the broker based on
-     * the configured republish intervals and previous published message.
+     * This function will publish an batch of logged statistics when the pot is connected
+     * to the broker again.
+     */
+    void replayTelemetry();
+
+    /**
+     * This function will append an statistic that couldn't be published to the telemetry log
+     * and report the statistics the log dropped to make room for it.
+     *
+     * @param channel       The channel of the pot.
+     * @param moisture      The percentage of moisture in the soil.
+     * @param waterLevel    The percentage of water left in the reservoir.
+     * @param time          The unix time in seconds of the measurement.
+     */
+    void logStatistic( uint8_t channel, int moisture, int waterLevel, uint32_t time );
+
+    /**
+     * This function will add an statistic to the batch and publish the batch when it is full.
+     *
+     * @param channel       The channel of the pot.
+     * @param moisture      The percentage of moisture in the soil.
+     * @param waterLevel    The percentage of water left in the reservoir.
+     */
+    void batchStatistic( uint8_t channel, int moisture, int waterLevel );
+
+    /**
+     * This function checks if the batch is full or its oldest statistic waited long enough.
+     *
+     * @return bool - True if the batch should be published.
+     */
+    bool isStatisticBatchDue();
+
+    /**
+     * This function will publish the statistics in the batch as one message, when the broker
+     * is unreachable they are appended to the telemetry log.
+     */
+    void flushStatisticBatch();
+
+    /**
+     * This function will update the current warning and publish it right away when it
+     * changed. Active warnings get republished by the warning task.
      *
      * @param warningType   The type of warning to publish like an empty or near empty reservoir.
+     * @param channel       The channel the warning belongs to, TELEMETRY_CHANNEL_BOARD for the whole pot.
      */
-    void publishPotWarning( uint8_t warningType );
+    void publishPotWarning( uint8_t warningType, uint8_t channel );
+
+    /**
+     * The task callbacks below get registered at the scheduler, the context is an pointer
+     * to the plant care instance that registered them.
+     */
+    static void communicationTask( void* plantCare ); // Checks the connection and listens for messages.
+    static void reservoirTask( void* plantCare ); // Collects an echo of the water level measurement.
+    static void refreshWaterLevel( void* plantCare ); // Starts an water level measurement when the snapshot is stale.
+    static void refreshMoistureLevel( void* plantCareChannel ); // Measures the soil moisture of an channel when the snapshot is stale.
+    static void measurementTask( void* plantCare ); // Measures the soil moisture and gives water.
+    static void statisticTask( void* plantCare ); // Publishes pot statistics.
+    static void warningTask( void* plantCare ); // Republishes the active warning.
+    static void pingTask( void* plantCare ); // Pings the mqtt broker to keep the connection alive.
+    static void replayTask( void* plantCare ); // Publishes an batch of logged statistics.
+#ifdef POT_FLOW_METER
+    static void flowCheckTask( void* plantCareChannel ); // Checks the flow meter while the water pump of an channel runs.
+#else
+    static void waterPumpDeadlineTask( void* plantCareChannel ); // Stops the water pump of an channel.
+#endif
+    static void soakingDoneTask( void* plantCareChannel ); // Ends the soaking period of an channel after giving water.
 
     /**
      * This function will switch the water pump on so the plant receives water.
+     *
+     * @param channel   The channel of the pot.
      */
-    void activateWaterPump();
+    void activateWaterPump( uint8_t channel );
 
     /**
      * This function will switch the water pump off so the plant stops receiving water.
+     *
+     * @param channel   The channel of the pot.
+     */
+    void deactivateWaterPump( uint8_t channel );
+
+    /**
+     * This function is called by the safety timer when the water pump deadline passes. It
+     * only cuts the power to the pump, the state machine picks up the change on the next pass.
      */
-    void deactivateWaterPump();
+    static void forceWaterPumpOff();
 };
 
 #endif //WATERUP_PLANTPOT_PLANTCARE_H
@@ -0,0 +1,86 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ */
+#include "PotChannels.h"
+
+/**
+ * Create an arbiter without pump running and no channel waiting.
+ */
+PumpArbiter::PumpArbiter()
+{
+    this->owner = CHANNEL_NONE;
+    this->lastOwner = POT_CHANNEL_COUNT - 1; // The first turn goes to channel 0.
+    this->waiting = 0;
+}
+
+/**
+ * Give the pumps to an channel when they are free, otherwise queue the channel.
+ *
+ * @param channel   The channel that wants to give water.
+ * @return bool - True if the channel may switch its pump on.
+ */
+bool PumpArbiter::acquire( uint8_t channel )
+{
+    if( channel >= POT_CHANNEL_COUNT )
+    {
+        return false;
+    }
+
+    if( this->owner == CHANNEL_NONE || this->owner == channel )
+    {
+        this->owner = channel;
+        this->waiting &= ~( 1 << channel );
+        return true;
+    }
+
+    this->waiting |= 1 << channel;
+    return false;
+}
+
+/**
+ * Take the pumps back from the channel that was using them.
+ *
+ * @param channel   The channel that switched its pump off.
+ */
+void PumpArbiter::release( uint8_t channel )
+{
+    if( this->owner == channel )
+    {
+        this->lastOwner = channel;
+        this->owner = CHANNEL_NONE;
+    }
+}
+
+/**
+ * Return the first waiting channel after the channel that used the pumps last.
+ *
+ * @return uint8_t - The next channel, CHANNEL_NONE if the pumps are in use or no channel is waiting.
+ */
+uint8_t PumpArbiter::takeNextWaiting()
+{
+    if( this->owner != CHANNEL_NONE || this->waiting == 0 )
+    {
+        return CHANNEL_NONE;
+    }
+
+    for( uint8_t i = 1; i <= POT_CHANNEL_COUNT; i++ )
+    {
+        uint8_t channel = ( this->lastOwner + i ) % POT_CHANNEL_COUNT;
+        if( this->waiting & ( 1 << channel ))
+        {
+            this->waiting &= ~( 1 << channel );
+            return channel;
+        }
+    }
+    return CHANNEL_NONE;
+}
+
+/**
+ * Return the channel that is using the pumps.
+ *
+ * @return uint8_t - The channel, CHANNEL_NONE if no pump is running.
+ */
+uint8_t PumpArbiter::getOwner()
+{
+    return this->owner;
+}
@@ -0,0 +1,86 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ *
+ * This library contains the state of the pots driven by one board. In an greenhouse rack one
+ * board reads the soil moisture of every pot through an analog multiplexer and switches an
+ * pump per pot, while the pots share one reservoir, sonar and connection to the broker. The
+ * state of every channel is kept in an structure of arrays so the measurement loop over all
+ * channels stays small. The pump arbiter makes sure only one pump runs at the same time, the
+ * power supply and the shared reservoir outlet can't feed more. It doesn't use any Arduino
+ * functions so it can run in the host simulations.
+ */
+#ifndef WATERUP_PLANTPOT_POTCHANNELS_H
+#define WATERUP_PLANTPOT_POTCHANNELS_H
+
+#include <stdint.h>
+#include "../CommonDataTypes.h" // This header contains the amount of channels.
+#include <MeasurementCadence.h> // This library contains the state of the adaptive measurement interval.
+
+#define CHANNEL_NONE 0xFF // The channel id used when no channel is selected.
+
+/**
+ * Data structure that contains the state of every channel, an entry per channel in every array.
+ */
+struct ChannelTable
+{
+    uint8_t pumpState[POT_CHANNEL_COUNT]; // The water pump state of every channel.
+    uint32_t doseTime[POT_CHANNEL_COUNT]; // The milliseconds, or millilitres with an flow meter, of the dose that is soaking in, 0 when none is pending.
+    uint32_t dispensedVolume[POT_CHANNEL_COUNT]; // The total volume in millilitres the flow meter measured for every channel.
+    int16_t moistureBeforeDose[POT_CHANNEL_COUNT]; // The soil moisture in percent before the pending dose.
+    uint8_t unansweredDoses[POT_CHANNEL_COUNT]; // The amount of doses in a row after which the soil moisture didn't rise.
+    uint16_t responseGain[POT_CHANNEL_COUNT]; // The learned moisture rise of every channel, the pots of an rack can have different soil.
+    uint16_t learnedDoses[POT_CHANNEL_COUNT]; // The amount of doses the response gain of every channel is learned from.
+    CadenceState cadence[POT_CHANNEL_COUNT]; // The adaptive measurement interval of every channel.
+    uint8_t unpublished; // An bit for every channel with an measurement that isn't published yet.
+};
+
+/**
+ * This class is used to let the channels take turns using the water pumps.
+ */
+class PumpArbiter
+{
+public:
+    /**
+     * The constructor will create an arbiter without pump running and no channel waiting.
+     */
+    PumpArbiter();
+
+    /**
+     * This function gives the pumps to an channel when no other channel is using them. Otherwise
+     * the channel is put in the queue and gets its turn from takeNextWaiting().
+     *
+     * @param channel   The channel that wants to give water.
+     * @return bool - True if the channel may switch its pump on.
+     */
+    bool acquire( uint8_t channel );
+
+    /**
+     * This function takes the pumps back from the channel that was using them.
+     *
+     * @param channel   The channel that switched its pump off.
+     */
+    void release( uint8_t channel );
+
+    /**
+     * This function returns the next waiting channel and removes it from the queue. The channels
+     * take turns starting after the last channel that used the pumps, so an thirsty pot can't
+     * keep the pumps from the others.
+     *
+     * @return uint8_t - The next channel, CHANNEL_NONE if the pumps are in use or no channel is waiting.
+     */
+    uint8_t takeNextWaiting();
+
+    /**
+     * This function returns the channel that is using the pumps.
+     *
+     * @return uint8_t - The channel, CHANNEL_NONE if no pump is running.
+     */
+    uint8_t getOwner();
+
+private:
+    uint8_t owner; // The channel that is using the pumps, CHANNEL_NONE if none.
+    uint8_t lastOwner; // The channel that used the pumps last, the turns start after it.
+    uint8_t waiting; // An bit for every channel that is waiting for the pumps.
+};
+
+#endif //WATERUP_PLANTPOT_POTCHANNELS_H
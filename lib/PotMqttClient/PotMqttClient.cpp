@@ -0,0 +1,220 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ */
+#include "PotMqttClient.h"
+
+/**
+ * The constructor will save the buffer the packets are received in, the client starts without
+ * any routes so every message is ignored until setRoutes() is called.
+ *
+ * @param client    The connection to the broker.
+ * @param server    The address of the broker.
+ * @param port      The port of the broker.
+ * @param username  The username to login at the broker.
+ * @param password  The password to login at the broker.
+ * @param buffer    The buffer for the topic and the message of an received packet.
+ * @param size      The size of the buffer in bytes, one byte is kept free for the terminator.
+ */
+PotMqttClient::PotMqttClient( Client *client, const char *server, uint16_t port, const char *username, const char *password, char *buffer, uint16_t size ) :
+        Adafruit_MQTT_Client( client, server, port, username, password )
+{
+    this->buffer = buffer;
+    this->size = size;
+    this->prefix = "";
+    this->prefixLength = 0;
+    this->routes = nullptr;
+    this->routeCount = 0;
+}
+
+/**
+ * Set the routing table of the messages on the wildcard subscription. The table is searched
+ * binary, so an table that isn't sorted would lose messages without any warning. It is checked
+ * once here instead.
+ *
+ * @param prefix    The topic of the subscription without the wildcard, like inf1i-plantpot/5CCF7F199C39/subscribe/config/.
+ * @param routes    The routes, sorted by topic in strcmp order.
+ * @param count     The amount of routes.
+ */
+void PotMqttClient::setRoutes( const char *prefix, const PotMqttRoute *routes, uint8_t count )
+{
+    this->prefix = prefix;
+    this->prefixLength = (uint16_t) strlen( prefix );
+    this->routes = routes;
+    this->routeCount = count;
+
+    for ( uint8_t i = 1; i < count; i++ )
+    {
+        if ( strcmp( routes[i - 1].topic, routes[i].topic ) >= 0 )
+        {
+            POT_ERROR_PRINTLN( F( "[error] - The MQTT routes are not sorted at: " ) APPEND routes[i].topic )
+        }
+    }
+}
+
+/**
+ * Read the packets the broker sent and pass the messages to their handlers. Only the first
+ * packet is waited for, the packets after it are already in the receive buffer of the connection
+ * or arrive on the next call. Other packets than published messages are skipped, the Adafruit
+ * library reads the answers to its own requests while it waits for them.
+ *
+ * @param timeout   The time in milliseconds to wait for the first packet.
+ */
+void PotMqttClient::processMessages( int16_t timeout )
+{
+    uint8_t header;
+    uint32_t length;
+
+    while ( this->connected() && this->readPacket( &header, 1, timeout ) == 1 )
+    {
+        timeout = 0;
+        if ( !this->readRemainingLength( &length ))
+        {
+            POT_ERROR_PRINTLN( F( "[error] - The connection stopped in the middle of an MQTT packet." ))
+            return;
+        }
+
+        if (( header >> 4 ) != MQTT_PACKET_TYPE_PUBLISH )
+        {
+            this->skip( length );
+            continue;
+        }
+
+        if ( length >= this->size ) // Keep one byte free to terminate the message.
+        {
+            POT_ERROR_PRINTLN( F( "[error] - Skipped an MQTT message of: " ) APPEND length APPEND F( " bytes, it doesn't fit in the receive buffer." ))
+            this->skip( length );
+            continue;
+        }
+
+        if ( this->readPacket(( uint8_t * ) this->buffer, ( uint16_t ) length, MQTT_PACKET_READ_TIMEOUT ) != length )
+        {
+            POT_ERROR_PRINTLN( F( "[error] - The connection stopped in the middle of an MQTT message." ))
+            return;
+        }
+        this->dispatch( header & 0x0F, ( uint16_t ) length );
+    }
+}
+
+/**
+ * Look the handler of an topic up in an sorted routing table. The topic is part of an received
+ * packet so it isn't terminated, an route only matches when it has the same length.
+ *
+ * @param routes    The routes, sorted by topic in strcmp order.
+ * @param count     The amount of routes.
+ * @param topic     The last level of the topic, it doesn't have to be terminated.
+ * @param length    The length of the topic in bytes.
+ * @return const PotMqttRoute* - The route of the topic, nullptr when there is none.
+ */
+const PotMqttRoute *PotMqttClient::findRoute( const PotMqttRoute *routes, uint8_t count, const char *topic, uint16_t length )
+{
+    uint8_t low = 0;
+    uint8_t high = count;
+
+    while ( low < high )
+    {
+        uint8_t middle = ( uint8_t )(( low + high ) / 2 );
+        int order = strncmp( routes[middle].topic, topic, length );
+        if ( order == 0 && strlen( routes[middle].topic ) != length )
+        {
+            order = strlen( routes[middle].topic ) > length ? 1 : -1;
+        }
+
+        if ( order == 0 )
+        {
+            return &routes[middle];
+        }
+        if ( order < 0 )
+        {
+            low = ( uint8_t )( middle + 1 );
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * Read the remaining length of an packet. The length is encoded in 7 bits per byte with the
+ * lowest bits first, the highest bit tells if another byte follows.
+ *
+ * @param length    The variable to store the length in.
+ * @return bool - False when the connection stopped in the middle of the length.
+ */
+bool PotMqttClient::readRemainingLength( uint32_t *length )
+{
+    uint32_t multiplier = 1;
+    uint8_t encoded;
+
+    *length = 0;
+    for ( uint8_t i = 0; i < MQTT_MAX_LENGTH_BYTES; i++ )
+    {
+        if ( this->readPacket( &encoded, 1, MQTT_PACKET_READ_TIMEOUT ) != 1 )
+        {
+            return false;
+        }
+        *length += ( encoded & 0x7F ) * multiplier;
+        if (( encoded & 0x80 ) == 0 )
+        {
+            return true;
+        }
+        multiplier *= 128;
+    }
+    return false;
+}
+
+/**
+ * Read and forget the rest of an packet, in pieces of the receive buffer.
+ *
+ * @param length    The amount of bytes to skip.
+ */
+void PotMqttClient::skip( uint32_t length )
+{
+    while ( length > 0 )
+    {
+        uint16_t piece = length < this->size ? ( uint16_t ) length : this->size;
+        if ( this->readPacket(( uint8_t * ) this->buffer, piece, MQTT_PACKET_READ_TIMEOUT ) != piece )
+        {
+            return;
+        }
+        length -= piece;
+    }
+}
+
+/**
+ * Pass an published message to the handler of its topic. The packet starts with the length of
+ * the topic and the topic, messages with an quality of service above 0 have an packet id after
+ * it. The pot subscribes with quality of service 0, so the broker doesn't expect an answer. The
+ * message is terminated in the buffer so the handlers can parse it as an string.
+ *
+ * @param flags     The lower 4 bits of the first byte of the packet.
+ * @param length    The length of the packet in the buffer.
+ */
+void PotMqttClient::dispatch( uint8_t flags, uint16_t length )
+{
+    if ( length < 2 )
+    {
+        return;
+    }
+
+    uint16_t topicLength = ( uint16_t )((( uint8_t ) this->buffer[0] << 8 ) | ( uint8_t ) this->buffer[1] );
+    uint16_t messageStart = ( uint16_t )( 2 + topicLength + (( flags & 0x06 ) != 0 ? 2 : 0 ));
+    const char *topic = this->buffer + 2;
+
+    if ( messageStart > length || topicLength <= this->prefixLength || strncmp( topic, this->prefix, this->prefixLength ) != 0 )
+    {
+        POT_ERROR_PRINTLN( F( "[error] - Received an MQTT message outside of the subscription." ))
+        return;
+    }
+
+    const PotMqttRoute *route = PotMqttClient::findRoute( this->routes, this->routeCount, topic + this->prefixLength, ( uint16_t )( topicLength - this->prefixLength ));
+    if ( route == nullptr )
+    {
+        POT_DEBUG_PRINTLN( F( "[debug] - Ignored an MQTT message without an handler for its topic." ))
+        return;
+    }
+
+    this->buffer[length] = '\0';
+    route->handler( this->buffer + messageStart, ( uint16_t )( length - messageStart ));
+}
@@ -0,0 +1,109 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ *
+ * This library receives the configuration of the pot on an single wildcard subscription. The
+ * Adafruit MQTT library only delivers an message to an subscriber with the exact same topic, so
+ * every kind of configuration needed its own subscriber, topic buffer and message buffer. This
+ * client reads the publish packets itself into one buffer and looks the last level of the topic
+ * up in an table that is sorted by topic, so an new kind of configuration only needs an row.
+ */
+#ifndef WATERUP_PLANTPOT_POTMQTTCLIENT_H
+#define WATERUP_PLANTPOT_POTMQTTCLIENT_H
+
+#include <Arduino.h> // Include this library for using basic system functions and variables.
+#include "../PotDebugUtitities.h" // This header contains some debug utilities.
+#include <Adafruit_MQTT.h> // Include this library for MQTT communication.
+#include <Adafruit_MQTT_Client.h> // Include this library for reading the MQTT packets from the connection.
+
+#define MQTT_PACKET_TYPE_PUBLISH 3 // The packet type of an published message, in the upper 4 bits of the first byte.
+#define MQTT_PACKET_READ_TIMEOUT 500 // The time in milliseconds to wait for the rest of an packet that started arriving.
+#define MQTT_MAX_LENGTH_BYTES 4 // The maximum amount of bytes of the remaining length of an packet.
+
+/**
+ * Data structure that contains an row of the routing table.
+ */
+struct PotMqttRoute
+{
+    const char *topic; // The last level of the topic, like led.
+    SubscribeCallbackBufferType handler; // The function that receives the messages on the topic.
+};
+
+/**
+ * This class is used to dispatch the messages of an wildcard subscription.
+ */
+class PotMqttClient : public Adafruit_MQTT_Client
+{
+public:
+    /**
+     * The constructor will save the buffer the packets are received in.
+     *
+     * @param client    The connection to the broker.
+     * @param server    The address of the broker.
+     * @param port      The port of the broker.
+     * @param username  The username to login at the broker.
+     * @param password  The password to login at the broker.
+     * @param buffer    The buffer for the topic and the message of an received packet.
+     * @param size      The size of the buffer in bytes, one byte is kept free for the terminator.
+     */
+    PotMqttClient( Client *client, const char *server, uint16_t port, const char *username, const char *password, char *buffer, uint16_t size );
+
+    /**
+     * This function will set the routing table of the messages on the wildcard subscription.
+     *
+     * @param prefix    The topic of the subscription without the wildcard, like inf1i-plantpot/5CCF7F199C39/subscribe/config/.
+     * @param routes    The routes, sorted by topic in strcmp order.
+     * @param count     The amount of routes.
+     */
+    void setRoutes( const char *prefix, const PotMqttRoute *routes, uint8_t count );
+
+    /**
+     * This function will read the packets the broker sent and pass the messages to their handlers.
+     *
+     * @param timeout   The time in milliseconds to wait for the first packet.
+     */
+    void processMessages( int16_t timeout );
+
+    /**
+     * This function will look the handler of an topic up in an sorted routing table.
+     *
+     * @param routes    The routes, sorted by topic in strcmp order.
+     * @param count     The amount of routes.
+     * @param topic     The last level of the topic, it doesn't have to be terminated.
+     * @param length    The length of the topic in bytes.
+     * @return const PotMqttRoute* - The route of the topic, nullptr when there is none.
+     */
+    static const PotMqttRoute *findRoute( const PotMqttRoute *routes, uint8_t count, const char *topic, uint16_t length );
+
+private:
+    char *buffer; // The buffer for the topic and the message of an received packet.
+    uint16_t size; // The size of the buffer in bytes.
+    const char *prefix; // The topic of the subscription without the wildcard.
+    uint16_t prefixLength; // The length of the prefix in bytes.
+    const PotMqttRoute *routes; // The routes sorted by topic.
+    uint8_t routeCount; // The amount of routes.
+
+    /**
+     * This function will read the remaining length of an packet.
+     *
+     * @param length    The variable to store the length in.
+     * @return bool - False when the connection stopped in the middle of the length.
+     */
+    bool readRemainingLength( uint32_t *length );
+
+    /**
+     * This function will read and forget the rest of an packet.
+     *
+     * @param length    The amount of bytes to skip.
+     */
+    void skip( uint32_t length );
+
+    /**
+     * This function will pass an published message to the handler of its topic.
+     *
+     * @param flags     The lower 4 bits of the first byte of the packet.
+     * @param length    The length of the packet in the buffer.
+     */
+    void dispatch( uint8_t flags, uint16_t length );
+};
+
+#endif //WATERUP_PLANTPOT_POTMQTTCLIENT_H
@@ -0,0 +1,100 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ */
+#include "ReconnectBackoff.h"
+
+/**
+ * Create an backoff without failed attempts, the first attempt may start right away.
+ *
+ * @param initialDelay  The delay in milliseconds after the first failed attempt.
+ * @param maximumDelay  The longest delay in milliseconds between two attempts.
+ * @param seed          The seed of the random part of the delay, different for every pot.
+ */
+ReconnectBackoff::ReconnectBackoff( uint32_t initialDelay, uint32_t maximumDelay, uint32_t seed )
+{
+    this->initialDelay = initialDelay;
+    this->maximumDelay = maximumDelay;
+    this->random = seed != 0 ? seed : 1; // An xorshift generator never leaves 0.
+    this->lastFailureTime = 0;
+    this->statistics.attempts = 0;
+    this->statistics.connects = 0;
+    this->statistics.consecutiveFailures = 0;
+    this->statistics.lastDelay = 0;
+}
+
+/**
+ * Check if the next connection attempt may start. The time is compared as an difference so
+ * it keeps working when millis() wraps.
+ *
+ * @param now   The current time in milliseconds.
+ * @return bool - True if the delay after the last failed attempt passed.
+ */
+bool ReconnectBackoff::isAttemptDue( uint32_t now )
+{
+    return this->statistics.consecutiveFailures == 0 || now - this->lastFailureTime >= this->statistics.lastDelay;
+}
+
+/**
+ * Count an successful connection attempt.
+ */
+void ReconnectBackoff::recordSuccess()
+{
+    this->statistics.attempts++;
+    this->statistics.connects++;
+    this->statistics.consecutiveFailures = 0;
+    this->statistics.lastDelay = 0;
+}
+
+/**
+ * Count an failed connection attempt and compute the delay before the next one. The delay is
+ * the initial delay doubled for every failure before this one, limited to the maximum. The
+ * pot waits at least half of it and an random part of the other half.
+ *
+ * @param now   The current time in milliseconds.
+ * @return uint32_t - The delay in milliseconds before the next attempt.
+ */
+uint32_t ReconnectBackoff::recordFailure( uint32_t now )
+{
+    uint32_t delay = this->initialDelay;
+    for( uint16_t i = 0; i < this->statistics.consecutiveFailures && delay < this->maximumDelay; i++ )
+    {
+        delay *= 2;
+    }
+    if( delay > this->maximumDelay )
+    {
+        delay = this->maximumDelay;
+    }
+
+    this->statistics.attempts++;
+    if( this->statistics.consecutiveFailures < UINT16_MAX )
+    {
+        this->statistics.consecutiveFailures++;
+    }
+    this->statistics.lastDelay = delay / 2 + this->nextRandom() % ( delay / 2 + 1 );
+    this->lastFailureTime = now;
+    return this->statistics.lastDelay;
+}
+
+/**
+ * Return the counters of the connection attempts.
+ *
+ * @return ReconnectStatistics* - An pointer to the counters.
+ */
+ReconnectStatistics* ReconnectBackoff::getStatistics()
+{
+    return &this->statistics;
+}
+
+/**
+ * Return the next random number of an 32 bit xorshift generator, it is fast and good enough
+ * to spread the attempts of the pots.
+ *
+ * @return uint32_t - An random number.
+ */
+uint32_t ReconnectBackoff::nextRandom()
+{
+    this->random ^= this->random << 13;
+    this->random ^= this->random >> 17;
+    this->random ^= this->random << 5;
+    return this->random;
+}
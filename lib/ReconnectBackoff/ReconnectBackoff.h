@@ -0,0 +1,86 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ *
+ * This library decides when the pot tries to reconnect to the broker after an connection
+ * failed. The delay doubles after every failed attempt until it reaches an maximum, so an
+ * broker that is down isn't flooded with handshakes. Half of every delay is random, so the
+ * pots of an site that lost the broker at the same time don't all come back at the same
+ * moment. It doesn't use any Arduino functions so it can run in the host simulations.
+ */
+#ifndef WATERUP_PLANTPOT_RECONNECTBACKOFF_H
+#define WATERUP_PLANTPOT_RECONNECTBACKOFF_H
+
+#include <stdint.h>
+
+/**
+ * Data structure that contains the counters of the connection attempts.
+ */
+struct ReconnectStatistics
+{
+    uint32_t attempts; // The amount of connection attempts.
+    uint32_t connects; // The amount of successful connection attempts.
+    uint16_t consecutiveFailures; // The amount of failed attempts since the last connection.
+    uint32_t lastDelay; // The delay in milliseconds before the next attempt, 0 after an connection.
+};
+
+/**
+ * This class is used to compute the delay before the next connection attempt.
+ */
+class ReconnectBackoff
+{
+public:
+    /**
+     * The constructor will create an backoff without failed attempts.
+     *
+     * @param initialDelay  The delay in milliseconds after the first failed attempt.
+     * @param maximumDelay  The longest delay in milliseconds between two attempts.
+     * @param seed          The seed of the random part of the delay, different for every pot.
+     */
+    ReconnectBackoff( uint32_t initialDelay, uint32_t maximumDelay, uint32_t seed );
+
+    /**
+     * This function checks if the next connection attempt may start.
+     *
+     * @param now   The current time in milliseconds.
+     * @return bool - True if the delay after the last failed attempt passed.
+     */
+    bool isAttemptDue( uint32_t now );
+
+    /**
+     * This function will count an successful connection attempt, the next failure starts
+     * with the initial delay again.
+     */
+    void recordSuccess();
+
+    /**
+     * This function will count an failed connection attempt and compute the delay before
+     * the next one.
+     *
+     * @param now   The current time in milliseconds.
+     * @return uint32_t - The delay in milliseconds before the next attempt.
+     */
+    uint32_t recordFailure( uint32_t now );
+
+    /**
+     * This function returns the counters of the connection attempts.
+     *
+     * @return ReconnectStatistics* - An pointer to the counters.
+     */
+    ReconnectStatistics* getStatistics();
+
+private:
+    uint32_t initialDelay; // The delay in milliseconds after the first failed attempt.
+    uint32_t maximumDelay; // The longest delay in milliseconds between two attempts.
+    uint32_t random; // The state of the random number generator.
+    uint32_t lastFailureTime; // The time in milliseconds of the last failed attempt.
+    ReconnectStatistics statistics; // The counters of the connection attempts.
+
+    /**
+     * This function returns the next random number of an xorshift generator.
+     *
+     * @return uint32_t - An random number.
+     */
+    uint32_t nextRandom();
+};
+
+#endif //WATERUP_PLANTPOT_RECONNECTBACKOFF_H
@@ -0,0 +1,99 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ */
+#include "ReservoirModel.h"
+
+constexpr ReservoirSection ReservoirShape::sections[]; // The definition of the reservoir shape.
+
+/**
+ * Save the calibration of the pot.
+ *
+ * @param calibration   An pointer to the calibration points stored in the configuration.
+ */
+ReservoirModel::ReservoirModel( ReservoirCalibration *calibration )
+{
+    this->calibration = calibration;
+}
+
+/**
+ * Convert an echo time into the fill level of the reservoir. Every calibration point tells
+ * how far the model is off at its echo time, between two points the correction is
+ * interpolated and outside of them the nearest correction is used. One point corrects an
+ * offset, more points also correct the slope and shape.
+ *
+ * @param echoTime  The echo time in microseconds.
+ * @return uint16_t - The fill level in hundredths of a percent.
+ */
+uint16_t ReservoirModel::getFillLevel( uint32_t echoTime )
+{
+    int32_t fillLevel = lookupFillLevel( echoTime );
+    uint8_t pointCount = this->calibration->pointCount;
+
+    if( pointCount > 0 && pointCount <= RESERVOIR_CALIBRATION_POINTS )
+    {
+        uint8_t next = 0;
+        while( next < pointCount && this->calibration->echoTimes[next] < echoTime )
+        {
+            next++;
+        }
+
+        int32_t correction;
+        if( next == 0 )
+        {
+            correction = this->getCorrection( 0 );
+        }
+        else if( next == pointCount )
+        {
+            correction = this->getCorrection( pointCount - 1 );
+        }
+        else
+        {
+            int32_t previousEcho = this->calibration->echoTimes[next - 1];
+            int32_t nextEcho = this->calibration->echoTimes[next];
+            int32_t previousCorrection = this->getCorrection( next - 1 );
+            correction = previousCorrection + ( this->getCorrection( next ) - previousCorrection ) * ((int32_t) echoTime - previousEcho ) / ( nextEcho - previousEcho );
+        }
+        fillLevel += correction;
+    }
+
+    if( fillLevel < 0 )
+    {
+        return 0;
+    }
+    return fillLevel > RESERVOIR_FULL ? RESERVOIR_FULL : (uint16_t) fillLevel;
+}
+
+/**
+ * Convert an echo time into the fill level with the lookup table. The table has an entry
+ * every RESERVOIR_LOOKUP_STEP microseconds, in between the level is interpolated. Echoes
+ * from below the bottom, like an reflection of the reservoir floor, result in 0.
+ *
+ * @param echoTime  The echo time in microseconds.
+ * @return uint16_t - The fill level in hundredths of a percent.
+ */
+uint16_t ReservoirModel::lookupFillLevel( uint32_t echoTime )
+{
+    uint32_t index = echoTime / RESERVOIR_LOOKUP_STEP;
+
+    if( index >= FillLevelTable::size - 1 )
+    {
+        return FillLevelTable::fillLevels[FillLevelTable::size - 1];
+    }
+
+    int32_t current = FillLevelTable::fillLevels[index];
+    int32_t next = FillLevelTable::fillLevels[index + 1];
+    int32_t remainder = echoTime % RESERVOIR_LOOKUP_STEP;
+    return (uint16_t)( current + ( next - current ) * remainder / RESERVOIR_LOOKUP_STEP );
+}
+
+/**
+ * Return the difference between the real fill level and the fill level of the model at
+ * an calibration point.
+ *
+ * @param point The index of the calibration point.
+ * @return int32_t - The correction in hundredths of a percent.
+ */
+int32_t ReservoirModel::getCorrection( uint8_t point )
+{
+    return (int32_t) this->calibration->fillLevels[point] - lookupFillLevel( this->calibration->echoTimes[point] );
+}
@@ -0,0 +1,214 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ *
+ * This library converts the echo time of the ultra sonic sensor into the fill level of the
+ * water reservoir. The reservoir shape is described by its cross-section at several heights,
+ * the compiler integrates it into an lookup table so the pot only does an table lookup and
+ * an integer interpolation. The ESP8266 has no floating point unit so this keeps soft float
+ * math out of the measurement path.
+ */
+#ifndef WATERUP_PLANTPOT_RESERVOIRMODEL_H
+#define WATERUP_PLANTPOT_RESERVOIRMODEL_H
+
+#include <stdint.h>
+#include "../CommonDataTypes.h" // This header contains some data structures that are shared between libraries.
+
+/**
+ * The shape of the reservoir as {height in mm from the bottom, cross-section area in mm²} pairs
+ * ordered from the bottom up, the area changes linearly between two heights. The default is
+ * the 40 cm high prism with an 400 cm² cross-section used in our pots. An tapered reservoir
+ * could be described as { { 0, 30000 }, { 300, 40000 }, { 400, 42000 } }.
+ */
+#ifndef RESERVOIR_SHAPE
+#define RESERVOIR_SHAPE { { 0, 40000 }, { 400, 40000 } }
+#endif
+
+#define RESERVOIR_SENSOR_OFFSET_MM 0 // The distance in mm between the sensor and the water surface of an full reservoir.
+#define RESERVOIR_ECHO_MARGIN_MM 50 // The extra distance in mm below the bottom we wait for an echo.
+#define RESERVOIR_LOOKUP_STEP 16 // The echo time in microseconds between two entries of the lookup table.
+#define SOUND_SPEED_UM_PER_MICRO_SECOND 343 // The distance in micrometers sound travels in one micro second at 20 degrees.
+#define RESERVOIR_FULL 10000 // The fill level of an full reservoir, fill levels are in hundredths of a percent.
+
+/**
+ * Data structure that contains one section boundary of the reservoir shape.
+ */
+struct ReservoirSection
+{
+    uint32_t height; // The height in mm from the bottom of the reservoir.
+    uint32_t area; // The cross-section area in mm² at this height.
+};
+
+/**
+ * This class contains the compile time geometry of the reservoir. All heights are in
+ * micrometers and volumes in mm² times micrometers so no precision is lost in the integration.
+ */
+class ReservoirShape
+{
+public:
+    static constexpr ReservoirSection sections[] = RESERVOIR_SHAPE; // The section boundaries from the bottom up.
+    static constexpr uint8_t sectionCount = sizeof( sections ) / sizeof( ReservoirSection ); // The amount of boundaries.
+
+    /**
+     * This function returns the height of an full reservoir.
+     */
+    static constexpr int64_t topHeight()
+    {
+        return (int64_t) sections[sectionCount - 1].height * 1000;
+    }
+
+    /**
+     * This function returns the longest echo time that can come from the reservoir, the time
+     * the sound takes to reach the bottom plus an margin and come back.
+     *
+     * @param marginMm  The extra distance in mm below the bottom.
+     */
+    static constexpr uint32_t maxEchoTime( uint32_t marginMm )
+    {
+        return (uint32_t)(( topHeight() + ( RESERVOIR_SENSOR_OFFSET_MM + marginMm ) * 1000 ) * 2 / SOUND_SPEED_UM_PER_MICRO_SECOND );
+    }
+
+    /**
+     * This function returns the volume of water below an height.
+     *
+     * @param height    The height in micrometers.
+     * @param section   The section to start integrating at, used for the recursion.
+     */
+    static constexpr int64_t volumeBelow( int64_t height, uint8_t section = 1 )
+    {
+        return section >= sectionCount ? 0 : sectionVolume( section, height ) + volumeBelow( height, section + 1 );
+    }
+
+    /**
+     * This function returns the fill level the reservoir has for an echo time.
+     *
+     * @param echoTime  The echo time in microseconds.
+     * @return uint16_t - The fill level in hundredths of a percent.
+     */
+    static constexpr uint16_t fillLevelAtEchoTime( uint32_t echoTime )
+    {
+        return (uint16_t)( volumeBelow( waterHeight( echoTime )) * RESERVOIR_FULL / volumeBelow( topHeight() ));
+    }
+
+private:
+    /**
+     * This function returns the height of the water surface for an echo time, limited to
+     * the bottom and top of the reservoir.
+     */
+    static constexpr int64_t waterHeight( uint32_t echoTime )
+    {
+        return limit( topHeight() + RESERVOIR_SENSOR_OFFSET_MM * 1000 - (int64_t) echoTime * SOUND_SPEED_UM_PER_MICRO_SECOND / 2, 0, topHeight() );
+    }
+
+    /**
+     * These functions return the bottom and top height of an section.
+     */
+    static constexpr int64_t bottom( uint8_t section )
+    {
+        return (int64_t) sections[section - 1].height * 1000;
+    }
+    static constexpr int64_t top( uint8_t section )
+    {
+        return (int64_t) sections[section].height * 1000;
+    }
+
+    /**
+     * This function returns the cross-section area at an height inside an section.
+     */
+    static constexpr int64_t areaAt( uint8_t section, int64_t height )
+    {
+        return top( section ) == bottom( section ) ? sections[section].area :
+               sections[section - 1].area + ((int64_t) sections[section].area - sections[section - 1].area ) * ( height - bottom( section )) / ( top( section ) - bottom( section ));
+    }
+
+    /**
+     * This function returns the volume of water inside one section below an height, the
+     * area changes linearly so the volume is the average area times the height.
+     */
+    static constexpr int64_t sectionVolume( uint8_t section, int64_t height )
+    {
+        return height <= bottom( section ) ? 0 :
+               ( sections[section - 1].area + areaAt( section, limit( height, bottom( section ), top( section )))) * ( limit( height, bottom( section ), top( section )) - bottom( section )) / 2;
+    }
+
+    /**
+     * This function limits an value to an range.
+     */
+    static constexpr int64_t limit( int64_t value, int64_t minimum, int64_t maximum )
+    {
+        return value < minimum ? minimum : ( value > maximum ? maximum : value );
+    }
+};
+
+/**
+ * The templates below generate an list of indexes at compile time, they are used to fill
+ * the lookup table with one entry per index.
+ */
+template<uint16_t... I> struct IndexList {};
+template<uint16_t N, uint16_t... I> struct MakeIndexList : MakeIndexList<N - 1, N - 1, I...> {};
+template<uint16_t... I> struct MakeIndexList<0, I...> { typedef IndexList<I...> Type; };
+
+#define RESERVOIR_LOOKUP_SIZE ( ReservoirShape::maxEchoTime( 0 ) / RESERVOIR_LOOKUP_STEP + 2 ) // The amount of entries, the last one is past the bottom.
+
+/**
+ * This template contains the lookup table from echo time to fill level. Entry i contains the
+ * fill level at an echo time of i times RESERVOIR_LOOKUP_STEP.
+ */
+template<class List> struct ReservoirLookupTable;
+template<uint16_t... I> struct ReservoirLookupTable< IndexList<I...> >
+{
+    static constexpr uint16_t size = sizeof...( I ); // The amount of entries in the table.
+    static constexpr uint16_t fillLevels[] = { ReservoirShape::fillLevelAtEchoTime( I * RESERVOIR_LOOKUP_STEP )... }; // The fill levels.
+};
+template<uint16_t... I> constexpr uint16_t ReservoirLookupTable< IndexList<I...> >::fillLevels[];
+
+/**
+ * The lookup table of the configured reservoir shape.
+ */
+typedef ReservoirLookupTable< MakeIndexList< RESERVOIR_LOOKUP_SIZE >::Type > FillLevelTable;
+
+/**
+ * This class is used to convert echo times into fill levels with the lookup table and the
+ * calibration of the pot.
+ */
+class ReservoirModel
+{
+public:
+    /**
+     * The constructor will save the calibration of the pot.
+     *
+     * @param calibration   An pointer to the calibration points stored in the configuration.
+     */
+    ReservoirModel( ReservoirCalibration *calibration );
+
+    /**
+     * This function converts an echo time into the fill level of the reservoir. The level
+     * from the lookup table is corrected with the calibration points of the pot.
+     *
+     * @param echoTime  The echo time in microseconds.
+     * @return uint16_t - The fill level in hundredths of a percent.
+     */
+    uint16_t getFillLevel( uint32_t echoTime );
+
+    /**
+     * This function converts an echo time into the fill level of the reservoir described by
+     * the shape, without calibration.
+     *
+     * @param echoTime  The echo time in microseconds.
+     * @return uint16_t - The fill level in hundredths of a percent.
+     */
+    static uint16_t lookupFillLevel( uint32_t echoTime );
+
+private:
+    ReservoirCalibration *calibration; // The calibration points stored in the configuration.
+
+    /**
+     * This function returns the difference between the real fill level and the fill level
+     * of the model at an calibration point.
+     *
+     * @param point The index of the calibration point.
+     * @return int32_t - The correction in hundredths of a percent.
+     */
+    int32_t getCorrection( uint8_t point );
+};
+
+#endif //WATERUP_PLANTPOT_RESERVOIRMODEL_H
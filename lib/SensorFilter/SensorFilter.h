@@ -0,0 +1,270 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ *
+ * This library reduces an burst of raw sensor samples to one value with an confidence
+ * figure. Samples are kept in an fixed size ring buffer and reduced with an median or
+ * trimmed mean, optionally followed by exponential smoothing. All arithmetic is done in
+ * fixed point integers because the ESP8266 has no floating point unit.
+ */
+#ifndef WATERUP_PLANTPOT_SENSORFILTER_H
+#define WATERUP_PLANTPOT_SENSORFILTER_H
+
+#include <stdint.h>
+
+#define SENSOR_FILTER_FRACTION_BITS 8 // The amount of fraction bits of the fixed point smoothed value.
+#define SENSOR_FILTER_OUTLIER_FACTOR 3 // Samples further than this times the median deviation from the median are outliers.
+
+/**
+ * An enumeration containing the ways an burst of samples can be reduced to one value.
+ */
+enum SampleReduction
+{
+    REDUCE_MEDIAN = 0, // Take the middle sample, ignores up to half of the samples being outliers.
+    REDUCE_TRIMMED_MEAN = 1 // Average the samples after dropping the lowest and highest quarter.
+};
+
+/**
+ * Data structure that contains an filtered sensor value.
+ */
+struct FilteredValue
+{
+    int32_t value; // The filtered value in the unit of the raw samples.
+    uint8_t confidence; // The confidence in the value from 0 to 100 percent.
+    bool stable; // Boolean to check if the value didn't change more than the tolerance since the last burst.
+};
+
+/**
+ * This class is used to filter an burst of samples from an sensor.
+ *
+ * @tparam CAPACITY The maximum amount of samples in an burst.
+ */
+template<uint8_t CAPACITY> class SampleFilter
+{
+public:
+    /**
+     * The constructor will initiate an empty filter.
+     *
+     * @param burstSize         The amount of samples in an burst, at most CAPACITY.
+     * @param reduction         The way an burst is reduced to one value.
+     * @param smoothingFactor   The weight of an new value in the exponential smoothing from 1 to 256, 256 disables smoothing.
+     * @param tolerance         The deviation in raw units the samples may have before the confidence drops to 0.
+     */
+    SampleFilter( uint8_t burstSize, SampleReduction reduction, uint16_t smoothingFactor, int32_t tolerance )
+    {
+        this->burstSize = burstSize > CAPACITY ? CAPACITY : ( burstSize == 0 ? 1 : burstSize );
+        this->reduction = reduction;
+        this->smoothingFactor = smoothingFactor == 0 ? 1 : ( smoothingFactor > 256 ? 256 : smoothingFactor );
+        this->tolerance = tolerance > 0 ? tolerance : 1;
+        this->smoothedValue = 0;
+        this->hasValue = false;
+        this->hasPreviousValue = false;
+        this->startBurst();
+    }
+
+    /**
+     * This function will throw away the samples of the current burst.
+     */
+    void startBurst()
+    {
+        this->head = 0;
+        this->count = 0;
+        this->attempts = 0;
+    }
+
+    /**
+     * This function will add an valid sample to the ring buffer, when the buffer is full the
+     * oldest sample is overwritten.
+     *
+     * @param sample    The raw sample.
+     */
+    void addSample( int32_t sample )
+    {
+        this->samples[this->head] = sample;
+        this->head = ( this->head + 1 ) % CAPACITY;
+        if( this->count < CAPACITY )
+        {
+            this->count++;
+        }
+        this->attempts++;
+    }
+
+    /**
+     * This function will register an failed sample, like an echo that timed out. It counts
+     * towards the burst and lowers the confidence.
+     */
+    void addMissingSample()
+    {
+        this->attempts++;
+    }
+
+    /**
+     * This function checks if enough samples were taken to reduce the burst.
+     *
+     * @return bool - True if the burst is complete.
+     */
+    bool isBurstComplete()
+    {
+        return this->attempts >= this->burstSize;
+    }
+
+    /**
+     * This function will reduce the samples of the burst to one value and start an new
+     * burst. Outliers are left out and the confidence is lowered by missing samples, outliers
+     * and the spread of the remaining samples.
+     *
+     * @param result    The filtered value.
+     * @return bool - False if the burst didn't contain any valid samples.
+     */
+    bool reduce( FilteredValue *result )
+    {
+        uint8_t sampleCount = this->count;
+        uint8_t attemptCount = this->attempts;
+        this->startBurst();
+
+        if( sampleCount == 0 )
+        {
+            result->confidence = 0;
+            result->stable = false;
+            result->value = this->getValue();
+            return false;
+        }
+
+        int32_t sorted[CAPACITY];
+        for( uint8_t i = 0; i < sampleCount; i++ )
+        {
+            sorted[i] = this->samples[i];
+        }
+        sortSamples( sorted, sampleCount );
+
+        int32_t median = sorted[sampleCount / 2];
+        int32_t deviation = medianDeviation( sorted, sampleCount, median );
+        int32_t outlierLimit = deviation * SENSOR_FILTER_OUTLIER_FACTOR;
+        if( outlierLimit < this->tolerance / 2 )
+        {
+            outlierLimit = this->tolerance / 2; // Don't reject samples when they all agree closely.
+        }
+
+        uint8_t first = 0;
+        uint8_t last = sampleCount;
+        while( first < last && median - sorted[first] > outlierLimit ) first++;
+        while( last > first && sorted[last - 1] - median > outlierLimit ) last--;
+        uint8_t inliers = last - first;
+
+        int32_t value = median;
+        if( this->reduction == REDUCE_TRIMMED_MEAN )
+        {
+            uint8_t trim = inliers / 4;
+            int32_t sum = 0;
+            for( uint8_t i = first + trim; i < last - trim; i++ )
+            {
+                sum += sorted[i];
+            }
+            uint8_t used = inliers - 2 * trim;
+            value = ( sum + used / 2 ) / used;
+        }
+
+        uint32_t confidence = (uint32_t) inliers * 100 / ( attemptCount > 0 ? attemptCount : 1 );
+        confidence = deviation >= this->tolerance ? 0 : confidence * (uint32_t)( this->tolerance - deviation ) / (uint32_t) this->tolerance;
+
+        int32_t previousValue = this->getValue();
+        this->smooth( value );
+
+        result->value = this->getValue();
+        result->confidence = (uint8_t) confidence;
+        result->stable = this->hasPreviousValue && absolute( value - previousValue ) <= this->tolerance && confidence >= 50;
+        this->hasPreviousValue = true;
+        return true;
+    }
+
+    /**
+     * This function returns the last filtered value.
+     *
+     * @return int32_t - The filtered value rounded to the unit of the raw samples.
+     */
+    int32_t getValue()
+    {
+        return ( this->smoothedValue + ( 1 << ( SENSOR_FILTER_FRACTION_BITS - 1 ))) >> SENSOR_FILTER_FRACTION_BITS;
+    }
+
+private:
+    int32_t samples[CAPACITY]; // The ring buffer containing the samples of the current burst.
+    uint8_t head; // The position in the ring buffer the next sample is written to.
+    uint8_t count; // The amount of valid samples in the ring buffer.
+    uint8_t attempts; // The amount of samples taken in this burst, including the missing ones.
+    uint8_t burstSize; // The amount of samples in an burst.
+    SampleReduction reduction; // The way an burst is reduced to one value.
+    uint16_t smoothingFactor; // The weight of an new value in the exponential smoothing, 256 is 1.0.
+    int32_t tolerance; // The deviation in raw units the samples may have before the confidence drops to 0.
+    int32_t smoothedValue; // The smoothed value with SENSOR_FILTER_FRACTION_BITS fraction bits.
+    bool hasValue; // Boolean to check if the smoothed value was initiated.
+    bool hasPreviousValue; // Boolean to check if there was an burst before this one.
+
+    /**
+     * This function will fold an new value into the exponential smoothed value. The first
+     * value is taken as is so the filter doesn't start at zero.
+     *
+     * @param value The reduced value of the burst.
+     */
+    void smooth( int32_t value )
+    {
+        int32_t fixedValue = value << SENSOR_FILTER_FRACTION_BITS;
+        if( !this->hasValue )
+        {
+            this->smoothedValue = fixedValue;
+            this->hasValue = true;
+            return;
+        }
+        this->smoothedValue += (int32_t)(((int64_t)( fixedValue - this->smoothedValue ) * this->smoothingFactor ) >> 8 );
+    }
+
+    /**
+     * This function sorts an small array of samples with insertion sort.
+     *
+     * @param values    The samples to sort.
+     * @param length    The amount of samples.
+     */
+    static void sortSamples( int32_t *values, uint8_t length )
+    {
+        for( uint8_t i = 1; i < length; i++ )
+        {
+            int32_t value = values[i];
+            uint8_t j = i;
+            while( j > 0 && values[j - 1] > value )
+            {
+                values[j] = values[j - 1];
+                j--;
+            }
+            values[j] = value;
+        }
+    }
+
+    /**
+     * This function returns the median absolute deviation of sorted samples, an measure of
+     * the spread that isn't influenced by the outliers themselves.
+     *
+     * @param sorted    The sorted samples.
+     * @param length    The amount of samples.
+     * @param median    The median of the samples.
+     * @return int32_t - The median absolute deviation.
+     */
+    static int32_t medianDeviation( const int32_t *sorted, uint8_t length, int32_t median )
+    {
+        int32_t deviations[CAPACITY];
+        for( uint8_t i = 0; i < length; i++ )
+        {
+            deviations[i] = absolute( sorted[i] - median );
+        }
+        sortSamples( deviations, length );
+        return deviations[length / 2];
+    }
+
+    /**
+     * This function returns the absolute value of an integer.
+     */
+    static int32_t absolute( int32_t value )
+    {
+        return value < 0 ? -value : value;
+    }
+};
+
+#endif //WATERUP_PLANTPOT_SENSORFILTER_H
@@ -0,0 +1,177 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ */
+#include "SensorSnapshot.h"
+
+/**
+ * Save the scheduler used as clock and clear all readings.
+ *
+ * @param taskScheduler An pointer to the scheduler that keeps the time of the pot.
+ */
+SensorSnapshot::SensorSnapshot( TaskScheduler *taskScheduler )
+{
+    this->scheduler = taskScheduler;
+
+    for( uint8_t i = 0; i < SNAPSHOT_MAX_SENSORS; i++ )
+    {
+        this->addSensor( i, 0, 0, nullptr, nullptr );
+    }
+}
+
+/**
+ * Register an sensor and its refresh function. The initial value counts as stale so the
+ * first read starts an measurement.
+ *
+ * @param sensor        The sensor type.
+ * @param timeToLive    The time in milliseconds an value stays fresh.
+ * @param initialValue  The value returned until the first measurement finishes.
+ * @param refresh       The function that starts an new measurement.
+ * @param context       The context passed to the refresh function.
+ */
+void SensorSnapshot::addSensor( uint8_t sensor, uint32_t timeToLive, int32_t initialValue, TaskCallback refresh, void *context )
+{
+    if( sensor >= SNAPSHOT_MAX_SENSORS )
+    {
+        return;
+    }
+
+    SensorReading *reading = &this->readings[sensor];
+    reading->value = initialValue;
+    reading->confidence = 0;
+    reading->timestamp = 0;
+    reading->timeToLive = timeToLive;
+    reading->measurements = 0;
+    reading->measured = false;
+    reading->refreshing = false;
+    reading->refresh = refresh;
+    reading->context = context;
+}
+
+/**
+ * Change how long the values of an sensor stay fresh, like measuring less often when the
+ * value is stable.
+ *
+ * @param sensor        The sensor type.
+ * @param timeToLive    The time in milliseconds an value stays fresh.
+ */
+void SensorSnapshot::setTimeToLive( uint8_t sensor, uint32_t timeToLive )
+{
+    if( sensor < SNAPSHOT_MAX_SENSORS )
+    {
+        this->readings[sensor].timeToLive = timeToLive;
+    }
+}
+
+/**
+ * Store an new measurement of an sensor and finish its refresh. An unreliable measurement
+ * is stored too, the sensor isn't measured again until its time to live passed.
+ *
+ * @param sensor        The sensor type.
+ * @param value         The measured value.
+ * @param confidence    The confidence in percent of the value.
+ */
+void SensorSnapshot::update( uint8_t sensor, int32_t value, uint8_t confidence )
+{
+    if( sensor >= SNAPSHOT_MAX_SENSORS )
+    {
+        return;
+    }
+
+    SensorReading *reading = &this->readings[sensor];
+    reading->value = value;
+    reading->confidence = confidence;
+    reading->timestamp = this->scheduler->now();
+    reading->measurements++;
+    reading->measured = true;
+    reading->refreshing = false;
+}
+
+/**
+ * Mark the value of an sensor as stale, like the soil moisture after giving water.
+ *
+ * @param sensor    The sensor type.
+ */
+void SensorSnapshot::invalidate( uint8_t sensor )
+{
+    if( sensor < SNAPSHOT_MAX_SENSORS )
+    {
+        this->readings[sensor].measured = false;
+    }
+}
+
+/**
+ * Start an new measurement when the value of an sensor is stale and no measurement is
+ * running yet.
+ *
+ * @param sensor    The sensor type.
+ */
+void SensorSnapshot::refresh( uint8_t sensor )
+{
+    if( sensor >= SNAPSHOT_MAX_SENSORS || this->isFresh( sensor ))
+    {
+        return;
+    }
+
+    SensorReading *reading = &this->readings[sensor];
+    if( reading->refreshing || reading->refresh == nullptr )
+    {
+        return;
+    }
+
+    reading->refreshing = true;
+    reading->refresh( reading->context );
+}
+
+/**
+ * Return the latest value of an sensor and start an new measurement when it is stale.
+ *
+ * @param sensor    The sensor type.
+ * @return int32_t - The latest value.
+ */
+int32_t SensorSnapshot::getValue( uint8_t sensor )
+{
+    if( sensor >= SNAPSHOT_MAX_SENSORS )
+    {
+        return 0;
+    }
+
+    this->refresh( sensor );
+    return this->readings[sensor].value;
+}
+
+/**
+ * Return the confidence of the latest value of an sensor.
+ *
+ * @param sensor    The sensor type.
+ * @return uint8_t - The confidence in percent.
+ */
+uint8_t SensorSnapshot::getConfidence( uint8_t sensor )
+{
+    return sensor < SNAPSHOT_MAX_SENSORS ? this->readings[sensor].confidence : 0;
+}
+
+/**
+ * Return the amount of measurements of an sensor since boot.
+ *
+ * @param sensor    The sensor type.
+ * @return uint16_t - The amount of measurements.
+ */
+uint16_t SensorSnapshot::getMeasurementCount( uint8_t sensor )
+{
+    return sensor < SNAPSHOT_MAX_SENSORS ? this->readings[sensor].measurements : 0;
+}
+
+/**
+ * Check if the value of an sensor is measured and younger than its time to live.
+ *
+ * @param sensor    The sensor type.
+ * @return bool - True if the value is fresh.
+ */
+bool SensorSnapshot::isFresh( uint8_t sensor )
+{
+    if( sensor >= SNAPSHOT_MAX_SENSORS || !this->readings[sensor].measured )
+    {
+        return false;
+    }
+    return this->scheduler->now() - this->readings[sensor].timestamp < this->readings[sensor].timeToLive;
+}
@@ -0,0 +1,137 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ *
+ * This library keeps the latest reading of every sensor of the pot. The leds, statistics,
+ * warnings and watering all read the same snapshot, an sensor is only measured again when
+ * its reading is older than its time to live.
+ */
+#ifndef WATERUP_PLANTPOT_SENSORSNAPSHOT_H
+#define WATERUP_PLANTPOT_SENSORSNAPSHOT_H
+
+#include <stdint.h>
+#include <TaskScheduler.h> // This library contains the clock and callback type of the pot's tasks.
+#include <PotChannels.h> // This library contains the amount of pots driven by this board.
+
+#define SNAPSHOT_MAX_SENSORS ( SENSOR_SOIL_MOISTURE + POT_CHANNEL_COUNT ) // The water level and the soil moisture of every channel.
+
+/**
+ * An enumeration containing the sensors of the pot.
+ */
+enum SensorType
+{
+    SENSOR_WATER_LEVEL = 0, // The percentage of water left in the reservoir.
+    SENSOR_SOIL_MOISTURE = 1 // The percentage of moisture in the soil of channel 0, the other channels follow it.
+};
+
+/**
+ * Data structure that contains the latest reading of one sensor.
+ */
+struct SensorReading
+{
+    int32_t value; // The latest value of the sensor.
+    uint8_t confidence; // The confidence in percent of the latest value.
+    uint64_t timestamp; // The scheduler time in milliseconds the latest value was measured.
+    uint32_t timeToLive; // The time in milliseconds an value stays fresh.
+    uint16_t measurements; // The amount of measurements since boot.
+    bool measured; // Is the value measured or is it still the initial value.
+    bool refreshing; // Is an measurement running.
+    TaskCallback refresh; // The function that starts an new measurement.
+    void *context; // The context passed to the refresh function.
+};
+
+/**
+ * This class is used to share the latest sensor readings between all parts of the pot.
+ */
+class SensorSnapshot
+{
+public:
+    /**
+     * The constructor will save the scheduler used as clock and clear all readings.
+     *
+     * @param taskScheduler An pointer to the scheduler that keeps the time of the pot.
+     */
+    SensorSnapshot( TaskScheduler *taskScheduler );
+
+    /**
+     * This function registers an sensor. The refresh function starts an new measurement, it
+     * can call update right away or later when the measurement takes some time.
+     *
+     * @param sensor        The sensor type.
+     * @param timeToLive    The time in milliseconds an value stays fresh.
+     * @param initialValue  The value returned until the first measurement finishes.
+     * @param refresh       The function that starts an new measurement.
+     * @param context       The context passed to the refresh function.
+     */
+    void addSensor( uint8_t sensor, uint32_t timeToLive, int32_t initialValue, TaskCallback refresh, void *context );
+
+    /**
+     * This function changes how long the values of an sensor stay fresh.
+     *
+     * @param sensor        The sensor type.
+     * @param timeToLive    The time in milliseconds an value stays fresh.
+     */
+    void setTimeToLive( uint8_t sensor, uint32_t timeToLive );
+
+    /**
+     * This function stores an new measurement of an sensor.
+     *
+     * @param sensor        The sensor type.
+     * @param value         The measured value.
+     * @param confidence    The confidence in percent of the value.
+     */
+    void update( uint8_t sensor, int32_t value, uint8_t confidence );
+
+    /**
+     * This function marks the value of an sensor as stale, the next read measures it again.
+     *
+     * @param sensor    The sensor type.
+     */
+    void invalidate( uint8_t sensor );
+
+    /**
+     * This function starts an new measurement when the value of an sensor is stale.
+     *
+     * @param sensor    The sensor type.
+     */
+    void refresh( uint8_t sensor );
+
+    /**
+     * This function returns the latest value of an sensor, an new measurement is started when it
+     * is stale. Sensors that measure right away return the new value, the others return the
+     * latest value until their measurement finishes.
+     *
+     * @param sensor    The sensor type.
+     * @return int32_t - The latest value.
+     */
+    int32_t getValue( uint8_t sensor );
+
+    /**
+     * This function returns the confidence of the latest value of an sensor.
+     *
+     * @param sensor    The sensor type.
+     * @return uint8_t - The confidence in percent.
+     */
+    uint8_t getConfidence( uint8_t sensor );
+
+    /**
+     * This function returns the amount of measurements of an sensor since boot.
+     *
+     * @param sensor    The sensor type.
+     * @return uint16_t - The amount of measurements.
+     */
+    uint16_t getMeasurementCount( uint8_t sensor );
+
+    /**
+     * This function checks if the value of an sensor is younger than its time to live.
+     *
+     * @param sensor    The sensor type.
+     * @return bool - True if the value is fresh.
+     */
+    bool isFresh( uint8_t sensor );
+
+private:
+    SensorReading readings[SNAPSHOT_MAX_SENSORS]; // The latest readings of all sensors.
+    TaskScheduler *scheduler; // The scheduler that keeps the time of the pot.
+};
+
+#endif //WATERUP_PLANTPOT_SENSORSNAPSHOT_H
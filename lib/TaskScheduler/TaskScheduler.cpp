@@ -0,0 +1,233 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ */
+#include "TaskScheduler.h"
+
+/**
+ * Initiate the scheduler with an empty task list.
+ */
+TaskScheduler::TaskScheduler()
+{
+    for( uint8_t i = 0; i < SCHEDULER_MAX_TASKS; i++ )
+    {
+        this->tasks[i].callback = nullptr;
+        this->tasks[i].context = nullptr;
+        this->tasks[i].nextRunTime = 0;
+        this->tasks[i].interval = 0;
+    }
+    this->lastMillis = 0;
+    this->millisRollovers = 0;
+}
+
+/**
+ * Register an task that runs every interval.
+ *
+ * @param callback      The function to call when the task is due.
+ * @param context       An pointer passed to the callback, most of the time the owner of the task.
+ * @param interval      The interval in milliseconds between two runs of the task.
+ * @param firstDelay    The time in milliseconds before the task runs for the first time.
+ * @return uint8_t - The id of the task or SCHEDULER_INVALID_TASK if there was no free slot.
+ */
+uint8_t TaskScheduler::addPeriodicTask( TaskCallback callback, void* context, uint32_t interval, uint32_t firstDelay )
+{
+    if( interval == 0 ) // An periodic task without interval would starve the other tasks.
+    {
+        interval = 1;
+    }
+    return this->addTask( callback, context, interval, firstDelay );
+}
+
+/**
+ * Register an task that runs once after an delay.
+ *
+ * @param callback  The function to call when the task is due.
+ * @param context   An pointer passed to the callback, most of the time the owner of the task.
+ * @param delay     The time in milliseconds before the task runs.
+ * @return uint8_t - The id of the task or SCHEDULER_INVALID_TASK if there was no free slot.
+ */
+uint8_t TaskScheduler::addOneShotTask( TaskCallback callback, void* context, uint32_t delay )
+{
+    return this->addTask( callback, context, 0, delay );
+}
+
+/**
+ * Remove an task so it won't run again.
+ *
+ * @param taskId    The id of the task to remove.
+ */
+void TaskScheduler::cancelTask( uint8_t taskId )
+{
+    if( taskId < SCHEDULER_MAX_TASKS )
+    {
+        this->tasks[taskId].callback = nullptr;
+        this->tasks[taskId].context = nullptr;
+    }
+}
+
+/**
+ * Change the interval of an periodic task. When the new interval is shorter than the time
+ * left until the next run, the next run gets moved forward.
+ *
+ * @param taskId    The id of the task to update.
+ * @param interval  The new interval in milliseconds.
+ */
+void TaskScheduler::setTaskInterval( uint8_t taskId, uint32_t interval )
+{
+    if( taskId >= SCHEDULER_MAX_TASKS || this->tasks[taskId].callback == nullptr || this->tasks[taskId].interval == 0 )
+    {
+        return;
+    }
+
+    this->tasks[taskId].interval = interval > 0 ? interval : 1;
+
+    uint64_t latestRunTime = this->now() + this->tasks[taskId].interval;
+    if( this->tasks[taskId].nextRunTime > latestRunTime )
+    {
+        this->tasks[taskId].nextRunTime = latestRunTime;
+    }
+}
+
+/**
+ * Move the next run of an task to an delay from now.
+ *
+ * @param taskId    The id of the task to reschedule.
+ * @param delay     The time in milliseconds before the task runs again.
+ */
+void TaskScheduler::rescheduleTask( uint8_t taskId, uint32_t delay )
+{
+    if( taskId < SCHEDULER_MAX_TASKS && this->tasks[taskId].callback != nullptr )
+    {
+        this->tasks[taskId].nextRunTime = this->now() + delay;
+    }
+}
+
+/**
+ * Run all tasks whose deadline passed. Periodic tasks keep their rhythm, but when the
+ * scheduler fell behind more than an interval the missed runs are skipped instead of
+ * running the task several times in a row.
+ */
+void TaskScheduler::run()
+{
+    for( uint8_t i = 0; i < SCHEDULER_MAX_TASKS; i++ )
+    {
+        ScheduledTask *task = &this->tasks[i];
+        uint64_t currentTime = this->now();
+
+        if( task->callback == nullptr || task->nextRunTime > currentTime )
+        {
+            continue;
+        }
+
+        TaskCallback callback = task->callback;
+        void *context = task->context;
+
+        if( task->interval == 0 ) // One shot tasks release their slot before they run.
+        {
+            task->callback = nullptr;
+            task->context = nullptr;
+        }
+        else
+        {
+            task->nextRunTime += task->interval;
+            if( task->nextRunTime <= currentTime )
+            {
+                task->nextRunTime = currentTime + task->interval;
+            }
+        }
+
+        callback( context );
+    }
+}
+
+/**
+ * Return the milliseconds since the last reset as an 64 bit number. Every time millis()
+ * is smaller than the last time we read it, it rolled over. This only works as long as
+ * the time is read at least once every 49 days, which the main loop always does.
+ *
+ * @return uint64_t - The milliseconds since the last reset.
+ */
+uint64_t TaskScheduler::now()
+{
+    uint32_t currentMillis = millis();
+
+    if( currentMillis < this->lastMillis )
+    {
+        this->millisRollovers++;
+    }
+    this->lastMillis = currentMillis;
+
+    return ((uint64_t) this->millisRollovers << 32 ) | currentMillis;
+}
+
+/**
+ * Return the time until the deadline of the first task that is due.
+ *
+ * @return uint32_t - The time in milliseconds until the next task is due, 0 if an task is due now.
+ */
+uint32_t TaskScheduler::getTimeUntilNextTask()
+{
+    uint64_t currentTime = this->now();
+    uint64_t nextRunTime = UINT64_MAX;
+
+    for( uint8_t i = 0; i < SCHEDULER_MAX_TASKS; i++ )
+    {
+        if( this->tasks[i].callback != nullptr && this->tasks[i].nextRunTime < nextRunTime )
+        {
+            nextRunTime = this->tasks[i].nextRunTime;
+        }
+    }
+
+    if( nextRunTime <= currentTime )
+    {
+        return 0;
+    }
+
+    uint64_t timeLeft = nextRunTime - currentTime;
+    return timeLeft > UINT32_MAX ? UINT32_MAX : (uint32_t) timeLeft;
+}
+
+/**
+ * Idle until the next task is due or the maximum idle time passed. The delay() function
+ * yields to the WiFi stack and allows the ESP8266 to enter light sleep in between.
+ *
+ * @param maxIdleTime   The maximum time in milliseconds to idle.
+ */
+void TaskScheduler::sleepUntilNextTask( uint32_t maxIdleTime )
+{
+    uint32_t idleTime = this->getTimeUntilNextTask();
+
+    if( idleTime > maxIdleTime )
+    {
+        idleTime = maxIdleTime;
+    }
+
+    if( idleTime > 0 )
+    {
+        delay( idleTime );
+    }
+}
+
+/**
+ * Register an task in the first free slot.
+ *
+ * @param callback  The function to call when the task is due.
+ * @param context   An pointer passed to the callback.
+ * @param interval  The interval in milliseconds, 0 for an one shot task.
+ * @param delay     The time in milliseconds before the task runs for the first time.
+ * @return uint8_t - The id of the task or SCHEDULER_INVALID_TASK if there was no free slot.
+ */
+uint8_t TaskScheduler::addTask( TaskCallback callback, void* context, uint32_t interval, uint32_t delay )
+{
+    for( uint8_t i = 0; i < SCHEDULER_MAX_TASKS; i++ )
+    {
+        if( this->tasks[i].callback == nullptr )
+        {
+            this->tasks[i].callback = callback;
+            this->tasks[i].context = context;
+            this->tasks[i].interval = interval;
+            this->tasks[i].nextRunTime = this->now() + delay;
+            return i;
+        }
+    }
+    return SCHEDULER_INVALID_TASK;
+}
@@ -0,0 +1,141 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ *
+ * This library contains an small cooperative task scheduler. Tasks register an callback
+ * that runs once or periodically, the scheduler runs the tasks whose deadline passed and
+ * tells the main loop how long it can sleep until the next deadline.
+ */
+#ifndef WATERUP_PLANTPOT_TASKSCHEDULER_H
+#define WATERUP_PLANTPOT_TASKSCHEDULER_H
+
+#include <Arduino.h> // Include this library for using basic system functions and variables.
+#include "../PotDebugUtitities.h" // This header contains some debug utilities.
+#include "../CommonDataTypes.h" // This header contains the amount of channels.
+
+#define SCHEDULER_SHARED_TASKS 11 // The tasks the board needs once: the periodic tasks, the reservoir and pump tasks and two spare slots.
+#define SCHEDULER_MAX_TASKS ( SCHEDULER_SHARED_TASKS + POT_CHANNEL_COUNT ) // The maximum amount of tasks that can be registered at the same time, every channel can be soaking.
+#define SCHEDULER_MAX_IDLE_TIME 100 // The maximum time in milliseconds the main loop sleeps between two passes.
+#define SCHEDULER_INVALID_TASK 0xFF // The task id returned when no task slot was available.
+
+/**
+ * The function signature of an task callback. The context pointer is the one given
+ * when the task was registered, most of the time the object that owns the task.
+ */
+typedef void (*TaskCallback)( void* context );
+
+class TaskScheduler;
+
+/**
+ * This class is used to run periodic and one shot tasks at their deadlines.
+ */
+class TaskScheduler
+{
+public:
+    /**
+     * The constructor will initiate the scheduler with an empty task list.
+     */
+    TaskScheduler();
+
+    /**
+     * This function will register an task that runs every interval.
+     *
+     * @param callback      The function to call when the task is due.
+     * @param context       An pointer passed to the callback, most of the time the owner of the task.
+     * @param interval      The interval in milliseconds between two runs of the task.
+     * @param firstDelay    The time in milliseconds before the task runs for the first time.
+     * @return uint8_t - The id of the task or SCHEDULER_INVALID_TASK if there was no free slot.
+     */
+    uint8_t addPeriodicTask( TaskCallback callback, void* context, uint32_t interval, uint32_t firstDelay );
+
+    /**
+     * This function will register an task that runs once after an delay. The task slot is
+     * released before the callback runs so the callback can register new tasks.
+     *
+     * @param callback  The function to call when the task is due.
+     * @param context   An pointer passed to the callback, most of the time the owner of the task.
+     * @param delay     The time in milliseconds before the task runs.
+     * @return uint8_t - The id of the task or SCHEDULER_INVALID_TASK if there was no free slot.
+     */
+    uint8_t addOneShotTask( TaskCallback callback, void* context, uint32_t delay );
+
+    /**
+     * This function will remove an task so it won't run again.
+     *
+     * @param taskId    The id of the task to remove.
+     */
+    void cancelTask( uint8_t taskId );
+
+    /**
+     * This function will change the interval of an periodic task. The next run gets moved
+     * so it is at most one new interval away.
+     *
+     * @param taskId    The id of the task to update.
+     * @param interval  The new interval in milliseconds.
+     */
+    void setTaskInterval( uint8_t taskId, uint32_t interval );
+
+    /**
+     * This function will move the next run of an task to an delay from now.
+     *
+     * @param taskId    The id of the task to reschedule.
+     * @param delay     The time in milliseconds before the task runs again.
+     */
+    void rescheduleTask( uint8_t taskId, uint32_t delay );
+
+    /**
+     * This function will run all tasks whose deadline passed.
+     */
+    void run();
+
+    /**
+     * This function returns the milliseconds since the last reset as an 64 bit number so
+     * it doesn't roll over after 49 days like millis() does.
+     *
+     * @return uint64_t - The milliseconds since the last reset.
+     */
+    uint64_t now();
+
+    /**
+     * This function returns the time until the deadline of the first task that is due.
+     *
+     * @return uint32_t - The time in milliseconds until the next task is due, 0 if an task is due now.
+     */
+    uint32_t getTimeUntilNextTask();
+
+    /**
+     * This function will idle until the next task is due. The delay allows the ESP8266 to
+     * enter light sleep when the WiFi sleep mode permits it.
+     *
+     * @param maxIdleTime   The maximum time in milliseconds to idle.
+     */
+    void sleepUntilNextTask( uint32_t maxIdleTime );
+
+private:
+    /**
+     * Data structure that contains an registered task.
+     */
+    struct ScheduledTask
+    {
+        TaskCallback callback; // The function to call, nullptr if this slot is free.
+        void* context; // The pointer passed to the callback.
+        uint64_t nextRunTime; // The time in milliseconds the task is due.
+        uint32_t interval; // The interval in milliseconds of an periodic task, 0 for an one shot task.
+    };
+
+    ScheduledTask tasks[SCHEDULER_MAX_TASKS]; // The registered tasks.
+    uint32_t lastMillis; // The value of millis() the last time the time was read.
+    uint32_t millisRollovers; // The amount of times millis() rolled over.
+
+    /**
+     * This function will register an task in the first free slot.
+     *
+     * @param callback  The function to call when the task is due.
+     * @param context   An pointer passed to the callback.
+     * @param interval  The interval in milliseconds, 0 for an one shot task.
+     * @param delay     The time in milliseconds before the task runs for the first time.
+     * @return uint8_t - The id of the task or SCHEDULER_INVALID_TASK if there was no free slot.
+     */
+    uint8_t addTask( TaskCallback callback, void* context, uint32_t interval, uint32_t delay );
+};
+
+#endif //WATERUP_PLANTPOT_TASKSCHEDULER_H
@@ -0,0 +1,303 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ */
+#include "TelemetryCodec.h"
+
+/**
+ * Write an message into an buffer. The type decides which fields are written, the flags
+ * decide which optional fields of an statistic are appended.
+ *
+ * @param message   The fields of the message.
+ * @param buffer    The buffer the message is written to.
+ * @param size      The size of the buffer in bytes.
+ * @return uint8_t - The length of the message, 0 when the buffer is too small.
+ */
+uint8_t TelemetryCodec::encode( const TelemetryMessage &message, uint8_t *buffer, uint8_t size )
+{
+    uint16_t length = getLength( message.type, message.flags, 0 );
+    if( length == 0 || length > size || message.type == TELEMETRY_TYPE_BATCH )
+    {
+        return 0;
+    }
+
+    uint8_t *position = buffer;
+    *position++ = TELEMETRY_CODEC_VERSION;
+    *position++ = message.type;
+    *position++ = message.flags;
+    *position++ = message.type == TELEMETRY_TYPE_WARNING ? message.warning : message.channel;
+    for( uint8_t i = 0; i < TELEMETRY_MAC_SIZE; i++ )
+    {
+        *position++ = message.mac[i];
+    }
+    position = write( position, message.counter, 4 );
+
+    if( message.type == TELEMETRY_TYPE_WARNING )
+    {
+        *position = message.channel;
+    }
+    else if( message.type == TELEMETRY_TYPE_STATISTIC )
+    {
+        position = write( position, (uint16_t) message.moisture, 2 );
+        position = write( position, (uint16_t) message.waterLevel, 2 );
+        position = write( position, (uint16_t) message.hoursLeft, 2 );
+        position = write( position, message.interval, 4 );
+        if( message.flags & TELEMETRY_FLAG_TIME )
+        {
+            position = write( position, message.time, 4 );
+        }
+        if( message.flags & TELEMETRY_FLAG_DISPENSED )
+        {
+            write( position, message.dispensed, 4 );
+        }
+    }
+    return (uint8_t) length;
+}
+
+/**
+ * Write an batch of statistics into an buffer. The fields that are the same for every
+ * statistic are written once, the samples follow.
+ *
+ * @param message   The fields of the batch.
+ * @param samples   The statistics of the batch.
+ * @param count     The amount of statistics, at most TELEMETRY_MAX_BATCH_SIZE.
+ * @param buffer    The buffer the message is written to.
+ * @param size      The size of the buffer in bytes.
+ * @return uint16_t - The length of the message, 0 when the buffer is too small.
+ */
+uint16_t TelemetryCodec::encodeBatch( const TelemetryMessage &message, const TelemetrySample *samples, uint8_t count, uint8_t *buffer, uint16_t size )
+{
+    uint16_t length = getLength( TELEMETRY_TYPE_BATCH, message.flags, count );
+    if( count > TELEMETRY_MAX_BATCH_SIZE || length > size )
+    {
+        return 0;
+    }
+
+    uint8_t *position = buffer;
+    *position++ = TELEMETRY_CODEC_VERSION;
+    *position++ = TELEMETRY_TYPE_BATCH;
+    *position++ = message.flags;
+    *position++ = count;
+    for( uint8_t i = 0; i < TELEMETRY_MAC_SIZE; i++ )
+    {
+        *position++ = message.mac[i];
+    }
+    position = write( position, message.counter, 4 );
+    position = write( position, (uint16_t) message.hoursLeft, 2 );
+    position = write( position, message.interval, 4 );
+
+    for( uint8_t i = 0; i < count; i++ )
+    {
+        position = write( position, samples[i].time, 4 );
+        *position++ = samples[i].channel;
+        position = write( position, (uint16_t) samples[i].moisture, 2 );
+        position = write( position, (uint16_t) samples[i].waterLevel, 2 );
+        if( message.flags & TELEMETRY_FLAG_DISPENSED )
+        {
+            position = write( position, samples[i].dispensed, 4 );
+        }
+    }
+    return length;
+}
+
+/**
+ * Read an message from an buffer. Fields that aren't in the message are set to 0, except the
+ * hours left of an statistic that wasn't forecasted which is -1 like in the json message.
+ *
+ * @param buffer    The received message.
+ * @param length    The length of the received message.
+ * @param message   The fields of the message.
+ * @return bool - False when the version, type or length of the message is wrong.
+ */
+bool TelemetryCodec::decode( const uint8_t *buffer, uint16_t length, TelemetryMessage &message )
+{
+    if( length < TELEMETRY_HEADER_SIZE || buffer[0] != TELEMETRY_CODEC_VERSION || getLength( buffer[1], buffer[2], buffer[3] ) != length )
+    {
+        return false;
+    }
+
+    const uint8_t *position = buffer + 1;
+    message = TelemetryMessage();
+    message.type = *position++;
+    message.flags = *position++;
+    if( message.type == TELEMETRY_TYPE_WARNING )
+    {
+        message.warning = *position++;
+    }
+    else if( message.type == TELEMETRY_TYPE_BATCH )
+    {
+        message.sampleCount = *position++;
+    }
+    else
+    {
+        message.channel = *position++;
+    }
+    for( uint8_t i = 0; i < TELEMETRY_MAC_SIZE; i++ )
+    {
+        message.mac[i] = *position++;
+    }
+    message.counter = read( position, 4 );
+    message.hoursLeft = -1;
+
+    if( message.type == TELEMETRY_TYPE_WARNING )
+    {
+        message.channel = *position;
+    }
+    else if( message.type == TELEMETRY_TYPE_STATISTIC )
+    {
+        message.moisture = (int16_t) read( position, 2 );
+        message.waterLevel = (int16_t) read( position, 2 );
+        message.hoursLeft = (int16_t) read( position, 2 );
+        message.interval = read( position, 4 );
+        if( message.flags & TELEMETRY_FLAG_TIME )
+        {
+            message.time = read( position, 4 );
+        }
+        if( message.flags & TELEMETRY_FLAG_DISPENSED )
+        {
+            message.dispensed = read( position, 4 );
+        }
+    }
+    else if( message.type == TELEMETRY_TYPE_BATCH )
+    {
+        message.hoursLeft = (int16_t) read( position, 2 );
+        message.interval = read( position, 4 );
+    }
+    return true;
+}
+
+/**
+ * Read an sample from an batch that was decoded before, decode() checked that the buffer
+ * contains all samples.
+ *
+ * @param buffer    The received batch.
+ * @param index     The index of the sample, smaller than the sample count of the batch.
+ * @param sample    The fields of the sample.
+ */
+void TelemetryCodec::decodeSample( const uint8_t *buffer, uint8_t index, TelemetrySample &sample )
+{
+    bool dispensed = buffer[2] & TELEMETRY_FLAG_DISPENSED;
+    const uint8_t *position = buffer + TELEMETRY_BATCH_HEADER_SIZE + index * ( TELEMETRY_SAMPLE_SIZE + ( dispensed ? 4 : 0 ));
+
+    sample = TelemetrySample();
+    sample.time = read( position, 4 );
+    sample.channel = *position++;
+    sample.moisture = (int16_t) read( position, 2 );
+    sample.waterLevel = (int16_t) read( position, 2 );
+    if( dispensed )
+    {
+        sample.dispensed = read( position, 4 );
+    }
+}
+
+/**
+ * Convert an mac address like 5C:CF:7F:19:9C:39 into its bytes, both upper and lower case
+ * hexadecimal digits are accepted.
+ *
+ * @param text  The formatted mac address.
+ * @param mac   The buffer of TELEMETRY_MAC_SIZE bytes.
+ * @return bool - False when the text isn't an mac address.
+ */
+bool TelemetryCodec::parseMacAddress( const char *text, uint8_t *mac )
+{
+    for( uint8_t i = 0; i < TELEMETRY_MAC_SIZE; i++ )
+    {
+        uint8_t value = 0;
+        for( uint8_t digit = 0; digit < 2; digit++ )
+        {
+            char character = *text++;
+            value <<= 4;
+            if( character >= '0' && character <= '9' )
+            {
+                value |= character - '0';
+            }
+            else if( character >= 'A' && character <= 'F' )
+            {
+                value |= character - 'A' + 10;
+            }
+            else if( character >= 'a' && character <= 'f' )
+            {
+                value |= character - 'a' + 10;
+            }
+            else
+            {
+                return false;
+            }
+        }
+        mac[i] = value;
+
+        if( i < TELEMETRY_MAC_SIZE - 1 && *text++ != ':' )
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Return the length of an message.
+ *
+ * @param type    The type of the message.
+ * @param flags   The optional fields in the message.
+ * @param count   The amount of samples in an batch.
+ * @return uint16_t - The length in bytes, 0 for an unknown type.
+ */
+uint16_t TelemetryCodec::getLength( uint8_t type, uint8_t flags, uint8_t count )
+{
+    if( type == TELEMETRY_TYPE_WARNING )
+    {
+        return TELEMETRY_WARNING_SIZE;
+    }
+    if( type == TELEMETRY_TYPE_BATCH )
+    {
+        return TELEMETRY_BATCH_HEADER_SIZE + count * ( TELEMETRY_SAMPLE_SIZE + ( flags & TELEMETRY_FLAG_DISPENSED ? 4 : 0 ));
+    }
+    if( type != TELEMETRY_TYPE_STATISTIC )
+    {
+        return 0;
+    }
+
+    uint16_t length = TELEMETRY_STATISTIC_SIZE;
+    if( flags & TELEMETRY_FLAG_TIME )
+    {
+        length += 4;
+    }
+    if( flags & TELEMETRY_FLAG_DISPENSED )
+    {
+        length += 4;
+    }
+    return length;
+}
+
+/**
+ * Write an number of an amount of bytes, least significant byte first.
+ *
+ * @param buffer    The position in the buffer.
+ * @param value     The number.
+ * @param bytes     The amount of bytes.
+ * @return uint8_t* - The position after the number.
+ */
+uint8_t* TelemetryCodec::write( uint8_t *buffer, uint32_t value, uint8_t bytes )
+{
+    for( uint8_t i = 0; i < bytes; i++ )
+    {
+        *buffer++ = (uint8_t)( value >> ( 8 * i ));
+    }
+    return buffer;
+}
+
+/**
+ * Read an number of an amount of bytes, least significant byte first.
+ *
+ * @param buffer    The position in the buffer, it is moved past the number.
+ * @param bytes     The amount of bytes.
+ * @return uint32_t - The number.
+ */
+uint32_t TelemetryCodec::read( const uint8_t *&buffer, uint8_t bytes )
+{
+    uint32_t value = 0;
+    for( uint8_t i = 0; i < bytes; i++ )
+    {
+        value |= (uint32_t)( *buffer++ ) << ( 8 * i );
+    }
+    return value;
+}
@@ -0,0 +1,177 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ *
+ * This library packs the statistic and warning messages into an small binary message, the
+ * backend selects the encoding of an pot with its mqtt configuration. Every message starts
+ * with an version byte so the format can change without breaking older pots, the numbers are
+ * written little endian byte by byte so the layout doesn't depend on the compiler. It doesn't
+ * use any Arduino functions so the backend decoder and the host simulations can use it.
+ *
+ * Layout of an message, the optional fields are only written when their flag is set:
+ *  byte  0      version, TELEMETRY_CODEC_VERSION
+ *  byte  1      type, TELEMETRY_TYPE_STATISTIC or TELEMETRY_TYPE_WARNING
+ *  byte  2      flags, TELEMETRY_FLAG_*
+ *  byte  3      channel of an statistic or code of an warning
+ *  bytes 4-9    mac address
+ *  bytes 10-13  counter
+ * Warning only:
+ *  byte  14     channel of the pot, TELEMETRY_CHANNEL_BOARD for an warning about the reservoir
+ * Statistic only:
+ *  bytes 14-15  moisture
+ *  bytes 16-17  water level
+ *  bytes 18-19  hours left
+ *  bytes 20-23  measurement interval
+ *  4 bytes      unix time of an logged statistic, TELEMETRY_FLAG_TIME
+ *  4 bytes      dispensed volume, TELEMETRY_FLAG_DISPENSED
+ * Batch of statistics, byte 3 holds the amount of samples:
+ *  bytes 14-15  hours left
+ *  bytes 16-19  measurement interval
+ *  per sample   unix time 4 bytes, channel 1 byte, moisture 2 bytes, water level 2 bytes and
+ *               the dispensed volume 4 bytes with TELEMETRY_FLAG_DISPENSED
+ */
+#ifndef WATERUP_PLANTPOT_TELEMETRYCODEC_H
+#define WATERUP_PLANTPOT_TELEMETRYCODEC_H
+
+#include <stdint.h>
+
+#define TELEMETRY_ENCODING_JSON 0 // Publish the statistics and warnings as json.
+#define TELEMETRY_ENCODING_BINARY 1 // Publish the statistics and warnings as packed binary messages.
+
+#define TELEMETRY_CODEC_VERSION 2 // The version of the binary layout, increment on every change.
+#define TELEMETRY_TYPE_STATISTIC 1 // The message contains an statistic.
+#define TELEMETRY_TYPE_WARNING 2 // The message contains an warning.
+#define TELEMETRY_TYPE_BATCH 3 // The message contains an batch of statistics.
+#define TELEMETRY_FLAG_TIME 0x01 // The statistic was logged and contains its measurement time.
+#define TELEMETRY_FLAG_DISPENSED 0x02 // The statistic contains the volume the flow meter measured.
+#define TELEMETRY_CHANNEL_BOARD 0xFF // The channel of an warning that belongs to the whole pot, like an empty reservoir.
+
+#define TELEMETRY_HEADER_SIZE 14 // The size of the fields every message starts with.
+#define TELEMETRY_WARNING_SIZE 15 // The size of an warning.
+#define TELEMETRY_STATISTIC_SIZE 24 // The size of an statistic without the optional fields.
+#define TELEMETRY_MAX_MESSAGE_SIZE 32 // The size of the largest message, an statistic with all optional fields.
+#define TELEMETRY_BATCH_HEADER_SIZE 20 // The size of an batch without samples.
+#define TELEMETRY_SAMPLE_SIZE 9 // The size of an sample in an batch without the optional fields.
+#define TELEMETRY_MAX_BATCH_SIZE 12 // The maximum amount of samples in an batch, so the json batch fits the send buffer.
+#define TELEMETRY_MAC_SIZE 6 // The amount of bytes in an mac address.
+
+/**
+ * Data structure that contains the fields of an statistic or warning message.
+ */
+struct TelemetryMessage
+{
+    uint8_t type; // TELEMETRY_TYPE_STATISTIC or TELEMETRY_TYPE_WARNING.
+    uint8_t flags; // The optional fields in the message.
+    uint8_t channel; // The channel of the pot the statistic or warning belongs to.
+    uint8_t warning; // The code of the warning.
+    uint8_t mac[TELEMETRY_MAC_SIZE]; // The mac address of the pot.
+    uint32_t counter; // The message counter of the type.
+    int16_t moisture; // The percentage of moisture in the ground.
+    int16_t waterLevel; // The percentage of water left in the reservoir.
+    int16_t hoursLeft; // The forecasted hours until the reservoir is empty, -1 if unknown.
+    uint32_t interval; // The interval in milliseconds between two measurements.
+    uint32_t time; // The unix time in seconds of an logged statistic.
+    uint32_t dispensed; // The total volume in millilitres the flow meter measured.
+    uint8_t sampleCount; // The amount of samples in an batch.
+};
+
+/**
+ * Data structure that contains one statistic of an batch.
+ */
+struct TelemetrySample
+{
+    uint32_t time; // The unix time in seconds of the measurement, 0 when the clock wasn't set yet.
+    uint8_t channel; // The channel of the pot the statistic belongs to.
+    int16_t moisture; // The percentage of moisture in the ground.
+    int16_t waterLevel; // The percentage of water left in the reservoir.
+    uint32_t dispensed; // The total volume in millilitres the flow meter measured.
+};
+
+/**
+ * This class is used to encode and decode the binary messages.
+ */
+class TelemetryCodec
+{
+public:
+    /**
+     * This function will write an message into an buffer.
+     *
+     * @param message   The fields of the message.
+     * @param buffer    The buffer the message is written to.
+     * @param size      The size of the buffer in bytes.
+     * @return uint8_t - The length of the message, 0 when the buffer is too small.
+     */
+    static uint8_t encode( const TelemetryMessage &message, uint8_t *buffer, uint8_t size );
+
+    /**
+     * This function will write an batch of statistics into an buffer. The hours left and the
+     * interval of the message belong to the whole batch, the sample count is set from count.
+     *
+     * @param message   The fields of the batch.
+     * @param samples   The statistics of the batch.
+     * @param count     The amount of statistics, at most TELEMETRY_MAX_BATCH_SIZE.
+     * @param buffer    The buffer the message is written to.
+     * @param size      The size of the buffer in bytes.
+     * @return uint16_t - The length of the message, 0 when the buffer is too small.
+     */
+    static uint16_t encodeBatch( const TelemetryMessage &message, const TelemetrySample *samples, uint8_t count, uint8_t *buffer, uint16_t size );
+
+    /**
+     * This function will read an message from an buffer.
+     *
+     * @param buffer    The received message.
+     * @param length    The length of the received message.
+     * @param message   The fields of the message.
+     * @return bool - False when the version, type or length of the message is wrong.
+     */
+    static bool decode( const uint8_t *buffer, uint16_t length, TelemetryMessage &message );
+
+    /**
+     * This function will read an sample from an batch that was decoded before.
+     *
+     * @param buffer    The received batch.
+     * @param index     The index of the sample, smaller than the sample count of the batch.
+     * @param sample    The fields of the sample.
+     */
+    static void decodeSample( const uint8_t *buffer, uint8_t index, TelemetrySample &sample );
+
+    /**
+     * This function will convert an mac address like 5C:CF:7F:19:9C:39 into its bytes.
+     *
+     * @param text  The formatted mac address.
+     * @param mac   The buffer of TELEMETRY_MAC_SIZE bytes.
+     * @return bool - False when the text isn't an mac address.
+     */
+    static bool parseMacAddress( const char *text, uint8_t *mac );
+
+private:
+    /**
+     * This function will return the length of an message.
+     *
+     * @param type    The type of the message.
+     * @param flags   The optional fields in the message.
+     * @param count   The amount of samples in an batch.
+     * @return uint16_t - The length in bytes, 0 for an unknown type.
+     */
+    static uint16_t getLength( uint8_t type, uint8_t flags, uint8_t count );
+
+    /**
+     * This function will write an number of an amount of bytes, least significant byte first.
+     *
+     * @param buffer    The position in the buffer.
+     * @param value     The number.
+     * @param bytes     The amount of bytes.
+     * @return uint8_t* - The position after the number.
+     */
+    static uint8_t* write( uint8_t *buffer, uint32_t value, uint8_t bytes );
+
+    /**
+     * This function will read an number of an amount of bytes, least significant byte first.
+     *
+     * @param buffer    The position in the buffer, it is moved past the number.
+     * @param bytes     The amount of bytes.
+     * @return uint32_t - The number.
+     */
+    static uint32_t read( const uint8_t *&buffer, uint8_t bytes );
+};
+
+#endif //WATERUP_PLANTPOT_TELEMETRYCODEC_H
@@ -0,0 +1,301 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ */
+#include "TelemetryLog.h"
+
+/**
+ * Create an empty log, setup loads the log from the flash.
+ */
+TelemetryLog::TelemetryLog()
+{
+    this->state.magic = TELEMETRY_STATE_MAGIC;
+    this->state.firstSegment = 0;
+    this->state.lastSegment = 0;
+    this->state.readOffset = 0;
+    this->batchSegment = 0;
+    this->batchOffset = 0;
+    this->droppedRecords = 0;
+    this->mounted = false;
+}
+
+/**
+ * Mount the file system and load the state of the log. The state is only written when the
+ * segments change or an batch is replayed, so after an power loss we look for segments
+ * started after the state was written. When the newest segment doesn't end at an record
+ * boundary an record was cut off, we start an new segment so new records stay aligned.
+ *
+ * @return bool - False if the file system can't be mounted.
+ */
+bool TelemetryLog::setup()
+{
+    this->mounted = SPIFFS.begin();
+    if( !this->mounted )
+    {
+        POT_ERROR_PRINTLN( F("[error] - Unable to mount the file system, statistics won't be logged.") )
+        return false;
+    }
+
+    File stateFile = SPIFFS.open( TELEMETRY_STATE_PATH, "r" );
+    if( stateFile )
+    {
+        TelemetryState storedState;
+        if( stateFile.read( (uint8_t*) &storedState, sizeof( TelemetryState )) == sizeof( TelemetryState ) &&
+            storedState.magic == TELEMETRY_STATE_MAGIC &&
+            storedState.checksum == calculateChecksum( (const uint8_t*) &storedState, offsetof( TelemetryState, checksum )))
+        {
+            this->state = storedState;
+        }
+        stateFile.close();
+    }
+
+    char path[TELEMETRY_PATH_SIZE];
+    getSegmentPath( path, this->state.lastSegment + 1 );
+    while( SPIFFS.exists( path ))
+    {
+        this->state.lastSegment++;
+        getSegmentPath( path, this->state.lastSegment + 1 );
+    }
+
+    if( this->getSegmentSize( this->state.lastSegment ) % sizeof( TelemetryRecord ) != 0 )
+    {
+        POT_ERROR_PRINTLN( F("[error] - The telemetry log contains an partly written record, starting an new segment.") )
+        this->startSegment();
+    }
+
+    POT_DEBUG_PRINTLN( F("[debug] - Telemetry log segments: ") APPEND this->state.firstSegment APPEND F(" - ") APPEND this->state.lastSegment )
+    return true;
+}
+
+/**
+ * Append an statistic to the log.
+ *
+ * @param time          The unix time in seconds of the measurement.
+ * @param channel       The channel of the pot the statistic belongs to.
+ * @param moisture      The percentage of moisture in the soil.
+ * @param waterLevel    The percentage of water left in the reservoir.
+ * @return bool - True if the record is written to the flash.
+ */
+bool TelemetryLog::append( uint32_t time, uint8_t channel, int16_t moisture, int16_t waterLevel )
+{
+    if( !this->mounted )
+    {
+        return false;
+    }
+
+    if( this->getSegmentSize( this->state.lastSegment ) + sizeof( TelemetryRecord ) > TELEMETRY_SEGMENT_SIZE )
+    {
+        this->startSegment();
+    }
+
+    TelemetryRecord record;
+    record.time = time;
+    record.moisture = moisture;
+    record.waterLevel = waterLevel;
+    record.channel = channel;
+    record.magic = TELEMETRY_RECORD_MAGIC;
+    record.checksum = calculateChecksum( (const uint8_t*) &record, offsetof( TelemetryRecord, checksum ));
+
+    char path[TELEMETRY_PATH_SIZE];
+    getSegmentPath( path, this->state.lastSegment );
+    File segment = SPIFFS.open( path, "a" );
+    if( !segment )
+    {
+        POT_ERROR_PRINTLN( F("[error] - Unable to open the telemetry segment: ") APPEND path )
+        return false;
+    }
+
+    bool written = segment.write( (const uint8_t*) &record, sizeof( TelemetryRecord )) == sizeof( TelemetryRecord );
+    segment.close();
+    return written;
+}
+
+/**
+ * Check if there are records that aren't replayed yet.
+ *
+ * @return bool - True if there are records to replay.
+ */
+bool TelemetryLog::hasBacklog()
+{
+    if( !this->mounted )
+    {
+        return false;
+    }
+    return this->state.firstSegment != this->state.lastSegment || this->state.readOffset < this->getSegmentSize( this->state.firstSegment );
+}
+
+/**
+ * Read the next batch of records from the oldest segments. The position after the batch is
+ * kept aside, the replay position only moves when the batch is committed so an batch that
+ * couldn't be published is read again.
+ *
+ * @param records       The array to write the records to.
+ * @param maxRecords    The maximum amount of records to read.
+ * @return uint8_t - The amount of records read.
+ */
+uint8_t TelemetryLog::readBatch( TelemetryRecord *records, uint8_t maxRecords )
+{
+    uint8_t count = 0;
+    this->batchSegment = this->state.firstSegment;
+    this->batchOffset = this->state.readOffset;
+
+    if( !this->mounted )
+    {
+        return 0;
+    }
+
+    char path[TELEMETRY_PATH_SIZE];
+    while( count < maxRecords )
+    {
+        getSegmentPath( path, this->batchSegment );
+        File segment = SPIFFS.open( path, "r" );
+        if( segment && segment.seek( this->batchOffset, SeekSet ))
+        {
+            while( count < maxRecords && segment.read( (uint8_t*) &records[count], sizeof( TelemetryRecord )) == sizeof( TelemetryRecord ))
+            {
+                this->batchOffset += sizeof( TelemetryRecord );
+                if( records[count].magic == TELEMETRY_RECORD_MAGIC &&
+                    records[count].checksum == calculateChecksum( (const uint8_t*) &records[count], offsetof( TelemetryRecord, checksum )))
+                {
+                    count++;
+                }
+                else
+                {
+                    POT_ERROR_PRINTLN( F("[error] - Skipping an corrupt telemetry record in segment: ") APPEND path )
+                }
+            }
+        }
+        if( segment )
+        {
+            segment.close();
+        }
+
+        if( count == maxRecords || this->batchSegment == this->state.lastSegment )
+        {
+            break;
+        }
+        this->batchSegment++; // The segment is read completely, continue with the next one.
+        this->batchOffset = 0;
+    }
+    return count;
+}
+
+/**
+ * Remove the records of the last batch from the log. Segments that are replayed completely
+ * are deleted, the state is written so an reboot doesn't replay the batch again.
+ */
+void TelemetryLog::commitBatch()
+{
+    if( this->batchSegment < this->state.firstSegment ) // The segments of the batch were dropped in the mean time.
+    {
+        return;
+    }
+
+    char path[TELEMETRY_PATH_SIZE];
+    while( this->state.firstSegment < this->batchSegment )
+    {
+        getSegmentPath( path, this->state.firstSegment );
+        SPIFFS.remove( path );
+        this->state.firstSegment++;
+    }
+
+    this->state.readOffset = this->batchOffset;
+    this->storeState();
+}
+
+/**
+ * Return the amount of records dropped because the log was full.
+ */
+uint32_t TelemetryLog::getDroppedRecords()
+{
+    return this->droppedRecords;
+}
+
+/**
+ * Write the state of the log to the flash.
+ */
+void TelemetryLog::storeState()
+{
+    this->state.magic = TELEMETRY_STATE_MAGIC;
+    this->state.checksum = calculateChecksum( (const uint8_t*) &this->state, offsetof( TelemetryState, checksum ));
+
+    File stateFile = SPIFFS.open( TELEMETRY_STATE_PATH, "w" );
+    if( !stateFile )
+    {
+        POT_ERROR_PRINTLN( F("[error] - Unable to write the telemetry log state.") )
+        return;
+    }
+    stateFile.write( (const uint8_t*) &this->state, sizeof( TelemetryState ));
+    stateFile.close();
+}
+
+/**
+ * Start an new segment. When there are too many segments the oldest one is dropped, even if
+ * it isn't replayed yet, so the log never takes more than its share of the flash.
+ */
+void TelemetryLog::startSegment()
+{
+    this->state.lastSegment++;
+
+    if( this->state.lastSegment - this->state.firstSegment >= TELEMETRY_MAX_SEGMENTS )
+    {
+        char path[TELEMETRY_PATH_SIZE];
+        getSegmentPath( path, this->state.firstSegment );
+        uint32_t segmentSize = this->getSegmentSize( this->state.firstSegment );
+        if( segmentSize > this->state.readOffset )
+        {
+            this->droppedRecords += ( segmentSize - this->state.readOffset ) / sizeof( TelemetryRecord );
+        }
+        SPIFFS.remove( path );
+        this->state.firstSegment++;
+        this->state.readOffset = 0;
+        POT_ERROR_PRINTLN( F("[error] - The telemetry log is full, dropped the oldest segment.") )
+    }
+
+    this->storeState();
+}
+
+/**
+ * Return the size in bytes of an segment, 0 if it doesn't exist.
+ */
+uint32_t TelemetryLog::getSegmentSize( uint32_t segment )
+{
+    char path[TELEMETRY_PATH_SIZE];
+    getSegmentPath( path, segment );
+    if( !SPIFFS.exists( path ))
+    {
+        return 0;
+    }
+
+    File file = SPIFFS.open( path, "r" );
+    uint32_t size = file ? file.size() : 0;
+    if( file )
+    {
+        file.close();
+    }
+    return size;
+}
+
+/**
+ * Write the path of an segment file to an buffer of TELEMETRY_PATH_SIZE bytes.
+ */
+void TelemetryLog::getSegmentPath( char *path, uint32_t segment )
+{
+    snprintf( path, TELEMETRY_PATH_SIZE, TELEMETRY_SEGMENT_PATH, (unsigned long) segment );
+}
+
+/**
+ * Calculate the CRC-16/CCITT checksum of an block of memory.
+ */
+uint16_t TelemetryLog::calculateChecksum( const uint8_t *data, uint16_t length )
+{
+    uint16_t crc = 0xFFFF;
+    while( length-- )
+    {
+        crc ^= (uint16_t)( *data++ ) << 8;
+        for( uint8_t i = 0; i < 8; i++ )
+        {
+            crc = ( crc & 0x8000 ) ? ( crc << 1 ) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
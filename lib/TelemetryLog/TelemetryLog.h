@@ -0,0 +1,142 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ *
+ * This library keeps the statistics that couldn't be published in an append only log on the
+ * flash file system. The log is split into segment files of an bounded size, when the log
+ * is full the oldest segment is dropped. Every record has its own checksum so an record that
+ * was half written when the power was cut gets skipped instead of corrupting the replay.
+ */
+#ifndef WATERUP_PLANTPOT_TELEMETRYLOG_H
+#define WATERUP_PLANTPOT_TELEMETRYLOG_H
+
+#include <Arduino.h> // Include this library for using basic system functions and variables.
+#include <FS.h> // Include this library for using the SPIFFS flash file system.
+#include "../PotDebugUtitities.h" // This header contains some debug utilities.
+
+#define TELEMETRY_SEGMENT_PATH "/tl/%lu" // The path of an segment file, the placeholder is the segment number.
+#define TELEMETRY_STATE_PATH "/tl/state" // The path of the file that contains the position of the replay.
+#define TELEMETRY_PATH_SIZE 16 // The maximum length of an segment path.
+#define TELEMETRY_SEGMENT_SIZE 4092 // The maximum size in bytes of one segment, 341 records.
+#define TELEMETRY_MAX_SEGMENTS 16 // The maximum amount of segments, 16 segments keep almost 4 days of minute statistics.
+#define TELEMETRY_RECORD_MAGIC 0x55 // The value that marks an written record, erased flash reads as 0xFF.
+#define TELEMETRY_STATE_MAGIC 0x57544C31 // The value that marks an valid state file.
+
+/**
+ * Data structure that contains one logged statistic as it is stored on the flash.
+ */
+struct TelemetryRecord
+{
+    uint32_t time; // The unix time in seconds of the measurement, 0 when the clock wasn't set yet.
+    int16_t moisture; // The percentage of moisture in the soil.
+    int16_t waterLevel; // The percentage of water left in the reservoir.
+    uint8_t channel; // The channel of the pot the statistic belongs to.
+    uint8_t magic; // The TELEMETRY_RECORD_MAGIC value.
+    uint16_t checksum; // The CRC-16 of the fields above.
+};
+
+/**
+ * Data structure that contains the state of the log, the segments in use and the position
+ * of the replay in the oldest segment.
+ */
+struct TelemetryState
+{
+    uint32_t magic; // The TELEMETRY_STATE_MAGIC value.
+    uint32_t firstSegment; // The number of the oldest segment.
+    uint32_t lastSegment; // The number of the segment new records are appended to.
+    uint32_t readOffset; // The offset in the oldest segment of the first record that isn't replayed.
+    uint16_t checksum; // The CRC-16 of the fields above.
+};
+
+/**
+ * This class is used to log statistics while the broker is unreachable and read them back
+ * in batches once the connection returns.
+ */
+class TelemetryLog
+{
+public:
+    /**
+     * The constructor will create an empty log, setup loads the log from the flash.
+     */
+    TelemetryLog();
+
+    /**
+     * This function mounts the file system and loads the state of the log. An record that was
+     * cut off by an power loss is left behind by starting an new segment.
+     *
+     * @return bool - False if the file system can't be mounted.
+     */
+    bool setup();
+
+    /**
+     * This function appends an statistic to the log. When the newest segment is full an new one
+     * is started, when there are too many segments the oldest one is dropped.
+     *
+     * @param time          The unix time in seconds of the measurement.
+     * @param channel       The channel of the pot the statistic belongs to.
+     * @param moisture      The percentage of moisture in the soil.
+     * @param waterLevel    The percentage of water left in the reservoir.
+     * @return bool - True if the record is written to the flash.
+     */
+    bool append( uint32_t time, uint8_t channel, int16_t moisture, int16_t waterLevel );
+
+    /**
+     * This function checks if there are records that aren't replayed yet.
+     *
+     * @return bool - True if there are records to replay.
+     */
+    bool hasBacklog();
+
+    /**
+     * This function reads the next batch of records to replay, records with an invalid checksum
+     * are skipped. The records stay in the log until the batch is committed.
+     *
+     * @param records       The array to write the records to.
+     * @param maxRecords    The maximum amount of records to read.
+     * @return uint8_t - The amount of records read.
+     */
+    uint8_t readBatch( TelemetryRecord *records, uint8_t maxRecords );
+
+    /**
+     * This function removes the records of the last batch from the log after they are replayed.
+     */
+    void commitBatch();
+
+    /**
+     * This function returns the amount of records dropped because the log was full.
+     */
+    uint32_t getDroppedRecords();
+
+private:
+    TelemetryState state; // The segments in use and the position of the replay.
+    uint32_t batchSegment; // The segment after the last record of the batch.
+    uint32_t batchOffset; // The offset after the last record of the batch.
+    uint32_t droppedRecords; // The amount of records dropped because the log was full.
+    bool mounted; // Is the file system mounted.
+
+    /**
+     * This function writes the state of the log to the flash.
+     */
+    void storeState();
+
+    /**
+     * This function starts an new segment and drops the oldest one when there are too many.
+     */
+    void startSegment();
+
+    /**
+     * This function returns the size in bytes of an segment, 0 if it doesn't exist.
+     */
+    uint32_t getSegmentSize( uint32_t segment );
+
+    /**
+     * This function writes the path of an segment file to an buffer.
+     */
+    static void getSegmentPath( char *path, uint32_t segment );
+
+    /**
+     * This function calculates the CRC-16/CCITT checksum of an block of memory.
+     */
+    static uint16_t calculateChecksum( const uint8_t *data, uint16_t length );
+};
+
+#endif //WATERUP_PLANTPOT_TELEMETRYLOG_H
@@ -0,0 +1,172 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ */
+#include "UltrasonicSensor.h"
+
+uint8_t UltrasonicSensor::echoPin = 0; // Initiate the static echo pin, it is set by the constructor.
+volatile uint8_t UltrasonicSensor::state = UltrasonicSensor::SONAR_IDLE; // Initiate the measurement state.
+volatile uint32_t UltrasonicSensor::echoStartTime = 0; // Initiate the echo start timestamp.
+volatile uint32_t UltrasonicSensor::echoEndTime = 0; // Initiate the echo end timestamp.
+
+/**
+ * The constructor will save the pins connected to the sensor and the maximum time
+ * an echo may take to return.
+ *
+ * @param triggerPin    The pin connected to the trigger port of the sensor.
+ * @param echoPin       The pin connected to the echo port of the sensor.
+ * @param echoTimeout   The maximum time in microseconds between the trigger and the falling echo edge.
+ */
+UltrasonicSensor::UltrasonicSensor( uint8_t triggerPin, uint8_t echoPin, uint32_t echoTimeout )
+{
+    this->triggerPin = triggerPin;
+    this->echoTimeout = echoTimeout;
+    this->triggerTime = 0;
+    this->lastTriggerMillis = 0;
+    UltrasonicSensor::echoPin = echoPin;
+}
+
+/**
+ * Setup the I/O pins and attach the interrupt handler to the echo pin so both edges
+ * of the echo get timestamped.
+ */
+void UltrasonicSensor::setup()
+{
+    pinMode( this->triggerPin, OUTPUT );
+    pinMode( UltrasonicSensor::echoPin, INPUT );
+    digitalWrite( this->triggerPin, LOW );
+    attachInterrupt( digitalPinToInterrupt( UltrasonicSensor::echoPin ), &UltrasonicSensor::handleEchoInterrupt, CHANGE );
+}
+
+/**
+ * Send an trigger pulse to the sensor and start an new measurement. The sensor is only
+ * triggered when the previous echo has died out, else we would measure an old echo.
+ *
+ * @return bool - False if an measurement is still in progress or the sensor needs more time.
+ */
+bool UltrasonicSensor::trigger()
+{
+    this->checkTimeout();
+
+    if( UltrasonicSensor::state == SONAR_WAITING_FOR_ECHO || UltrasonicSensor::state == SONAR_RECEIVING_ECHO )
+    {
+        return false;
+    }
+
+    // A timed out echo can still be high, wait for the sensor to release the echo pin.
+    if( millis() - this->lastTriggerMillis < SONAR_MIN_CYCLE_TIME || digitalRead( UltrasonicSensor::echoPin ) == HIGH )
+    {
+        return false;
+    }
+
+    UltrasonicSensor::state = SONAR_WAITING_FOR_ECHO;
+
+    // Send short pulse to the trigger pin
+    digitalWrite( this->triggerPin, HIGH );
+    delayMicroseconds( SONAR_TRIGGER_PULSE_TIME );
+    digitalWrite( this->triggerPin, LOW );
+
+    this->triggerTime = micros();
+    this->lastTriggerMillis = millis();
+    return true;
+}
+
+/**
+ * Check if the last measurement finished, either because both echo edges were received
+ * or because the echo timed out.
+ *
+ * @return bool - True if the measurement finished.
+ */
+bool UltrasonicSensor::isMeasurementReady()
+{
+    this->checkTimeout();
+    return UltrasonicSensor::state == SONAR_READY || UltrasonicSensor::state == SONAR_TIMEOUT;
+}
+
+/**
+ * Check if the last finished measurement received an valid echo.
+ *
+ * @return bool - True if the echo returned within the timeout.
+ */
+bool UltrasonicSensor::hasValidEcho()
+{
+    return UltrasonicSensor::state == SONAR_READY;
+}
+
+/**
+ * Return the time the sound took to travel to the water surface and back and release the
+ * sensor so it can be triggered again.
+ *
+ * @return uint32_t - The echo time in microseconds or 0 if the echo timed out.
+ */
+uint32_t UltrasonicSensor::readEchoTime()
+{
+    uint32_t echoTime = 0;
+
+    if( UltrasonicSensor::state == SONAR_READY )
+    {
+        echoTime = UltrasonicSensor::echoEndTime - UltrasonicSensor::echoStartTime;
+    }
+
+    if( this->isMeasurementReady() )
+    {
+        UltrasonicSensor::state = SONAR_IDLE;
+    }
+    return echoTime;
+}
+
+/**
+ * Return the current state of the measurement.
+ *
+ * @return MeasurementState - The state of the measurement.
+ */
+UltrasonicSensor::MeasurementState UltrasonicSensor::getState()
+{
+    this->checkTimeout();
+    return (MeasurementState) UltrasonicSensor::state;
+}
+
+/**
+ * End the measurement when the echo did not return within the timeout. The timeout is
+ * based on the depth of the reservoir so we never wait longer than the sound needs to
+ * reach the bottom and come back.
+ */
+void UltrasonicSensor::checkTimeout()
+{
+    if( UltrasonicSensor::state != SONAR_WAITING_FOR_ECHO && UltrasonicSensor::state != SONAR_RECEIVING_ECHO )
+    {
+        return;
+    }
+
+    if( micros() - this->triggerTime > this->echoTimeout )
+    {
+        noInterrupts();
+        if( UltrasonicSensor::state != SONAR_READY ) // The echo could have arrived just now.
+        {
+            UltrasonicSensor::state = SONAR_TIMEOUT;
+        }
+        interrupts();
+    }
+}
+
+/**
+ * Timestamp the rising and falling edge of the echo pin. Edges that arrive while no
+ * measurement is in progress, like the tail of an timed out echo, are ignored.
+ */
+void ICACHE_RAM_ATTR UltrasonicSensor::handleEchoInterrupt()
+{
+    uint32_t now = micros();
+
+    if( digitalRead( UltrasonicSensor::echoPin ) == HIGH )
+    {
+        if( UltrasonicSensor::state == SONAR_WAITING_FOR_ECHO )
+        {
+            UltrasonicSensor::echoStartTime = now;
+            UltrasonicSensor::state = SONAR_RECEIVING_ECHO;
+        }
+    }
+    else if( UltrasonicSensor::state == SONAR_RECEIVING_ECHO )
+    {
+        UltrasonicSensor::echoEndTime = now;
+        UltrasonicSensor::state = SONAR_READY;
+    }
+}
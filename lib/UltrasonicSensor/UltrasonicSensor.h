@@ -0,0 +1,115 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ *
+ * This library drives the ultra sonic sensor without blocking the main loop. It fires
+ * the trigger pulse and timestamps the echo edges from an pin change interrupt so the
+ * pot can keep doing other work while the sound travels to the water surface and back.
+ */
+#ifndef WATERUP_PLANTPOT_ULTRASONICSENSOR_H
+#define WATERUP_PLANTPOT_ULTRASONICSENSOR_H
+
+#include <Arduino.h> // Include this library for using basic system functions and variables.
+#include "../PotDebugUtitities.h" // This header contains some debug utilities.
+
+#define SONAR_TRIGGER_PULSE_TIME 10 // The time in microseconds the trigger pin is held high to start an measurement.
+#define SONAR_ECHO_START_LATENCY 500 // The maximum time in microseconds the sensor takes to raise the echo pin after an trigger.
+#define SONAR_MIN_CYCLE_TIME 60 // The minimum time in milliseconds between two measurements so old echoes have died out.
+
+class UltrasonicSensor;
+
+/**
+ * This class is used to take asynchronous distance measurements with the ultra sonic sensor.
+ */
+class UltrasonicSensor
+{
+public:
+    /**
+     * An enumeration containing all states of an measurement.
+     */
+    enum MeasurementState
+    {
+        SONAR_IDLE = 0, // No measurement is in progress.
+        SONAR_WAITING_FOR_ECHO = 1, // The trigger pulse was send and we wait for the echo pin to rise.
+        SONAR_RECEIVING_ECHO = 2, // The echo pin is high and we wait for it to fall.
+        SONAR_READY = 3, // Both echo edges are received and the echo time can be read.
+        SONAR_TIMEOUT = 4 // The echo did not return within the timeout.
+    };
+
+    /**
+     * The constructor will save the pins connected to the sensor and the maximum time
+     * an echo may take to return.
+     *
+     * @param triggerPin    The pin connected to the trigger port of the sensor.
+     * @param echoPin       The pin connected to the echo port of the sensor.
+     * @param echoTimeout   The maximum time in microseconds between the trigger and the falling echo edge.
+     */
+    UltrasonicSensor( uint8_t triggerPin, uint8_t echoPin, uint32_t echoTimeout );
+
+    /**
+     * This function will setup the I/O pins and attach the echo pin change interrupt.
+     */
+    void setup();
+
+    /**
+     * This function will send an trigger pulse to the sensor and start an new measurement.
+     * It only takes the length of the trigger pulse, the echo is received in the background.
+     *
+     * @return bool - False if an measurement is still in progress or the sensor needs more time.
+     */
+    bool trigger();
+
+    /**
+     * This function checks if the last measurement finished, either because both echo
+     * edges were received or because the echo timed out.
+     *
+     * @return bool - True if the measurement finished.
+     */
+    bool isMeasurementReady();
+
+    /**
+     * This function checks if the last finished measurement received an valid echo.
+     *
+     * @return bool - True if the echo returned within the timeout.
+     */
+    bool hasValidEcho();
+
+    /**
+     * This function returns the time the sound took to travel to the water surface and back
+     * and releases the sensor for the next measurement.
+     *
+     * @return uint32_t - The echo time in microseconds or 0 if the echo timed out.
+     */
+    uint32_t readEchoTime();
+
+    /**
+     * This function returns the current state of the measurement.
+     *
+     * @return MeasurementState - The state of the measurement.
+     */
+    MeasurementState getState();
+
+private:
+    uint8_t triggerPin; // The pin connected to the trigger port of the sensor.
+    uint32_t echoTimeout; // The maximum time in microseconds between the trigger and the falling echo edge.
+    uint32_t triggerTime; // The time in microseconds the last trigger pulse was send.
+    uint32_t lastTriggerMillis; // The time in milliseconds the last trigger pulse was send.
+
+    static uint8_t echoPin; // The pin connected to the echo port of the sensor.
+    static volatile uint8_t state; // The state of the measurement, shared with the interrupt handler.
+    static volatile uint32_t echoStartTime; // The time in microseconds the echo pin went high.
+    static volatile uint32_t echoEndTime; // The time in microseconds the echo pin went low.
+
+    /**
+     * This function will check if the echo took longer than the timeout and end the
+     * measurement if it did.
+     */
+    void checkTimeout();
+
+    /**
+     * This interrupt handler gets called on every edge of the echo pin and timestamps
+     * the start and end of the echo.
+     */
+    static void handleEchoInterrupt();
+};
+
+#endif //WATERUP_PLANTPOT_ULTRASONICSENSOR_H
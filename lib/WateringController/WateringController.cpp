@@ -0,0 +1,160 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ */
+#include "WateringController.h"
+
+/**
+ * Save the watering settings and the dose limits.
+ *
+ * @param wateringSettings  An pointer to the watering settings stored in the configuration.
+ * @param defaultDoseTime   The time in milliseconds of an dose when the gain is unknown.
+ * @param maxDoseTime       The maximum time in milliseconds of one dose.
+ * @param minDoseTime       The shortest time in milliseconds worth running the pump for.
+ */
+WateringController::WateringController( WateringSettings *wateringSettings, uint32_t defaultDoseTime, uint32_t maxDoseTime, uint32_t minDoseTime )
+{
+    this->settings = wateringSettings;
+    this->defaultDoseTime = defaultDoseTime;
+    this->maxDoseTime = maxDoseTime;
+    this->minDoseTime = minDoseTime;
+    this->moistureBeforeDose = 0;
+    this->doseTime = 0;
+}
+
+/**
+ * Check if the doses are sized with the learned gain.
+ *
+ * @return bool - True in the adaptive mode.
+ */
+bool WateringController::isAdaptive()
+{
+    return this->settings->mode == WATERING_MODE_ADAPTIVE;
+}
+
+/**
+ * Compute how long the pump should run to raise the soil moisture to the target. Until the
+ * gain is learned, or in the fixed mode, the default dose is used. The dose is limited so an
+ * badly learned gain can't drown the plant.
+ *
+ * @param moisture      The current percentage of moisture in the soil.
+ * @param target        The optimal percentage of moisture in the soil.
+ * @param responseGain  The learned gain of the channel that gets the dose.
+ * @return uint32_t - The dose time in milliseconds, 0 when the soil is moist enough.
+ */
+uint32_t WateringController::computeDoseTime( int16_t moisture, int16_t target, uint16_t responseGain )
+{
+    if( moisture >= target )
+    {
+        return 0;
+    }
+
+    if( !this->isAdaptive() || responseGain == WATERING_GAIN_UNKNOWN )
+    {
+        return this->defaultDoseTime;
+    }
+
+    uint32_t doseTime = ((uint32_t)( target - moisture ) << WATERING_GAIN_FRACTION_BITS ) * 1000 / responseGain;
+
+    if( doseTime < this->minDoseTime )
+    {
+        return this->minDoseTime;
+    }
+    return doseTime > this->maxDoseTime ? this->maxDoseTime : doseTime;
+}
+
+/**
+ * Remember an dose so its response can be learned after the water settled.
+ *
+ * @param moisture  The percentage of moisture in the soil before the dose.
+ * @param doseTime  The time in milliseconds the pump ran.
+ */
+void WateringController::startDose( int16_t moisture, uint32_t doseTime )
+{
+    this->moistureBeforeDose = moisture;
+    this->doseTime = doseTime;
+}
+
+/**
+ * Learn the response gain from the moisture rise of the last dose. The first response sets
+ * the gain, after that it is smoothed so one odd measurement doesn't change the doses much.
+ * When the moisture didn't rise the water didn't reach the sensor yet, that response is
+ * thrown away instead of making the next dose as long as possible.
+ *
+ * @param moisture      The percentage of moisture in the soil after the water settled.
+ * @param responseGain  An pointer to the learned gain of the channel that got the dose.
+ * @param learnedDoses  An pointer to the amount of doses the gain of the channel is learned from.
+ * @return bool - True if the gain changed and should be persisted.
+ */
+bool WateringController::learn( int16_t moisture, uint16_t *responseGain, uint16_t *learnedDoses )
+{
+    uint32_t doseTime = this->doseTime;
+    this->doseTime = 0;
+
+    if( doseTime == 0 || moisture <= this->moistureBeforeDose )
+    {
+        return false;
+    }
+
+    uint32_t response = ((uint32_t)( moisture - this->moistureBeforeDose ) << WATERING_GAIN_FRACTION_BITS ) * 1000 / doseTime;
+    if( response == 0 )
+    {
+        response = 1;
+    }
+    if( response > 0xFFFF )
+    {
+        response = 0xFFFF;
+    }
+
+    if( *responseGain == WATERING_GAIN_UNKNOWN )
+    {
+        *responseGain = (uint16_t) response;
+    }
+    else
+    {
+        int32_t gain = *responseGain;
+        gain += (((int32_t) response - gain ) * WATERING_GAIN_SMOOTHING ) / 256;
+        *responseGain = (uint16_t)( gain < 1 ? 1 : gain );
+    }
+
+    if( *learnedDoses < 0xFFFF )
+    {
+        (*learnedDoses)++;
+    }
+    return true;
+}
+
+/**
+ * Check if there is an dose of which the response isn't learned yet.
+ */
+bool WateringController::isDosePending()
+{
+    return this->doseTime != 0;
+}
+
+/**
+ * Return the moisture before the dose of which the response isn't learned yet.
+ */
+int16_t WateringController::getMoistureBeforeDose()
+{
+    return this->moistureBeforeDose;
+}
+
+/**
+ * Return the time of the dose of which the response isn't learned yet, 0 when there is none.
+ */
+uint32_t WateringController::getDoseTime()
+{
+    return this->doseTime;
+}
+
+/**
+ * Return the time the water needs to settle after an dose. In the adaptive mode the doses
+ * are sized to the target so the pot only waits until the water reached the sensor.
+ *
+ * @param fixedSleepTime    The configured sleep time used in the fixed mode.
+ * @return uint32_t - The time in milliseconds to wait before giving water again.
+ */
+uint32_t WateringController::getSettleTime( uint32_t fixedSleepTime )
+{
+    return this->isAdaptive() && fixedSleepTime > WATERING_SETTLE_TIME ? WATERING_SETTLE_TIME : fixedSleepTime;
+}
@@ -0,0 +1,105 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ *
+ * This library sizes the water doses of the pot. In the adaptive mode it remembers how much
+ * the soil moisture rose after every dose and learns how many moisture percent one second of
+ * pumping gives in this pot, the next dose is sized to reach the optimal moisture level. With
+ * an flow meter the doses are millilitres instead of milliseconds and the gain is learned per
+ * litre instead of per second. It doesn't use any Arduino functions so it can run in the host
+ * simulations.
+ */
+#ifndef WATERUP_PLANTPOT_WATERINGCONTROLLER_H
+#define WATERUP_PLANTPOT_WATERINGCONTROLLER_H
+
+#include <stdint.h>
+#include "../CommonDataTypes.h" // This header contains some data structures that are shared between libraries.
+
+#define WATERING_MODE_FIXED 0 // Every dose runs the pump for the default time and waits the configured sleep time.
+#define WATERING_MODE_ADAPTIVE 1 // Every dose is sized with the learned response gain.
+#define WATERING_GAIN_UNKNOWN 0 // The response gain of an pot that didn't receive water yet.
+#define WATERING_GAIN_FRACTION_BITS 8 // The gain is stored in 1/256 moisture percent per second of pumping.
+#define WATERING_GAIN_SMOOTHING 64 // The weight out of 256 of an new response in the learned gain.
+#define WATERING_MIN_DOSE_TIME 500 // The shortest time in milliseconds worth running the pump for.
+#define WATERING_SETTLE_TIME 600000 // The time in milliseconds the water gets to reach the moisture sensor in the adaptive mode.
+
+/**
+ * This class is used to size the water doses and learn the response gain of the pot.
+ */
+class WateringController
+{
+public:
+    /**
+     * The constructor will save the watering settings and the dose limits.
+     *
+     * @param wateringSettings  An pointer to the watering settings stored in the configuration.
+     * @param defaultDoseTime   The time in milliseconds of an dose when the gain is unknown.
+     * @param maxDoseTime       The maximum time in milliseconds of one dose.
+     * @param minDoseTime       The shortest time in milliseconds worth running the pump for.
+     */
+    WateringController( WateringSettings *wateringSettings, uint32_t defaultDoseTime, uint32_t maxDoseTime, uint32_t minDoseTime = WATERING_MIN_DOSE_TIME );
+
+    /**
+     * This function checks if the doses are sized with the learned gain.
+     *
+     * @return bool - True in the adaptive mode.
+     */
+    bool isAdaptive();
+
+    /**
+     * This function computes how long the pump should run to raise the soil moisture to the target.
+     *
+     * @param moisture      The current percentage of moisture in the soil.
+     * @param target        The optimal percentage of moisture in the soil.
+     * @param responseGain  The learned gain of the channel that gets the dose.
+     * @return uint32_t - The dose time in milliseconds, 0 when the soil is moist enough.
+     */
+    uint32_t computeDoseTime( int16_t moisture, int16_t target, uint16_t responseGain );
+
+    /**
+     * This function remembers an dose so its response can be learned after the water settled.
+     *
+     * @param moisture  The percentage of moisture in the soil before the dose.
+     * @param doseTime  The time in milliseconds the pump ran.
+     */
+    void startDose( int16_t moisture, uint32_t doseTime );
+
+    /**
+     * This function learns the response gain from the moisture rise of the last dose.
+     *
+     * @param moisture      The percentage of moisture in the soil after the water settled.
+     * @param responseGain  An pointer to the learned gain of the channel that got the dose.
+     * @param learnedDoses  An pointer to the amount of doses the gain of the channel is learned from.
+     * @return bool - True if the gain changed and should be persisted.
+     */
+    bool learn( int16_t moisture, uint16_t *responseGain, uint16_t *learnedDoses );
+
+    /**
+     * This function checks if there is an dose of which the response isn't learned yet.
+     */
+    bool isDosePending();
+
+    /**
+     * These functions return the dose of which the response isn't learned yet, they are used
+     * to keep it in RTC memory during deep sleep.
+     */
+    int16_t getMoistureBeforeDose();
+    uint32_t getDoseTime();
+
+    /**
+     * This function returns the time the water needs to settle after an dose.
+     *
+     * @param fixedSleepTime    The configured sleep time used in the fixed mode.
+     * @return uint32_t - The time in milliseconds to wait before giving water again.
+     */
+    uint32_t getSettleTime( uint32_t fixedSleepTime );
+
+private:
+    WateringSettings *settings; // The watering settings stored in the configuration, the mode is shared by the channels.
+    uint32_t defaultDoseTime; // The time in milliseconds of an dose when the gain is unknown.
+    uint32_t maxDoseTime; // The maximum time in milliseconds of one dose.
+    uint32_t minDoseTime; // The shortest time in milliseconds worth running the pump for.
+    int16_t moistureBeforeDose; // The percentage of moisture in the soil before the last dose.
+    uint32_t doseTime; // The time in milliseconds of the last dose, 0 when it is learned.
+};
+
+#endif //WATERUP_PLANTPOT_WATERINGCONTROLLER_H
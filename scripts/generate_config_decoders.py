@@ -0,0 +1,267 @@
+"""
+Licence: GPLv3 - General Public Licence version 3
+
+This script generates the schemas of the configuration messages in lib/ConfigDecoder from the
+example messages in json/. The examples define which keys an message has, the bindings below
+define which setting every key is decoded into and which values are valid. The build fails when
+an example has an key without an binding, so an new field of the backend can't be dropped
+without anyone noticing.
+
+Every schema is an hash table with an slot for every key. The script searches the smallest
+table and the seed of the FNV-1a hash that give every key its own slot, so the decoder finds an
+key with one hash and one compare.
+
+PlatformIO runs it before every build through extra_scripts in platformio.ini, it can also be run
+by hand with: python3 scripts/generate_config_decoders.py
+"""
+import json
+import os
+
+try:
+    Import("env")  # PlatformIO runs the script inside SCons, without __file__.
+    ROOT = env.subst("$PROJECT_DIR")
+except NameError:
+    ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+OUTPUT_DIR = os.path.join(ROOT, "lib", "ConfigDecoder")
+HASH_PRIME = 16777619  # The prime of the 32 bit FNV-1a hash, the same as CONFIG_HASH_PRIME.
+HASH_OFFSET_BASIS = 2166136261  # The first seed that is tried, the offset basis of FNV-1a.
+MAX_SEED_ATTEMPTS = 65536  # The amount of seeds tried per table size.
+MAX_SLOTS = 32  # The decoder marks the found fields with one bit per slot in an uint32_t.
+
+# The largest value of the integer types of the settings.
+TYPE_MAXIMUM = {"uint8_t": "UINT8_MAX", "uint16_t": "UINT16_MAX", "uint32_t": "UINT32_MAX"}
+
+
+def mac():
+    """The mac address of the pot the message is meant for."""
+    return {"kind": "CONFIG_FIELD_MAC", "required": True}
+
+
+def text(value, required=True):
+    """An text that has to have one value."""
+    return {"kind": "CONFIG_FIELD_TEXT", "text": value, "required": required}
+
+
+def unsigned(member, c_type, minimum=0, maximum=None, required=True):
+    """An unsigned number stored in member, an setting like led.red."""
+    return {"kind": "CONFIG_FIELD_UNSIGNED", "member": member, "type": c_type, "minimum": minimum,
+            "maximum": maximum if maximum is not None else TYPE_MAXIMUM[c_type], "required": required}
+
+
+# The configuration messages, the settings of every message are filled with the current
+# configuration before decoding so the optional fields keep their value.
+MESSAGES = [
+    {
+        "name": "LedConfig", "example": ("potConfig.json", "led-config"),
+        "settings": [("led", "LedSettings")],
+        "fields": {
+            "mac": mac(),
+            "red": unsigned("led.red", "uint8_t"),
+            "green": unsigned("led.green", "uint8_t"),
+            "blue": unsigned("led.blue", "uint8_t"),
+        },
+    },
+    {
+        "name": "MqttConfig", "example": ("potConfig.json", "mqtt-config"),
+        "settings": [("mqtt", "MQTTSettings"), ("telemetry", "TelemetrySettings")],
+        "fields": {
+            "mac": mac(),
+            "stat-interval": unsigned("mqtt.statisticPublishInterval", "uint32_t", minimum=1),
+            "resend-interval": unsigned("mqtt.resendWarningInterval", "uint32_t", minimum=1),
+            "ping-interval": unsigned("mqtt.pingBrokerInterval", "uint32_t", minimum=1),
+            "publish-threshold": unsigned("mqtt.publishReservoirWarningThreshold", "uint8_t", maximum=100),
+            "encoding": unsigned("telemetry.encoding", "uint8_t", maximum="TELEMETRY_ENCODING_BINARY", required=False),
+            "batch-size": unsigned("telemetry.batchSize", "uint8_t", minimum=1, maximum="TELEMETRY_MAX_BATCH_SIZE", required=False),
+            "batch-latency": unsigned("telemetry.batchLatency", "uint32_t", required=False),
+        },
+    },
+    {
+        "name": "PlantCareConfig", "example": ("potConfig.json", "plant-config"),
+        "settings": [("plantCare", "PlantCareSettings"), ("cadence", "CadenceSettings")],
+        "fields": {
+            "mac": mac(),
+            "moisture-need": unsigned("plantCare.groundMoistureOptimal", "uint8_t", maximum=100),
+            "interval": unsigned("plantCare.takeMeasurementInterval", "uint32_t", minimum=1),
+            "contains-plant": unsigned("plantCare.containsPlant", "uint8_t", maximum=1, required=False),
+            "interval-floor": unsigned("cadence.measurementFloor", "uint32_t", minimum=1, required=False),
+            "interval-ceiling": unsigned("cadence.measurementCeiling", "uint32_t", minimum=1, required=False),
+        },
+    },
+    {
+        "name": "ReservoirCalibrationConfig", "example": ("potConfig.json", "reservoir-calibration"),
+        "settings": [("point", "ReservoirCalibrationPoint")],
+        "fields": {
+            "mac": mac(),
+            "echo-time": unsigned("point.echoTime", "uint16_t", minimum=1),
+            "fill-level": unsigned("point.fillLevel", "uint16_t", maximum="RESERVOIR_FULL"),
+            "clear": unsigned("point.clear", "uint8_t", maximum=1, required=False),
+        },
+    },
+    {
+        "name": "WarningConfig", "example": ("potWarningConfiguration.json", None),
+        "settings": [("mqtt", "MQTTSettings")],
+        "fields": {
+            "mac": mac(),
+            "type": text("warning-conf"),
+            "warning": text("LOW_RESORVOIR"),
+            "value": unsigned("mqtt.publishReservoirWarningThreshold", "uint8_t", maximum=100),
+        },
+    },
+]
+
+
+def fnv1a(seed, key):
+    """The same hash as ConfigDecoder::hash()."""
+    value = seed
+    for byte in key.encode("utf-8"):
+        value ^= byte
+        value = (value * HASH_PRIME) & 0xFFFFFFFF
+    return value
+
+
+def find_perfect_hash(keys):
+    """Return the smallest table size and an seed that give every key its own slot."""
+    for slot_count in range(len(keys), MAX_SLOTS + 1):
+        for attempt in range(MAX_SEED_ATTEMPTS):
+            seed = (HASH_OFFSET_BASIS + attempt) & 0xFFFFFFFF
+            slots = set(fnv1a(seed, key) % slot_count for key in keys)
+            if len(slots) == len(keys):
+                return slot_count, seed
+    raise SystemExit("No perfect hash with at most %d slots for: %s" % (MAX_SLOTS, ", ".join(keys)))
+
+
+def read_example(message):
+    """Return the keys of the example message in json/."""
+    file_name, path = message["example"]
+    with open(os.path.join(ROOT, "json", file_name)) as example_file:
+        example = json.load(example_file)
+    if path is not None:
+        example = example[path]
+    return list(example.keys())
+
+
+def label(message):
+    """Return the name of an message, like led-config."""
+    return message["example"][1] or message["fields"]["type"]["text"]
+
+
+def constant_name(name):
+    """Convert an name like LedConfig to LED_CONFIG."""
+    return "".join("_" + character if character.isupper() and index > 0 else character
+                   for index, character in enumerate(name)).upper()
+
+
+def check_bindings(message, keys):
+    """Fail when the example and the bindings of an message disagree."""
+    fields = message["fields"]
+    unbound = [key for key in keys if key not in fields]
+    if unbound:
+        raise SystemExit("%s: the example has keys without an binding: %s" % (message["name"], ", ".join(unbound)))
+    missing = [key for key, field in fields.items() if field["required"] and key not in keys]
+    if missing:
+        raise SystemExit("%s: the example misses required keys: %s" % (message["name"], ", ".join(missing)))
+
+
+def settings_type(message, member):
+    """Return the struct of the setting an member like led.red belongs to."""
+    settings = dict(message["settings"])
+    return settings[member.split(".")[0]]
+
+
+def generate_header():
+    lines = [
+        "/**",
+        " * Generated by scripts/generate_config_decoders.py from the example messages in json/, don't",
+        " * edit it. Change the bindings in the script and run it again.",
+        " *",
+        " * This header contains the decoded configuration messages and their schemas.",
+        " */",
+        "#ifndef WATERUP_PLANTPOT_CONFIGSCHEMAS_H",
+        "#define WATERUP_PLANTPOT_CONFIGSCHEMAS_H",
+        "",
+        "#include <stdint.h>",
+        "#include \"../CommonDataTypes.h\" // This header contains the settings the messages are decoded into.",
+        "#include \"ConfigDecoder.h\" // This header contains the decoder that reads the schemas.",
+        "",
+    ]
+    for message in MESSAGES:
+        file_name = message["example"][0]
+        lines += [
+            "/**",
+            " * Data structure that contains an decoded %s message, like in json/%s." % (label(message), file_name),
+            " */",
+            "struct %sMessage" % message["name"],
+            "{",
+        ]
+        for member, c_type in message["settings"]:
+            lines.append("    %s %s; // The %s the message is decoded into." % (c_type, member, c_type))
+        lines += ["};", "", "extern const ConfigSchema %s_SCHEMA; // The schema of the message." % constant_name(message["name"]), ""]
+    lines += ["#endif //WATERUP_PLANTPOT_CONFIGSCHEMAS_H", ""]
+    return "\n".join(lines)
+
+
+def generate_source():
+    lines = [
+        "/**",
+        " * Generated by scripts/generate_config_decoders.py from the example messages in json/, don't",
+        " * edit it. Change the bindings in the script and run it again.",
+        " */",
+        "#include \"ConfigSchemas.h\"",
+        "#include <stddef.h>",
+        "#include <TelemetryCodec.h> // This library contains the limits of the message encoding and batches.",
+        "#include <ReservoirModel.h> // This library contains the fill level of an full reservoir.",
+        "",
+    ]
+    for message in MESSAGES:
+        keys = read_example(message)
+        check_bindings(message, keys)
+        keys = list(message["fields"].keys())
+        slot_count, seed = find_perfect_hash(keys)
+        name = constant_name(message["name"])
+        struct = "%sMessage" % message["name"]
+
+        slots = [None] * slot_count
+        for key in keys:
+            slots[fnv1a(seed, key) % slot_count] = key
+        required = sum(1 << index for index, key in enumerate(slots) if key is not None and message["fields"][key]["required"])
+
+        lines.append("// The fields of an %s message, in the slot of the hash of their key." % label(message))
+        lines.append("static const ConfigField %s_FIELDS[%d] = {" % (name, slot_count))
+        for key in slots:
+            if key is None:
+                lines.append("        { nullptr, 0, CONFIG_FIELD_NONE, 0, 0, 0, 0, nullptr },")
+                continue
+            field = message["fields"][key]
+            if field["kind"] == "CONFIG_FIELD_UNSIGNED":
+                member = field["member"]
+                lines.append("        { \"%s\", %d, CONFIG_FIELD_UNSIGNED, offsetof( %s, %s ), sizeof( %s::%s ), %s, %s, nullptr }," % (
+                    key, len(key), struct, member, settings_type(message, member), member.split(".")[1], field["minimum"], field["maximum"]))
+            elif field["kind"] == "CONFIG_FIELD_TEXT":
+                lines.append("        { \"%s\", %d, CONFIG_FIELD_TEXT, 0, 0, 0, 0, \"%s\" }," % (key, len(key), field["text"]))
+            else:
+                lines.append("        { \"%s\", %d, CONFIG_FIELD_MAC, 0, 0, 0, 0, nullptr }," % (key, len(key)))
+        lines += [
+            "};",
+            "const ConfigSchema %s_SCHEMA = { %s_FIELDS, %d, 0x%08XUL, 0x%08XUL };" % (name, name, slot_count, seed, required),
+            "",
+        ]
+    return "\n".join(lines)
+
+
+def write_if_changed(path, content):
+    """Only write an file that changed, so the build doesn't recompile the decoder every time."""
+    if os.path.exists(path):
+        with open(path) as current_file:
+            if current_file.read() == content:
+                return
+    with open(path, "w") as output_file:
+        output_file.write(content)
+    print("Generated %s" % os.path.relpath(path, ROOT))
+
+
+def generate():
+    write_if_changed(os.path.join(OUTPUT_DIR, "ConfigSchemas.h"), generate_header())
+    write_if_changed(os.path.join(OUTPUT_DIR, "ConfigSchemas.cpp"), generate_source())
+
+
+generate()
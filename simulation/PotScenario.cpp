@@ -0,0 +1,247 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ */
+#include "PotScenario.h"
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <SimulatedBoard.h>
+#include <SimulatedBroker.h>
+#include <Configuration.h>
+#include <PlantCare.h>
+#include <TelemetryCodec.h>
+#include <string>
+#include <chrono>
+
+void setup(); // The firmware entry points and instances in src/main.cpp.
+void loop();
+extern Configuration configuration;
+extern PlantCare plantCare;
+extern Communication communication;
+
+PotPhysics physics; // The simulated pot.
+PotScenario *activeScenario = nullptr; // The scenario that is running.
+PotScenarioResult *activeResult = nullptr; // The result of the scenario that is running.
+FILE *traceFile = nullptr; // The file the trace is written to.
+uint64_t traceInterval = 0; // The simulated microseconds between two rows of the trace.
+uint32_t refillEventId = 0; // The id of the pending refill, 0 when the owner isn't on his way.
+
+/**
+ * The owner refills the reservoir.
+ *
+ * @param context   Not used.
+ */
+void refillReservoir( void *context )
+{
+    refillEventId = 0;
+    physics.refill();
+}
+
+/**
+ * Take the broker down or bring it back up.
+ *
+ * @param context   Not used.
+ */
+void toggleBroker( void *context )
+{
+    SimulatedBroker::setReachable( !SimulatedBroker::isReachable() );
+}
+
+/**
+ * Count an warning the pot published. An reservoir warning sends the owner to refill the
+ * reservoir, an owner that is already on his way doesn't come twice.
+ *
+ * @param warningType   The code of the warning.
+ */
+void countWarning( int warningType )
+{
+    activeResult->warnings++;
+    if( warningType != 0 && refillEventId == 0 )
+    {
+        refillEventId = SimulatedBoard::addEvent( SimulatedBoard::now() + (uint64_t)( activeScenario->refillDelay * 3600e6 ), &refillReservoir, nullptr );
+    }
+}
+
+/**
+ * Count the messages the pot publishes. An json message always starts with an brace, every
+ * other message is decoded as an binary message.
+ *
+ * @param topic     The topic of the message.
+ * @param payload   The message.
+ * @param length    The length of the message.
+ * @param context   Not used.
+ */
+void countMessage( const char *topic, const uint8_t *payload, size_t length, void *context )
+{
+    if( length > 0 && payload[0] != '{' )
+    {
+        TelemetryMessage message;
+        if( !TelemetryCodec::decode( payload, (uint16_t) length, message ))
+        {
+            activeResult->undecodable++;
+        }
+        else if( message.type == TELEMETRY_TYPE_WARNING )
+        {
+            countWarning( message.warning );
+        }
+        else if( message.type == TELEMETRY_TYPE_BATCH )
+        {
+            activeResult->statistics += message.sampleCount;
+        }
+        else
+        {
+            activeResult->statistics++;
+        }
+        return;
+    }
+
+    std::string text( (const char*) payload, length );
+    const char *message = text.c_str();
+    const char *warning = strstr( message, "\"warning\":\"" );
+    if( strstr( message, "\"warning-mesg\"" ) != nullptr && warning != nullptr )
+    {
+        countWarning( atoi( warning + 11 ));
+    }
+    else if( strstr( message, "\"potstats-mesg\"" ) != nullptr )
+    {
+        activeResult->statistics++;
+    }
+    else if( strstr( message, "\"potstats-batch\"" ) != nullptr )
+    {
+        const char *samples = strstr( message, "[[" ); // Every statistic is an array in the samples array.
+        for( const char *sample = samples != nullptr ? samples + 1 : nullptr; sample != nullptr; sample = strchr( sample + 1, '[' ))
+        {
+            activeResult->statistics++;
+        }
+    }
+}
+
+/**
+ * Check if the true moisture is inside the band around the optimal level.
+ *
+ * @param context   Not used.
+ */
+void sampleMoisture( void *context )
+{
+    physics.update();
+    double difference = physics.getMoisture() - activeScenario->groundMoistureOptimal;
+    if( difference > activeScenario->moistureBand || difference < -activeScenario->moistureBand )
+    {
+        activeResult->outOfBandTime += SCENARIO_SAMPLE_INTERVAL / 1e6;
+    }
+    SimulatedBoard::addEvent( SimulatedBoard::now() + SCENARIO_SAMPLE_INTERVAL, &sampleMoisture, nullptr );
+}
+
+/**
+ * Write an row of the trace with the true state of the pot.
+ *
+ * @param context   Not used.
+ */
+void writeTrace( void *context )
+{
+    physics.update();
+    fprintf( traceFile, "%.3f,%.2f,%.2f,%d,%.1f,%u,%u\n",
+             SimulatedBoard::now() / 3600e6, physics.getMoisture(), physics.getReservoirLevel(), physics.isPumpOn() ? 1 : 0,
+             physics.getTotals()->pumpedVolume, activeResult->statistics, physics.getTotals()->moistureReadings );
+    SimulatedBoard::addEvent( SimulatedBoard::now() + traceInterval, &writeTrace, nullptr );
+}
+
+/**
+ * Fill an scenario with the settings the firmware starts with and the default pot.
+ *
+ * @param scenario  The scenario to fill.
+ */
+void initScenario( PotScenario *scenario )
+{
+    scenario->days = 30;
+    scenario->seed = 1;
+    scenario->refillDelay = 12;
+    scenario->moistureBand = 5;
+    scenario->takeMeasurementInterval = configuration.getPlantCareSettings()->takeMeasurementInterval;
+    scenario->sleepAfterGivingWater = configuration.getPlantCareSettings()->sleepAfterGivingWater;
+    scenario->groundMoistureOptimal = configuration.getPlantCareSettings()->groundMoistureOptimal;
+    scenario->publishReservoirWarningThreshold = configuration.getMqttSettings()->publishReservoirWarningThreshold;
+    scenario->telemetryEncoding = configuration.getTelemetrySettings()->encoding;
+    scenario->batchSize = configuration.getTelemetrySettings()->batchSize;
+    scenario->batchLatency = configuration.getTelemetrySettings()->batchLatency;
+    scenario->outageStart = 24;
+    scenario->outageHours = 0;
+    scenario->fragmentLengthSupported = true;
+    scenario->physics = *physics.getParameters();
+    scenario->physics.pumpPin = IO_PIN_WATER_PUMP;
+    scenario->physics.sonarTriggerPin = IO_PIN_SONAR_TRIGGER;
+    scenario->physics.sonarEchoPin = IO_PIN_SONAR_ECHO;
+    scenario->physics.moisturePin = IO_PIN_SOIL_MOISTURE;
+#ifdef POT_FLOW_METER
+    scenario->physics.flowMeterPin = IO_PIN_FLOW_METER;
+#endif
+}
+
+/**
+ * Run the firmware for the days of the scenario. The settings are stored in the configuration
+ * before setup(), the same way they would be after an configuration message and an restart.
+ *
+ * @param scenario      The scenario to run.
+ * @param result        The result to fill.
+ * @param trace         The file an CSV trace is written to, nullptr for no trace.
+ * @param traceEvery    The simulated microseconds between two rows of the trace.
+ */
+void runScenario( PotScenario *scenario, PotScenarioResult *result, FILE *trace, uint64_t traceEvery )
+{
+    memset( result, 0, sizeof( PotScenarioResult ));
+    activeScenario = scenario;
+    activeResult = result;
+
+    MQTTSettings *mqttSettings = configuration.getMqttSettings();
+    configuration.setPlantCareSettings( scenario->takeMeasurementInterval, scenario->sleepAfterGivingWater, scenario->groundMoistureOptimal, configuration.getPlantCareSettings()->containsPlant );
+    configuration.setMQTTSettings( mqttSettings->statisticPublishInterval, mqttSettings->resendWarningInterval, mqttSettings->pingBrokerInterval, scenario->publishReservoirWarningThreshold );
+    configuration.setTelemetrySettings( scenario->telemetryEncoding, scenario->batchSize, scenario->batchLatency );
+    plantCare.loadConfiguration();
+
+    *physics.getParameters() = scenario->physics;
+    physics.reset();
+    SimulatedBoard::setRandomSeed( scenario->seed );
+    SimulatedBoard::attachDevice( &physics );
+    SimulatedBroker::onPublish( &countMessage, nullptr );
+    SimulatedBroker::setFragmentLengthSupported( scenario->fragmentLengthSupported );
+    SimulatedBoard::addEvent( SimulatedBoard::now() + SCENARIO_SAMPLE_INTERVAL, &sampleMoisture, nullptr );
+    if( scenario->outageHours > 0 )
+    {
+        SimulatedBoard::addEvent( SimulatedBoard::now() + (uint64_t)( scenario->outageStart * 3600e6 ), &toggleBroker, nullptr );
+        SimulatedBoard::addEvent( SimulatedBoard::now() + (uint64_t)(( scenario->outageStart + scenario->outageHours ) * 3600e6 ), &toggleBroker, nullptr );
+    }
+
+    if( trace != nullptr )
+    {
+        traceFile = trace;
+        traceInterval = traceEvery;
+        fprintf( traceFile, "hours,moisture,reservoir,pump,pumpedMl,statistics,moistureReadings\n" );
+        writeTrace( nullptr );
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    uint64_t end = SimulatedBoard::now() + (uint64_t)( scenario->days * 86400e6 );
+
+    setup();
+    while( SimulatedBoard::now() < end )
+    {
+        loop();
+    }
+    physics.update();
+
+    SimulatedBrokerStatistics *broker = SimulatedBroker::getStatistics();
+    result->totals = *physics.getTotals();
+    result->finalMoisture = physics.getMoisture();
+    result->finalReservoirLevel = physics.getReservoirLevel();
+    result->messages = broker->messages;
+    result->bytes = broker->bytes;
+    result->pings = broker->pings;
+    result->connects = broker->connects;
+    result->connectAttempts = communication.getReconnectStatistics()->attempts;
+    result->fullHandshakes = broker->fullHandshakes;
+    result->resumedHandshakes = broker->resumedHandshakes;
+    result->tlsBuffers = communication.getTlsBuffers();
+    result->lowestFreeHeap = SimulatedBoard::getLowestFreeHeap();
+    result->rejected = broker->rejected;
+    result->eepromCommits = EEPROM.getCommitCount();
+    result->wallSeconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+}
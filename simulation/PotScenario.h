@@ -0,0 +1,83 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ *
+ * This file runs one scenario of the pot simulation: the real firmware with an set of plant
+ * care settings against an pot with an set of physics parameters. The firmware is made of
+ * global instances that are constructed once, so an scenario can only run once per process.
+ * The sweep forks an fresh process for every scenario.
+ */
+#ifndef WATERUP_SIMULATION_POTSCENARIO_H
+#define WATERUP_SIMULATION_POTSCENARIO_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "physics/PotPhysics.h"
+
+#define SCENARIO_SAMPLE_INTERVAL 60000000 // The simulated microseconds between two checks of the moisture band.
+
+/**
+ * Data structure that contains everything an scenario is run with.
+ */
+struct PotScenario
+{
+    double days; // The simulated time in days.
+    uint32_t seed; // The seed of the random numbers of the sensors.
+    double refillDelay; // The hours the owner takes to refill the reservoir after an warning.
+    double moistureBand; // The percentage the moisture may differ from the optimal level before it counts as out of band.
+    uint32_t takeMeasurementInterval; // The plant care measurement interval in milliseconds.
+    uint32_t sleepAfterGivingWater; // The plant care time in milliseconds between two doses.
+    uint8_t groundMoistureOptimal; // The plant care moisture level in percent at which the plant gets water.
+    uint8_t publishReservoirWarningThreshold; // The reservoir level in percent at which the user gets warned.
+    uint8_t telemetryEncoding; // The encoding of the statistic and warning messages, json or binary.
+    uint8_t batchSize; // The amount of statistics in one message, 1 publishes every statistic right away.
+    uint32_t batchLatency; // The longest time in milliseconds an statistic waits in an batch.
+    double outageStart; // The hour at which the broker goes down.
+    double outageHours; // The hours the broker stays down, 0 for no outage.
+    bool fragmentLengthSupported; // Boolean to check if the broker agrees to an smaller TLS fragment length.
+    PotPhysicsParameters physics; // The pot, soil and plant the firmware runs against.
+};
+
+/**
+ * Data structure that contains what happened during an scenario.
+ */
+struct PotScenarioResult
+{
+    PotPhysicsTotals totals; // The water and sensor totals of the pot.
+    double outOfBandTime; // The time in seconds the moisture was outside the band around the optimal level.
+    double finalMoisture; // The moisture in percent at the end.
+    double finalReservoirLevel; // The reservoir level in percent at the end.
+    uint32_t statistics; // The amount of statistics that reached the broker, alone or in an batch.
+    uint32_t warnings; // The amount of warning messages that reached the broker.
+    uint32_t messages; // The amount of messages that reached the broker.
+    uint64_t bytes; // The amount of payload bytes that reached the broker.
+    uint32_t pings; // The amount of pings the broker received.
+    uint32_t connects; // The amount of connections to the broker.
+    uint32_t connectAttempts; // The amount of connection attempts of the pot.
+    uint32_t fullHandshakes; // The amount of TLS handshakes with an key exchange.
+    uint32_t resumedHandshakes; // The amount of TLS handshakes that resumed an session.
+    uint8_t tlsBuffers; // The size of the TLS buffers the pot ended up with, Communication::TLS_BUFFERS_*.
+    uint32_t lowestFreeHeap; // The lowest free heap in bytes, while the TLS buffers were allocated.
+    uint32_t rejected; // The amount of messages the broker rejected.
+    uint32_t undecodable; // The amount of binary messages the backend couldn't decode.
+    uint32_t eepromCommits; // The amount of EEPROM commits.
+    double wallSeconds; // The real time in seconds the scenario took.
+};
+
+/**
+ * Fill an scenario with the settings the firmware starts with and the default pot.
+ *
+ * @param scenario  The scenario to fill.
+ */
+void initScenario( PotScenario *scenario );
+
+/**
+ * Run the firmware for the days of the scenario. This can only be done once per process.
+ *
+ * @param scenario  The scenario to run.
+ * @param result    The result to fill.
+ * @param trace     The file an CSV trace is written to, nullptr for no trace.
+ * @param traceInterval The simulated microseconds between two rows of the trace.
+ */
+void runScenario( PotScenario *scenario, PotScenarioResult *result, FILE *trace, uint64_t traceInterval );
+
+#endif //WATERUP_SIMULATION_POTSCENARIO_H
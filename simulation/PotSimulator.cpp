@@ -0,0 +1,195 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ *
+ * This program runs the real pot firmware from src/main.cpp on the host against an simulated
+ * board, pot and broker. The simulated clock only moves when the firmware waits, so months
+ * of operation run in seconds. An simulated owner refills the reservoir some time after the
+ * pot published an reservoir warning. At the end it prints what the plant, the reservoir,
+ * the sensors and the radio went through, so watering and publishing policies can be
+ * compared before they are rolled out.
+ *
+ * Usage: pot-simulator [--days 30] [--seed 1] [--refill-delay 12] [--evapotranspiration 35]
+ *                      [--moisture-optimal 30] [--measurement-interval 60000] [--water-sleep 3600000]
+ *                      [--warning-threshold 30] [--encoding json|binary] [--batch-size 1] [--batch-latency 300000]
+ *                      [--outage-start 24] [--outage-hours 0] [--refuse-fragment-length] [--csv trace.csv] [--trace-minutes 10] [--verbose]
+ */
+#include <Arduino.h>
+#include <SimulatedBoard.h>
+#include <TelemetryCodec.h>
+#include <Communication.h>
+#include "PotScenario.h"
+
+#define SIMULATOR_USAGE "[--days 30] [--seed 1] [--refill-delay 12] [--evapotranspiration 35] [--moisture-optimal 30] " \
+    "[--measurement-interval 60000] [--water-sleep 3600000] [--warning-threshold 30] [--encoding json|binary] [--batch-size 1] [--batch-latency 300000] [--outage-start 24] [--outage-hours 0] [--refuse-fragment-length] [--csv trace.csv] [--trace-minutes 10] [--verbose]"
+
+/**
+ * Data structure that contains the options of the simulator that aren't part of the scenario.
+ */
+struct SimulatorOptions
+{
+    double traceMinutes; // The simulated minutes between two rows of the trace.
+    const char *csvPath; // The file the trace is written to, nullptr for no trace.
+    bool verbose; // Boolean to check if the serial output of the firmware is printed.
+};
+
+/**
+ * Parse the command line options.
+ *
+ * @param argc      The amount of arguments.
+ * @param argv      The arguments.
+ * @param options   The simulator options to fill.
+ * @param scenario  The scenario to fill.
+ * @return bool - False when the usage should be printed.
+ */
+bool parseOptions( int argc, char **argv, SimulatorOptions *options, PotScenario *scenario )
+{
+    for( int i = 1; i < argc; i++ )
+    {
+        bool hasValue = i + 1 < argc;
+        if( strcmp( argv[i], "--verbose" ) == 0 )
+        {
+            options->verbose = true;
+        }
+        else if( strcmp( argv[i], "--days" ) == 0 && hasValue )
+        {
+            scenario->days = atof( argv[++i] );
+        }
+        else if( strcmp( argv[i], "--seed" ) == 0 && hasValue )
+        {
+            scenario->seed = (uint32_t) strtoul( argv[++i], nullptr, 10 );
+        }
+        else if( strcmp( argv[i], "--refill-delay" ) == 0 && hasValue )
+        {
+            scenario->refillDelay = atof( argv[++i] );
+        }
+        else if( strcmp( argv[i], "--evapotranspiration" ) == 0 && hasValue )
+        {
+            scenario->physics.evapotranspiration = atof( argv[++i] );
+        }
+        else if( strcmp( argv[i], "--moisture-optimal" ) == 0 && hasValue )
+        {
+            scenario->groundMoistureOptimal = (uint8_t) atoi( argv[++i] );
+        }
+        else if( strcmp( argv[i], "--measurement-interval" ) == 0 && hasValue )
+        {
+            scenario->takeMeasurementInterval = (uint32_t) strtoul( argv[++i], nullptr, 10 );
+        }
+        else if( strcmp( argv[i], "--water-sleep" ) == 0 && hasValue )
+        {
+            scenario->sleepAfterGivingWater = (uint32_t) strtoul( argv[++i], nullptr, 10 );
+        }
+        else if( strcmp( argv[i], "--warning-threshold" ) == 0 && hasValue )
+        {
+            scenario->publishReservoirWarningThreshold = (uint8_t) atoi( argv[++i] );
+        }
+        else if( strcmp( argv[i], "--encoding" ) == 0 && hasValue )
+        {
+            const char *encoding = argv[++i];
+            if( strcmp( encoding, "json" ) == 0 )
+            {
+                scenario->telemetryEncoding = TELEMETRY_ENCODING_JSON;
+            }
+            else if( strcmp( encoding, "binary" ) == 0 )
+            {
+                scenario->telemetryEncoding = TELEMETRY_ENCODING_BINARY;
+            }
+            else
+            {
+                return false;
+            }
+        }
+        else if( strcmp( argv[i], "--batch-size" ) == 0 && hasValue )
+        {
+            scenario->batchSize = (uint8_t) atoi( argv[++i] );
+        }
+        else if( strcmp( argv[i], "--batch-latency" ) == 0 && hasValue )
+        {
+            scenario->batchLatency = (uint32_t) strtoul( argv[++i], nullptr, 10 );
+        }
+        else if( strcmp( argv[i], "--outage-start" ) == 0 && hasValue )
+        {
+            scenario->outageStart = atof( argv[++i] );
+        }
+        else if( strcmp( argv[i], "--outage-hours" ) == 0 && hasValue )
+        {
+            scenario->outageHours = atof( argv[++i] );
+        }
+        else if( strcmp( argv[i], "--refuse-fragment-length" ) == 0 )
+        {
+            scenario->fragmentLengthSupported = false;
+        }
+        else if( strcmp( argv[i], "--csv" ) == 0 && hasValue )
+        {
+            options->csvPath = argv[++i];
+        }
+        else if( strcmp( argv[i], "--trace-minutes" ) == 0 && hasValue )
+        {
+            options->traceMinutes = atof( argv[++i] );
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return scenario->days > 0 && options->traceMinutes > 0 && scenario->batchSize > 0 && scenario->batchSize <= TELEMETRY_MAX_BATCH_SIZE;
+}
+
+/**
+ * Print what happened during the simulation.
+ *
+ * @param scenario  The scenario that ran.
+ * @param result    What happened.
+ */
+void printReport( PotScenario *scenario, PotScenarioResult *result )
+{
+    PotPhysicsTotals *totals = &result->totals;
+
+    printf( "Simulated %.1f days in %.2f s (%.0fx real time)\n", scenario->days, result->wallSeconds, scenario->days * 86400 / result->wallSeconds );
+    printf( "Plant:     dry %.1f h, waterlogged %.1f h, out of band %.1f h, moisture now %.1f%%\n",
+            totals->dryTime / 3600, totals->waterloggedTime / 3600, result->outOfBandTime / 3600, result->finalMoisture );
+    printf( "Water:     %u doses, %.2f L pumped in %.0f s, %.2f L drained, %.2f L used by the plant\n",
+            totals->pumpStarts, totals->pumpedVolume / 1000, totals->pumpTime, totals->drainedVolume / 1000, totals->consumedVolume / 1000 );
+    printf( "Reservoir: %u refills, empty for %.1f h, pump ran dry for %.0f s, level now %.1f%%\n",
+            totals->refills, totals->emptyReservoirTime / 3600, totals->dryPumpTime, result->finalReservoirLevel );
+    printf( "Sensors:   %u sonar triggers, %u moisture readings\n", totals->sonarTriggers, totals->moistureReadings );
+    printf( "Radio:     %u statistics, %u warnings, %u messages (%llu bytes), %u pings, %u connects (%u attempts), %u rejected, %u undecodable\n",
+            result->statistics, result->warnings, result->messages, (unsigned long long) result->bytes, result->pings, result->connects, result->connectAttempts, result->rejected, result->undecodable );
+    printf( "TLS:       %u full handshakes, %u resumed handshakes, %s buffers, lowest free heap %u bytes\n", result->fullHandshakes, result->resumedHandshakes,
+            result->tlsBuffers == Communication::TLS_BUFFERS_LEAN ? "lean" : "full", result->lowestFreeHeap );
+    printf( "Flash:     %u EEPROM commits\n", result->eepromCommits );
+}
+
+int main( int argc, char **argv )
+{
+    SimulatorOptions options = { 10, nullptr, false };
+    PotScenario scenario;
+    PotScenarioResult result;
+    FILE *trace = nullptr;
+
+    initScenario( &scenario );
+    if( !parseOptions( argc, argv, &options, &scenario ))
+    {
+        fprintf( stderr, "Usage: %s " SIMULATOR_USAGE "\n", argv[0] );
+        return 1;
+    }
+
+    if( options.csvPath != nullptr )
+    {
+        trace = fopen( options.csvPath, "w" );
+        if( trace == nullptr )
+        {
+            fprintf( stderr, "Unable to open %s\n", options.csvPath );
+            return 1;
+        }
+    }
+
+    Serial.setEnabled( options.verbose );
+    runScenario( &scenario, &result, trace, (uint64_t)( options.traceMinutes * 60e6 ));
+    printReport( &scenario, &result );
+
+    if( trace != nullptr )
+    {
+        fclose( trace );
+    }
+    return 0;
+}
@@ -0,0 +1,325 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ *
+ * This program simulates every combination of plant care settings and plant profiles and
+ * prints an CSV row with the water used, the time out of the moisture band, the pump cycles
+ * and the messages sent for each of them. The firmware is made of global instances, so every
+ * combination runs in its own forked process. An new process is started as soon as one
+ * finishes, so the sweep keeps all cores busy and scales with the amount of cores.
+ *
+ * Usage: pot-sweep [--days 14] [--seed 1] [--jobs cores] [--moisture-optimal 20,30,40]
+ *                  [--measurement-interval 60000,300000] [--water-sleep 600000,3600000]
+ *                  [--warning-threshold 15,30] [--profiles all] [--csv results.csv]
+ */
+#include <Arduino.h>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include "PotScenario.h"
+
+#define SWEEP_USAGE "[--days 14] [--seed 1] [--jobs cores] [--moisture-optimal 20,30,40] [--measurement-interval 60000,300000] " \
+    "[--water-sleep 600000,3600000] [--warning-threshold 15,30] [--profiles all] [--csv results.csv]"
+
+/**
+ * Data structure that contains the plant and weather a combination is simulated with.
+ */
+struct PlantProfile
+{
+    const char *name; // The name of the profile used in the options and results.
+    double evapotranspiration; // The water the plant and sun take out at noon in milliliters per hour.
+    double nightFactor; // The part of the noon evapotranspiration that remains at night, 0-1.
+    double soilVolume; // The volume of the soil in milliliters.
+};
+
+const PlantProfile plantProfiles[] = {
+        { "succulent-indoor", 8, 0.30, 2000 },
+        { "herb-indoor", 35, 0.15, 3000 },
+        { "herb-balcony", 90, 0.10, 3000 },
+        { "tomato-summer", 250, 0.05, 8000 },
+};
+const size_t plantProfileCount = sizeof( plantProfiles ) / sizeof( PlantProfile );
+
+/**
+ * Data structure that contains the values to sweep over.
+ */
+struct SweepGrid
+{
+    std::vector<uint32_t> moistureOptimal; // The optimal moisture levels in percent.
+    std::vector<uint32_t> measurementInterval; // The measurement intervals in milliseconds.
+    std::vector<uint32_t> waterSleep; // The times in milliseconds between two doses.
+    std::vector<uint32_t> warningThreshold; // The reservoir warning thresholds in percent.
+    std::vector<const PlantProfile *> profiles; // The plant profiles.
+};
+
+/**
+ * Parse an comma separated list of numbers.
+ *
+ * @param text      The list.
+ * @param values    The vector the numbers are stored in.
+ * @return bool - False if the list is empty.
+ */
+bool parseList( const char *text, std::vector<uint32_t> *values )
+{
+    values->clear();
+    while( *text != '\0' )
+    {
+        char *end;
+        values->push_back((uint32_t) strtoul( text, &end, 10 ));
+        if( end == text )
+        {
+            return false;
+        }
+        text = *end == ',' ? end + 1 : end;
+    }
+    return !values->empty();
+}
+
+/**
+ * Parse an comma separated list of plant profile names, all selects every profile.
+ *
+ * @param text      The list.
+ * @param profiles  The vector the profiles are stored in.
+ * @return bool - False if an profile doesn't exist.
+ */
+bool parseProfiles( const char *text, std::vector<const PlantProfile *> *profiles )
+{
+    profiles->clear();
+    std::string names( text );
+    size_t start = 0;
+    while( start <= names.size())
+    {
+        size_t end = names.find( ',', start );
+        std::string name = names.substr( start, end == std::string::npos ? std::string::npos : end - start );
+        bool found = false;
+
+        for( size_t i = 0; i < plantProfileCount; i++ )
+        {
+            if( name == "all" || name == plantProfiles[i].name )
+            {
+                profiles->push_back( &plantProfiles[i] );
+                found = true;
+            }
+        }
+        if( !found )
+        {
+            return false;
+        }
+        if( end == std::string::npos )
+        {
+            break;
+        }
+        start = end + 1;
+    }
+    return true;
+}
+
+/**
+ * Run the scenarios in forked processes, at most jobs at the same time. The results are
+ * written into memory that is shared with the children.
+ *
+ * @param scenarios The scenarios to run.
+ * @param results   The shared results, one for each scenario.
+ * @param failed    Set for every scenario whose process didn't exit cleanly.
+ * @param jobs      The maximum amount of processes at the same time.
+ */
+void runSweep( std::vector<PotScenario> &scenarios, PotScenarioResult *results, std::vector<bool> &failed, unsigned jobs )
+{
+    std::map<pid_t, size_t> workers;
+    size_t next = 0;
+    size_t finished = 0;
+
+    while( finished < scenarios.size())
+    {
+        while( workers.size() < jobs && next < scenarios.size())
+        {
+            fflush( stdout );
+            fflush( stderr );
+            pid_t pid = fork();
+            if( pid == 0 )
+            {
+                runScenario( &scenarios[next], &results[next], nullptr, 0 );
+                _exit( 0 );
+            }
+            if( pid < 0 )
+            {
+                failed[next++] = true;
+                finished++;
+                continue;
+            }
+            workers[pid] = next++;
+        }
+
+        int status;
+        pid_t pid = waitpid( -1, &status, 0 );
+        if( pid < 0 )
+        {
+            break;
+        }
+
+        std::map<pid_t, size_t>::iterator worker = workers.find( pid );
+        if( worker != workers.end())
+        {
+            failed[worker->second] = !WIFEXITED( status ) || WEXITSTATUS( status ) != 0;
+            workers.erase( worker );
+            finished++;
+            fprintf( stderr, "\r%zu/%zu scenarios", finished, scenarios.size());
+        }
+    }
+    fprintf( stderr, "\n" );
+}
+
+int main( int argc, char **argv )
+{
+    PotScenario base;
+    SweepGrid grid;
+    const char *csvPath = nullptr;
+    long cores = sysconf( _SC_NPROCESSORS_ONLN );
+    unsigned jobs = cores > 0 ? (unsigned) cores : 1;
+    bool valid = true;
+
+    initScenario( &base );
+    base.days = 14;
+    parseList( "20,30,40", &grid.moistureOptimal );
+    parseList( "60000,300000", &grid.measurementInterval );
+    parseList( "600000,3600000", &grid.waterSleep );
+    parseList( "15,30", &grid.warningThreshold );
+    parseProfiles( "all", &grid.profiles );
+
+    for( int i = 1; i < argc && valid; i++ )
+    {
+        bool hasValue = i + 1 < argc;
+        if( strcmp( argv[i], "--days" ) == 0 && hasValue )
+        {
+            base.days = atof( argv[++i] );
+            valid = base.days > 0;
+        }
+        else if( strcmp( argv[i], "--seed" ) == 0 && hasValue )
+        {
+            base.seed = (uint32_t) strtoul( argv[++i], nullptr, 10 );
+        }
+        else if( strcmp( argv[i], "--jobs" ) == 0 && hasValue )
+        {
+            jobs = (unsigned) strtoul( argv[++i], nullptr, 10 );
+            valid = jobs > 0;
+        }
+        else if( strcmp( argv[i], "--moisture-optimal" ) == 0 && hasValue )
+        {
+            valid = parseList( argv[++i], &grid.moistureOptimal );
+        }
+        else if( strcmp( argv[i], "--measurement-interval" ) == 0 && hasValue )
+        {
+            valid = parseList( argv[++i], &grid.measurementInterval );
+        }
+        else if( strcmp( argv[i], "--water-sleep" ) == 0 && hasValue )
+        {
+            valid = parseList( argv[++i], &grid.waterSleep );
+        }
+        else if( strcmp( argv[i], "--warning-threshold" ) == 0 && hasValue )
+        {
+            valid = parseList( argv[++i], &grid.warningThreshold );
+        }
+        else if( strcmp( argv[i], "--profiles" ) == 0 && hasValue )
+        {
+            valid = parseProfiles( argv[++i], &grid.profiles );
+        }
+        else if( strcmp( argv[i], "--csv" ) == 0 && hasValue )
+        {
+            csvPath = argv[++i];
+        }
+        else
+        {
+            valid = false;
+        }
+    }
+
+    if( !valid )
+    {
+        fprintf( stderr, "Usage: %s " SWEEP_USAGE "\n", argv[0] );
+        return 1;
+    }
+
+    FILE *output = csvPath != nullptr ? fopen( csvPath, "w" ) : stdout;
+    if( output == nullptr )
+    {
+        fprintf( stderr, "Unable to open %s\n", csvPath );
+        return 1;
+    }
+
+    std::vector<PotScenario> scenarios;
+    std::vector<const PlantProfile *> scenarioProfiles;
+    for( const PlantProfile *profile : grid.profiles )
+    {
+        for( uint32_t moistureOptimal : grid.moistureOptimal )
+        {
+            for( uint32_t measurementInterval : grid.measurementInterval )
+            {
+                for( uint32_t waterSleep : grid.waterSleep )
+                {
+                    for( uint32_t warningThreshold : grid.warningThreshold )
+                    {
+                        PotScenario scenario = base;
+                        scenario.physics.evapotranspiration = profile->evapotranspiration;
+                        scenario.physics.nightFactor = profile->nightFactor;
+                        scenario.physics.soilVolume = profile->soilVolume;
+                        scenario.groundMoistureOptimal = (uint8_t) moistureOptimal;
+                        scenario.takeMeasurementInterval = measurementInterval;
+                        scenario.sleepAfterGivingWater = waterSleep;
+                        scenario.publishReservoirWarningThreshold = (uint8_t) warningThreshold;
+                        scenarios.push_back( scenario );
+                        scenarioProfiles.push_back( profile );
+                    }
+                }
+            }
+        }
+    }
+
+    size_t resultsSize = scenarios.size() * sizeof( PotScenarioResult );
+    PotScenarioResult *results = (PotScenarioResult *) mmap( nullptr, resultsSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0 );
+    if( results == MAP_FAILED )
+    {
+        fprintf( stderr, "Unable to allocate the results of %zu scenarios\n", scenarios.size());
+        return 1;
+    }
+    std::vector<bool> failed( scenarios.size(), false );
+
+    Serial.setEnabled( false );
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    runSweep( scenarios, results, failed, jobs );
+    double wallSeconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+    fprintf( output, "profile,moistureOptimal,measurementInterval,waterSleep,warningThreshold,"
+                     "waterUsedL,outOfBandHours,dryHours,waterloggedHours,pumpCycles,refills,emptyReservoirHours,messages,bytes\n" );
+    for( size_t i = 0; i < scenarios.size(); i++ )
+    {
+        if( failed[i] )
+        {
+            fprintf( stderr, "Scenario %zu (%s) failed\n", i, scenarioProfiles[i]->name );
+            continue;
+        }
+
+        PotScenarioResult *result = &results[i];
+        fprintf( output, "%s,%u,%u,%u,%u,%.2f,%.1f,%.1f,%.1f,%u,%u,%.1f,%u,%llu\n",
+                 scenarioProfiles[i]->name, scenarios[i].groundMoistureOptimal, scenarios[i].takeMeasurementInterval,
+                 scenarios[i].sleepAfterGivingWater, scenarios[i].publishReservoirWarningThreshold,
+                 result->totals.pumpedVolume / 1000, result->outOfBandTime / 3600, result->totals.dryTime / 3600,
+                 result->totals.waterloggedTime / 3600, result->totals.pumpStarts, result->totals.refills,
+                 result->totals.emptyReservoirTime / 3600, result->messages, (unsigned long long) result->bytes );
+    }
+
+    struct rusage usage;
+    getrusage( RUSAGE_CHILDREN, &usage );
+    double cpuSeconds = usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + ( usage.ru_utime.tv_usec + usage.ru_stime.tv_usec ) / 1e6;
+    fprintf( stderr, "%zu scenarios of %.1f days in %.1f s on %u processes, %.1f cpu seconds (%.1fx parallel)\n",
+             scenarios.size(), base.days, wallSeconds, jobs, cpuSeconds, cpuSeconds / wallSeconds );
+
+    if( output != stdout )
+    {
+        fclose( output );
+    }
+    munmap( results, resultsSize );
+    return 0;
+}
@@ -0,0 +1,187 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ *
+ * This program converts the statistic and warning messages of the pots into the json messages
+ * the backend already ingests, so pots can switch to the binary encoding one at the time. It
+ * reads one message per line: an json message is passed through as is, every other line is
+ * read as the hexadecimal payload like mosquitto_sub -F %x prints it. An hexadecimal json
+ * payload is passed through as well, so one subscription can feed both encodings. Messages
+ * that can't be decoded are reported on stderr and skipped.
+ *
+ * Usage: mosquitto_sub -t 'inf1i-plantpot/publish/#' -F %x | telemetry-decoder
+ */
+#include <stdio.h>
+#include <string.h>
+#include <TelemetryCodec.h>
+#include <MessageWriter.h>
+
+#define DECODER_LINE_SIZE 1024 // The size of the longest line that is read, hexadecimal doubles the message length.
+#define DECODER_BUFFER_SIZE 512 // The size of an json message, BATCH_BUFFER_SIZE in Communication.h.
+
+/**
+ * Convert an hexadecimal digit into its value.
+ *
+ * @param character The digit.
+ * @return int - The value, -1 if the character isn't an digit.
+ */
+int readHexDigit( char character )
+{
+    if( character >= '0' && character <= '9' )
+    {
+        return character - '0';
+    }
+    if( character >= 'a' && character <= 'f' )
+    {
+        return character - 'a' + 10;
+    }
+    if( character >= 'A' && character <= 'F' )
+    {
+        return character - 'A' + 10;
+    }
+    return -1;
+}
+
+/**
+ * Convert an line of hexadecimal digits into bytes.
+ *
+ * @param line      The line without the line ending.
+ * @param payload   The buffer for the bytes.
+ * @param size      The size of the buffer.
+ * @return int - The amount of bytes, -1 if the line isn't hexadecimal or too long.
+ */
+int readHexPayload( const char *line, uint8_t *payload, size_t size )
+{
+    size_t length = strlen( line );
+    if( length % 2 != 0 || length / 2 > size )
+    {
+        return -1;
+    }
+
+    for( size_t i = 0; i < length / 2; i++ )
+    {
+        int high = readHexDigit( line[2 * i] );
+        int low = readHexDigit( line[2 * i + 1] );
+        if( high < 0 || low < 0 )
+        {
+            return -1;
+        }
+        payload[i] = (uint8_t)( high << 4 | low );
+    }
+    return (int)( length / 2 );
+}
+
+/**
+ * Write an binary message as the json message the pot would have published, with the fields
+ * in the same order.
+ *
+ * @param message   The decoded message.
+ * @param payload   The binary message, the samples of an batch are read from it.
+ * @param writer    The writer of the json message.
+ * @return bool - False when the message didn't fit in the buffer.
+ */
+bool writeJsonMessage( const TelemetryMessage &message, const uint8_t *payload, MessageWriter &writer )
+{
+    char mac[MAC_ADDRESS_LENGTH];
+    snprintf( mac, sizeof( mac ), "%02X:%02X:%02X:%02X:%02X:%02X",
+              message.mac[0], message.mac[1], message.mac[2], message.mac[3], message.mac[4], message.mac[5] );
+
+    writer.begin();
+    writer.addText( "mac", mac );
+    if( message.type == TELEMETRY_TYPE_WARNING )
+    {
+        writer.addFlashText( "type", "warning-mesg" );
+        writer.addUnsigned( "counter", message.counter );
+        writer.addUnsigned( "channel", message.channel );
+        writer.addUnsigned( "warning", message.warning, true );
+        return writer.end();
+    }
+
+    if( message.type == TELEMETRY_TYPE_BATCH )
+    {
+        writer.addFlashText( "type", "potstats-batch" );
+        writer.addUnsigned( "counter", message.counter );
+        writer.addSigned( "hoursLeft", message.hoursLeft );
+        writer.addUnsigned( "interval", message.interval );
+        writer.beginArray( "samples" );
+        for( uint8_t i = 0; i < message.sampleCount; i++ )
+        {
+            TelemetrySample sample;
+            TelemetryCodec::decodeSample( payload, i, sample );
+            writer.beginArray();
+            writer.addUnsignedElement( sample.time );
+            writer.addUnsignedElement( sample.channel );
+            writer.addSignedElement( sample.moisture );
+            writer.addSignedElement( sample.waterLevel );
+            if( message.flags & TELEMETRY_FLAG_DISPENSED )
+            {
+                writer.addUnsignedElement( sample.dispensed );
+            }
+            writer.endArray();
+        }
+        writer.endArray();
+        return writer.end();
+    }
+
+    writer.addFlashText( "type", "potstats-mesg" );
+    writer.addUnsigned( "counter", message.counter );
+    writer.addUnsigned( "channel", message.channel );
+    writer.addSigned( "moisture", message.moisture );
+    writer.addSigned( "waterLevel", message.waterLevel );
+    if( message.flags & TELEMETRY_FLAG_TIME )
+    {
+        writer.addUnsigned( "time", message.time );
+    }
+    else
+    {
+        writer.addSigned( "hoursLeft", message.hoursLeft );
+        writer.addUnsigned( "interval", message.interval );
+    }
+    if( message.flags & TELEMETRY_FLAG_DISPENSED )
+    {
+        writer.addUnsigned( "dispensed", message.dispensed );
+    }
+    return writer.end();
+}
+
+int main()
+{
+    char line[DECODER_LINE_SIZE];
+    uint8_t payload[DECODER_LINE_SIZE / 2 + 1];
+    char json[DECODER_BUFFER_SIZE];
+    MessageWriter writer( json, DECODER_BUFFER_SIZE );
+    unsigned long lineNumber = 0;
+    int failures = 0;
+
+    while( fgets( line, sizeof( line ), stdin ) != nullptr )
+    {
+        lineNumber++;
+        line[strcspn( line, "\r\n" )] = '\0';
+        if( line[0] == '\0' )
+        {
+            continue;
+        }
+        if( line[0] == '{' )
+        {
+            puts( line );
+            continue;
+        }
+
+        int length = readHexPayload( line, payload, DECODER_LINE_SIZE / 2 );
+        TelemetryMessage message;
+        if( length > 0 && payload[0] == '{' )
+        {
+            payload[length] = '\0';
+            puts( (const char*) payload );
+        }
+        else if( length > 0 && TelemetryCodec::decode( payload, (uint16_t) length, message ) && writeJsonMessage( message, payload, writer ))
+        {
+            puts( json );
+        }
+        else
+        {
+            fprintf( stderr, "Unable to decode line %lu: %s\n", lineNumber, line );
+            failures++;
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,332 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ *
+ * This benchmark compares the generated config decoders with the ArduinoJson parser they
+ * replaced. The ArduinoJson path parses the message into an DynamicJsonBuffer and reads every
+ * setting by key like Communication::parseJsonData() did. It measures the real ArduinoJson 5
+ * when CMake is given its source directory in ARDUINOJSON_DIR, otherwise the host version of the
+ * library in framework/ that the simulator uses. The heap is measured by replacing malloc and
+ * free of glibc, ArduinoJson allocates its buffer with malloc and the host version with new.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#ifdef __GLIBC__
+#include <malloc.h>
+#define BENCHMARK_HAS_HEAP 1
+#endif
+#include <ArduinoJson.h>
+#include <ConfigDecoder.h>
+#include <ConfigSchemas.h>
+
+#define BENCHMARK_MESSAGES 500000 // The amount of messages every decoder decodes per kind of message.
+#define BENCHMARK_BUFFER_SIZE 256 // The size of the receive buffer, RECEIVE_BUFFER_SIZE in Communication.h.
+#define BENCHMARK_MAC_ADDRESS "5C:CF:7F:19:9C:39" // The mac address of the pot that decodes the messages.
+
+#ifdef BENCHMARK_ARDUINOJSON_LIBRARY
+#define BENCHMARK_ARDUINOJSON_NAME "ArduinoJson 5"
+#else
+#define BENCHMARK_ARDUINOJSON_NAME "ArduinoJson (host)"
+#endif
+
+static size_t heapInUse = 0; // The bytes allocated on the heap right now.
+static size_t heapPeak = 0; // The most bytes that were allocated at the same time since the last reset.
+static unsigned long heapAllocations = 0; // The amount of heap allocations since the start.
+
+#ifdef BENCHMARK_HAS_HEAP
+extern "C" void *__libc_malloc( size_t size );
+extern "C" void *__libc_calloc( size_t count, size_t size );
+extern "C" void *__libc_realloc( void *memory, size_t size );
+extern "C" void __libc_free( void *memory );
+
+/**
+ * This function adds an allocation to the heap counters.
+ *
+ * @param memory    The allocated memory, nullptr when the allocation failed.
+ */
+static void countAllocation( void *memory )
+{
+    if( memory != nullptr )
+    {
+        heapAllocations++;
+        heapInUse += malloc_usable_size( memory );
+        heapPeak = heapInUse > heapPeak ? heapInUse : heapPeak;
+    }
+}
+
+/**
+ * This function removes an allocation from the heap counters.
+ *
+ * @param memory    The memory that is freed, nullptr is ignored.
+ */
+static void countFree( void *memory )
+{
+    if( memory != nullptr )
+    {
+        heapInUse -= malloc_usable_size( memory );
+    }
+}
+
+extern "C" void *malloc( size_t size )
+{
+    void *memory = __libc_malloc( size );
+    countAllocation( memory );
+    return memory;
+}
+
+extern "C" void *calloc( size_t count, size_t size )
+{
+    void *memory = __libc_calloc( count, size );
+    countAllocation( memory );
+    return memory;
+}
+
+extern "C" void *realloc( void *memory, size_t size )
+{
+    countFree( memory );
+    void *resized = __libc_realloc( memory, size );
+    countAllocation( resized != nullptr ? resized : ( size > 0 ? memory : nullptr ));
+    return resized;
+}
+
+extern "C" void free( void *memory )
+{
+    countFree( memory );
+    __libc_free( memory );
+}
+#endif
+
+/**
+ * Data structure that contains an configuration message and its schema.
+ */
+struct BenchmarkMessage
+{
+    const char *name; // The name of the message.
+    const ConfigSchema *schema; // The schema of the message.
+    const char *json; // The message like the backend sends it.
+};
+
+/**
+ * Data structure that contains the settings every kind of message is decoded into.
+ */
+struct DecodedSettings
+{
+    LedConfigMessage led; // The settings of an led-config message.
+    MqttConfigMessage mqtt; // The settings of an mqtt-config message.
+    PlantCareConfigMessage plantCare; // The settings of an plant-config message.
+    WarningConfigMessage warning; // The settings of an warning-conf message.
+};
+
+/**
+ * Data structure that contains the result of an decoder.
+ */
+struct DecoderResult
+{
+    double nanoseconds; // The average time in nanoseconds per message.
+    double allocations; // The average heap allocations per message.
+    size_t peakHeap; // The most heap in bytes used while decoding one message.
+    unsigned long decoded; // The amount of accepted messages, so the work can't be optimized away.
+};
+
+static const BenchmarkMessage messages[] = {
+        { "led-config", &LED_CONFIG_SCHEMA, "{\"mac\":\"5c:cf:7f:19:9c:39\",\"red\":255,\"green\": 255,\"blue\":255}" },
+        { "mqtt-config", &MQTT_CONFIG_SCHEMA, "{\"mac\": \"5c:cf:7f:19:9c:39\",\"stat-interval\": 60,\"resend-interval\": 7200,\"ping-interval\": 60,\"publish-threshold\":30,\"encoding\": 0,\"batch-size\": 1,\"batch-latency\": 300000}" },
+        { "plant-config", &PLANT_CARE_CONFIG_SCHEMA, "{\"mac\":\"5c:cf:7f:19:9c:39\",\"moisture-need\":50,\"interval\":3600,\"contains-plant\":1}" },
+        { "warning-conf", &WARNING_CONFIG_SCHEMA, "{\"mac\":\"5c:cf:7f:19:9c:39\",\"type\":\"warning-conf\",\"warning\":\"LOW_RESORVOIR\",\"value\":50}" }
+};
+
+/**
+ * This function decodes an message with ArduinoJson like Communication::parseJsonData() did
+ * before the generated decoders. The mac address is compared without case like the decoders do.
+ *
+ * @param message   The kind of message.
+ * @param buffer    The receive buffer, ArduinoJson parses it in place.
+ * @param settings  The settings to decode the message into.
+ * @return bool - True if the message was accepted.
+ */
+bool decodeWithArduinoJson( const BenchmarkMessage &message, char *buffer, DecodedSettings &settings )
+{
+    DynamicJsonBuffer jsonBuffer( JSON_OBJECT_SIZE( 4 ) + 80 );
+    JsonObject &root = jsonBuffer.parseObject( buffer );
+
+    if( !root.success() || root["mac"] == false )
+    {
+        return false;
+    }
+    const char *mac = root["mac"];
+    if( strcasecmp( mac, BENCHMARK_MAC_ADDRESS ) != 0 )
+    {
+        return false;
+    }
+
+    if( message.schema == &LED_CONFIG_SCHEMA )
+    {
+        settings.led.led.red = (uint8_t) root["red"];
+        settings.led.led.green = (uint8_t) root["green"];
+        settings.led.led.blue = (uint8_t) root["blue"];
+    }
+    else if( message.schema == &MQTT_CONFIG_SCHEMA )
+    {
+        settings.mqtt.mqtt.statisticPublishInterval = (uint32_t) root["stat-interval"];
+        settings.mqtt.mqtt.resendWarningInterval = (uint32_t) root["resend-interval"];
+        settings.mqtt.mqtt.pingBrokerInterval = (uint32_t) root["ping-interval"];
+        settings.mqtt.mqtt.publishReservoirWarningThreshold = (uint8_t) root["publish-threshold"];
+        if( root.containsKey( "encoding" ) || root.containsKey( "batch-size" ) || root.containsKey( "batch-latency" ))
+        {
+            settings.mqtt.telemetry.encoding = root.containsKey( "encoding" ) ? (uint8_t) root["encoding"] : settings.mqtt.telemetry.encoding;
+            settings.mqtt.telemetry.batchSize = root.containsKey( "batch-size" ) ? (uint8_t) root["batch-size"] : settings.mqtt.telemetry.batchSize;
+            settings.mqtt.telemetry.batchLatency = root.containsKey( "batch-latency" ) ? (uint32_t) root["batch-latency"] : settings.mqtt.telemetry.batchLatency;
+        }
+    }
+    else if( message.schema == &PLANT_CARE_CONFIG_SCHEMA )
+    {
+        settings.plantCare.plantCare.groundMoistureOptimal = (uint8_t) root["moisture-need"];
+        settings.plantCare.plantCare.takeMeasurementInterval = (uint32_t) root["interval"];
+        settings.plantCare.plantCare.containsPlant = (uint8_t) root["contains-plant"];
+    }
+    else
+    {
+        const char *warning = root["warning"];
+        if( warning == nullptr || strcmp( warning, "LOW_RESORVOIR" ) != 0 )
+        {
+            return false;
+        }
+        settings.warning.mqtt.publishReservoirWarningThreshold = (uint8_t) root["value"];
+    }
+    return true;
+}
+
+/**
+ * This function decodes an message with its generated decoder.
+ *
+ * @param message   The kind of message.
+ * @param buffer    The receive buffer.
+ * @param length    The length of the message.
+ * @param settings  The settings to decode the message into.
+ * @return bool - True if the message was accepted.
+ */
+bool decodeWithSchema( const BenchmarkMessage &message, const char *buffer, uint16_t length, DecodedSettings &settings )
+{
+    void *decoded = message.schema == &LED_CONFIG_SCHEMA ? (void *) &settings.led :
+                    message.schema == &MQTT_CONFIG_SCHEMA ? (void *) &settings.mqtt :
+                    message.schema == &PLANT_CARE_CONFIG_SCHEMA ? (void *) &settings.plantCare : (void *) &settings.warning;
+    ConfigDecoder decoder( buffer, length );
+    return decoder.decode( *message.schema, BENCHMARK_MAC_ADDRESS, decoded ) == CONFIG_DECODE_OK;
+}
+
+/**
+ * This function checks if two decoders read the same settings.
+ *
+ * @param first     The settings read by the first decoder.
+ * @param second    The settings read by the second decoder.
+ * @return bool - True if every setting is the same.
+ */
+bool isSameSettings( const DecodedSettings &first, const DecodedSettings &second )
+{
+    return first.led.led.red == second.led.led.red && first.led.led.green == second.led.led.green && first.led.led.blue == second.led.led.blue &&
+           first.mqtt.mqtt.statisticPublishInterval == second.mqtt.mqtt.statisticPublishInterval &&
+           first.mqtt.mqtt.resendWarningInterval == second.mqtt.mqtt.resendWarningInterval &&
+           first.mqtt.mqtt.pingBrokerInterval == second.mqtt.mqtt.pingBrokerInterval &&
+           first.mqtt.mqtt.publishReservoirWarningThreshold == second.mqtt.mqtt.publishReservoirWarningThreshold &&
+           first.mqtt.telemetry.encoding == second.mqtt.telemetry.encoding &&
+           first.mqtt.telemetry.batchSize == second.mqtt.telemetry.batchSize &&
+           first.mqtt.telemetry.batchLatency == second.mqtt.telemetry.batchLatency &&
+           first.plantCare.plantCare.groundMoistureOptimal == second.plantCare.plantCare.groundMoistureOptimal &&
+           first.plantCare.plantCare.takeMeasurementInterval == second.plantCare.plantCare.takeMeasurementInterval &&
+           first.plantCare.plantCare.containsPlant == second.plantCare.plantCare.containsPlant &&
+           first.warning.mqtt.publishReservoirWarningThreshold == second.warning.mqtt.publishReservoirWarningThreshold;
+}
+
+/**
+ * This function decodes one message with the chosen decoder. The message is copied into the
+ * receive buffer first like the MQTT client does, ArduinoJson changes the buffer while it parses.
+ *
+ * @param message       The kind of message.
+ * @param useSchema     True to use the generated decoder, false for ArduinoJson.
+ * @param settings      The settings to decode the message into.
+ * @return bool - True if the message was accepted.
+ */
+bool decode( const BenchmarkMessage &message, bool useSchema, DecodedSettings &settings )
+{
+    char buffer[BENCHMARK_BUFFER_SIZE];
+    uint16_t length = (uint16_t) strlen( message.json );
+
+    memcpy( buffer, message.json, length + 1 );
+    return useSchema ? decodeWithSchema( message, buffer, length, settings ) : decodeWithArduinoJson( message, buffer, settings );
+}
+
+/**
+ * This function runs an decoder on an kind of message and measures it.
+ *
+ * @param message   The kind of message.
+ * @param useSchema True to measure the generated decoder, false for ArduinoJson.
+ * @return DecoderResult - The measurements.
+ */
+DecoderResult measure( const BenchmarkMessage &message, bool useSchema )
+{
+    DecodedSettings settings = {};
+    DecoderResult result;
+
+    size_t heapBefore = heapInUse;
+    heapPeak = heapInUse;
+    decode( message, useSchema, settings );
+    result.peakHeap = heapPeak - heapBefore;
+
+    result.decoded = 0;
+    unsigned long allocationsBefore = heapAllocations;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    for( uint32_t i = 0; i < BENCHMARK_MESSAGES; i++ )
+    {
+        result.decoded += decode( message, useSchema, settings ) ? 1 : 0;
+    }
+
+    std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+    result.nanoseconds = std::chrono::duration<double, std::nano>( stop - start ).count() / BENCHMARK_MESSAGES;
+    result.allocations = (double)( heapAllocations - allocationsBefore ) / BENCHMARK_MESSAGES;
+    return result;
+}
+
+/**
+ * Check that both decoders read the same settings from the messages and print the measurements.
+ */
+int main()
+{
+    DecodedSettings expected = {};
+    DecodedSettings actual = {};
+    const uint8_t messageCount = sizeof( messages ) / sizeof( messages[0] );
+
+    for( uint8_t i = 0; i < messageCount; i++ )
+    {
+        if( !decode( messages[i], false, expected ) || !decode( messages[i], true, actual ))
+        {
+            printf( "An decoder rejected the %s message: %s\n", messages[i].name, messages[i].json );
+            return 1;
+        }
+    }
+    if( !isSameSettings( expected, actual ))
+    {
+        printf( "The decoders read different settings from the messages.\n" );
+        return 1;
+    }
+
+    printf( "%-14s %-20s %12s %22s %16s\n", "Message", "Decoder", "ns/message", "allocations/message", "peak heap bytes" );
+    for( uint8_t i = 0; i < messageCount; i++ )
+    {
+        DecoderResult parsed = measure( messages[i], false );
+        DecoderResult decoded = measure( messages[i], true );
+        if( parsed.decoded != BENCHMARK_MESSAGES || decoded.decoded != BENCHMARK_MESSAGES )
+        {
+            return 1;
+        }
+
+        printf( "%-14s %-20s %12.1f %22.2f %16lu\n", messages[i].name, BENCHMARK_ARDUINOJSON_NAME, parsed.nanoseconds, parsed.allocations, (unsigned long) parsed.peakHeap );
+        printf( "%-14s %-20s %12.1f %22.2f %16lu\n", messages[i].name, "Generated decoder", decoded.nanoseconds, decoded.allocations, (unsigned long) decoded.peakHeap );
+        printf( "%-14s Speed up: %.1fx\n", "", parsed.nanoseconds / decoded.nanoseconds );
+    }
+#ifndef BENCHMARK_HAS_HEAP
+    printf( "\nThe heap isn't measured on this host, malloc can only be replaced on glibc.\n" );
+#endif
+    return 0;
+}
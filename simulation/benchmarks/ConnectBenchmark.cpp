@@ -0,0 +1,412 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ *
+ * This benchmark compares the connection to the broker before and after the fingerprint check
+ * moved into the handshake of the mqtt connection. The pot used to open an TLS connection only
+ * to verify the fingerprint of the broker and then opened the mqtt connection with an second
+ * full handshake. Now it opens one connection, checks the fingerprint during its handshake and
+ * resumes the session of the previous connection on every reconnect. The broker stand in is an
+ * OpenSSL server in an thread of the benchmark with an self signed RSA 2048 certificate and an
+ * session cache, it answers the MQTT CONNECT packet with an CONNACK. Both sides are limited to
+ * what BearSSL on the ESP8266 supports: TLS 1.2 and session ids, BearSSL doesn't do tickets.
+ * The host is about two orders of magnitude faster than the ESP8266, the ratio between the
+ * modes is what carries over.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+
+#define BENCHMARK_RECONNECTS 200 // The amount of reconnects measured per mode.
+#define BENCHMARK_HOST "mqtt.inf1i.ga" // The common name of the certificate, MQTT_BROKER_HOST in Communication.h.
+#define BENCHMARK_CIPHERS "ECDHE-RSA-AES128-GCM-SHA256:AES128-SHA256" // Cipher suites BearSSL offers for an RSA certificate.
+#define BENCHMARK_SESSION_TIMEOUT 86400 // The lifetime in seconds of an session in the cache of the broker.
+
+/**
+ * The MQTT 3.1.1 CONNECT packet of the pot, with the client id, username and password.
+ */
+static const unsigned char connectPacket[] = {
+    0x10, 0x32, 0x00, 0x04, 'M', 'Q', 'T', 'T', 0x04, 0xC2, 0x01, 0x2C,
+    0x00, 0x0C, 'w', 'a', 't', 'e', 'r', 'u', 'p', '-', 'p', 'o', 't', '1',
+    0x00, 0x0E, 'i', 'n', 'f', '1', 'i', '-', 'p', 'l', 'a', 'n', 't', 'p', 'o', 't',
+    0x00, 0x08, 'p', 'a', 's', 's', 'w', 'o', 'r', 'd'
+};
+
+static const unsigned char connackPacket[] = { 0x20, 0x02, 0x00, 0x00 }; // The CONNACK packet of an accepted connection.
+
+/**
+ * Data structure that contains the measurements of one mode.
+ */
+struct ConnectResult
+{
+    double bootMilliseconds; // The time of the first connection after an power up.
+    double medianMilliseconds; // The median time of an reconnect.
+    double cpuMilliseconds; // The average cpu time of the pot side of an reconnect.
+    unsigned long fullHandshakes; // The amount of handshakes with an key exchange.
+    unsigned long resumedHandshakes; // The amount of handshakes that resumed an session.
+};
+
+/**
+ * This function reads the cpu time of the calling thread, the broker runs in an other thread.
+ *
+ * @return double - The cpu time in milliseconds.
+ */
+double readThreadTime()
+{
+    timespec time;
+    clock_gettime( CLOCK_THREAD_CPUTIME_ID, &time );
+    return time.tv_sec * 1000.0 + time.tv_nsec / 1000000.0;
+}
+
+/**
+ * This function creates the RSA key and the self signed certificate of the broker.
+ *
+ * @param key           The location to save the key.
+ * @param certificate   The location to save the certificate.
+ * @return bool - False when OpenSSL couldn't create them.
+ */
+bool createCertificate( EVP_PKEY **key, X509 **certificate )
+{
+    *key = EVP_RSA_gen( 2048 );
+    *certificate = X509_new();
+    if( *key == nullptr || *certificate == nullptr )
+    {
+        return false;
+    }
+
+    X509_set_version( *certificate, 2 );
+    ASN1_INTEGER_set( X509_get_serialNumber( *certificate ), 1 );
+    X509_gmtime_adj( X509_getm_notBefore( *certificate ), 0 );
+    X509_gmtime_adj( X509_getm_notAfter( *certificate ), 86400L * 365 );
+    X509_set_pubkey( *certificate, *key );
+
+    X509_NAME *name = X509_get_subject_name( *certificate );
+    X509_NAME_add_entry_by_txt( name, "CN", MBSTRING_ASC, (const unsigned char*) BENCHMARK_HOST, -1, -1, 0 );
+    X509_set_issuer_name( *certificate, name );
+    return X509_sign( *certificate, *key, EVP_sha256()) > 0;
+}
+
+/**
+ * This function limits an TLS context to what BearSSL on the ESP8266 supports.
+ *
+ * @param context   The context of the broker or the pot.
+ */
+void limitToBearSsl( SSL_CTX *context )
+{
+    SSL_CTX_set_min_proto_version( context, TLS1_2_VERSION );
+    SSL_CTX_set_max_proto_version( context, TLS1_2_VERSION );
+    SSL_CTX_set_cipher_list( context, BENCHMARK_CIPHERS );
+    SSL_CTX_set_options( context, SSL_OP_NO_TICKET );
+}
+
+/**
+ * This function reads exactly the requested amount of bytes from an TLS connection.
+ *
+ * @param connection    The connection.
+ * @param buffer        The buffer for the bytes.
+ * @param length        The amount of bytes.
+ * @return bool - False when the connection closed first.
+ */
+bool readFully( SSL *connection, unsigned char *buffer, int length )
+{
+    while( length > 0 )
+    {
+        int received = SSL_read( connection, buffer, length );
+        if( received <= 0 )
+        {
+            return false;
+        }
+        buffer += received;
+        length -= received;
+    }
+    return true;
+}
+
+/**
+ * This function runs the broker stand in. It handles one connection at the time: the handshake,
+ * the CONNECT packet and the CONNACK, then it waits for the pot to close the connection. An
+ * connection that only verifies the certificate closes right after the handshake.
+ *
+ * @param listener  The socket that accepts the connections.
+ * @param context   The TLS context with the certificate and the session cache.
+ */
+void runBroker( int listener, SSL_CTX *context )
+{
+    int socket;
+    while(( socket = accept( listener, nullptr, nullptr )) >= 0 )
+    {
+        SSL *connection = SSL_new( context );
+        SSL_set_fd( connection, socket );
+
+        unsigned char header[2];
+        unsigned char body[128];
+        if( SSL_accept( connection ) == 1 && readFully( connection, header, 2 ) && header[1] < sizeof( body ) && readFully( connection, body, header[1] ))
+        {
+            SSL_write( connection, connackPacket, sizeof( connackPacket ));
+            SSL_read( connection, body, sizeof( body )); // Wait for the pot to close the connection.
+        }
+        SSL_shutdown( connection );
+        SSL_free( connection );
+        close( socket );
+    }
+}
+
+/**
+ * This function opens an TCP connection to the broker stand in.
+ *
+ * @param port  The port of the broker.
+ * @return int - The socket, -1 on failure.
+ */
+int openSocket( uint16_t port )
+{
+    int socket = ::socket( AF_INET, SOCK_STREAM, 0 );
+    int noDelay = 1;
+    setsockopt( socket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof( noDelay ));
+
+    sockaddr_in address;
+    memset( &address, 0, sizeof( address ));
+    address.sin_family = AF_INET;
+    address.sin_port = htons( port );
+    address.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+    if( connect( socket, (sockaddr*) &address, sizeof( address )) != 0 )
+    {
+        close( socket );
+        return -1;
+    }
+    return socket;
+}
+
+/**
+ * This function checks the SHA1 fingerprint of the certificate the broker sent, like
+ * WiFiClientSecure does with MQTT_BROKER_FINGERPRINT.
+ *
+ * @param connection    The connection after the handshake.
+ * @param expected      The fingerprint of the broker.
+ * @return bool - True if the fingerprint matches.
+ */
+bool verifyFingerprint( SSL *connection, const unsigned char *expected )
+{
+    unsigned char fingerprint[EVP_MAX_MD_SIZE];
+    unsigned int length = 0;
+    X509 *certificate = SSL_get1_peer_certificate( connection );
+    bool trusted = certificate != nullptr && X509_digest( certificate, EVP_sha1(), fingerprint, &length ) && memcmp( fingerprint, expected, length ) == 0;
+    X509_free( certificate );
+    return trusted;
+}
+
+/**
+ * This function opens one TLS connection to the broker stand in.
+ *
+ * @param context       The TLS context of the pot.
+ * @param port          The port of the broker.
+ * @param fingerprint   The fingerprint of the broker, nullptr to skip the check.
+ * @param session       The session to resume, nullptr for an full handshake, it is replaced by the new session.
+ * @param sendConnect   True to send the CONNECT packet and wait for the CONNACK.
+ * @param result        The handshake counters.
+ * @return bool - True if the connection was opened and accepted.
+ */
+bool openConnection( SSL_CTX *context, uint16_t port, const unsigned char *fingerprint, SSL_SESSION **session, bool sendConnect, ConnectResult *result )
+{
+    int socket = openSocket( port );
+    if( socket < 0 )
+    {
+        return false;
+    }
+
+    SSL *connection = SSL_new( context );
+    SSL_set_fd( connection, socket );
+    SSL_set_tlsext_host_name( connection, BENCHMARK_HOST );
+    if( session != nullptr && *session != nullptr )
+    {
+        SSL_set_session( connection, *session );
+    }
+
+    bool accepted = SSL_connect( connection ) == 1;
+    if( accepted && SSL_session_reused( connection ))
+    {
+        result->resumedHandshakes++; // The certificate was checked when the session was created.
+    }
+    else if( accepted )
+    {
+        result->fullHandshakes++;
+        accepted = fingerprint == nullptr || verifyFingerprint( connection, fingerprint );
+    }
+
+    if( accepted && sendConnect )
+    {
+        unsigned char connack[sizeof( connackPacket )];
+        accepted = SSL_write( connection, connectPacket, sizeof( connectPacket )) == sizeof( connectPacket ) && readFully( connection, connack, sizeof( connack )) && memcmp( connack, connackPacket, sizeof( connack )) == 0;
+    }
+
+    if( accepted && session != nullptr )
+    {
+        SSL_SESSION_free( *session );
+        *session = SSL_get1_session( connection );
+    }
+
+    SSL_shutdown( connection );
+    SSL_free( connection );
+    close( socket );
+    return accepted;
+}
+
+/**
+ * This function connects the pot like Communication::connect() did before the change: an
+ * connection that verifies the fingerprint and an second one for the mqtt connection, both
+ * with an full handshake.
+ *
+ * @param context       The TLS context of the pot.
+ * @param port          The port of the broker.
+ * @param fingerprint   The fingerprint of the broker.
+ * @param result        The handshake counters.
+ * @return bool - True if the pot is connected.
+ */
+bool connectBefore( SSL_CTX *context, uint16_t port, const unsigned char *fingerprint, ConnectResult *result )
+{
+    return openConnection( context, port, fingerprint, nullptr, false, result ) && openConnection( context, port, nullptr, nullptr, true, result );
+}
+
+/**
+ * This function connects the pot like Communication::connect() does now: one connection that
+ * checks the fingerprint during its handshake and resumes the session of the last connection.
+ *
+ * @param context       The TLS context of the pot.
+ * @param port          The port of the broker.
+ * @param fingerprint   The fingerprint of the broker.
+ * @param session       The session of the last connection, like the tlsSession in Communication.cpp.
+ * @param result        The handshake counters.
+ * @return bool - True if the pot is connected.
+ */
+bool connectAfter( SSL_CTX *context, uint16_t port, const unsigned char *fingerprint, SSL_SESSION **session, ConnectResult *result )
+{
+    return openConnection( context, port, fingerprint, session, true, result );
+}
+
+/**
+ * This function measures the connection after an power up and BENCHMARK_RECONNECTS reconnects.
+ *
+ * @param context       The TLS context of the pot.
+ * @param port          The port of the broker.
+ * @param fingerprint   The fingerprint of the broker.
+ * @param resume        True to measure the connection with session resumption.
+ * @param result        The measurements.
+ * @return bool - False when an connection failed.
+ */
+bool measure( SSL_CTX *context, uint16_t port, const unsigned char *fingerprint, bool resume, ConnectResult *result )
+{
+    std::vector<double> latencies;
+    SSL_SESSION *session = nullptr; // The session is lost at an power up.
+    double cpuTime = 0;
+    memset( result, 0, sizeof( ConnectResult ));
+
+    for( int connection = 0; connection <= BENCHMARK_RECONNECTS; connection++ )
+    {
+        double cpuBefore = readThreadTime();
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        bool connected = resume ? connectAfter( context, port, fingerprint, &session, result ) : connectBefore( context, port, fingerprint, result );
+
+        double milliseconds = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
+        if( !connected )
+        {
+            SSL_SESSION_free( session );
+            return false;
+        }
+
+        if( connection == 0 )
+        {
+            result->bootMilliseconds = milliseconds;
+            continue;
+        }
+        latencies.push_back( milliseconds );
+        cpuTime += readThreadTime() - cpuBefore;
+    }
+
+    std::sort( latencies.begin(), latencies.end());
+    result->medianMilliseconds = latencies[latencies.size() / 2];
+    result->cpuMilliseconds = cpuTime / BENCHMARK_RECONNECTS;
+    SSL_SESSION_free( session );
+    return true;
+}
+
+/**
+ * Start the broker stand in, measure both modes and print the measurements.
+ */
+int main()
+{
+    EVP_PKEY *key = nullptr;
+    X509 *certificate = nullptr;
+    if( !createCertificate( &key, &certificate ))
+    {
+        printf( "Unable to create the certificate of the broker.\n" );
+        return 1;
+    }
+
+    unsigned char fingerprint[EVP_MAX_MD_SIZE];
+    unsigned int fingerprintLength = 0;
+    X509_digest( certificate, EVP_sha1(), fingerprint, &fingerprintLength );
+
+    SSL_CTX *brokerContext = SSL_CTX_new( TLS_server_method());
+    limitToBearSsl( brokerContext );
+    SSL_CTX_use_certificate( brokerContext, certificate );
+    SSL_CTX_use_PrivateKey( brokerContext, key );
+    SSL_CTX_set_session_id_context( brokerContext, (const unsigned char*) "waterup", 7 );
+    SSL_CTX_set_timeout( brokerContext, BENCHMARK_SESSION_TIMEOUT );
+
+    SSL_CTX *potContext = SSL_CTX_new( TLS_client_method());
+    limitToBearSsl( potContext );
+    SSL_CTX_set_verify( potContext, SSL_VERIFY_NONE, nullptr ); // The fingerprint is checked instead, like on the pot.
+
+    int listener = socket( AF_INET, SOCK_STREAM, 0 );
+    sockaddr_in address;
+    socklen_t addressLength = sizeof( address );
+    memset( &address, 0, sizeof( address ));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+    if( bind( listener, (sockaddr*) &address, sizeof( address )) != 0 || listen( listener, 4 ) != 0 || getsockname( listener, (sockaddr*) &address, &addressLength ) != 0 )
+    {
+        printf( "Unable to start the broker stand in.\n" );
+        return 1;
+    }
+    uint16_t port = ntohs( address.sin_port );
+    std::thread broker( runBroker, listener, brokerContext );
+
+    ConnectResult before;
+    ConnectResult after;
+    bool measured = measure( potContext, port, fingerprint, false, &before ) && measure( potContext, port, fingerprint, true, &after );
+
+    shutdown( listener, SHUT_RDWR ); // Stops the accept loop of the broker.
+    broker.join();
+    close( listener );
+
+    if( !measured )
+    {
+        printf( "An connection to the broker stand in failed.\n" );
+        ERR_print_errors_fp( stdout );
+        return 1;
+    }
+
+    printf( "Broker stand in on 127.0.0.1:%u, RSA 2048, TLS 1.2, %d reconnects per mode\n\n", (unsigned) port, BENCHMARK_RECONNECTS );
+    printf( "%-34s %10s %16s %16s %8s %8s\n", "Connection", "boot ms", "reconnect ms", "pot cpu ms", "full", "resumed" );
+    printf( "%-34s %10.2f %16.2f %16.2f %8lu %8lu\n", "verify + connect (before)", before.bootMilliseconds, before.medianMilliseconds, before.cpuMilliseconds, before.fullHandshakes, before.resumedHandshakes );
+    printf( "%-34s %10.2f %16.2f %16.2f %8lu %8lu\n", "connect + resume session (after)", after.bootMilliseconds, after.medianMilliseconds, after.cpuMilliseconds, after.fullHandshakes, after.resumedHandshakes );
+    printf( "\nReconnect speed up: %.1fx latency, %.1fx pot cpu time\n", before.medianMilliseconds / after.medianMilliseconds, before.cpuMilliseconds / after.cpuMilliseconds );
+
+    SSL_CTX_free( potContext );
+    SSL_CTX_free( brokerContext );
+    X509_free( certificate );
+    EVP_PKEY_free( key );
+    return after.resumedHandshakes == BENCHMARK_RECONNECTS ? 0 : 1;
+}
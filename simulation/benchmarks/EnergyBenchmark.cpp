@@ -0,0 +1,145 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ *
+ * This benchmark simulates one day of the pot and compares the average current of the
+ * always on main loop with the deep sleep duty cycle mode. The duty cycle is planned by the
+ * same DutyCyclePlanner the pot uses, the currents and durations below are the figures from
+ * the ESP8266 datasheet and measurements on an D1 mini. The water pump and the led's are left
+ * out, they draw the same in both modes or are switched off on batteries.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "DutyCyclePlanner.h"
+
+#define SIMULATED_TIME 86400000ULL // The simulated time in milliseconds (one day).
+#define DEFAULT_MEASURE_INTERVAL_S 60 // The default measurement interval in seconds from Configuration.h.
+#define BATTERY_CAPACITY_MAH 2500.0 // The capacity of the battery pack used to estimate the run time.
+
+// Always on mode, connected to the WiFi network with modem sleep between the tasks.
+#define ALWAYS_ON_IDLE_CURRENT_MA 15.0 // Modem sleep current while waiting for the next task.
+#define ALWAYS_ON_ACTIVE_CURRENT_MA 75.0 // Current while the cpu and receiver are active.
+#define ALWAYS_ON_LISTEN_INTERVAL 100 // The interval in milliseconds the pot listens for messages.
+#define ALWAYS_ON_LISTEN_TIME 10 // The time in milliseconds the pot listens for messages.
+#define ALWAYS_ON_PUBLISH_TIME 40 // The time in milliseconds an publication over the open connection takes.
+#define ALWAYS_ON_MEASURE_TIME 5 // The time in milliseconds an measurement takes.
+
+// Duty cycle mode.
+#define DEEP_SLEEP_CURRENT_MA 0.02 // Deep sleep current of the ESP8266.
+#define WAKE_RADIO_OFF_CURRENT_MA 15.0 // Current after an wake up with the radio disabled.
+#define WAKE_RADIO_OFF_TIME 250 // Boot, measure and go back to sleep with the radio disabled.
+#define WAKE_RADIO_ON_CURRENT_MA 80.0 // Average current while connecting and publishing.
+#define WAKE_RADIO_ON_TIME 4200 // Boot, WiFi association, TLS handshake, publish and listen.
+
+/**
+ * Data structure that contains the result of an simulated day.
+ */
+struct EnergyResult
+{
+    double averageCurrent; // The average current in milliampere.
+    unsigned long wakeUps; // The amount of wake ups, 0 for the always on mode.
+    unsigned long radioWakeUps; // The amount of wake ups with the radio enabled.
+    unsigned long publications; // The amount of statistic publications.
+};
+
+/**
+ * Simulate one day of the always on main loop. The pot listens for messages every
+ * listen interval and wakes the cpu for every measurement and publication.
+ *
+ * @param intervals The configured intervals.
+ * @return EnergyResult - The result of the simulated day.
+ */
+EnergyResult simulateAlwaysOn( const DutyCycleIntervals &intervals )
+{
+    EnergyResult result;
+    memset( &result, 0, sizeof( result ));
+
+    double listenTime = (double) SIMULATED_TIME / ALWAYS_ON_LISTEN_INTERVAL * ALWAYS_ON_LISTEN_TIME;
+    double measureTime = (double) SIMULATED_TIME / intervals.measurementInterval * ALWAYS_ON_MEASURE_TIME;
+    result.publications = (unsigned long)( SIMULATED_TIME / intervals.statisticInterval );
+    double publishTime = (double) result.publications * ALWAYS_ON_PUBLISH_TIME;
+
+    double activeTime = listenTime + measureTime + publishTime;
+    double idleTime = SIMULATED_TIME - activeTime;
+    result.averageCurrent = ( activeTime * ALWAYS_ON_ACTIVE_CURRENT_MA + idleTime * ALWAYS_ON_IDLE_CURRENT_MA ) / SIMULATED_TIME;
+    return result;
+}
+
+/**
+ * Simulate one day of the duty cycle mode with the planner of the pot. Every wake up takes
+ * the due measurements, publishes when the radio is enabled and sleeps until the next deadline.
+ *
+ * @param intervals The configured intervals.
+ * @return EnergyResult - The result of the simulated day.
+ */
+EnergyResult simulateDutyCycle( const DutyCycleIntervals &intervals )
+{
+    EnergyResult result;
+    memset( &result, 0, sizeof( result ));
+
+    RtcPotState state;
+    memset( &state, 0, sizeof( state ));
+    state.radioEnabled = 1;
+
+    double chargeMaMs = 0;
+    uint64_t now = 0;
+
+    while( now < SIMULATED_TIME )
+    {
+        uint32_t awakeTime = state.radioEnabled ? WAKE_RADIO_ON_TIME : WAKE_RADIO_OFF_TIME;
+        chargeMaMs += awakeTime * ( state.radioEnabled ? WAKE_RADIO_ON_CURRENT_MA : WAKE_RADIO_OFF_CURRENT_MA );
+        result.wakeUps++;
+        result.radioWakeUps += state.radioEnabled;
+
+        if( DutyCyclePlanner::isMeasurementDue( state, intervals, now ))
+        {
+            state.lastMeasurementTime = now;
+        }
+        if( state.radioEnabled && DutyCyclePlanner::isStatisticDue( state, intervals, now ))
+        {
+            state.lastPublishStatisticsTime = now;
+            result.publications++;
+        }
+
+        now += awakeTime;
+        bool radioNeeded = false;
+        uint32_t sleepTime = DutyCyclePlanner::computeSleepTime( state, intervals, now, &radioNeeded );
+        chargeMaMs += sleepTime * DEEP_SLEEP_CURRENT_MA;
+        now += sleepTime;
+        state.radioEnabled = radioNeeded ? 1 : 0;
+    }
+
+    result.averageCurrent = chargeMaMs / now;
+    return result;
+}
+
+/**
+ * Run the simulation for the default configuration and several longer publish intervals
+ * and print the average current and the estimated battery life of both modes.
+ */
+int main()
+{
+    const uint32_t publishIntervals[] = { 10000, 60000, 300000, 900000, 3600000 };
+
+    printf( "Simulated time: 24h, measurement interval: %u s, battery: %.0f mAh\n\n", DEFAULT_MEASURE_INTERVAL_S, BATTERY_CAPACITY_MAH );
+    printf( "%-18s | %-28s | %-40s\n", "publish interval", "always on", "duty cycle" );
+    printf( "%-18s | %9s %8s %9s | %9s %8s %8s %6s %7s\n", "", "avg mA", "days", "messages", "avg mA", "days", "wakeups", "radio", "saving" );
+
+    for( unsigned i = 0; i < sizeof( publishIntervals ) / sizeof( publishIntervals[0] ); i++ )
+    {
+        DutyCycleIntervals intervals;
+        intervals.measurementInterval = DEFAULT_MEASURE_INTERVAL_S * 1000;
+        intervals.statisticInterval = publishIntervals[i];
+        intervals.warningInterval = 7200000;
+        intervals.sleepAfterGivingWater = 3600000;
+
+        EnergyResult alwaysOn = simulateAlwaysOn( intervals );
+        EnergyResult dutyCycle = simulateDutyCycle( intervals );
+
+        printf( "%15u s  | %9.3f %8.1f %9lu | %9.3f %8.1f %8lu %6lu %6.1fx\n",
+                publishIntervals[i] / 1000,
+                alwaysOn.averageCurrent, BATTERY_CAPACITY_MAH / alwaysOn.averageCurrent / 24, alwaysOn.publications,
+                dutyCycle.averageCurrent, BATTERY_CAPACITY_MAH / dutyCycle.averageCurrent / 24, dutyCycle.wakeUps,
+                dutyCycle.radioWakeUps, alwaysOn.averageCurrent / dutyCycle.averageCurrent );
+    }
+    return 0;
+}
@@ -0,0 +1,182 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ *
+ * This benchmark compares the MessageWriter with the snprintf serializer it replaced. The old
+ * serializer asked WiFi.macAddress() for an new String for every message and filled an format
+ * string, the host std::string stands in for the Arduino String and allocates the same way
+ * because an mac address is longer than the small string buffer. Every heap allocation of the
+ * benchmark is counted by replacing the global operator new. The cycles are read from the
+ * time stamp counter on x86, on other hosts only the time is reported.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include <string>
+#include <chrono>
+#if defined( __x86_64__ ) || defined( __i386__ )
+#include <x86intrin.h>
+#define BENCHMARK_HAS_TSC 1
+#endif
+#include "MessageWriter.h"
+
+#define BENCHMARK_MESSAGES 2000000 // The amount of statistic messages every serializer writes.
+#define BENCHMARK_BUFFER_SIZE 200 // The size of the send buffer, JSON_BUFFER_SIZE in Communication.h.
+#define BENCHMARK_MAC_ADDRESS "5C:CF:7F:19:9C:39" // The mac address written into every message.
+
+static unsigned long heapAllocations = 0; // The amount of heap allocations since the start.
+
+void *operator new( size_t size )
+{
+    heapAllocations++;
+    void *memory = malloc( size > 0 ? size : 1 );
+    if( memory == nullptr )
+    {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void operator delete( void *memory ) noexcept
+{
+    free( memory );
+}
+
+void operator delete( void *memory, size_t size ) noexcept
+{
+    free( memory );
+}
+
+/**
+ * Data structure that contains the result of an serializer.
+ */
+struct SerializerResult
+{
+    double nanoseconds; // The average time in nanoseconds per message.
+    double cycles; // The average time stamp counter cycles per message, 0 without an counter.
+    double allocations; // The average heap allocations per message.
+    unsigned long bytes; // The total length of the messages, so the work can't be optimized away.
+};
+
+/**
+ * This function returns the mac address like WiFi.macAddress() does, as an new string.
+ *
+ * @return std::string - The formatted mac address.
+ */
+std::string readMacAddress()
+{
+    return std::string( BENCHMARK_MAC_ADDRESS );
+}
+
+/**
+ * This function writes an statistic message like the pot did before the MessageWriter.
+ *
+ * @param buffer    The send buffer.
+ * @param counter   The message counter.
+ * @return int - The length of the message.
+ */
+int writeWithSnprintf( char *buffer, uint32_t counter )
+{
+    static const char *format = "{\"mac\":\"%s\",\"type\":\"potstats-mesg\",\"counter\":%lu,\"channel\":%u,\"moisture\":%d,\"waterLevel\":%d,\"hoursLeft\":%d,\"interval\":%lu}";
+    return snprintf( buffer, BENCHMARK_BUFFER_SIZE, format, readMacAddress().c_str(), (unsigned long) counter, 0U, (int)( counter % 100 ), 73, -1, 3600000UL );
+}
+
+/**
+ * This function writes an statistic message like Communication::publishStatistic() does.
+ *
+ * @param writer    The writer of the send buffer.
+ * @param mac       The mac address that was formatted once.
+ * @param counter   The message counter.
+ * @return int - The length of the message.
+ */
+int writeWithMessageWriter( MessageWriter &writer, const char *mac, uint32_t counter )
+{
+    writer.begin();
+    writer.addText( PSTR( "mac" ), mac );
+    writer.addFlashText( PSTR( "type" ), PSTR( "potstats-mesg" ));
+    writer.addUnsigned( PSTR( "counter" ), counter );
+    writer.addUnsigned( PSTR( "channel" ), 0 );
+    writer.addSigned( PSTR( "moisture" ), (int32_t)( counter % 100 ));
+    writer.addSigned( PSTR( "waterLevel" ), 73 );
+    writer.addSigned( PSTR( "hoursLeft" ), -1 );
+    writer.addUnsigned( PSTR( "interval" ), 3600000UL );
+    writer.end();
+    return writer.getLength();
+}
+
+/**
+ * This function reads the time stamp counter.
+ *
+ * @return uint64_t - The cycles since the start of the cpu, 0 without an counter.
+ */
+uint64_t readCycles()
+{
+#ifdef BENCHMARK_HAS_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/**
+ * This function runs an serializer and measures it.
+ *
+ * @param useWriter True to measure the MessageWriter, false for snprintf.
+ * @return SerializerResult - The measurements.
+ */
+SerializerResult measure( bool useWriter )
+{
+    char buffer[BENCHMARK_BUFFER_SIZE];
+    char mac[MAC_ADDRESS_LENGTH];
+    MessageWriter writer( buffer, BENCHMARK_BUFFER_SIZE );
+    SerializerResult result;
+    result.bytes = 0;
+
+    strncpy( mac, readMacAddress().c_str(), MAC_ADDRESS_LENGTH - 1 ); // Formatted once, like in Communication::setup().
+    mac[MAC_ADDRESS_LENGTH - 1] = '\0'; // The buffer is on the stack, strncpy doesn't terminate an address that fills it.
+
+    unsigned long allocationsBefore = heapAllocations;
+    uint64_t cyclesBefore = readCycles();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    for( uint32_t counter = 0; counter < BENCHMARK_MESSAGES; counter++ )
+    {
+        result.bytes += useWriter ? writeWithMessageWriter( writer, mac, counter ) : writeWithSnprintf( buffer, counter );
+    }
+
+    std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+    uint64_t cyclesAfter = readCycles();
+
+    result.nanoseconds = std::chrono::duration<double, std::nano>( stop - start ).count() / BENCHMARK_MESSAGES;
+    result.cycles = (double)( cyclesAfter - cyclesBefore ) / BENCHMARK_MESSAGES;
+    result.allocations = (double)( heapAllocations - allocationsBefore ) / BENCHMARK_MESSAGES;
+    return result;
+}
+
+/**
+ * Check that both serializers write the same message and print the measurements.
+ */
+int main()
+{
+    char expected[BENCHMARK_BUFFER_SIZE];
+    char actual[BENCHMARK_BUFFER_SIZE];
+    MessageWriter writer( actual, BENCHMARK_BUFFER_SIZE );
+
+    writeWithSnprintf( expected, 12345 );
+    writeWithMessageWriter( writer, BENCHMARK_MAC_ADDRESS, 12345 );
+    if( strcmp( expected, actual ) != 0 )
+    {
+        printf( "The serializers write different messages:\n%s\n%s\n", expected, actual );
+        return 1;
+    }
+    printf( "Message (%u bytes): %s\n\n", (unsigned) strlen( actual ), actual );
+
+    SerializerResult formatted = measure( false );
+    SerializerResult written = measure( true );
+
+    printf( "%-20s %12s %16s %22s\n", "Serializer", "ns/message", "cycles/message", "allocations/message" );
+    printf( "%-20s %12.1f %16.0f %22.2f\n", "snprintf + String", formatted.nanoseconds, formatted.cycles, formatted.allocations );
+    printf( "%-20s %12.1f %16.0f %22.2f\n", "MessageWriter", written.nanoseconds, written.cycles, written.allocations );
+    printf( "\nSpeed up: %.1fx, %lu bytes written per serializer\n", formatted.nanoseconds / written.nanoseconds, written.bytes );
+    return formatted.bytes == written.bytes ? 0 : 1;
+}
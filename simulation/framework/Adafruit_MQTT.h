@@ -0,0 +1,75 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ *
+ * Host version of the Adafruit MQTT library used by the pot simulator. The messages go to
+ * the simulated broker instead of the network.
+ */
+#ifndef WATERUP_SIMULATION_ADAFRUIT_MQTT_H
+#define WATERUP_SIMULATION_ADAFRUIT_MQTT_H
+
+#include <Arduino.h>
+
+#define MAXSUBSCRIPTIONS 5
+#define SUBSCRIPTIONDATALEN 100
+#define MQTT_QOS_0 0
+#define MQTT_QOS_1 1
+
+typedef void (*SubscribeCallbackBufferType)( char *data, uint16_t length );
+
+class Client;
+
+class Adafruit_MQTT;
+
+/**
+ * This class is an subscription to an topic.
+ */
+class Adafruit_MQTT_Subscribe
+{
+public:
+    Adafruit_MQTT_Subscribe( Adafruit_MQTT *mqtt, const char *topic, uint8_t qos = 0 ) : topic( topic ), callback( nullptr ) {}
+    void setCallback( SubscribeCallbackBufferType callback ) { this->callback = callback; }
+
+    const char *topic; // The topic of the subscription.
+    SubscribeCallbackBufferType callback; // The function that receives the messages.
+};
+
+/**
+ * This class publishes messages to an topic.
+ */
+class Adafruit_MQTT_Publish
+{
+public:
+    Adafruit_MQTT_Publish( Adafruit_MQTT *mqtt, const char *topic, uint8_t qos = 0 ) : mqtt( mqtt ), topic( topic ) {}
+    bool publish( const char *message );
+    bool publish( uint8_t *payload, uint16_t length );
+
+private:
+    Adafruit_MQTT *mqtt; // The client the message is published with.
+    const char *topic; // The topic the message is published to.
+};
+
+/**
+ * This class is an connection to the simulated broker.
+ */
+class Adafruit_MQTT
+{
+public:
+    Adafruit_MQTT() : client( nullptr ), subscriptionCount( 0 ), isConnected( false ) {}
+    int8_t connect();
+    bool disconnect();
+    bool connected();
+    const char *connectErrorString( int8_t code );
+    bool subscribe( Adafruit_MQTT_Subscribe *subscription );
+    bool ping( uint8_t attempts = 1 );
+    bool publish( const char *topic, const uint8_t *payload, uint16_t length );
+
+protected:
+    Client *client; // The connection the packets are sent over, nullptr without one.
+    Adafruit_MQTT_Subscribe *subscriptions[MAXSUBSCRIPTIONS]; // The subscriptions that receive messages.
+    uint8_t subscriptionCount; // The amount of subscriptions.
+
+private:
+    bool isConnected; // Boolean to check if the connection to the broker is open.
+};
+
+#endif //WATERUP_SIMULATION_ADAFRUIT_MQTT_H
@@ -0,0 +1,26 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ *
+ * Host version of the Adafruit MQTT client used by the pot simulator.
+ */
+#ifndef WATERUP_SIMULATION_ADAFRUIT_MQTT_CLIENT_H
+#define WATERUP_SIMULATION_ADAFRUIT_MQTT_CLIENT_H
+
+#include <Adafruit_MQTT.h>
+#include <ESP8266WiFi.h>
+
+/**
+ * This class is an connection to the simulated broker over an TCP client. The packets the
+ * broker sends to the pot can be read byte by byte like from the real connection.
+ */
+class Adafruit_MQTT_Client : public Adafruit_MQTT
+{
+public:
+    Adafruit_MQTT_Client( Client *client, const char *server, uint16_t port, const char *username, const char *password )
+    {
+        this->client = client;
+    }
+    uint16_t readPacket( uint8_t *buffer, uint16_t maxlen, int16_t timeout );
+};
+
+#endif //WATERUP_SIMULATION_ADAFRUIT_MQTT_CLIENT_H
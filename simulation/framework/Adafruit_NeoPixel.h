@@ -0,0 +1,35 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ *
+ * Host version of the NeoPixel library used by the pot simulator, it only keeps the colors.
+ */
+#ifndef WATERUP_SIMULATION_ADAFRUIT_NEOPIXEL_H
+#define WATERUP_SIMULATION_ADAFRUIT_NEOPIXEL_H
+
+#include <Arduino.h>
+#include <vector>
+
+#define NEO_RGB 0
+#define NEO_GRB 1
+#define NEO_KHZ800 0
+
+/**
+ * This class is an strip of leds.
+ */
+class Adafruit_NeoPixel
+{
+public:
+    Adafruit_NeoPixel( uint16_t count, uint8_t pin, int type ) : pixels( count, 0 ) {}
+    void begin() {}
+    void show() {}
+    void clear() { this->pixels.assign( this->pixels.size(), 0 ); }
+    void setPixelColor( uint16_t index, uint32_t color ) { if( index < this->pixels.size() ) this->pixels[index] = color; }
+    uint32_t getPixelColor( uint16_t index ) { return index < this->pixels.size() ? this->pixels[index] : 0; }
+    uint16_t numPixels() { return this->pixels.size(); }
+    static uint32_t Color( uint8_t red, uint8_t green, uint8_t blue ) { return ( (uint32_t) red << 16 ) | ( (uint32_t) green << 8 ) | blue; }
+
+private:
+    std::vector<uint32_t> pixels; // The color of every led.
+};
+
+#endif //WATERUP_SIMULATION_ADAFRUIT_NEOPIXEL_H
@@ -0,0 +1,134 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ *
+ * Host version of the Arduino core used by the pot simulator. Time only passes when the
+ * firmware waits or reads the clock, the pins are connected to the simulated pot physics.
+ * Only the parts of the core the pot firmware uses are implemented.
+ */
+#ifndef WATERUP_SIMULATION_ARDUINO_H
+#define WATERUP_SIMULATION_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <string>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define RISING 1
+#define FALLING 2
+#define CHANGE 3
+#define A0 17
+
+#define ICACHE_RAM_ATTR
+#define IRAM_ATTR
+#define PROGMEM
+#define F( string ) ( string )
+#define pgm_read_byte( address ) ( *(const uint8_t*)( address ))
+#define pgm_read_word( address ) ( *(const uint16_t*)( address ))
+#define pgm_read_dword( address ) ( *(const uint32_t*)( address ))
+#define digitalPinToInterrupt( pin ) ( pin )
+#define noInterrupts() // The simulator runs interrupts between two firmware statements, never inside one.
+#define interrupts()
+
+unsigned long millis();
+unsigned long micros();
+void delay( unsigned long milliseconds );
+void delayMicroseconds( unsigned int microseconds );
+void yield();
+
+void pinMode( uint8_t pin, uint8_t mode );
+void digitalWrite( uint8_t pin, uint8_t value );
+int digitalRead( uint8_t pin );
+int analogRead( uint8_t pin );
+void attachInterrupt( uint8_t pin, void (*handler)(), int mode );
+void detachInterrupt( uint8_t pin );
+
+long random( long maximum );
+long random( long minimum, long maximum );
+
+/**
+ * This class is an small version of the Arduino string.
+ */
+class String
+{
+public:
+    String( const char *text = "" ) : text( text ) {}
+    String( const std::string &text ) : text( text ) {}
+    const char *c_str() const { return this->text.c_str(); }
+    unsigned int length() const { return this->text.size(); }
+    bool equals( const String &other ) const { return this->text == other.text; }
+    bool operator==( const String &other ) const { return this->text == other.text; }
+    String operator+( const String &other ) const { return String( this->text + other.text ); }
+
+private:
+    std::string text;
+};
+
+/**
+ * This class is the serial port, the output is only written to stdout when it is enabled
+ * by the simulator so the console isn't flooded during long runs.
+ */
+class Print
+{
+public:
+    void begin( unsigned long baudRate ) {}
+    void setEnabled( bool enabled ) { this->enabled = enabled; }
+    size_t write( const uint8_t *buffer, size_t size );
+    size_t print( const char *text );
+    size_t print( const String &text ) { return this->print( text.c_str() ); }
+    size_t print( char character );
+    size_t print( unsigned char number ) { return this->print( (unsigned long) number ); }
+    size_t print( int number ) { return this->print( (long) number ); }
+    size_t print( unsigned int number ) { return this->print( (unsigned long) number ); }
+    size_t print( long number );
+    size_t print( unsigned long number );
+    size_t print( long long number ) { return this->print( (long) number ); }
+    size_t print( unsigned long long number ) { return this->print( (unsigned long) number ); }
+    size_t print( double number );
+    size_t println() { return this->print( "\n" ); }
+    template<class T> size_t println( const T &value ) { return this->print( value ) + this->println(); }
+
+private:
+    bool enabled; // Boolean to check if the output is written to stdout, zero initialised before any constructor runs.
+};
+
+extern Print Serial;
+
+enum RFMode
+{
+    RF_DEFAULT = 0,
+    RF_DISABLED = 4
+};
+#define WAKE_RF_DEFAULT RF_DEFAULT
+#define WAKE_RF_DISABLED RF_DISABLED
+
+/**
+ * This class contains the ESP8266 specific functions.
+ */
+class EspClass
+{
+public:
+    uint32_t getFreeHeap();
+    uint32_t getChipId();
+    uint32_t getCycleCount();
+    void deepSleep( uint64_t time, RFMode mode = RF_DEFAULT );
+    bool rtcUserMemoryRead( uint32_t offset, uint32_t *data, size_t size );
+    bool rtcUserMemoryWrite( uint32_t offset, uint32_t *data, size_t size );
+};
+
+extern EspClass ESP;
+
+void configTime( int timezone, int daylightOffset, const char *server1, const char *server2 = nullptr, const char *server3 = nullptr );
+
+#endif //WATERUP_SIMULATION_ARDUINO_H
@@ -0,0 +1,69 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ *
+ * Host version of the ArduinoJson library the config benchmark compares the generated config
+ * decoders with, the firmware doesn't use it anymore. It only parses flat objects with string,
+ * number and boolean values like the pot configuration messages.
+ */
+#ifndef WATERUP_SIMULATION_ARDUINOJSON_H
+#define WATERUP_SIMULATION_ARDUINOJSON_H
+
+#include <Arduino.h>
+#include <map>
+
+#define JSON_OBJECT_SIZE( count ) ( ( count ) * 16 )
+
+/**
+ * This class is an value of an json object.
+ */
+class JsonVariant
+{
+public:
+    JsonVariant() : value( nullptr ) {}
+    JsonVariant( const std::string *value ) : value( value ) {}
+
+    template<class T> operator T() const { return (T) strtod( this->value != nullptr ? this->value->c_str() : "", nullptr ); }
+    operator String() const { return this->value != nullptr ? String( *this->value ) : String(); }
+    operator const char*() const { return this->value != nullptr ? this->value->c_str() : nullptr; }
+    operator bool() const { return this->value != nullptr && *this->value != "false" && *this->value != "0"; }
+    bool operator==( bool other ) const { return (bool) *this == other; }
+
+private:
+    const std::string *value; // The value without quotes inside the parsed object, like the real library it lives until the next parse.
+};
+
+/**
+ * This class is an parsed json object.
+ */
+class JsonObject
+{
+public:
+    JsonObject() : parsed( false ) {}
+    bool success() const { return this->parsed; }
+    bool containsKey( const char *key ) const { return this->values.count( key ) > 0; }
+    JsonVariant operator[]( const char *key ) const;
+    bool parse( const char *json );
+
+private:
+    bool parsed; // Boolean to check if the json was valid.
+    std::map<std::string, std::string> values; // The values by key.
+};
+
+/**
+ * This class owns the parsed json objects.
+ */
+class DynamicJsonBuffer
+{
+public:
+    DynamicJsonBuffer( size_t capacity = 0 ) {}
+    JsonObject &parseObject( const char *json )
+    {
+        this->object.parse( json );
+        return this->object;
+    }
+
+private:
+    JsonObject object; // The last parsed object.
+};
+
+#endif //WATERUP_SIMULATION_ARDUINOJSON_H
@@ -0,0 +1,36 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ *
+ * Host version of the ESP8266 EEPROM emulation used by the pot simulator.
+ */
+#ifndef WATERUP_SIMULATION_EEPROM_H
+#define WATERUP_SIMULATION_EEPROM_H
+
+#include <Arduino.h>
+
+#define SIMULATED_EEPROM_SIZE 4096 // The size in bytes of the flash sector that emulates the EEPROM.
+
+/**
+ * This class is the EEPROM, it starts erased like an new chip.
+ */
+class EEPROMClass
+{
+public:
+    void begin( size_t size );
+    uint8_t read( int address );
+    void write( int address, uint8_t value );
+    bool commit();
+    void end() {}
+
+    uint32_t getCommitCount() { return this->commitCount; }
+
+private:
+    uint8_t memory[SIMULATED_EEPROM_SIZE]; // The emulated EEPROM content.
+    size_t size; // The size passed to begin().
+    bool erased; // Boolean to check if the memory was erased, zero initialised before any constructor runs.
+    uint32_t commitCount; // The amount of commits, every commit erases an flash sector on the real pot.
+};
+
+extern EEPROMClass EEPROM;
+
+#endif //WATERUP_SIMULATION_EEPROM_H
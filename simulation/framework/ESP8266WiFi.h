@@ -0,0 +1,126 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ *
+ * Host version of the ESP8266 WiFi library used by the pot simulator. The pot is always
+ * connected to the wireless network, the simulated network decides if the broker is reachable.
+ * The TLS client takes the time of an full or an resumed handshake of the ESP8266 and the heap
+ * of the BearSSL buffers while the connection is open.
+ */
+#ifndef WATERUP_SIMULATION_ESP8266WIFI_H
+#define WATERUP_SIMULATION_ESP8266WIFI_H
+
+#include <Arduino.h>
+#include <Streaming.h>
+
+#define WL_CONNECTED 3
+#define WIFI_NONE_SLEEP 0
+#define WIFI_LIGHT_SLEEP 1
+#define WIFI_MODEM_SLEEP 2
+
+#define SIMULATED_MAC_ADDRESS "5C:CF:7F:19:9C:39" // The mac address of the simulated pot.
+#define SIMULATED_FULL_HANDSHAKE_TIME 1800 // The time in milliseconds the ESP8266 takes for an TLS handshake with an RSA key exchange.
+#define SIMULATED_RESUMED_HANDSHAKE_TIME 150 // The time in milliseconds the ESP8266 takes to resume an TLS session.
+#define SIMULATED_TLS_CONTEXT_SIZE 4200 // The heap in bytes of the BearSSL client and certificate contexts.
+#define SIMULATED_TLS_RECEIVE_OVERHEAD 325 // The bytes BearSSL adds to the receive buffer for the record header and MAC.
+#define SIMULATED_TLS_TRANSMIT_OVERHEAD 85 // The bytes BearSSL adds to the transmit buffer for the record header and MAC.
+#define SIMULATED_TLS_MAX_RECORD 16384 // The largest TLS record, the broker sends it when it doesn't limit the fragment length.
+#define BR_ERR_TOO_LARGE 6 // The error of BearSSL when an record doesn't fit the receive buffer.
+#define BR_ERR_X509_NOT_TRUSTED 62 // The error of BearSSL when the certificate doesn't match the fingerprint.
+
+/**
+ * Data structure that contains an IPv4 address.
+ */
+struct IPAddress
+{
+    uint8_t octets[4];
+};
+
+inline Print &operator<<( Print &printer, const IPAddress &address )
+{
+    char text[16];
+    snprintf( text, sizeof( text ), "%u.%u.%u.%u", address.octets[0], address.octets[1], address.octets[2], address.octets[3] );
+    printer.print( text );
+    return printer;
+}
+
+/**
+ * This class is the wireless network interface.
+ */
+class ESP8266WiFiClass
+{
+public:
+    String macAddress() { return String( SIMULATED_MAC_ADDRESS ); }
+    int waitForConnectResult() { return WL_CONNECTED; }
+    int status() { return WL_CONNECTED; }
+    IPAddress localIP() { IPAddress address = {{ 192, 168, 1, 42 }}; return address; }
+    void printDiag( Print &printer ) { printer.print( "Simulated WiFi\n" ); }
+    bool setSleepMode( int mode ) { return true; }
+};
+
+extern ESP8266WiFiClass WiFi;
+
+/**
+ * This class is an TCP connection.
+ */
+class Client
+{
+public:
+    virtual ~Client() {}
+    virtual int connect( const char *host, uint16_t port ) = 0;
+    virtual bool connected() = 0;
+    virtual void stop() = 0;
+};
+
+namespace BearSSL
+{
+    /**
+     * This class is an TLS session the client can resume, the simulated broker hands out
+     * an new id after every full handshake.
+     */
+    class Session
+    {
+    public:
+        Session() : id( 0 ) {}
+
+        uint32_t id; // The id of the session at the simulated broker, 0 when there is none.
+    };
+
+    /**
+     * This class is an TLS connection to the simulated broker, the certificate of the
+     * simulated broker always matches.
+     */
+    class WiFiClientSecure : public Client
+    {
+    public:
+        WiFiClientSecure() : open( false ), session( nullptr ), receiveBufferSize( SIMULATED_TLS_MAX_RECORD ), transmitBufferSize( 512 ), lastError( 0 ) {}
+        int connect( const char *host, uint16_t port );
+        bool connected();
+        void stop();
+        bool verify( const char *fingerprint, const char *host ) { return true; }
+        void setFingerprint( const char *fingerprint ) {}
+        void setInsecure() {}
+        void setSession( Session *session ) { this->session = session; }
+        void setBufferSizes( int receive, int transmit ) { this->receiveBufferSize = receive; this->transmitBufferSize = transmit; }
+        static bool probeMaxFragmentLength( const char *host, uint16_t port, uint16_t length );
+        bool getMFLNStatus();
+        int getLastSSLError( char *text = nullptr, size_t size = 0 ) { return this->lastError; }
+
+    private:
+        bool open; // Boolean to check if the connection is open.
+        Session *session; // The session offered to the broker and saved after the handshake.
+        int receiveBufferSize; // The largest record in bytes the client can receive.
+        int transmitBufferSize; // The largest record in bytes the client sends.
+        int lastError; // The BearSSL error of the last connection, 0 without one.
+
+        /**
+         * This function returns the heap the buffers and contexts of an open connection take.
+         *
+         * @return int32_t - The heap in bytes.
+         */
+        int32_t getHeapSize() { return SIMULATED_TLS_CONTEXT_SIZE + this->receiveBufferSize + SIMULATED_TLS_RECEIVE_OVERHEAD + this->transmitBufferSize + SIMULATED_TLS_TRANSMIT_OVERHEAD; }
+    };
+}
+
+using BearSSL::WiFiClientSecure;
+
+#endif //WATERUP_SIMULATION_ESP8266WIFI_H
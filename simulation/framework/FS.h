@@ -0,0 +1,68 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ *
+ * Host version of the SPIFFS file system used by the pot simulator, the files are kept
+ * in memory for the duration of the simulation.
+ */
+#ifndef WATERUP_SIMULATION_FS_H
+#define WATERUP_SIMULATION_FS_H
+
+#include <Arduino.h>
+#include <memory>
+
+namespace fs
+{
+    enum SeekMode
+    {
+        SeekSet = 0,
+        SeekCur = 1,
+        SeekEnd = 2
+    };
+
+    struct OpenFile;
+
+    /**
+     * This class is an open file, copies share the same position like on the pot.
+     */
+    class File
+    {
+    public:
+        File() {}
+        File( std::shared_ptr<OpenFile> file ) : file( file ) {}
+
+        size_t write( const uint8_t *buffer, size_t size );
+        size_t read( uint8_t *buffer, size_t size );
+        bool seek( uint32_t position, SeekMode mode = SeekSet );
+        size_t position() const;
+        size_t size() const;
+        void flush() {}
+        void close();
+        operator bool() const;
+
+    private:
+        std::shared_ptr<OpenFile> file; // The file, empty when the open failed.
+    };
+
+    /**
+     * This class is the file system.
+     */
+    class FS
+    {
+    public:
+        bool begin();
+        File open( const char *path, const char *mode );
+        bool exists( const char *path );
+        bool remove( const char *path );
+        bool rename( const char *pathFrom, const char *pathTo );
+    };
+}
+
+using fs::File;
+using fs::SeekSet;
+using fs::SeekCur;
+using fs::SeekEnd;
+using fs::SeekMode;
+
+extern fs::FS SPIFFS;
+
+#endif //WATERUP_SIMULATION_FS_H
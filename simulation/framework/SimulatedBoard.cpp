@@ -0,0 +1,608 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ *
+ * This file contains the simulated board and the host version of the Arduino core, the
+ * ESP8266 functions, the Ticker, the EEPROM emulation and the SPIFFS file system.
+ */
+#include "SimulatedBoard.h"
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <Ticker.h>
+#include <FS.h>
+#include <map>
+#include <vector>
+#include <random>
+
+/**
+ * Data structure that contains the state of the simulated board. It is created on first use
+ * because the firmware already uses the board from the constructors of its global objects,
+ * and never destroyed because their destructors use it too.
+ */
+struct BoardState
+{
+    /**
+     * Data structure that contains an event of the clock.
+     */
+    struct Event
+    {
+        uint32_t id; // The id of the event.
+        SimulatedEventCallback callback; // The function to call.
+        void *context; // The pointer passed to the function.
+    };
+
+    uint64_t time = 0; // The simulated time in microseconds.
+    uint32_t nextEventId = 1; // The id of the next event.
+    bool runningEvents = false; // Boolean to check if the events are running, an event can read the clock too.
+    std::multimap<uint64_t, Event> events; // The pending events ordered by time.
+    SimulatedDevice *device = nullptr; // The hardware connected to the pins.
+    uint8_t pinLevels[SIMULATED_PIN_COUNT] = {}; // The level of every pin.
+    void (*interruptHandlers[SIMULATED_PIN_COUNT])() = {}; // The interrupt handler of every pin.
+    int interruptModes[SIMULATED_PIN_COUNT] = {}; // The edges the interrupt handlers run on.
+    std::mt19937 random; // The random number generator.
+    uint8_t rtcMemory[512] = {}; // The RTC user memory.
+    std::map<std::string, std::vector<uint8_t>> files; // The SPIFFS files by path.
+    int32_t allocatedHeap = 0; // The heap in bytes taken by the host libraries.
+    int32_t peakAllocatedHeap = 0; // The most heap in bytes the host libraries took at once.
+};
+
+static BoardState &board()
+{
+    static BoardState *state = new BoardState();
+    return *state;
+}
+
+Print Serial;
+EspClass ESP;
+EEPROMClass EEPROM;
+fs::FS SPIFFS;
+
+/**
+ * Return the simulated time since the pot was powered on.
+ *
+ * @return uint64_t - The time in microseconds.
+ */
+uint64_t SimulatedBoard::now()
+{
+    return board().time;
+}
+
+/**
+ * Move the simulated clock forward and run the events that became due in the order of their
+ * time. An event that reads the clock moves it forward too, those reads only add time because
+ * the loop below already runs the events.
+ *
+ * @param microseconds  The time to move forward.
+ */
+void SimulatedBoard::advance( uint64_t microseconds )
+{
+    BoardState &state = board();
+    uint64_t target = state.time + microseconds;
+
+    if( state.runningEvents )
+    {
+        state.time = target;
+        return;
+    }
+
+    state.runningEvents = true;
+    while( !state.events.empty() && state.events.begin()->first <= target )
+    {
+        std::multimap<uint64_t, BoardState::Event>::iterator next = state.events.begin();
+        BoardState::Event event = next->second;
+        if( next->first > state.time )
+        {
+            state.time = next->first;
+        }
+        state.events.erase( next );
+        event.callback( event.context );
+
+        if( state.time > target ) // The event read the clock.
+        {
+            target = state.time;
+        }
+    }
+    state.time = target;
+    state.runningEvents = false;
+}
+
+/**
+ * Add an event to the clock.
+ *
+ * @param time      The simulated time in microseconds the event runs at.
+ * @param callback  The function to call.
+ * @param context   The pointer passed to the function.
+ * @return uint32_t - The id of the event, used to cancel it.
+ */
+uint32_t SimulatedBoard::addEvent( uint64_t time, SimulatedEventCallback callback, void *context )
+{
+    BoardState &state = board();
+    BoardState::Event event = { state.nextEventId++, callback, context };
+    state.events.insert( std::make_pair( time, event ));
+    return event.id;
+}
+
+/**
+ * Remove an event that didn't run yet.
+ *
+ * @param eventId   The id returned by addEvent().
+ */
+void SimulatedBoard::cancelEvent( uint32_t eventId )
+{
+    BoardState &state = board();
+    for( std::multimap<uint64_t, BoardState::Event>::iterator i = state.events.begin(); i != state.events.end(); ++i )
+    {
+        if( i->second.id == eventId )
+        {
+            state.events.erase( i );
+            return;
+        }
+    }
+}
+
+/**
+ * Connect the hardware to the pins.
+ *
+ * @param device    The device, nullptr disconnects it.
+ */
+void SimulatedBoard::attachDevice( SimulatedDevice *device )
+{
+    board().device = device;
+}
+
+/**
+ * Drive an input pin and run the interrupt handler attached to it when the edge matches.
+ *
+ * @param pin   The pin to drive.
+ * @param level The new level of the pin.
+ */
+void SimulatedBoard::setPinLevel( uint8_t pin, uint8_t level )
+{
+    BoardState &state = board();
+    if( pin >= SIMULATED_PIN_COUNT || state.pinLevels[pin] == level )
+    {
+        return;
+    }
+
+    state.pinLevels[pin] = level;
+    int mode = state.interruptModes[pin];
+    if( state.interruptHandlers[pin] != nullptr && ( mode == CHANGE || ( mode == RISING && level == HIGH ) || ( mode == FALLING && level == LOW )))
+    {
+        state.interruptHandlers[pin]();
+    }
+}
+
+/**
+ * Return the level of an pin.
+ *
+ * @param pin   The pin to read.
+ * @return uint8_t - The level of the pin.
+ */
+uint8_t SimulatedBoard::getPinLevel( uint8_t pin )
+{
+    return pin < SIMULATED_PIN_COUNT ? board().pinLevels[pin] : LOW;
+}
+
+/**
+ * Set the seed of the random number generator.
+ *
+ * @param seed  The seed.
+ */
+void SimulatedBoard::setRandomSeed( uint32_t seed )
+{
+    board().random.seed( seed );
+}
+
+/**
+ * Return an random number of the board.
+ *
+ * @return uint32_t - An random number.
+ */
+uint32_t SimulatedBoard::nextRandom()
+{
+    return board().random();
+}
+
+/**
+ * Take or give back heap.
+ *
+ * @param bytes The amount of bytes taken, negative to give them back.
+ */
+void SimulatedBoard::allocateHeap( int32_t bytes )
+{
+    board().allocatedHeap += bytes;
+    if( board().allocatedHeap > board().peakAllocatedHeap )
+    {
+        board().peakAllocatedHeap = board().allocatedHeap;
+    }
+}
+
+/**
+ * Return the lowest free heap since the pot was powered on.
+ *
+ * @return uint32_t - The free heap in bytes.
+ */
+uint32_t SimulatedBoard::getLowestFreeHeap()
+{
+    return (uint32_t)( SIMULATED_FREE_HEAP - board().peakAllocatedHeap );
+}
+
+unsigned long millis()
+{
+    SimulatedBoard::advance( SIMULATED_CLOCK_READ_TIME );
+    return (unsigned long)( SimulatedBoard::now() / 1000 );
+}
+
+unsigned long micros()
+{
+    SimulatedBoard::advance( SIMULATED_CLOCK_READ_TIME );
+    return (unsigned long)(uint32_t) SimulatedBoard::now();
+}
+
+void delay( unsigned long milliseconds )
+{
+    SimulatedBoard::advance( (uint64_t) milliseconds * 1000 );
+}
+
+void delayMicroseconds( unsigned int microseconds )
+{
+    SimulatedBoard::advance( microseconds );
+}
+
+void yield()
+{
+    SimulatedBoard::advance( SIMULATED_CLOCK_READ_TIME );
+}
+
+void pinMode( uint8_t pin, uint8_t mode )
+{
+}
+
+void digitalWrite( uint8_t pin, uint8_t value )
+{
+    BoardState &state = board();
+    if( pin >= SIMULATED_PIN_COUNT )
+    {
+        return;
+    }
+
+    state.pinLevels[pin] = value ? HIGH : LOW;
+    if( state.device != nullptr )
+    {
+        state.device->pinWritten( pin, state.pinLevels[pin] );
+    }
+}
+
+int digitalRead( uint8_t pin )
+{
+    return SimulatedBoard::getPinLevel( pin );
+}
+
+int analogRead( uint8_t pin )
+{
+    SimulatedBoard::advance( 100 ); // The ESP8266 needs about 100 microseconds for an conversion.
+    return board().device != nullptr ? board().device->readAnalog( pin ) : 0;
+}
+
+void attachInterrupt( uint8_t pin, void (*handler)(), int mode )
+{
+    if( pin < SIMULATED_PIN_COUNT )
+    {
+        board().interruptHandlers[pin] = handler;
+        board().interruptModes[pin] = mode;
+    }
+}
+
+void detachInterrupt( uint8_t pin )
+{
+    if( pin < SIMULATED_PIN_COUNT )
+    {
+        board().interruptHandlers[pin] = nullptr;
+    }
+}
+
+long random( long maximum )
+{
+    return maximum > 0 ? (long)( SimulatedBoard::nextRandom() % (uint32_t) maximum ) : 0;
+}
+
+long random( long minimum, long maximum )
+{
+    return maximum > minimum ? minimum + random( maximum - minimum ) : minimum;
+}
+
+void configTime( int timezone, int daylightOffset, const char *server1, const char *server2, const char *server3 )
+{
+}
+
+size_t Print::write( const uint8_t *buffer, size_t size )
+{
+    if( this->enabled )
+    {
+        fwrite( buffer, 1, size, stdout );
+    }
+    return size;
+}
+
+size_t Print::print( const char *text )
+{
+    return this->write( (const uint8_t*) text, strlen( text ));
+}
+
+size_t Print::print( char character )
+{
+    return this->write( (const uint8_t*) &character, 1 );
+}
+
+size_t Print::print( long number )
+{
+    char text[24];
+    snprintf( text, sizeof( text ), "%ld", number );
+    return this->print( text );
+}
+
+size_t Print::print( unsigned long number )
+{
+    char text[24];
+    snprintf( text, sizeof( text ), "%lu", number );
+    return this->print( text );
+}
+
+size_t Print::print( double number )
+{
+    char text[32];
+    snprintf( text, sizeof( text ), "%.2f", number );
+    return this->print( text );
+}
+
+uint32_t EspClass::getFreeHeap()
+{
+    return (uint32_t)( SIMULATED_FREE_HEAP - board().allocatedHeap );
+}
+
+uint32_t EspClass::getChipId()
+{
+    return 0x199C39;
+}
+
+uint32_t EspClass::getCycleCount()
+{
+    return (uint32_t)( SimulatedBoard::now() * 80 ); // The ESP8266 runs at 80 MHz.
+}
+
+/**
+ * Deep sleep ends the firmware, the duty cycle mode wakes up in setup() again which the
+ * simulator doesn't do yet.
+ */
+void EspClass::deepSleep( uint64_t time, RFMode mode )
+{
+    fprintf( stderr, "The pot went into deep sleep, the duty cycle mode is not simulated.\n" );
+    exit( 1 );
+}
+
+bool EspClass::rtcUserMemoryRead( uint32_t offset, uint32_t *data, size_t size )
+{
+    if( offset * 4 + size > sizeof( board().rtcMemory ))
+    {
+        return false;
+    }
+    memcpy( data, board().rtcMemory + offset * 4, size );
+    return true;
+}
+
+bool EspClass::rtcUserMemoryWrite( uint32_t offset, uint32_t *data, size_t size )
+{
+    if( offset * 4 + size > sizeof( board().rtcMemory ))
+    {
+        return false;
+    }
+    memcpy( board().rtcMemory + offset * 4, data, size );
+    return true;
+}
+
+void EEPROMClass::begin( size_t size )
+{
+    if( !this->erased )
+    {
+        memset( this->memory, 0xFF, sizeof( this->memory ));
+        this->erased = true;
+    }
+    this->size = size < SIMULATED_EEPROM_SIZE ? size : SIMULATED_EEPROM_SIZE;
+}
+
+uint8_t EEPROMClass::read( int address )
+{
+    return address >= 0 && (size_t) address < this->size ? this->memory[address] : 0;
+}
+
+void EEPROMClass::write( int address, uint8_t value )
+{
+    if( address >= 0 && (size_t) address < this->size )
+    {
+        this->memory[address] = value;
+    }
+}
+
+bool EEPROMClass::commit()
+{
+    this->commitCount++;
+    return true;
+}
+
+void Ticker::once_ms( uint32_t milliseconds, void (*callback)() )
+{
+    this->schedule( milliseconds, false, (void (*)( void* )) callback, nullptr );
+}
+
+void Ticker::attach_ms( uint32_t milliseconds, void (*callback)() )
+{
+    this->schedule( milliseconds, true, (void (*)( void* )) callback, nullptr );
+}
+
+void Ticker::detach()
+{
+    if( this->eventId != 0 )
+    {
+        SimulatedBoard::cancelEvent( this->eventId );
+        this->eventId = 0;
+    }
+}
+
+bool Ticker::active()
+{
+    return this->eventId != 0;
+}
+
+void Ticker::schedule( uint32_t milliseconds, bool periodic, void (*callback)( void* ), void *argument )
+{
+    this->detach();
+    this->interval = milliseconds;
+    this->periodic = periodic;
+    this->callback = callback;
+    this->argument = argument;
+    this->eventId = SimulatedBoard::addEvent( SimulatedBoard::now() + (uint64_t) milliseconds * 1000, &Ticker::fire, this );
+}
+
+void Ticker::fire( void *ticker )
+{
+    Ticker *self = (Ticker*) ticker;
+    self->eventId = 0;
+    if( self->periodic )
+    {
+        self->eventId = SimulatedBoard::addEvent( SimulatedBoard::now() + (uint64_t) self->interval * 1000, &Ticker::fire, self );
+    }
+    self->callback( self->argument );
+}
+
+namespace fs
+{
+    /**
+     * Data structure that contains an open file.
+     */
+    struct OpenFile
+    {
+        std::string path; // The path of the file.
+        size_t position; // The read and write position.
+        bool readable; // Boolean to check if the file was opened for reading.
+        bool writable; // Boolean to check if the file was opened for writing.
+        bool open; // Boolean to check if the file wasn't closed.
+    };
+
+    size_t File::write( const uint8_t *buffer, size_t size )
+    {
+        if( !*this || !this->file->writable )
+        {
+            return 0;
+        }
+
+        std::vector<uint8_t> &content = board().files[this->file->path];
+        if( content.size() < this->file->position + size )
+        {
+            content.resize( this->file->position + size );
+        }
+        memcpy( content.data() + this->file->position, buffer, size );
+        this->file->position += size;
+        return size;
+    }
+
+    size_t File::read( uint8_t *buffer, size_t size )
+    {
+        if( !*this || !this->file->readable )
+        {
+            return 0;
+        }
+
+        std::vector<uint8_t> &content = board().files[this->file->path];
+        size_t available = this->file->position < content.size() ? content.size() - this->file->position : 0;
+        size_t count = size < available ? size : available;
+        memcpy( buffer, content.data() + this->file->position, count );
+        this->file->position += count;
+        return count;
+    }
+
+    bool File::seek( uint32_t position, SeekMode mode )
+    {
+        if( !*this )
+        {
+            return false;
+        }
+
+        size_t base = mode == SeekSet ? 0 : mode == SeekCur ? this->file->position : this->size();
+        if( base + position > this->size() )
+        {
+            return false;
+        }
+        this->file->position = base + position;
+        return true;
+    }
+
+    size_t File::position() const
+    {
+        return *this ? this->file->position : 0;
+    }
+
+    size_t File::size() const
+    {
+        return *this ? board().files[this->file->path].size() : 0;
+    }
+
+    void File::close()
+    {
+        if( this->file )
+        {
+            this->file->open = false;
+        }
+    }
+
+    File::operator bool() const
+    {
+        return this->file && this->file->open;
+    }
+
+    bool FS::begin()
+    {
+        return true;
+    }
+
+    File FS::open( const char *path, const char *mode )
+    {
+        bool exists = board().files.count( path ) > 0;
+        if( mode[0] == 'r' && !exists )
+        {
+            return File();
+        }
+
+        std::shared_ptr<OpenFile> file( new OpenFile() );
+        file->path = path;
+        file->readable = mode[0] == 'r' || mode[1] == '+';
+        file->writable = mode[0] != 'r' || mode[1] == '+';
+        file->open = true;
+
+        if( mode[0] == 'w' || !exists )
+        {
+            board().files[path].clear();
+        }
+        file->position = mode[0] == 'a' ? board().files[path].size() : 0;
+        return File( file );
+    }
+
+    bool FS::exists( const char *path )
+    {
+        return board().files.count( path ) > 0;
+    }
+
+    bool FS::remove( const char *path )
+    {
+        return board().files.erase( path ) > 0;
+    }
+
+    bool FS::rename( const char *pathFrom, const char *pathTo )
+    {
+        if( !this->exists( pathFrom ))
+        {
+            return false;
+        }
+        board().files[pathTo] = board().files[pathFrom];
+        board().files.erase( pathFrom );
+        return true;
+    }
+}
@@ -0,0 +1,138 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ *
+ * This header contains the simulated board the host version of the Arduino core runs on.
+ * The board keeps an simulated clock with an queue of events, like the edges of an sonar
+ * echo or an Ticker deadline. The clock only moves when the firmware waits or reads it, so
+ * the pot runs as fast as the host can execute the firmware between two waits.
+ */
+#ifndef WATERUP_SIMULATION_SIMULATEDBOARD_H
+#define WATERUP_SIMULATION_SIMULATEDBOARD_H
+
+#include <stdint.h>
+
+#define SIMULATED_PIN_COUNT 32 // The amount of pins of the simulated board.
+#define SIMULATED_CLOCK_READ_TIME 1 // The time in microseconds reading the clock takes, so polling loops end.
+#define SIMULATED_FREE_HEAP 40000 // The free heap in bytes of the ESP8266 after connecting to the WiFi network.
+
+typedef void (*SimulatedEventCallback)( void *context );
+
+/**
+ * This class is the hardware connected to the pins of the simulated board.
+ */
+class SimulatedDevice
+{
+public:
+    virtual ~SimulatedDevice() {}
+
+    /**
+     * This function is called when the firmware writes an output pin.
+     *
+     * @param pin   The pin that was written.
+     * @param level The new level of the pin.
+     */
+    virtual void pinWritten( uint8_t pin, uint8_t level ) = 0;
+
+    /**
+     * This function is called when the firmware reads an analog pin.
+     *
+     * @param pin   The pin that is read.
+     * @return int - The value of the analog to digital converter, 0-1023.
+     */
+    virtual int readAnalog( uint8_t pin ) = 0;
+};
+
+/**
+ * This class is the simulated board, all its state is static like the hardware it replaces.
+ */
+class SimulatedBoard
+{
+public:
+    /**
+     * This function returns the simulated time since the pot was powered on.
+     *
+     * @return uint64_t - The time in microseconds.
+     */
+    static uint64_t now();
+
+    /**
+     * This function moves the simulated clock forward and runs the events that became due
+     * in the order of their time.
+     *
+     * @param microseconds  The time to move forward.
+     */
+    static void advance( uint64_t microseconds );
+
+    /**
+     * This function adds an event to the clock.
+     *
+     * @param time      The simulated time in microseconds the event runs at.
+     * @param callback  The function to call.
+     * @param context   The pointer passed to the function.
+     * @return uint32_t - The id of the event, used to cancel it.
+     */
+    static uint32_t addEvent( uint64_t time, SimulatedEventCallback callback, void *context );
+
+    /**
+     * This function removes an event that didn't run yet.
+     *
+     * @param eventId   The id returned by addEvent().
+     */
+    static void cancelEvent( uint32_t eventId );
+
+    /**
+     * This function connects the hardware to the pins.
+     *
+     * @param device    The device, nullptr disconnects it.
+     */
+    static void attachDevice( SimulatedDevice *device );
+
+    /**
+     * This function is used by the devices to drive an input pin, the interrupt handler
+     * attached to the pin runs when the edge matches.
+     *
+     * @param pin   The pin to drive.
+     * @param level The new level of the pin.
+     */
+    static void setPinLevel( uint8_t pin, uint8_t level );
+
+    /**
+     * This function returns the level of an pin.
+     *
+     * @param pin   The pin to read.
+     * @return uint8_t - The level of the pin.
+     */
+    static uint8_t getPinLevel( uint8_t pin );
+
+    /**
+     * This function sets the seed of the random number generator used by the firmware.
+     *
+     * @param seed  The seed.
+     */
+    static void setRandomSeed( uint32_t seed );
+
+    /**
+     * This function returns an random number of the board, the devices use it too so one
+     * seed repeats an whole simulation.
+     *
+     * @return uint32_t - An random number.
+     */
+    static uint32_t nextRandom();
+
+    /**
+     * This function is used by the host libraries to take or give back heap, like the TLS
+     * client does with its buffers.
+     *
+     * @param bytes The amount of bytes taken, negative to give them back.
+     */
+    static void allocateHeap( int32_t bytes );
+
+    /**
+     * This function returns the lowest free heap since the pot was powered on.
+     *
+     * @return uint32_t - The free heap in bytes.
+     */
+    static uint32_t getLowestFreeHeap();
+};
+
+#endif //WATERUP_SIMULATION_SIMULATEDBOARD_H
@@ -0,0 +1,478 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ *
+ * This file contains the simulated broker and the host version of the WiFi, MQTT and json
+ * libraries that talk to it.
+ */
+#include "SimulatedBroker.h"
+#include "SimulatedBoard.h"
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+#include <Adafruit_MQTT.h>
+#include <Adafruit_MQTT_Client.h>
+#include <ArduinoJson.h>
+#include <deque>
+#include <string>
+
+/**
+ * Data structure that contains the state of the simulated broker.
+ */
+struct BrokerState
+{
+    /**
+     * Data structure that contains an message queued for the pot.
+     */
+    struct Message
+    {
+        std::string topic; // The topic of the message.
+        std::string message; // The message.
+    };
+
+    bool reachable = true; // Boolean to check if the pot can reach the broker.
+    bool fragmentLengthSupported = true; // Boolean to check if the broker agrees to an smaller TLS fragment length.
+    SimulatedPublishCallback callback = nullptr; // The function called for every published message.
+    void *context = nullptr; // The pointer passed to the function.
+    std::deque<Message> queue; // The messages queued for the pot.
+    std::string packets; // The packets on their way to the pot, the pot reads them byte by byte.
+    SimulatedBrokerStatistics statistics = {}; // The traffic between the pot and the broker.
+    uint32_t sessionId = 0; // The id of the TLS session in the cache, 0 when there is none.
+    uint64_t sessionTime = 0; // The time of the full handshake that created the session.
+};
+
+static BrokerState &broker()
+{
+    static BrokerState *state = new BrokerState();
+    return *state;
+}
+
+ESP8266WiFiClass WiFi;
+
+/**
+ * Make the broker reachable or unreachable.
+ *
+ * @param reachable True if the pot can reach the broker.
+ */
+void SimulatedBroker::setReachable( bool reachable )
+{
+    broker().reachable = reachable;
+}
+
+/**
+ * Check if the broker is reachable.
+ *
+ * @return bool - True if the pot can reach the broker.
+ */
+bool SimulatedBroker::isReachable()
+{
+    return broker().reachable;
+}
+
+/**
+ * Set if the broker agrees to an smaller TLS fragment length.
+ *
+ * @param supported True if the broker limits its records to the fragment length.
+ */
+void SimulatedBroker::setFragmentLengthSupported( bool supported )
+{
+    broker().fragmentLengthSupported = supported;
+}
+
+/**
+ * Check if the broker agrees to an smaller TLS fragment length.
+ *
+ * @return bool - True if the broker limits its records to the fragment length.
+ */
+bool SimulatedBroker::isFragmentLengthSupported()
+{
+    return broker().fragmentLengthSupported;
+}
+
+/**
+ * Set the function called for every message the pot publishes.
+ *
+ * @param callback  The function to call, nullptr to remove it.
+ * @param context   The pointer passed to the function.
+ */
+void SimulatedBroker::onPublish( SimulatedPublishCallback callback, void *context )
+{
+    broker().callback = callback;
+    broker().context = context;
+}
+
+/**
+ * Queue an message for the pot.
+ *
+ * @param topic     The topic of the message.
+ * @param message   The message.
+ */
+void SimulatedBroker::send( const char *topic, const char *message )
+{
+    BrokerState::Message queued = { topic, message };
+    broker().queue.push_back( queued );
+}
+
+/**
+ * Receive an message published by the pot.
+ *
+ * @param topic     The topic of the message.
+ * @param payload   The message.
+ * @param length    The length of the message.
+ * @return bool - True if the broker received it.
+ */
+bool SimulatedBroker::receive( const char *topic, const uint8_t *payload, size_t length )
+{
+    BrokerState &state = broker();
+    if( !state.reachable )
+    {
+        state.statistics.rejected++;
+        return false;
+    }
+
+    state.statistics.messages++;
+    state.statistics.bytes += length;
+    if( state.callback != nullptr )
+    {
+        state.callback( topic, payload, length, state.context );
+    }
+    return true;
+}
+
+/**
+ * Check if an topic matches the topic of an subscription. An + matches one level of the topic
+ * and an # matches the rest of the topic.
+ *
+ * @param filter    The topic of the subscription.
+ * @param topic     The topic of the message.
+ * @return bool - True if the subscription receives the message.
+ */
+static bool matchTopic( const char *filter, const char *topic )
+{
+    while( *filter != '\0' )
+    {
+        if( *filter == '#' )
+        {
+            return true;
+        }
+        if( *filter == '+' )
+        {
+            while( *topic != '\0' && *topic != '/' )
+            {
+                topic++;
+            }
+            filter++;
+            continue;
+        }
+        if( *filter != *topic )
+        {
+            return false;
+        }
+        filter++;
+        topic++;
+    }
+    return *topic == '\0';
+}
+
+/**
+ * Take the next queued message for an subscription.
+ *
+ * @param filter    The topic of the subscription.
+ * @param topic     The string for the topic of the message.
+ * @param message   The string for the message.
+ * @return bool - False if there is no message for the subscription.
+ */
+bool SimulatedBroker::takeMessage( const char *filter, std::string *topic, std::string *message )
+{
+    std::deque<BrokerState::Message> &queue = broker().queue;
+    for( std::deque<BrokerState::Message>::iterator i = queue.begin(); i != queue.end(); ++i )
+    {
+        if( matchTopic( filter, i->topic.c_str() ))
+        {
+            *topic = i->topic;
+            *message = i->message;
+            queue.erase( i );
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Return the traffic between the pot and the broker.
+ *
+ * @return SimulatedBrokerStatistics* - An pointer to the statistics.
+ */
+SimulatedBrokerStatistics *SimulatedBroker::getStatistics()
+{
+    return &broker().statistics;
+}
+
+int BearSSL::WiFiClientSecure::connect( const char *host, uint16_t port )
+{
+    this->stop();
+    this->lastError = 0;
+    if( !SimulatedBroker::isReachable() )
+    {
+        return 0;
+    }
+
+    BrokerState &state = broker();
+    if( this->receiveBufferSize < SIMULATED_TLS_MAX_RECORD && !state.fragmentLengthSupported )
+    {
+        delay( SIMULATED_FULL_HANDSHAKE_TIME );
+        this->lastError = BR_ERR_TOO_LARGE; // The certificate of the broker doesn't fit in the receive buffer.
+        return 0;
+    }
+
+    this->open = true;
+    SimulatedBoard::allocateHeap( this->getHeapSize() );
+    if( this->session != nullptr && this->session->id != 0 && this->session->id == state.sessionId && millis() - state.sessionTime < SIMULATED_SESSION_LIFETIME )
+    {
+        delay( SIMULATED_RESUMED_HANDSHAKE_TIME );
+        state.statistics.resumedHandshakes++;
+        return 1;
+    }
+
+    delay( SIMULATED_FULL_HANDSHAKE_TIME );
+    state.statistics.fullHandshakes++;
+    state.sessionId++;
+    state.sessionTime = millis();
+    if( this->session != nullptr )
+    {
+        this->session->id = state.sessionId;
+    }
+    return 1;
+}
+
+bool BearSSL::WiFiClientSecure::connected()
+{
+    return this->open && SimulatedBroker::isReachable();
+}
+
+void BearSSL::WiFiClientSecure::stop()
+{
+    if( this->open )
+    {
+        SimulatedBoard::allocateHeap( -this->getHeapSize() ); // BearSSL frees its buffers when the connection closes.
+    }
+    this->open = false;
+}
+
+bool BearSSL::WiFiClientSecure::probeMaxFragmentLength( const char *host, uint16_t port, uint16_t length )
+{
+    delay( 100 ); // The probe only exchanges the hello messages.
+    return SimulatedBroker::isReachable() && SimulatedBroker::isFragmentLengthSupported();
+}
+
+bool BearSSL::WiFiClientSecure::getMFLNStatus()
+{
+    return this->open && this->receiveBufferSize < SIMULATED_TLS_MAX_RECORD && SimulatedBroker::isFragmentLengthSupported();
+}
+
+bool Adafruit_MQTT_Publish::publish( const char *message )
+{
+    return this->mqtt->publish( this->topic, (const uint8_t*) message, strlen( message ));
+}
+
+bool Adafruit_MQTT_Publish::publish( uint8_t *payload, uint16_t length )
+{
+    return this->mqtt->publish( this->topic, payload, length );
+}
+
+int8_t Adafruit_MQTT::connect()
+{
+    if( this->client != nullptr && !this->client->connect( nullptr, 0 ))
+    {
+        return -1;
+    }
+    delay( 50 ); // The connect packet takes some time.
+    if( !SimulatedBroker::isReachable() )
+    {
+        return -1;
+    }
+
+    this->isConnected = true;
+    SimulatedBroker::getStatistics()->connects++;
+    return 0;
+}
+
+bool Adafruit_MQTT::disconnect()
+{
+    if( this->client != nullptr )
+    {
+        this->client->stop();
+    }
+    broker().packets.clear(); // The packets on the way are lost with the connection.
+    this->isConnected = false;
+    return true;
+}
+
+bool Adafruit_MQTT::connected()
+{
+    if( this->isConnected && !SimulatedBroker::isReachable() )
+    {
+        this->isConnected = false; // The broker dropped the connection.
+    }
+    return this->isConnected;
+}
+
+const char *Adafruit_MQTT::connectErrorString( int8_t code )
+{
+    return code == 0 ? "Connected" : "The broker is unreachable";
+}
+
+bool Adafruit_MQTT::subscribe( Adafruit_MQTT_Subscribe *subscription )
+{
+    if( this->subscriptionCount >= MAXSUBSCRIPTIONS )
+    {
+        return false;
+    }
+    this->subscriptions[this->subscriptionCount++] = subscription;
+    return true;
+}
+
+/**
+ * Append an published message with quality of service 0 to the packets on their way to the pot.
+ *
+ * @param packets   The packets on their way to the pot.
+ * @param topic     The topic of the message.
+ * @param message   The message.
+ */
+static void appendPublishPacket( std::string &packets, const std::string &topic, const std::string &message )
+{
+    size_t length = 2 + topic.size() + message.size();
+
+    packets += (char) 0x30; // An publish packet without flags.
+    do
+    {
+        uint8_t encoded = (uint8_t)( length % 128 );
+        length /= 128;
+        packets += (char)( length > 0 ? encoded | 0x80 : encoded );
+    }
+    while( length > 0 );
+    packets += (char)( topic.size() >> 8 );
+    packets += (char)( topic.size() & 0xFF );
+    packets += topic;
+    packets += message;
+}
+
+uint16_t Adafruit_MQTT_Client::readPacket( uint8_t *buffer, uint16_t maxlen, int16_t timeout )
+{
+    std::string &packets = broker().packets;
+    if( !this->connected() )
+    {
+        return 0;
+    }
+
+    std::string topic;
+    std::string message;
+    for( uint8_t i = 0; packets.empty() && i < this->subscriptionCount; i++ )
+    {
+        if( SimulatedBroker::takeMessage( this->subscriptions[i]->topic, &topic, &message ))
+        {
+            appendPublishPacket( packets, topic, message );
+        }
+    }
+
+    uint16_t length = packets.size() < maxlen ? (uint16_t) packets.size() : maxlen;
+    memcpy( buffer, packets.data(), length );
+    packets.erase( 0, length );
+    return length;
+}
+
+bool Adafruit_MQTT::ping( uint8_t attempts )
+{
+    if( !this->connected() )
+    {
+        return false;
+    }
+    SimulatedBroker::getStatistics()->pings++;
+    return true;
+}
+
+bool Adafruit_MQTT::publish( const char *topic, const uint8_t *payload, uint16_t length )
+{
+    return this->connected() && SimulatedBroker::receive( topic, payload, length );
+}
+
+/**
+ * Return the value of an key, an missing key returns an value that converts to 0 and false.
+ *
+ * @param key   The key.
+ * @return JsonVariant - The value.
+ */
+JsonVariant JsonObject::operator[]( const char *key ) const
+{
+    std::map<std::string, std::string>::const_iterator value = this->values.find( key );
+    return value != this->values.end() ? JsonVariant( &value->second ) : JsonVariant();
+}
+
+/**
+ * Parse an flat json object, nested objects and arrays make the parsing fail.
+ *
+ * @param json  The json text.
+ * @return bool - True if the json was valid.
+ */
+bool JsonObject::parse( const char *json )
+{
+    this->values.clear();
+    this->parsed = false;
+
+    const char *position = json;
+    while( *position == ' ' ) position++;
+    if( *position++ != '{' )
+    {
+        return false;
+    }
+
+    while( true )
+    {
+        while( *position == ' ' || *position == ',' ) position++;
+        if( *position == '}' )
+        {
+            this->parsed = true;
+            return true;
+        }
+        if( *position++ != '"' )
+        {
+            return false;
+        }
+
+        const char *keyEnd = strchr( position, '"' );
+        if( keyEnd == nullptr )
+        {
+            return false;
+        }
+        std::string key( position, keyEnd );
+        position = keyEnd + 1;
+
+        while( *position == ' ' ) position++;
+        if( *position++ != ':' )
+        {
+            return false;
+        }
+        while( *position == ' ' ) position++;
+
+        const char *valueEnd;
+        if( *position == '"' )
+        {
+            position++;
+            valueEnd = strchr( position, '"' );
+            if( valueEnd == nullptr )
+            {
+                return false;
+            }
+            this->values[key] = std::string( position, valueEnd );
+            position = valueEnd + 1;
+        }
+        else
+        {
+            valueEnd = position + strcspn( position, ",} " );
+            if( valueEnd == position || *position == '{' || *position == '[' )
+            {
+                return false;
+            }
+            this->values[key] = std::string( position, valueEnd );
+            position = valueEnd;
+        }
+    }
+}
@@ -0,0 +1,115 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ *
+ * This header contains the simulated MQTT broker the host version of the MQTT library
+ * talks to. The simulator counts the messages the pot publishes and can send configuration
+ * messages to the pot. Like an broker with an TLS session cache it lets the pot resume its
+ * session for SIMULATED_SESSION_LIFETIME after the full handshake.
+ */
+#ifndef WATERUP_SIMULATION_SIMULATEDBROKER_H
+#define WATERUP_SIMULATION_SIMULATEDBROKER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+#define SIMULATED_SESSION_LIFETIME 86400000ULL // The time in milliseconds the broker keeps an TLS session after the full handshake.
+
+typedef void (*SimulatedPublishCallback)( const char *topic, const uint8_t *payload, size_t length, void *context );
+
+/**
+ * Data structure that contains the traffic between the pot and the simulated broker.
+ */
+struct SimulatedBrokerStatistics
+{
+    uint32_t connects; // The amount of opened connections.
+    uint32_t fullHandshakes; // The amount of TLS handshakes with an key exchange.
+    uint32_t resumedHandshakes; // The amount of TLS handshakes that resumed an session.
+    uint32_t messages; // The amount of messages published by the pot.
+    uint64_t bytes; // The amount of payload bytes published by the pot.
+    uint32_t pings; // The amount of pings sent by the pot.
+    uint32_t rejected; // The amount of messages published while the broker was unreachable.
+};
+
+/**
+ * This class is the simulated broker.
+ */
+class SimulatedBroker
+{
+public:
+    /**
+     * This function makes the broker reachable or unreachable, like during an outage.
+     *
+     * @param reachable True if the pot can reach the broker.
+     */
+    static void setReachable( bool reachable );
+
+    /**
+     * This function checks if the broker is reachable.
+     *
+     * @return bool - True if the pot can reach the broker.
+     */
+    static bool isReachable();
+
+    /**
+     * This function sets if the broker agrees to an smaller TLS fragment length, like an
+     * broker with an TLS library that doesn't support the extension.
+     *
+     * @param supported True if the broker limits its records to the fragment length.
+     */
+    static void setFragmentLengthSupported( bool supported );
+
+    /**
+     * This function checks if the broker agrees to an smaller TLS fragment length.
+     *
+     * @return bool - True if the broker limits its records to the fragment length.
+     */
+    static bool isFragmentLengthSupported();
+
+    /**
+     * This function sets the function called for every message the pot publishes.
+     *
+     * @param callback  The function to call, nullptr to remove it.
+     * @param context   The pointer passed to the function.
+     */
+    static void onPublish( SimulatedPublishCallback callback, void *context );
+
+    /**
+     * This function queues an message for the pot, it is delivered the next time the pot
+     * processes its packets.
+     *
+     * @param topic     The topic of the message.
+     * @param message   The message.
+     */
+    static void send( const char *topic, const char *message );
+
+    /**
+     * This function is called by the MQTT library when the pot publishes an message.
+     *
+     * @param topic     The topic of the message.
+     * @param payload   The message.
+     * @param length    The length of the message.
+     * @return bool - True if the broker received it.
+     */
+    static bool receive( const char *topic, const uint8_t *payload, size_t length );
+
+    /**
+     * This function takes the next queued message for an subscription, the + and # wildcards
+     * match like they do at an real broker.
+     *
+     * @param filter    The topic of the subscription.
+     * @param topic     The string for the topic of the message.
+     * @param message   The string for the message.
+     * @return bool - False if there is no message for the subscription.
+     */
+    static bool takeMessage( const char *filter, std::string *topic, std::string *message );
+
+    /**
+     * This function returns the traffic between the pot and the broker.
+     *
+     * @return SimulatedBrokerStatistics* - An pointer to the statistics.
+     */
+    static SimulatedBrokerStatistics *getStatistics();
+};
+
+#endif //WATERUP_SIMULATION_SIMULATEDBROKER_H
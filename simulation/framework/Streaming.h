@@ -0,0 +1,28 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ *
+ * Host version of the Streaming library used by the pot simulator.
+ */
+#ifndef WATERUP_SIMULATION_STREAMING_H
+#define WATERUP_SIMULATION_STREAMING_H
+
+#include <Arduino.h>
+
+enum _EndLineCode
+{
+    endl
+};
+
+template<class T> inline Print &operator<<( Print &printer, const T &value )
+{
+    printer.print( value );
+    return printer;
+}
+
+inline Print &operator<<( Print &printer, _EndLineCode endLine )
+{
+    printer.println();
+    return printer;
+}
+
+#endif //WATERUP_SIMULATION_STREAMING_H
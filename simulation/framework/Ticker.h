@@ -0,0 +1,41 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ *
+ * Host version of the ESP8266 Ticker used by the pot simulator, the callbacks run as
+ * events of the simulated clock.
+ */
+#ifndef WATERUP_SIMULATION_TICKER_H
+#define WATERUP_SIMULATION_TICKER_H
+
+#include <Arduino.h>
+
+/**
+ * This class calls an function after an delay or at an interval.
+ */
+class Ticker
+{
+public:
+    Ticker() : eventId( 0 ) {}
+    ~Ticker() { this->detach(); }
+
+    void once_ms( uint32_t milliseconds, void (*callback)() );
+    template<class A> void once_ms( uint32_t milliseconds, void (*callback)( A ), A argument )
+    {
+        this->schedule( milliseconds, false, (void (*)( void* )) callback, (void*) argument );
+    }
+    void attach_ms( uint32_t milliseconds, void (*callback)() );
+    void detach();
+    bool active();
+
+private:
+    uint32_t eventId; // The id of the pending clock event, 0 when there is none.
+    uint32_t interval; // The interval in milliseconds of an periodic ticker.
+    bool periodic; // Boolean to check if the ticker repeats.
+    void (*callback)( void* ); // The function to call.
+    void *argument; // The argument passed to the function.
+
+    void schedule( uint32_t milliseconds, bool periodic, void (*callback)( void* ), void *argument );
+    static void fire( void *ticker );
+};
+
+#endif //WATERUP_SIMULATION_TICKER_H
@@ -0,0 +1,23 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ *
+ * Host version of the WiFiManager library used by the pot simulator, the simulated pot
+ * always has valid wifi settings.
+ */
+#ifndef WATERUP_SIMULATION_WIFIMANAGER_H
+#define WATERUP_SIMULATION_WIFIMANAGER_H
+
+#include <ESP8266WiFi.h>
+
+/**
+ * This class connects to the wireless network.
+ */
+class WiFiManager
+{
+public:
+    void setConfigPortalTimeout( unsigned long seconds ) {}
+    bool autoConnect() { return true; }
+    bool autoConnect( const char *accessPointName ) { return true; }
+};
+
+#endif //WATERUP_SIMULATION_WIFIMANAGER_H
@@ -0,0 +1,309 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ */
+#include "PotPhysics.h"
+#include <math.h>
+#include <string.h>
+
+/**
+ * Create an model with the default parameters, an 16 liter reservoir and 3 liters of potting
+ * soil with an houseplant that drinks about half an liter on an sunny day.
+ */
+PotPhysics::PotPhysics()
+{
+    PotPhysicsParameters defaults = {
+            16, 13, 12, 17, PHYSICS_NO_PIN, // The pins of the mains powered pot.
+            40000, 400, 0, 1.0, 450, 15, 0.01, // The reservoir and sonar.
+            20, 10, 450, // The pump and flow meter.
+            3000, 0.50, 0.35, 0.08, 0.25, 300, 2.0, 35, 0.15, 8, 8 // The soil and plant.
+    };
+    this->parameters = defaults;
+    this->reset();
+}
+
+/**
+ * Return the parameters so they can be changed before the simulation starts.
+ *
+ * @return PotPhysicsParameters* - An pointer to the parameters.
+ */
+PotPhysicsParameters *PotPhysics::getParameters()
+{
+    return &this->parameters;
+}
+
+/**
+ * Start the model with the parameters.
+ */
+void PotPhysics::reset()
+{
+    memset( &this->totals, 0, sizeof( this->totals ));
+    this->lastUpdate = SimulatedBoard::now();
+    this->reservoirVolume = this->parameters.reservoirArea * this->parameters.reservoirHeight * this->parameters.initialReservoirLevel / 1000;
+    this->surfaceWater = 0;
+    this->soilWater = this->parameters.soilVolume * this->parameters.initialWaterContent;
+    this->pumpOn = false;
+    this->triggerHigh = false;
+    this->meteredVolume = 0;
+    this->flowEventId = 0;
+}
+
+/**
+ * Integrate the model until the current simulated time. The pump and sensors call this
+ * before they change or read the model, so the steps end exactly at their events.
+ */
+void PotPhysics::update()
+{
+    uint64_t now = SimulatedBoard::now();
+    while( this->lastUpdate < now )
+    {
+        uint64_t stepTime = now - this->lastUpdate < PHYSICS_MAX_STEP ? now - this->lastUpdate : PHYSICS_MAX_STEP;
+        double hour = fmod( this->parameters.startHour + this->lastUpdate / 3600e6, 24 );
+        this->step( stepTime / 1e6, hour );
+        this->lastUpdate += stepTime;
+    }
+}
+
+/**
+ * Fill the reservoir to the top.
+ */
+void PotPhysics::refill()
+{
+    this->update();
+    double capacity = this->parameters.reservoirArea * this->parameters.reservoirHeight / 1000;
+    this->totals.refilledVolume += capacity - this->reservoirVolume;
+    this->totals.refills++;
+    this->reservoirVolume = capacity;
+}
+
+/**
+ * Return the water content of the soil as the sensor would report it.
+ *
+ * @return double - The percentage of the saturated water content, 0-100.
+ */
+double PotPhysics::getMoisture()
+{
+    return 100 * this->soilWater / ( this->parameters.soilVolume * this->parameters.saturation );
+}
+
+/**
+ * Return the fill level of the reservoir.
+ *
+ * @return double - The percentage of water in the reservoir, 0-100.
+ */
+double PotPhysics::getReservoirLevel()
+{
+    return 100 * this->reservoirVolume * 1000 / ( this->parameters.reservoirArea * this->parameters.reservoirHeight );
+}
+
+/**
+ * Check if the pump is switched on.
+ *
+ * @return bool - True if the pump is on.
+ */
+bool PotPhysics::isPumpOn()
+{
+    return this->pumpOn;
+}
+
+/**
+ * Return what happened in the model.
+ *
+ * @return PotPhysicsTotals* - An pointer to the totals.
+ */
+PotPhysicsTotals *PotPhysics::getTotals()
+{
+    return &this->totals;
+}
+
+/**
+ * Switch the pump or trigger the sonar when the firmware writes their pins. The sonar starts
+ * its echo on the falling edge of the trigger pulse like the HC-SR04 does. While the pump
+ * runs the flow meter pulses are scheduled.
+ *
+ * @param pin   The pin that was written.
+ * @param level The new level of the pin.
+ */
+void PotPhysics::pinWritten( uint8_t pin, uint8_t level )
+{
+    if( pin == this->parameters.pumpPin && ( level == 1 ) != this->pumpOn )
+    {
+        this->update();
+        this->pumpOn = level == 1;
+        if( this->pumpOn )
+        {
+            this->totals.pumpStarts++;
+        }
+
+        if( this->parameters.flowMeterPin != PHYSICS_NO_PIN )
+        {
+            SimulatedBoard::cancelEvent( this->flowEventId );
+            this->flowEventId = 0;
+            this->meteredVolume = this->totals.pumpedVolume;
+            if( this->pumpOn )
+            {
+                this->flowEventId = SimulatedBoard::addEvent( SimulatedBoard::now() + (uint64_t)( 1e9 / ( this->parameters.pumpFlow * this->parameters.flowMeterPulses )), &PotPhysics::pulseFlowMeter, this );
+            }
+        }
+    }
+    else if( pin == this->parameters.sonarTriggerPin )
+    {
+        if( this->triggerHigh && level == 0 )
+        {
+            this->startEcho();
+        }
+        this->triggerHigh = level == 1;
+    }
+}
+
+/**
+ * Read the soil moisture sensor, its value rises with the water content of the soil.
+ *
+ * @param pin   The pin that is read.
+ * @return int - The value of the analog to digital converter, 0-1023.
+ */
+int PotPhysics::readAnalog( uint8_t pin )
+{
+    if( pin != this->parameters.moisturePin )
+    {
+        return 0;
+    }
+
+    this->update();
+    this->totals.moistureReadings++;
+    double value = this->getMoisture() * 10.23 + this->noise( this->parameters.moistureNoise );
+    return value < 0 ? 0 : value > 1023 ? 1023 : (int) value;
+}
+
+/**
+ * Integrate the model over an step. The pump puts water on the soil surface from where it
+ * soaks in with an time constant, the plant takes water out depending on the sun and on how
+ * easy it can get it, and water above the field capacity drains away.
+ *
+ * @param seconds   The length of the step.
+ * @param hour      The hour of the day at the start of the step.
+ */
+void PotPhysics::step( double seconds, double hour )
+{
+    PotPhysicsParameters &p = this->parameters;
+    double waterHeight = this->reservoirVolume * 1000 / p.reservoirArea;
+
+    if( this->pumpOn )
+    {
+        this->totals.pumpTime += seconds;
+        double pumped = waterHeight > p.pumpIntakeHeight ? p.pumpFlow * seconds : 0;
+        double available = ( waterHeight - p.pumpIntakeHeight ) * p.reservoirArea / 1000;
+        if( pumped > available )
+        {
+            pumped = available > 0 ? available : 0;
+        }
+        if( pumped == 0 )
+        {
+            this->totals.dryPumpTime += seconds;
+        }
+        this->reservoirVolume -= pumped;
+        this->surfaceWater += pumped;
+        this->totals.pumpedVolume += pumped;
+    }
+
+    double soaked = this->surfaceWater * ( 1 - exp( -seconds / p.infiltrationTime ));
+    this->surfaceWater -= soaked;
+    this->soilWater += soaked;
+
+    double sun = p.nightFactor + ( 1 - p.nightFactor ) * fmax( 0, sin(( hour - 6 ) / 12 * M_PI ));
+    double availability = ( this->soilWater / p.soilVolume - p.wiltingPoint ) / ( p.fieldCapacity - p.wiltingPoint );
+    double consumed = p.evapotranspiration * sun * fmin( 1, fmax( 0, availability )) * seconds / 3600;
+    this->soilWater -= consumed;
+    this->totals.consumedVolume += consumed;
+
+    double excess = this->soilWater - p.fieldCapacity * p.soilVolume;
+    if( excess > 0 )
+    {
+        double drained = excess * ( 1 - exp( -p.drainageRate * seconds / 3600 ));
+        double overflow = this->soilWater - drained - p.saturation * p.soilVolume;
+        drained += overflow > 0 ? overflow : 0;
+        this->soilWater -= drained;
+        this->totals.drainedVolume += drained;
+        this->totals.waterloggedTime += seconds;
+    }
+
+    if( this->soilWater <= p.wiltingPoint * p.soilVolume )
+    {
+        this->totals.dryTime += seconds;
+    }
+    if( waterHeight <= p.pumpIntakeHeight )
+    {
+        this->totals.emptyReservoirTime += seconds;
+    }
+}
+
+/**
+ * Start an sonar echo from the current water height. The echo pin rises after the latency
+ * of the sensor and falls when the sound returned, an lost echo never rises.
+ */
+void PotPhysics::startEcho()
+{
+    this->update();
+    this->totals.sonarTriggers++;
+    if( SimulatedBoard::nextRandom() / 4294967296.0 < this->parameters.echoDropout )
+    {
+        return;
+    }
+
+    double waterHeight = this->reservoirVolume * 1000 / this->parameters.reservoirArea;
+    double distance = this->parameters.sensorOffset + this->parameters.reservoirHeight - waterHeight;
+    double echoTime = 2 * distance / PHYSICS_SOUND_SPEED + this->noise( this->parameters.echoNoise );
+    uint64_t riseTime = SimulatedBoard::now() + (uint64_t) this->parameters.echoLatency;
+
+    SimulatedBoard::addEvent( riseTime, &PotPhysics::raiseEcho, this );
+    SimulatedBoard::addEvent( riseTime + (uint64_t)( echoTime > 1 ? echoTime : 1 ), &PotPhysics::lowerEcho, this );
+}
+
+/**
+ * Return an normally distributed random number with the Box-Muller transform.
+ *
+ * @param deviation The standard deviation.
+ * @return double - The random number.
+ */
+double PotPhysics::noise( double deviation )
+{
+    double u1 = ( SimulatedBoard::nextRandom() + 1.0 ) / 4294967297.0;
+    double u2 = SimulatedBoard::nextRandom() / 4294967296.0;
+    return deviation * sqrt( -2 * log( u1 )) * cos( 2 * M_PI * u2 );
+}
+
+void PotPhysics::raiseEcho( void *physics )
+{
+    SimulatedBoard::setPinLevel( ((PotPhysics*) physics)->parameters.sonarEchoPin, 1 );
+}
+
+void PotPhysics::lowerEcho( void *physics )
+{
+    SimulatedBoard::setPinLevel( ((PotPhysics*) physics)->parameters.sonarEchoPin, 0 );
+}
+
+/**
+ * Give an pulse for every part of an liter the pump moved since the last pulse. The pulses
+ * follow the water that really flowed, so an pump that runs dry doesn't give any. The
+ * firmware can switch the pump off from the pulse, after that the pulses stop.
+ *
+ * @param physics   An pointer to the model.
+ */
+void PotPhysics::pulseFlowMeter( void *physics )
+{
+    PotPhysics *model = (PotPhysics*) physics;
+    double pulseVolume = 1000 / model->parameters.flowMeterPulses;
+
+    model->update();
+    model->flowEventId = 0;
+    while( model->pumpOn && model->totals.pumpedVolume - model->meteredVolume >= pulseVolume )
+    {
+        model->meteredVolume += pulseVolume;
+        SimulatedBoard::setPinLevel( model->parameters.flowMeterPin, 0 );
+        SimulatedBoard::setPinLevel( model->parameters.flowMeterPin, 1 );
+    }
+
+    if( model->pumpOn && model->flowEventId == 0 )
+    {
+        model->flowEventId = SimulatedBoard::addEvent( SimulatedBoard::now() + (uint64_t)( pulseVolume * 1e6 / model->parameters.pumpFlow ), &PotPhysics::pulseFlowMeter, model );
+    }
+}
@@ -0,0 +1,179 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ *
+ * This library contains an simple physical model of the plant pot for the simulator. The
+ * pump moves water from the reservoir onto the soil, the water soaks in, the plant and the
+ * sun take it out again following an day and night rhythm and soil wetter than its field
+ * capacity drains away. The sonar and soil moisture sensor measure the model with noise and
+ * an flow meter in the water line gives an pulse for every bit of water the pump moves.
+ * The model has its own reservoir dimensions so an mismatch with the firmware shows up.
+ */
+#ifndef WATERUP_SIMULATION_POTPHYSICS_H
+#define WATERUP_SIMULATION_POTPHYSICS_H
+
+#include <stdint.h>
+#include <SimulatedBoard.h>
+
+#define PHYSICS_MAX_STEP 60000000 // The longest time in microseconds the model is integrated in one step.
+#define PHYSICS_SOUND_SPEED 0.343 // The speed of sound in millimeters per microsecond.
+#define PHYSICS_NO_PIN 0xFF // The pin of an device the pot doesn't have.
+
+/**
+ * Data structure that contains the parameters of the model.
+ */
+struct PotPhysicsParameters
+{
+    uint8_t pumpPin; // The pin that switches the water pump.
+    uint8_t sonarTriggerPin; // The pin connected to the trigger port of the sonar.
+    uint8_t sonarEchoPin; // The pin connected to the echo port of the sonar.
+    uint8_t moisturePin; // The analog pin connected to the soil moisture sensor.
+    uint8_t flowMeterPin; // The pin connected to the flow meter, PHYSICS_NO_PIN when the pot doesn't have one.
+
+    double reservoirArea; // The area of the reservoir in square millimeters.
+    double reservoirHeight; // The height of the reservoir in millimeters.
+    double sensorOffset; // The distance in millimeters between the sonar and the top of the reservoir.
+    double initialReservoirLevel; // The fill level of the reservoir at the start, 0-1.
+    double echoLatency; // The time in microseconds between the trigger and the rising echo.
+    double echoNoise; // The standard deviation of the echo time in microseconds.
+    double echoDropout; // The chance an echo doesn't return, 0-1.
+
+    double pumpFlow; // The water the pump moves in milliliters per second.
+    double pumpIntakeHeight; // The water height in millimeters below which the pump runs dry.
+    double flowMeterPulses; // The amount of pulses the flow meter gives per liter.
+
+    double soilVolume; // The volume of the soil in milliliters.
+    double saturation; // The water content of saturated soil, 0-1.
+    double fieldCapacity; // The water content the soil holds against gravity, 0-1.
+    double wiltingPoint; // The water content below which the plant can't take up water, 0-1.
+    double initialWaterContent; // The water content at the start, 0-1.
+    double infiltrationTime; // The time constant in seconds of water soaking into the soil.
+    double drainageRate; // The part of the water above field capacity that drains per hour.
+    double evapotranspiration; // The water the plant and sun take out at noon in milliliters per hour.
+    double nightFactor; // The part of the noon evapotranspiration that remains at night, 0-1.
+    double startHour; // The hour of the day the simulation starts at.
+    double moistureNoise; // The standard deviation of the soil moisture sensor in analog units.
+};
+
+/**
+ * Data structure that contains what happened in the model, used to judge an policy.
+ */
+struct PotPhysicsTotals
+{
+    double pumpedVolume; // The water pumped onto the soil in milliliters.
+    double drainedVolume; // The water that drained or overflowed in milliliters.
+    double consumedVolume; // The water taken out by the plant and sun in milliliters.
+    double refilledVolume; // The water added to the reservoir in milliliters.
+    double pumpTime; // The time in seconds the pump ran.
+    double dryPumpTime; // The time in seconds the pump ran without water.
+    double dryTime; // The time in seconds the soil was at the wilting point.
+    double waterloggedTime; // The time in seconds the soil was wetter than its field capacity.
+    double emptyReservoirTime; // The time in seconds the pump couldn't reach the water.
+    uint32_t pumpStarts; // The amount of times the pump was switched on.
+    uint32_t sonarTriggers; // The amount of sonar measurements.
+    uint32_t moistureReadings; // The amount of analog readings of the soil moisture sensor.
+    uint32_t refills; // The amount of times the reservoir was refilled.
+};
+
+/**
+ * This class is the simulated pot connected to the pins of the simulated board.
+ */
+class PotPhysics : public SimulatedDevice
+{
+public:
+    /**
+     * The constructor will create an model with the default parameters.
+     */
+    PotPhysics();
+
+    /**
+     * This function returns the parameters so they can be changed before the simulation starts.
+     *
+     * @return PotPhysicsParameters* - An pointer to the parameters.
+     */
+    PotPhysicsParameters *getParameters();
+
+    /**
+     * This function starts the model with the parameters.
+     */
+    void reset();
+
+    /**
+     * This function integrates the model until the current simulated time.
+     */
+    void update();
+
+    /**
+     * This function fills the reservoir, like the owner does after an warning.
+     */
+    void refill();
+
+    /**
+     * This function returns the water content of the soil as the sensor would report it.
+     *
+     * @return double - The percentage of the saturated water content, 0-100.
+     */
+    double getMoisture();
+
+    /**
+     * This function returns the fill level of the reservoir.
+     *
+     * @return double - The percentage of water in the reservoir, 0-100.
+     */
+    double getReservoirLevel();
+
+    /**
+     * This function checks if the pump is switched on.
+     *
+     * @return bool - True if the pump is on.
+     */
+    bool isPumpOn();
+
+    /**
+     * This function returns what happened in the model.
+     *
+     * @return PotPhysicsTotals* - An pointer to the totals.
+     */
+    PotPhysicsTotals *getTotals();
+
+    void pinWritten( uint8_t pin, uint8_t level ) override;
+    int readAnalog( uint8_t pin ) override;
+
+private:
+    PotPhysicsParameters parameters; // The parameters of the model.
+    PotPhysicsTotals totals; // What happened in the model.
+    uint64_t lastUpdate; // The simulated time in microseconds the model was integrated until.
+    double reservoirVolume; // The water in the reservoir in milliliters.
+    double surfaceWater; // The water on the soil that didn't soak in yet in milliliters.
+    double soilWater; // The water in the soil in milliliters.
+    bool pumpOn; // Boolean to check if the pump is switched on.
+    bool triggerHigh; // Boolean to check if the sonar trigger pin is high.
+    double meteredVolume; // The pumped water in milliliters the flow meter gave pulses for.
+    uint32_t flowEventId; // The id of the next flow meter pulse event, 0 when the pump is off.
+
+    /**
+     * This function integrates the model over an step.
+     *
+     * @param seconds   The length of the step.
+     * @param hour      The hour of the day at the start of the step.
+     */
+    void step( double seconds, double hour );
+
+    /**
+     * This function starts an sonar echo from the current water height.
+     */
+    void startEcho();
+
+    /**
+     * This function returns an normally distributed random number.
+     *
+     * @param deviation The standard deviation.
+     * @return double - The random number.
+     */
+    double noise( double deviation );
+
+    static void raiseEcho( void *physics ); // Raises the echo pin.
+    static void lowerEcho( void *physics ); // Lowers the echo pin.
+    static void pulseFlowMeter( void *physics ); // Gives the flow meter pulses of the water pumped since the last pulse.
+};
+
+#endif //WATERUP_SIMULATION_POTPHYSICS_H
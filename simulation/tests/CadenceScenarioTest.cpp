@@ -0,0 +1,53 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ *
+ * This test runs the firmware for an week against the default pot, which the firmware keeps
+ * watered. The moisture stays around the threshold and the reservoir drains slowly, so the
+ * measurement cadence has to back off from the floor interval. An pot that measures at the
+ * floor next to its threshold publishes more statistics than one that measures every minute.
+ */
+#include <stdio.h>
+#include <Arduino.h>
+#include "../PotScenario.h"
+
+#define TEST_DAYS 7 // The simulated days.
+#define TEST_FIXED_INTERVAL 60 // The measurement interval in seconds of an pot without cadence.
+#define TEST_BACKOFF_FACTOR 4 // The pot has to publish at least this many times less than at the fixed interval.
+
+static unsigned failures = 0; // The amount of checks that failed.
+
+/**
+ * Count an check and print it when it failed.
+ *
+ * @param passed    The result of the check.
+ * @param name      The description of the check.
+ */
+static void check( bool passed, const char *name )
+{
+    if( !passed )
+    {
+        printf( "FAILED: %s\n", name );
+        failures++;
+    }
+}
+
+int main()
+{
+    PotScenario scenario;
+    PotScenarioResult result;
+    uint32_t fixedStatistics = TEST_DAYS * 86400 / TEST_FIXED_INTERVAL;
+
+    initScenario( &scenario );
+    scenario.days = TEST_DAYS;
+    Serial.setEnabled( false );
+    runScenario( &scenario, &result, nullptr, 0 );
+
+    check( result.totals.pumpStarts > 0, "the plant is watered" );
+    check( result.totals.dryTime == 0, "the soil doesn't dry out" );
+    check( result.statistics > 0, "the pot publishes statistics" );
+    check( result.statistics * TEST_BACKOFF_FACTOR <= fixedStatistics, "the cadence backs off" );
+
+    printf( "%u statistics in %u days, %u at an fixed interval of %u s / %u failures\n",
+            result.statistics, TEST_DAYS, fixedStatistics, TEST_FIXED_INTERVAL, failures );
+    return failures == 0 ? 0 : 1;
+}
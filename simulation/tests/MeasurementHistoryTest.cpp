@@ -0,0 +1,140 @@
+/**
+ * Licence: GPLv3 - General Public Licence version 3
+ *
+ * This test appends about 5 days of minute measurements to an measurement history, more than
+ * fits in its buffer, and reads them back. Every record that is still in the history has to
+ * come back exactly as it was appended: after the oldest blocks were dropped, from the middle
+ * of the history and through the aggregates. The measurements drift like an real pot with
+ * jitter on the interval, outages, pump events and jumps in the soil moisture after watering,
+ * so both the compact and the full records are written.
+ */
+#include <stdio.h>
+#include <vector>
+#include "MeasurementHistory.h"
+
+#define TEST_MEASUREMENTS 8000 // The amount of measurements appended to the history.
+#define TEST_INTERVAL 60 // The measurement interval in seconds.
+#define TEST_OUTAGE 3600 // The time in seconds the pot sometimes doesn't measure.
+#define TEST_WINDOW 100 // The amount of measurements in the aggregate and seek window.
+
+static uint32_t randomState = 1; // The state of the random generator, the test is the same on every host.
+static unsigned failures = 0; // The amount of checks that failed.
+
+/**
+ * Return an pseudo random number, rand() differs between the c libraries.
+ *
+ * @param range The amount of numbers to choose from.
+ * @return uint32_t - An number from 0 to range - 1.
+ */
+static uint32_t randomNumber( uint32_t range )
+{
+    randomState = randomState * 1103515245UL + 12345UL;
+    return ( randomState >> 16 ) % range;
+}
+
+/**
+ * Count an check and print it when it failed.
+ *
+ * @param passed    The result of the check.
+ * @param name      The description of the check.
+ */
+static void check( bool passed, const char *name )
+{
+    if( !passed )
+    {
+        printf( "FAILED: %s\n", name );
+        failures++;
+    }
+}
+
+/**
+ * Compare an record read from the history with the measurement that was appended.
+ */
+static bool isSameRecord( const HistoryRecord &expected, const HistoryRecord &actual )
+{
+    return expected.timestamp == actual.timestamp && expected.moisture == actual.moisture &&
+           expected.waterLevel == actual.waterLevel && expected.events == actual.events;
+}
+
+int main()
+{
+    static MeasurementHistory history; // Too large for the stack of some hosts.
+    std::vector<HistoryRecord> appended;
+    uint32_t timestamp = 1500000000;
+    int16_t moisture = 40;
+    int16_t waterLevel = 80;
+
+    for( unsigned i = 0; i < TEST_MEASUREMENTS; i++ )
+    {
+        timestamp += TEST_INTERVAL + ( randomNumber( 10 ) == 0 ? randomNumber( 3 ) - 1 : 0 ) + ( randomNumber( 500 ) == 0 ? TEST_OUTAGE : 0 );
+        moisture += ( int16_t )( randomNumber( 3 ) - 1 );
+        waterLevel -= randomNumber( 20 ) == 0 ? 1 : 0;
+        uint8_t events = 0;
+        if( randomNumber( 200 ) == 0 )
+        {
+            moisture += 30;
+            events = HISTORY_EVENT_PUMP_STARTED | HISTORY_EVENT_PUMP_STOPPED;
+        }
+        if( waterLevel < 5 )
+        {
+            waterLevel = 100;
+        }
+
+        HistoryRecord record = { timestamp, moisture, waterLevel, events };
+        history.append( record.timestamp, record.moisture, record.waterLevel, record.events );
+        appended.push_back( record );
+    }
+
+    // The oldest blocks are dropped, the records after them have to be complete.
+    HistoryCursor cursor;
+    HistoryRecord record;
+    size_t first = appended.size() - history.getRecordCount();
+    size_t index = first;
+    check( first > 0, "the history dropped the oldest blocks" );
+    check( history.getUsedBytes() <= MEASUREMENT_HISTORY_BLOCKS * MEASUREMENT_HISTORY_BLOCK_SIZE, "the records fit in the buffer" );
+
+    history.startIteration( &cursor );
+    while( history.next( &cursor, &record ))
+    {
+        check( index < appended.size() && isSameRecord( appended[index], record ), "the records round trip" );
+        index++;
+    }
+    check( index == appended.size(), "the iteration reads every record" );
+
+    check( history.getLatest( &record ) && isSameRecord( appended.back(), record ), "the latest record" );
+
+    // Seek into the middle of the history.
+    const HistoryRecord &windowStart = appended[appended.size() - TEST_WINDOW];
+    history.startIterationAt( &cursor, windowStart.timestamp );
+    check( history.next( &cursor, &record ) && isSameRecord( windowStart, record ), "the iteration starts at an timestamp" );
+
+    // The aggregates of the window.
+    HistoryAggregate aggregate;
+    int32_t moistureSum = 0;
+    int16_t minimumMoisture = windowStart.moisture;
+    int16_t maximumWaterLevel = windowStart.waterLevel;
+    uint16_t pumpStarts = 0;
+    for( size_t i = appended.size() - TEST_WINDOW; i < appended.size(); i++ )
+    {
+        moistureSum += appended[i].moisture;
+        minimumMoisture = appended[i].moisture < minimumMoisture ? appended[i].moisture : minimumMoisture;
+        maximumWaterLevel = appended[i].waterLevel > maximumWaterLevel ? appended[i].waterLevel : maximumWaterLevel;
+        pumpStarts += ( appended[i].events & HISTORY_EVENT_PUMP_STARTED ) ? 1 : 0;
+    }
+    history.aggregate( windowStart.timestamp, &aggregate );
+    check( aggregate.count == TEST_WINDOW, "the aggregate counts the window" );
+    check( aggregate.averageMoisture == moistureSum / TEST_WINDOW, "the average moisture" );
+    check( aggregate.minimumMoisture == minimumMoisture, "the minimum moisture" );
+    check( aggregate.maximumWaterLevel == maximumWaterLevel, "the maximum water level" );
+    check( aggregate.pumpStarts == pumpStarts, "the pump starts" );
+
+    printf( "%zu of %u records kept in %u bytes, %.2f days\n", appended.size() - first, TEST_MEASUREMENTS,
+            history.getUsedBytes(), ( appended.back().timestamp - appended[first].timestamp ) / 86400.0 );
+
+    history.clear();
+    history.startIteration( &cursor );
+    check( history.getRecordCount() == 0 && !history.next( &cursor, &record ) && !history.getLatest( &record ), "an cleared history is empty" );
+
+    printf( "%u failures\n", failures );
+    return failures == 0 ? 0 : 1;
+}
@@ -9,6 +9,35 @@
 #include <Communication.h> // This library contains the code for communication between the pot and broker.
 #include <PlantCare.h> // This library contains the code for taking care of the plant.
 #include <LedController.h> // This library contains the code for taking care of the plant.
+#include <TaskScheduler.h> // This library contains the code for running tasks at their deadlines.
+#include <DutyCycle.h> // This library contains the code for sleeping between measurements on battery power.
+#include <SensorSnapshot.h> // This library contains the latest readings shared by all parts of the pot.
+#include <MeasurementHistory.h> // This library contains the compressed history of the pot measurements.
+#include <TelemetryLog.h> // This library contains the flash log of statistics that couldn't be published.
+
+/**
+ * This scheduler instance will run the tasks of the pot at their deadlines and lets the
+ * pot sleep in between.
+ */
+TaskScheduler scheduler;
+
+/**
+ * This snapshot instance will keep the latest sensor readings, the leds, statistics,
+ * warnings and watering all read from it so one measurement serves all of them.
+ */
+SensorSnapshot sensorSnapshot( &scheduler );
+
+/**
+ * This history instance will keep an compressed history of the measurements in ram, several
+ * days of minute measurements fit in about 4 KB.
+ */
+MeasurementHistory measurementHistory;
+
+/**
+ * This telemetry log instance will keep the statistics that couldn't be published on the
+ * flash, they get published when the connection to the broker returns.
+ */
+TelemetryLog telemetryLog;
 
 /**
  * This configuration instance will handle receiving and persisting pot configuration
@@ -27,7 +56,7 @@ Communication communication( &configuration );
  * associated with the plant pot, like giving water, publishing statistics and listening
  * for net pot configuration.
  */
-PlantCare plantCare( &communication );
+PlantCare plantCare( &communication, &scheduler, &sensorSnapshot, &measurementHistory, &telemetryLog );
 
 /**
  * This led controller instance will control the led lightning in the water reservoir. It
@@ -35,25 +64,50 @@ PlantCare plantCare( &communication );
  */
 LedController ledController;
 
+#ifdef POT_DUTY_CYCLE
+/**
+ * This duty cycle instance will keep the pot state in RTC memory while the pot is in deep
+ * sleep. It is only used when the pot runs on batteries.
+ */
+DutyCycle dutyCycle;
+#endif
+
+/**
+ * This task will update the led color based on the water level in the sensor snapshot.
+ *
+ * @param context   Not used, the led controller and sensor snapshot instances are global.
+ */
+void refreshLeds( void *context )
+{
+    ledController.setColorBasedOnWaterLevel( sensorSnapshot.getValue( SENSOR_WATER_LEVEL ));
+}
+
 /**
  * This is the standard entry point of the code it will initiate the libraries and start
  * serial communication for debugging purposes. It will get executed after every poser circle.
+ * In duty cycle mode it will also get executed after every wake up from deep sleep.
  */
 void setup()
 {
+#ifdef POT_DUTY_CYCLE
+    dutyCycle.restore();
+    plantCare.runDutyCycle( &dutyCycle ); // Takes care of the plant and goes back to deep sleep.
+#endif
     communication.setup();
+    telemetryLog.setup();
+    plantCare.setup();
     ledController.setup();
+    scheduler.addPeriodicTask( &refreshLeds, nullptr, LED_REFRESH_INTERVAL, 0 );
 }
 
 /**
  * This is the standard process of the plant pot. It iterate over this function as long as
  * the pot is powered on. This function will call the takeCareOfPlant() function which will
- * start the pot's main program.
+ * run the pot's tasks that are due, after that the pot sleeps until the next deadline.
  */
 void loop()
 {
-    int waterLevel = plantCare.checkWaterReservoir();
-    ledController.setColorBasedOnWaterLevel(waterLevel);
     plantCare.takeCareOfPlant();
+    scheduler.sleepUntilNextTask( SCHEDULER_MAX_IDLE_TIME );
 }
 